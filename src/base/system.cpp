@@ -10,6 +10,7 @@
 #include <cstdio>
 #include <cstring>
 #include <iterator> // std::size
+#include <limits>
 #include <string_view>
 
 #include "lock.h"
@@ -25,6 +26,7 @@
 #if defined(CONF_FAMILY_UNIX)
 #include <csignal>
 #include <locale>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/utsname.h>
@@ -161,6 +163,19 @@ void net_buffer_init(NETSOCKET_BUFFER *buffer);
 void net_buffer_reinit(NETSOCKET_BUFFER *buffer);
 void net_buffer_simple(NETSOCKET_BUFFER *buffer, char **buf, int *size);
 
+#ifdef CONF_PLATFORM_LINUX
+/* datagrams queued by net_udp_send until net_udp_flush */
+typedef struct
+{
+	int size;
+	int socks[VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovecs[VLEN];
+	char bufs[VLEN][PACKETSIZE];
+	struct sockaddr_storage sockaddrs[VLEN];
+} NETSOCKET_SEND_QUEUE;
+#endif
+
 struct NETSOCKET_INTERNAL
 {
 	int type;
@@ -169,6 +184,9 @@ struct NETSOCKET_INTERNAL
 	int web_ipv4sock;
 
 	NETSOCKET_BUFFER buffer;
+#ifdef CONF_PLATFORM_LINUX
+	NETSOCKET_SEND_QUEUE *send_queue;
+#endif
 };
 static NETSOCKET_INTERNAL invalid_socket = {NETTYPE_INVALID, -1, -1, -1};
 
@@ -463,6 +481,45 @@ int io_sync(IOHANDLE io)
 #endif
 }
 
+void *io_mmap(IOHANDLE io, unsigned *size)
+{
+	*size = 0;
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno((FILE *)io));
+	LARGE_INTEGER length;
+	if(!GetFileSizeEx(file, &length) || length.QuadPart <= 0 || length.QuadPart > std::numeric_limits<unsigned>::max())
+		return nullptr;
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if(mapping == NULL)
+		return nullptr;
+	// the view keeps the mapping object alive
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if(data == NULL)
+		return nullptr;
+	*size = length.QuadPart;
+#else
+	struct stat sb;
+	if(fstat(fileno((FILE *)io), &sb) != 0 || sb.st_size <= 0 || (uint64_t)sb.st_size > std::numeric_limits<unsigned>::max())
+		return nullptr;
+	const size_t length = sb.st_size;
+	void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno((FILE *)io), 0);
+	if(data == MAP_FAILED)
+		return nullptr;
+	*size = length;
+#endif
+	return data;
+}
+
+void io_munmap(void *data, unsigned size)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 #define ASYNC_BUFSIZE (8 * 1024)
 #define ASYNC_LOCAL_BUFSIZE (64 * 1024)
 
@@ -473,6 +530,9 @@ struct ASYNCIO
 	SEMAPHORE sphore;
 	void *thread;
 
+	ASYNCIO_WRITE_FUNC write_func;
+	void *write_user;
+
 	unsigned char *buffer;
 	unsigned int buffer_size;
 	unsigned int read_pos;
@@ -548,6 +608,10 @@ static void aio_thread(void *user)
 			{
 				if(aio->finish == ASYNCIO_CLOSE)
 				{
+					if(aio->write_func && aio->write_func(aio->io, nullptr, 0, 1, aio->write_user))
+					{
+						aio->error = 1;
+					}
 					io_close(aio->io);
 				}
 				aio_handle_free_and_unlock(aio);
@@ -581,9 +645,20 @@ static void aio_thread(void *user)
 		aio->read_pos = (aio->read_pos + buffers.len1 + buffers.len2) % aio->buffer_size;
 		aio->lock.unlock();
 
-		io_write(aio->io, local_buffer, local_buffer_len);
+		if(aio->write_func)
+		{
+			result_io_error = aio->write_func(aio->io, local_buffer, local_buffer_len, 0, aio->write_user);
+		}
+		else
+		{
+			io_write(aio->io, local_buffer, local_buffer_len);
+			result_io_error = 0;
+		}
 		io_flush(aio->io);
-		result_io_error = io_error(aio->io);
+		if(!result_io_error)
+		{
+			result_io_error = io_error(aio->io);
+		}
 
 		aio->lock.lock();
 		aio->error = result_io_error;
@@ -591,6 +666,11 @@ static void aio_thread(void *user)
 }
 
 ASYNCIO *aio_new(IOHANDLE io)
+{
+	return aio_new_with_write_func(io, nullptr, nullptr);
+}
+
+ASYNCIO *aio_new_with_write_func(IOHANDLE io, ASYNCIO_WRITE_FUNC write_func, void *user)
 {
 	ASYNCIO *aio = new ASYNCIO;
 	if(!aio)
@@ -598,6 +678,8 @@ ASYNCIO *aio_new(IOHANDLE io)
 		return 0;
 	}
 	aio->io = io;
+	aio->write_func = write_func;
+	aio->write_user = user;
 	sphore_init(&aio->sphore);
 	aio->thread = 0;
 
@@ -1447,6 +1529,9 @@ static int priv_net_close_all_sockets(NETSOCKET sock)
 		sock->type &= ~NETTYPE_IPV6;
 	}
 
+#if defined(CONF_PLATFORM_LINUX)
+	free(sock->send_queue);
+#endif
 	free(sock);
 	return 0;
 }
@@ -1625,6 +1710,26 @@ NETSOCKET net_udp_create(NETADDR bindaddr)
 	return sock;
 }
 
+static int priv_net_udp_sendto(NETSOCKET sock, int socket, const void *data, int size, const struct sockaddr *addr, socklen_t addrlen)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(queue && size <= PACKETSIZE && addrlen <= (socklen_t)sizeof(queue->sockaddrs[0]))
+	{
+		if(queue->size == VLEN)
+			net_udp_flush(sock);
+		int i = queue->size++;
+		queue->socks[i] = socket;
+		mem_copy(queue->bufs[i], data, size);
+		mem_copy(&queue->sockaddrs[i], addr, addrlen);
+		queue->iovecs[i].iov_len = size;
+		queue->msgs[i].msg_hdr.msg_namelen = addrlen;
+		return size;
+	}
+#endif
+	return sendto(socket, (const char *)data, size, 0, addr, addrlen);
+}
+
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
 {
 	int d = -1;
@@ -1644,7 +1749,7 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 			else
 				netaddr_to_sockaddr_in(addr, &sa);
 
-			d = sendto((int)sock->ipv4sock, (const char *)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			d = priv_net_udp_sendto(sock, sock->ipv4sock, data, size, (struct sockaddr *)&sa, sizeof(sa));
 		}
 		else
 			dbg_msg("net", "can't send ipv4 traffic to this socket");
@@ -1682,7 +1787,7 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 			else
 				netaddr_to_sockaddr_in6(addr, &sa);
 
-			d = sendto((int)sock->ipv6sock, (const char *)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			d = priv_net_udp_sendto(sock, sock->ipv6sock, data, size, (struct sockaddr *)&sa, sizeof(sa));
 		}
 		else
 			dbg_msg("net", "can't send ipv6 traffic to this socket");
@@ -1708,6 +1813,65 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 	return d;
 }
 
+int net_udp_set_send_batching(NETSOCKET sock, int enabled)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(!enabled)
+	{
+		net_udp_flush(sock);
+		free(sock->send_queue);
+		sock->send_queue = nullptr;
+		return 0;
+	}
+	if(sock->send_queue)
+		return 0;
+
+	NETSOCKET_SEND_QUEUE *queue = (NETSOCKET_SEND_QUEUE *)malloc(sizeof(*queue));
+	mem_zero(queue, sizeof(*queue));
+	for(int i = 0; i < VLEN; i++)
+	{
+		queue->iovecs[i].iov_base = queue->bufs[i];
+		queue->msgs[i].msg_hdr.msg_iov = &queue->iovecs[i];
+		queue->msgs[i].msg_hdr.msg_iovlen = 1;
+		queue->msgs[i].msg_hdr.msg_name = &queue->sockaddrs[i];
+	}
+	sock->send_queue = queue;
+	return 0;
+#else
+	return enabled ? -1 : 0;
+#endif
+}
+
+int net_udp_flush(NETSOCKET sock)
+{
+	int failed = 0;
+#if defined(CONF_PLATFORM_LINUX)
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(!queue)
+		return 0;
+
+	int start = 0;
+	while(start < queue->size)
+	{
+		/* the ipv4 and ipv6 datagrams are sent on different sockets */
+		int end = start + 1;
+		while(end < queue->size && queue->socks[end] == queue->socks[start])
+			end++;
+
+		int sent = sendmmsg(queue->socks[start], &queue->msgs[start], end - start, 0);
+		if(sent <= 0)
+		{
+			/* drop the datagram like a failing sendto would */
+			failed++;
+			sent = 1;
+		}
+		start += sent;
+	}
+	queue->size = 0;
+#endif
+	return failed;
+}
+
 void net_buffer_init(NETSOCKET_BUFFER *buffer)
 {
 #if defined(CONF_PLATFORM_LINUX)
@@ -1830,6 +1994,7 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, unsigned char **data)
 
 int net_udp_close(NETSOCKET sock)
 {
+	net_udp_flush(sock);
 	return priv_net_close_all_sockets(sock);
 }
 
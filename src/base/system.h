@@ -395,6 +395,34 @@ int io_flush(IOHANDLE io);
  */
 int io_sync(IOHANDLE io);
 
+/**
+ * Maps the whole file into memory.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to the file.
+ * @param size Pointer to an unsigned that receives the size of the file.
+ *
+ * @return Pointer to the contents of the file or @c nullptr if the file
+ *         could not be mapped, e.g. because it is empty or too large.
+ *
+ * @remark The mapping is copy-on-write, changes to it are not written to
+ *         the file.
+ * @remark The mapping stays valid after the file is closed, it must be
+ *         released with @link io_munmap @endlink.
+ */
+void *io_mmap(IOHANDLE io, unsigned *size);
+
+/**
+ * Releases a mapping created by @link io_mmap @endlink.
+ *
+ * @ingroup File-IO
+ *
+ * @param data Pointer returned by @link io_mmap @endlink.
+ * @param size Size returned by @link io_mmap @endlink.
+ */
+void io_munmap(void *data, unsigned size);
+
 /**
  * Checks whether an error occurred during I/O with the file.
  *
@@ -444,6 +472,38 @@ typedef struct ASYNCIO ASYNCIO;
  */
 ASYNCIO *aio_new(IOHANDLE io);
 
+/**
+ * Writes the data queued on an ASYNCIO to its file, e.g. after
+ * compressing it. Called on the thread of the ASYNCIO.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to the file.
+ * @param buffer Pointer to the queued data.
+ * @param size Number of bytes queued.
+ * @param finish 1 for the last call before the file is closed, with
+ * no data.
+ * @param user The pointer passed to @link aio_new_with_write_func @endlink.
+ *
+ * @return 0 on success, nonzero on error.
+ */
+typedef int (*ASYNCIO_WRITE_FUNC)(IOHANDLE io, const void *buffer, unsigned size, int finish, void *user);
+
+/**
+ * Wraps a @link IOHANDLE @endlink for asynchronous writing, passing
+ * the data through a custom write function.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to the file.
+ * @param write_func Function that writes the data to the file.
+ * @param user Pointer passed to the write function, must stay valid
+ * until the writing finished.
+ *
+ * @return The handle for asynchronous writing.
+ */
+ASYNCIO *aio_new_with_write_func(IOHANDLE io, ASYNCIO_WRITE_FUNC write_func, void *user);
+
 /**
  * Locks the ASYNCIO structure so it can't be written into by
  * other threads.
@@ -932,6 +992,35 @@ NETSOCKET net_udp_create(NETADDR bindaddr);
  */
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size);
 
+/**
+ * Makes @link net_udp_send @endlink queue the packets of an UDP socket
+ * until @link net_udp_flush @endlink is called, which sends them with
+ * as few system calls as possible.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ * @param enabled Whether to queue the packets. Disabling it sends the
+ * queued packets.
+ *
+ * @return 0 on success. -1 if batching is not supported on this
+ * platform, the packets are sent immediately then.
+ *
+ * @remark Only implemented on Linux.
+ */
+int net_udp_set_send_batching(NETSOCKET sock, int enabled);
+
+/**
+ * Sends the packets queued on an UDP socket.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ *
+ * @return The number of packets that could not be sent.
+ */
+int net_udp_flush(NETSOCKET sock);
+
 /*
 	Function: net_udp_recv
 		Receives a packet over an UDP socket.
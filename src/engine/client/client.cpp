@@ -359,6 +359,7 @@ void CClient::OnEnterGame(bool Dummy)
 	m_aapSnapshots[Dummy][SNAP_CURRENT] = 0;
 	m_aapSnapshots[Dummy][SNAP_PREV] = 0;
 	m_aSnapshotStorage[Dummy].PurgeAll();
+	InvalidateSnapItemIndices(Dummy);
 	// Also make gameclient aware that snapshots have been purged
 	GameClient()->InvalidateSnapshot();
 	m_aReceivedSnapshots[Dummy] = 0;
@@ -578,6 +579,7 @@ void CClient::DisconnectWithReason(const char *pReason)
 	// clear snapshots
 	m_aapSnapshots[0][SNAP_CURRENT] = 0;
 	m_aapSnapshots[0][SNAP_PREV] = 0;
+	InvalidateSnapItemIndices(0);
 	m_aReceivedSnapshots[0] = 0;
 }
 
@@ -644,6 +646,7 @@ void CClient::DummyDisconnect(const char *pReason)
 
 	m_aapSnapshots[1][SNAP_CURRENT] = 0;
 	m_aapSnapshots[1][SNAP_PREV] = 0;
+	InvalidateSnapItemIndices(1);
 	m_aReceivedSnapshots[1] = 0;
 	m_DummyConnected = false;
 	GameClient()->OnDummyDisconnect();
@@ -682,12 +685,30 @@ void CClient::LoadDebugFont()
 
 // ---
 
+const CSnapshotItemIndex *CClient::SnapItemIndex(int SnapID) const
+{
+	const CSnapshotStorage::CHolder *pHolder = m_aapSnapshots[g_Config.m_ClDummy][SnapID];
+	CSnapshotItemIndex *pIndex = &m_aaSnapshotItemIndices[g_Config.m_ClDummy][SnapID];
+	if(pIndex->Snapshot() != pHolder->m_pAltSnap || m_aaSnapshotItemIndexTicks[g_Config.m_ClDummy][SnapID] != pHolder->m_Tick)
+	{
+		pIndex->Build(pHolder->m_pAltSnap);
+		m_aaSnapshotItemIndexTicks[g_Config.m_ClDummy][SnapID] = pHolder->m_Tick;
+	}
+	return pIndex;
+}
+
+void CClient::InvalidateSnapItemIndices(int Dummy)
+{
+	for(auto &Index : m_aaSnapshotItemIndices[Dummy])
+		Index.Clear();
+}
+
 void *CClient::SnapGetItem(int SnapID, int Index, CSnapItem *pItem) const
 {
 	dbg_assert(SnapID >= 0 && SnapID < NUM_SNAPSHOT_TYPES, "invalid SnapID");
 	const CSnapshotItem *pSnapshotItem = m_aapSnapshots[g_Config.m_ClDummy][SnapID]->m_pAltSnap->GetItem(Index);
 	pItem->m_DataSize = m_aapSnapshots[g_Config.m_ClDummy][SnapID]->m_pAltSnap->GetItemSize(Index);
-	pItem->m_Type = m_aapSnapshots[g_Config.m_ClDummy][SnapID]->m_pAltSnap->GetItemType(Index);
+	pItem->m_Type = SnapItemIndex(SnapID)->GetItemType(Index);
 	pItem->m_ID = pSnapshotItem->ID();
 	return (void *)pSnapshotItem->Data();
 }
@@ -703,7 +724,7 @@ const void *CClient::SnapFindItem(int SnapID, int Type, int ID) const
 	if(!m_aapSnapshots[g_Config.m_ClDummy][SnapID])
 		return 0x0;
 
-	return m_aapSnapshots[g_Config.m_ClDummy][SnapID]->m_pAltSnap->FindItem(Type, ID);
+	return SnapItemIndex(SnapID)->FindItem(Type, ID);
 }
 
 int CClient::SnapNumItems(int SnapID) const
@@ -794,7 +815,7 @@ void CClient::DebugRender()
 		{
 			if(m_SnapshotDelta.GetDataRate(i) && m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT])
 			{
-				int Type = m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT]->m_pAltSnap->GetExternalItemType(i);
+				int Type = SnapItemIndex(IClient::SNAP_CURRENT)->GetExternalItemType(i);
 				if(Type == UUID_INVALID)
 				{
 					str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", i, "Unknown UUID", m_SnapshotDelta.GetDataRate(i) / 8, m_SnapshotDelta.GetDataUpdates(i),
@@ -2290,6 +2311,8 @@ void CClient::OnDemoPlayerSnapshot(void *pData, int Size)
 	std::swap(m_aapSnapshots[g_Config.m_ClDummy][SNAP_PREV], m_aapSnapshots[g_Config.m_ClDummy][SNAP_CURRENT]);
 	mem_copy(m_aapSnapshots[g_Config.m_ClDummy][SNAP_CURRENT]->m_pSnap, pData, Size);
 	mem_copy(m_aapSnapshots[g_Config.m_ClDummy][SNAP_CURRENT]->m_pAltSnap, pAltSnapBuffer, AltSnapSize);
+	// the demo holders are reused with new contents
+	InvalidateSnapItemIndices(g_Config.m_ClDummy);
 
 	GameClient()->OnNewSnapshot();
 }
@@ -3504,6 +3527,8 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 
 	// try to start playback
 	m_DemoPlayer.SetListener(this);
+	m_DemoPlayer.SetPrefetchTicks(g_Config.m_ClDemoPrefetch * SERVER_TICK_SPEED);
+	m_DemoPlayer.SetKeyFrameIndexFiles(g_Config.m_ClDemoIndexCache);
 	if(m_DemoPlayer.Load(Storage(), m_pConsole, pFilename, StorageType))
 		return m_DemoPlayer.ErrorMessage();
 
@@ -3548,6 +3573,7 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 		m_aapSnapshots[g_Config.m_ClDummy][SnapshotType]->m_AltSnapSize = 0;
 		m_aapSnapshots[g_Config.m_ClDummy][SnapshotType]->m_Tick = -1;
 	}
+	InvalidateSnapItemIndices(g_Config.m_ClDummy);
 
 	// enter demo playback state
 	SetState(IClient::STATE_DEMOPLAYBACK);
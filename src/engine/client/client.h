@@ -185,6 +185,10 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	// the game snapshots are modifiable by the game
 	CSnapshotStorage m_aSnapshotStorage[NUM_DUMMIES];
 	CSnapshotStorage::CHolder *m_aapSnapshots[NUM_DUMMIES][NUM_SNAPSHOT_TYPES];
+	// item indices of the alternative snapshots, rebuilt on first use after
+	// the snapshot holder or its tick changed
+	mutable CSnapshotItemIndex m_aaSnapshotItemIndices[NUM_DUMMIES][NUM_SNAPSHOT_TYPES];
+	mutable int m_aaSnapshotItemIndexTicks[NUM_DUMMIES][NUM_SNAPSHOT_TYPES] = {};
 
 	int m_aReceivedSnapshots[NUM_DUMMIES] = {0, 0};
 	char m_aaSnapshotIncomingData[NUM_DUMMIES][CSnapshot::MAX_SIZE];
@@ -319,6 +323,8 @@ public:
 	// ---
 
 	int GetPredictionTime() override;
+	const CSnapshotItemIndex *SnapItemIndex(int SnapID) const;
+	void InvalidateSnapItemIndices(int Dummy);
 	void *SnapGetItem(int SnapID, int Index, CSnapItem *pItem) const override;
 	int SnapItemSize(int SnapID, int Index) const override;
 	const void *SnapFindItem(int SnapID, int Type, int ID) const override;
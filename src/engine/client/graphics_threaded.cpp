@@ -554,75 +554,20 @@ bool CGraphics_Threaded::UpdateTextTexture(CTextureHandle TextureID, int x, int
 
 bool CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
 {
-	char aCompleteFilename[IO_MAX_PATH_LENGTH];
-	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-	{
-		io_seek(File, 0, IOSEEK_END);
-		unsigned int FileSize = io_tell(File);
-		io_seek(File, 0, IOSEEK_START);
-
-		TImageByteBuffer ByteBuffer;
-		SImageByteBuffer ImageByteBuffer(&ByteBuffer);
-
-		ByteBuffer.resize(FileSize);
-		io_read(File, &ByteBuffer.front(), FileSize);
-
-		io_close(File);
-
-		uint8_t *pImgBuffer = NULL;
-		EImageFormat ImageFormat;
-		int PngliteIncompatible;
-		if(::LoadPNG(ImageByteBuffer, pFilename, PngliteIncompatible, pImg->m_Width, pImg->m_Height, pImgBuffer, ImageFormat))
-		{
-			if(ImageFormat == IMAGE_FORMAT_RGB)
-				pImg->m_Format = CImageInfo::FORMAT_RGB;
-			else if(ImageFormat == IMAGE_FORMAT_RGBA)
-				pImg->m_Format = CImageInfo::FORMAT_RGBA;
-			else
-			{
-				free(pImgBuffer);
-				log_error("game/png", "image had unsupported image format. filename='%s' format='%d'", pFilename, (int)ImageFormat);
-				return false;
-			}
-			pImg->m_pData = pImgBuffer;
-
-			if(m_WarnPngliteIncompatibleImages && PngliteIncompatible != 0)
-			{
-				SWarning Warning;
-				str_format(Warning.m_aWarningMsg, sizeof(Warning.m_aWarningMsg), Localize("\"%s\" is not compatible with pnglite and cannot be loaded by old DDNet versions: "), pFilename);
-				static const int FLAGS[] = {PNGLITE_COLOR_TYPE, PNGLITE_BIT_DEPTH, PNGLITE_INTERLACE_TYPE, PNGLITE_COMPRESSION_TYPE, PNGLITE_FILTER_TYPE};
-				static const char *EXPLANATION[] = {"color type", "bit depth", "interlace type", "compression type", "filter type"};
-
-				bool First = true;
-				for(size_t i = 0; i < std::size(FLAGS); ++i)
-				{
-					if((PngliteIncompatible & FLAGS[i]) != 0)
-					{
-						if(!First)
-						{
-							str_append(Warning.m_aWarningMsg, ", ");
-						}
-						str_append(Warning.m_aWarningMsg, EXPLANATION[i]);
-						First = false;
-					}
-				}
-				str_append(Warning.m_aWarningMsg, " unsupported");
-				m_vWarnings.emplace_back(Warning);
-			}
-		}
-		else
-		{
-			log_error("game/png", "failed to load file. filename='%s'", pFilename);
-			return false;
-		}
-	}
-	else
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(pFilename, StorageType, &pFileData, &FileSize))
 	{
 		log_error("game/png", "failed to open file. filename='%s'", pFilename);
 		return false;
 	}
 
+	int PngliteIncompatible = 0;
+	const bool Decoded = DecodePNG(pFileData, FileSize, pFilename, *pImg, PngliteIncompatible);
+	free(pFileData);
+	if(!Decoded)
+		return false;
+	WarnPngliteIncompatibility(pFilename, PngliteIncompatible);
 	return true;
 }
 
@@ -2671,6 +2616,33 @@ void CGraphics_Threaded::WarnPngliteIncompatibleImages(bool Warn)
 	m_WarnPngliteIncompatibleImages = Warn;
 }
 
+void CGraphics_Threaded::WarnPngliteIncompatibility(const char *pFilename, int PngliteIncompatible)
+{
+	if(!m_WarnPngliteIncompatibleImages || PngliteIncompatible == 0)
+		return;
+
+	SWarning Warning;
+	str_format(Warning.m_aWarningMsg, sizeof(Warning.m_aWarningMsg), Localize("\"%s\" is not compatible with pnglite and cannot be loaded by old DDNet versions: "), pFilename);
+	static const int FLAGS[] = {PNGLITE_COLOR_TYPE, PNGLITE_BIT_DEPTH, PNGLITE_INTERLACE_TYPE, PNGLITE_COMPRESSION_TYPE, PNGLITE_FILTER_TYPE};
+	static const char *EXPLANATION[] = {"color type", "bit depth", "interlace type", "compression type", "filter type"};
+
+	bool First = true;
+	for(size_t i = 0; i < std::size(FLAGS); ++i)
+	{
+		if((PngliteIncompatible & FLAGS[i]) != 0)
+		{
+			if(!First)
+			{
+				str_append(Warning.m_aWarningMsg, ", ");
+			}
+			str_append(Warning.m_aWarningMsg, EXPLANATION[i]);
+			First = false;
+		}
+	}
+	str_append(Warning.m_aWarningMsg, " unsupported");
+	m_vWarnings.emplace_back(Warning);
+}
+
 void CGraphics_Threaded::SetWindowParams(int FullscreenMode, bool IsBorderless, bool AllowResizing)
 {
 	m_pBackend->SetWindowParams(FullscreenMode, IsBorderless, AllowResizing);
@@ -1220,6 +1220,7 @@ public:
 	void Minimize() override;
 	void Maximize() override;
 	void WarnPngliteIncompatibleImages(bool Warn) override;
+	void WarnPngliteIncompatibility(const char *pFilename, int PngliteIncompatible) override;
 	void SetWindowParams(int FullscreenMode, bool IsBorderless, bool AllowResizing) override;
 	bool SetWindowScreen(int Index) override;
 	void Move(int x, int y) override;
@@ -24,10 +24,15 @@ extern "C" {
 void CSound::Mix(short *pFinalOut, unsigned Frames)
 {
 	Frames = minimum(Frames, m_MaxFrames);
+
+	const CLockScope MixLockScope(m_MixLock);
 	mem_zero(m_pMixBuffer, Frames * 2 * sizeof(int));
 
-	// acquire lock while we are mixing
+	// only hold the sound lock while the voices are set up, the samples are
+	// mixed without it
+	int NumMixVoices = 0;
 	m_SoundLock.lock();
+	ProcessVoiceCommands();
 
 	const int MasterVol = m_SoundVolume.load(std::memory_order_relaxed);
 
@@ -36,13 +41,7 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(!Voice.m_pSample)
 			continue;
 
-		// mix voice
-		int *pOut = m_pMixBuffer;
-
-		const int Step = Voice.m_pSample->m_Channels; // setup input sources
-		short *pInL = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
-		short *pInR = &Voice.m_pSample->m_pData[Voice.m_Tick * Step + 1];
-
+		const int Step = Voice.m_pSample->m_Channels;
 		unsigned End = Voice.m_pSample->m_NumFrames - Voice.m_Tick;
 
 		int VolumeR = round_truncate(Voice.m_pChannel->m_Vol * (Voice.m_Vol / 255.0f));
@@ -52,10 +51,6 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(Frames < End)
 			End = Frames;
 
-		// check if we have a mono sound
-		if(Voice.m_pSample->m_Channels == 1)
-			pInR = pInL;
-
 		// volume calculation
 		if(Voice.m_Flags & ISound::FLAG_POS && Voice.m_pChannel->m_Pan)
 		{
@@ -146,15 +141,17 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 			}
 		}
 
-		// process all frames
-		for(unsigned s = 0; s < End; s++)
+		// silent voices still advance, but don't need to be mixed
+		if(End > 0 && (VolumeL || VolumeR))
 		{
-			*pOut++ += (*pInL) * VolumeL;
-			*pOut++ += (*pInR) * VolumeR;
-			pInL += Step;
-			pInR += Step;
-			Voice.m_Tick++;
+			CMixVoice &Mixed = m_aMixVoices[NumMixVoices++];
+			Mixed.m_pData = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
+			Mixed.m_Channels = Step;
+			Mixed.m_Frames = End;
+			Mixed.m_VolumeL = VolumeL;
+			Mixed.m_VolumeR = VolumeR;
 		}
+		Voice.m_Tick += End;
 
 		// free voice if not used any more
 		if(Voice.m_Tick == Voice.m_pSample->m_NumFrames)
@@ -171,9 +168,14 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 
 	m_SoundLock.unlock();
 
+	for(int i = 0; i < NumMixVoices; i++)
+	{
+		const CMixVoice &Voice = m_aMixVoices[i];
+		MixVoice(m_pMixBuffer, Voice.m_pData, Voice.m_Channels, Voice.m_Frames, Voice.m_VolumeL, Voice.m_VolumeR);
+	}
+
 	// clamp accumulated values
-	for(unsigned i = 0; i < Frames * 2; i++)
-		pFinalOut[i] = clamp<int>(((m_pMixBuffer[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	ClampMix(pFinalOut, m_pMixBuffer, Frames * 2, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -614,6 +616,8 @@ void CSound::UnloadSample(int SampleID)
 		return;
 
 	Stop(SampleID);
+	// wait for the mixer to be done with the sample
+	const CLockScope MixLockScope(m_MixLock);
 	free(m_aSamples[SampleID].m_pData);
 	m_aSamples[SampleID].m_pData = nullptr;
 }
@@ -680,83 +684,120 @@ void CSound::SetListenerPos(float x, float y)
 	m_CenterY.store((int)y, std::memory_order_relaxed);
 }
 
-void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
+void CSound::QueueVoiceCommand(const CVoiceCommand &Command)
 {
-	if(!Voice.IsValid())
+	if(m_VoiceCommands.Push(Command))
 		return;
 
-	int VoiceID = Voice.Id();
-
+	// the mixer is behind, apply the queued commands right away
 	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
+	ProcessVoiceCommands();
+	ApplyVoiceCommand(Command);
+}
 
-	Volume = clamp(Volume, 0.0f, 1.0f);
-	m_aVoices[VoiceID].m_Vol = (int)(Volume * 255.0f);
+void CSound::ProcessVoiceCommands()
+{
+	CVoiceCommand Command;
+	while(m_VoiceCommands.Pop(&Command))
+		ApplyVoiceCommand(Command);
 }
 
-void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
+void CSound::ApplyVoiceCommand(const CVoiceCommand &Command)
 {
-	if(!Voice.IsValid())
+	CVoice &Voice = m_aVoices[Command.m_VoiceID];
+	if(Voice.m_Age != Command.m_Age)
 		return;
 
-	int VoiceID = Voice.Id();
+	switch(Command.m_Type)
+	{
+	case CVoiceCommand::VOLUME:
+		Voice.m_Vol = (int)(Command.m_aValues[0] * 255.0f);
+		break;
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
+	case CVoiceCommand::FALLOFF:
+		Voice.m_Falloff = Command.m_aValues[0];
+		break;
+
+	case CVoiceCommand::LOCATION:
+		Voice.m_X = Command.m_aValues[0];
+		Voice.m_Y = Command.m_aValues[1];
+		break;
 
-	Falloff = clamp(Falloff, 0.0f, 1.0f);
-	m_aVoices[VoiceID].m_Falloff = Falloff;
+	case CVoiceCommand::TIME_OFFSET:
+	{
+		if(!Voice.m_pSample)
+			return;
+
+		const float TimeOffset = Command.m_aValues[0];
+		int Tick = 0;
+		bool IsLooping = Voice.m_Flags & ISound::FLAG_LOOP;
+		uint64_t TickOffset = Voice.m_pSample->m_Rate * TimeOffset;
+		if(Voice.m_pSample->m_NumFrames > 0 && IsLooping)
+			Tick = TickOffset % Voice.m_pSample->m_NumFrames;
+		else
+			Tick = clamp(TickOffset, (uint64_t)0, (uint64_t)Voice.m_pSample->m_NumFrames);
+
+		// at least 200msec off, else depend on buffer size
+		float Threshold = maximum(0.2f * Voice.m_pSample->m_Rate, (float)m_MaxFrames);
+		if(absolute(Voice.m_Tick - Tick) > Threshold)
+		{
+			// take care of looping (modulo!)
+			if(!(IsLooping && (minimum(Voice.m_Tick, Tick) + Voice.m_pSample->m_NumFrames - maximum(Voice.m_Tick, Tick)) <= Threshold))
+			{
+				Voice.m_Tick = Tick;
+			}
+		}
+		break;
+	}
+
+	case CVoiceCommand::CIRCLE:
+		Voice.m_Shape = ISound::SHAPE_CIRCLE;
+		Voice.m_Circle.m_Radius = Command.m_aValues[0];
+		break;
+
+	case CVoiceCommand::RECTANGLE:
+		Voice.m_Shape = ISound::SHAPE_RECTANGLE;
+		Voice.m_Rectangle.m_Width = Command.m_aValues[0];
+		Voice.m_Rectangle.m_Height = Command.m_aValues[1];
+		break;
+
+	case CVoiceCommand::STOP:
+		Voice.m_pSample = nullptr;
+		Voice.m_Age++;
+		break;
+	}
 }
 
-void CSound::SetVoiceLocation(CVoiceHandle Voice, float x, float y)
+void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
 {
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceID = Voice.Id();
+	QueueVoiceCommand({CVoiceCommand::VOLUME, Voice.Id(), Voice.Age(), {clamp(Volume, 0.0f, 1.0f)}});
+}
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
+{
+	if(!Voice.IsValid())
 		return;
 
-	m_aVoices[VoiceID].m_X = x;
-	m_aVoices[VoiceID].m_Y = y;
+	QueueVoiceCommand({CVoiceCommand::FALLOFF, Voice.Id(), Voice.Age(), {clamp(Falloff, 0.0f, 1.0f)}});
 }
 
-void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+void CSound::SetVoiceLocation(CVoiceHandle Voice, float x, float y)
 {
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceID = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
+	QueueVoiceCommand({CVoiceCommand::LOCATION, Voice.Id(), Voice.Age(), {x, y}});
+}
 
-	if(!m_aVoices[VoiceID].m_pSample)
+void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+{
+	if(!Voice.IsValid())
 		return;
 
-	int Tick = 0;
-	bool IsLooping = m_aVoices[VoiceID].m_Flags & ISound::FLAG_LOOP;
-	uint64_t TickOffset = m_aVoices[VoiceID].m_pSample->m_Rate * TimeOffset;
-	if(m_aVoices[VoiceID].m_pSample->m_NumFrames > 0 && IsLooping)
-		Tick = TickOffset % m_aVoices[VoiceID].m_pSample->m_NumFrames;
-	else
-		Tick = clamp(TickOffset, (uint64_t)0, (uint64_t)m_aVoices[VoiceID].m_pSample->m_NumFrames);
-
-	// at least 200msec off, else depend on buffer size
-	float Threshold = maximum(0.2f * m_aVoices[VoiceID].m_pSample->m_Rate, (float)m_MaxFrames);
-	if(absolute(m_aVoices[VoiceID].m_Tick - Tick) > Threshold)
-	{
-		// take care of looping (modulo!)
-		if(!(IsLooping && (minimum(m_aVoices[VoiceID].m_Tick, Tick) + m_aVoices[VoiceID].m_pSample->m_NumFrames - maximum(m_aVoices[VoiceID].m_Tick, Tick)) <= Threshold))
-		{
-			m_aVoices[VoiceID].m_Tick = Tick;
-		}
-	}
+	QueueVoiceCommand({CVoiceCommand::TIME_OFFSET, Voice.Id(), Voice.Age(), {TimeOffset}});
 }
 
 void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
@@ -764,14 +805,7 @@ void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceID = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceID].m_Shape = ISound::SHAPE_CIRCLE;
-	m_aVoices[VoiceID].m_Circle.m_Radius = maximum(0.0f, Radius);
+	QueueVoiceCommand({CVoiceCommand::CIRCLE, Voice.Id(), Voice.Age(), {maximum(0.0f, Radius)}});
 }
 
 void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
@@ -779,20 +813,13 @@ void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceID = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceID].m_Shape = ISound::SHAPE_RECTANGLE;
-	m_aVoices[VoiceID].m_Rectangle.m_Width = maximum(0.0f, Width);
-	m_aVoices[VoiceID].m_Rectangle.m_Height = maximum(0.0f, Height);
+	QueueVoiceCommand({CVoiceCommand::RECTANGLE, Voice.Id(), Voice.Age(), {maximum(0.0f, Width), maximum(0.0f, Height)}});
 }
 
 ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
 {
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 
 	// search for voice
 	int VoiceID = -1;
@@ -853,6 +880,7 @@ void CSound::Pause(int SampleID)
 {
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleID];
 	for(auto &Voice : m_aVoices)
 	{
@@ -868,6 +896,7 @@ void CSound::Stop(int SampleID)
 {
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleID];
 	for(auto &Voice : m_aVoices)
 	{
@@ -886,6 +915,7 @@ void CSound::StopAll()
 {
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	for(auto &Voice : m_aVoices)
 	{
 		if(Voice.m_pSample)
@@ -904,19 +934,13 @@ void CSound::StopVoice(CVoiceHandle Voice)
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceID = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceID].m_pSample = nullptr;
-	m_aVoices[VoiceID].m_Age++;
+	QueueVoiceCommand({CVoiceCommand::STOP, Voice.Id(), Voice.Age(), {}});
 }
 
 bool CSound::IsPlaying(int SampleID)
 {
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	const CSample *pSample = &m_aSamples[SampleID];
 	return std::any_of(std::begin(m_aVoices), std::end(m_aVoices), [pSample](const auto &Voice) { return Voice.m_pSample == pSample; });
 }
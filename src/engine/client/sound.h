@@ -7,6 +7,8 @@
 
 #include <engine/sound.h>
 
+#include "sound_mix.h"
+
 #include <SDL_audio.h>
 
 #include <atomic>
@@ -54,11 +56,47 @@ class CSound : public IEngineSound
 		NUM_SAMPLES = 512,
 		NUM_VOICES = 256,
 		NUM_CHANNELS = 16,
+		NUM_VOICE_COMMANDS = 1024,
+	};
+
+	// changes of voices that don't need to be applied right away, they are
+	// queued by the game thread and applied by the mixer
+	struct CVoiceCommand
+	{
+		enum
+		{
+			VOLUME,
+			FALLOFF,
+			LOCATION,
+			TIME_OFFSET,
+			CIRCLE,
+			RECTANGLE,
+			STOP,
+		};
+		int m_Type;
+		int m_VoiceID;
+		int m_Age;
+		float m_aValues[2];
+	};
+
+	// what the mixer needs of a voice, filled while holding the sound lock
+	// so the samples can be mixed without it
+	struct CMixVoice
+	{
+		const short *m_pData;
+		int m_Channels;
+		unsigned m_Frames;
+		int m_VolumeL;
+		int m_VolumeR;
 	};
 
 	bool m_SoundEnabled = false;
 	SDL_AudioDeviceID m_Device = 0;
 	CLock m_SoundLock;
+	// held while mixing, so sample data isn't freed while it's mixed
+	CLock m_MixLock;
+	CSpscQueue<CVoiceCommand, NUM_VOICE_COMMANDS> m_VoiceCommands;
+	CMixVoice m_aMixVoices[NUM_VOICES];
 
 	CSample m_aSamples[NUM_SAMPLES] = {{0}};
 	CVoice m_aVoices[NUM_VOICES] = {{0}};
@@ -84,10 +122,16 @@ class CSound : public IEngineSound
 
 	void UpdateVolume();
 
+	void QueueVoiceCommand(const CVoiceCommand &Command) REQUIRES(!m_SoundLock);
+	// has to be called before the voices are used, so the queued commands are
+	// applied in order with the other changes
+	void ProcessVoiceCommands() REQUIRES(m_SoundLock);
+	void ApplyVoiceCommand(const CVoiceCommand &Command) REQUIRES(m_SoundLock);
+
 public:
 	int Init() override;
 	int Update() override;
-	void Shutdown() override REQUIRES(!m_SoundLock);
+	void Shutdown() override REQUIRES(!m_SoundLock, !m_MixLock);
 
 	bool IsSoundEnabled() override { return m_SoundEnabled; }
 
@@ -95,7 +139,7 @@ public:
 	int LoadWV(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override;
 	int LoadOpusFromMem(const void *pData, unsigned DataSize, bool FromEditor) override;
 	int LoadWVFromMem(const void *pData, unsigned DataSize, bool FromEditor) override;
-	void UnloadSample(int SampleID) override REQUIRES(!m_SoundLock);
+	void UnloadSample(int SampleID) override REQUIRES(!m_SoundLock, !m_MixLock);
 
 	float GetSampleTotalTime(int SampleID) override; // in s
 	float GetSampleCurrentTime(int SampleID) override REQUIRES(!m_SoundLock); // in s
@@ -121,7 +165,7 @@ public:
 	void StopVoice(CVoiceHandle Voice) override REQUIRES(!m_SoundLock);
 	bool IsPlaying(int SampleID) override REQUIRES(!m_SoundLock);
 
-	void Mix(short *pFinalOut, unsigned Frames) override REQUIRES(!m_SoundLock);
+	void Mix(short *pFinalOut, unsigned Frames) override REQUIRES(!m_SoundLock, !m_MixLock);
 	void PauseAudioDevice() override;
 	void UnpauseAudioDevice() override;
 };
@@ -0,0 +1,123 @@
+#include "sound_mix.h"
+
+#include <base/math.h>
+
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_MIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SOUND_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+static void MixVoiceScalar(int *pOut, const short *pIn, int Step, unsigned Frames, int VolumeL, int VolumeR)
+{
+	const short *pInL = pIn;
+	const short *pInR = Step == 1 ? pIn : pIn + 1;
+	for(unsigned s = 0; s < Frames; s++)
+	{
+		*pOut++ += (*pInL) * VolumeL;
+		*pOut++ += (*pInR) * VolumeR;
+		pInL += Step;
+		pInR += Step;
+	}
+}
+
+#if defined(SOUND_MIX_SSE2)
+// adds the products of eight 16 bit values to eight 32 bit values
+static void AddProducts(int *pOut, __m128i In, __m128i Volume)
+{
+	const __m128i Low = _mm_mullo_epi16(In, Volume);
+	const __m128i High = _mm_mulhi_epi16(In, Volume);
+	__m128i *pOutVec = (__m128i *)pOut;
+	_mm_storeu_si128(pOutVec, _mm_add_epi32(_mm_loadu_si128(pOutVec), _mm_unpacklo_epi16(Low, High)));
+	_mm_storeu_si128(pOutVec + 1, _mm_add_epi32(_mm_loadu_si128(pOutVec + 1), _mm_unpackhi_epi16(Low, High)));
+}
+#endif
+
+void MixVoice(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned Frame = 0;
+#if defined(SOUND_MIX_SSE2) || defined(SOUND_MIX_NEON)
+	// the vectorized paths multiply 16 bit values
+	const int Min = std::numeric_limits<short>::min();
+	const int Max = std::numeric_limits<short>::max();
+	if(Channels <= 2 && VolumeL >= Min && VolumeL <= Max && VolumeR >= Min && VolumeR <= Max)
+	{
+#if defined(SOUND_MIX_SSE2)
+		const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+		if(Channels == 2)
+		{
+			for(; Frame + 4 <= Frames; Frame += 4)
+				AddProducts(pOut + Frame * 2, _mm_loadu_si128((const __m128i *)(pIn + Frame * 2)), Volume);
+		}
+		else
+		{
+			for(; Frame + 8 <= Frames; Frame += 8)
+			{
+				const __m128i In = _mm_loadu_si128((const __m128i *)(pIn + Frame));
+				AddProducts(pOut + Frame * 2, _mm_unpacklo_epi16(In, In), Volume);
+				AddProducts(pOut + Frame * 2 + 8, _mm_unpackhi_epi16(In, In), Volume);
+			}
+		}
+#else
+		const int16_t aVolume[4] = {(int16_t)VolumeL, (int16_t)VolumeR, (int16_t)VolumeL, (int16_t)VolumeR};
+		const int16x4_t Volume = vld1_s16(aVolume);
+		if(Channels == 2)
+		{
+			for(; Frame + 4 <= Frames; Frame += 4)
+			{
+				const int16x8_t In = vld1q_s16(pIn + Frame * 2);
+				int *pFrameOut = pOut + Frame * 2;
+				vst1q_s32(pFrameOut, vmlal_s16(vld1q_s32(pFrameOut), vget_low_s16(In), Volume));
+				vst1q_s32(pFrameOut + 4, vmlal_s16(vld1q_s32(pFrameOut + 4), vget_high_s16(In), Volume));
+			}
+		}
+		else
+		{
+			for(; Frame + 4 <= Frames; Frame += 4)
+			{
+				const int16x4_t In = vld1_s16(pIn + Frame);
+				const int16x4x2_t Both = vzip_s16(In, In);
+				int *pFrameOut = pOut + Frame * 2;
+				vst1q_s32(pFrameOut, vmlal_s16(vld1q_s32(pFrameOut), Both.val[0], Volume));
+				vst1q_s32(pFrameOut + 4, vmlal_s16(vld1q_s32(pFrameOut + 4), Both.val[1], Volume));
+			}
+		}
+#endif
+	}
+#endif
+	MixVoiceScalar(pOut + Frame * 2, pIn + Frame * Channels, Channels, Frames - Frame, VolumeL, VolumeR);
+}
+
+void ClampMix(short *pFinalOut, const int *pMix, unsigned Samples, int MasterVol)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIX_SSE2)
+	const __m128i Volume = _mm_set1_epi32(MasterVol);
+	const __m128d Divisor = _mm_set1_pd(101.0);
+	__m128i aResult[2];
+	for(; i + 8 <= Samples; i += 8)
+	{
+		for(int Half = 0; Half < 2; Half++)
+		{
+			const __m128i Mix = _mm_loadu_si128((const __m128i *)(pMix + i + Half * 4));
+			// SSE2 can only multiply every other 32 bit value
+			const __m128i Even = _mm_mul_epu32(Mix, Volume);
+			const __m128i Odd = _mm_mul_epu32(_mm_srli_epi64(Mix, 32), Volume);
+			const __m128i Product = _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+			// the quotient of a 32 bit value is never rounded to the next
+			// integer in double precision, so truncating it gives the same
+			// result as the integer division
+			const __m128i QuotientLow = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(Product), Divisor));
+			const __m128i QuotientHigh = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(Product, _MM_SHUFFLE(1, 0, 3, 2))), Divisor));
+			aResult[Half] = _mm_srai_epi32(_mm_unpacklo_epi64(QuotientLow, QuotientHigh), 8);
+		}
+		_mm_storeu_si128((__m128i *)(pFinalOut + i), _mm_packs_epi32(aResult[0], aResult[1]));
+	}
+#endif
+	for(; i < Samples; i++)
+		pFinalOut[i] = clamp<int>(((pMix[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+}
@@ -0,0 +1,54 @@
+#ifndef ENGINE_CLIENT_SOUND_MIX_H
+#define ENGINE_CLIENT_SOUND_MIX_H
+
+#include <atomic>
+
+// Queue without locks for exactly one producer and one consumer thread at a
+// time. Other threads can only take over one of the roles if they are
+// synchronized with the previous one, e.g. by a lock.
+template<typename T, unsigned Capacity>
+class CSpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	T m_aItems[Capacity];
+	// only written by the consumer
+	std::atomic<unsigned> m_Head = 0;
+	// only written by the producer
+	std::atomic<unsigned> m_Tail = 0;
+
+public:
+	// returns false if the queue is full
+	bool Push(const T &Item)
+	{
+		const unsigned Tail = m_Tail.load(std::memory_order_relaxed);
+		if(Tail - m_Head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		m_aItems[Tail % Capacity] = Item;
+		m_Tail.store(Tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// returns false if the queue is empty
+	bool Pop(T *pItem)
+	{
+		const unsigned Head = m_Head.load(std::memory_order_relaxed);
+		if(Head == m_Tail.load(std::memory_order_acquire))
+			return false;
+		*pItem = m_aItems[Head % Capacity];
+		m_Head.store(Head + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+// Adds `Frames` frames of a voice to the interleaved stereo mix buffer
+// `pOut`. `pIn` has `Channels` interleaved channels, mono samples are
+// played on both sides and only the first two channels of other samples are
+// used. Uses SSE2 or NEON if they are available.
+void MixVoice(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR);
+
+// Applies the master volume (0 - 100) to the mix buffer and clamps the
+// result into `pFinalOut`, `Samples` is the number of values of both.
+void ClampMix(short *pFinalOut, const int *pMix, unsigned Samples, int MasterVol);
+
+#endif
@@ -1,6 +1,7 @@
 #include "image_loader.h"
 #include <base/log.h>
 #include <base/system.h>
+#include <engine/graphics.h>
 #include <csetjmp>
 #include <cstdlib>
 
@@ -259,6 +260,32 @@ bool LoadPNG(SImageByteBuffer &ByteLoader, const char *pFileName, int &PngliteIn
 	return true;
 }
 
+bool DecodePNG(const void *pFileData, size_t FileSize, const char *pFileName, CImageInfo &Image, int &PngliteIncompatible)
+{
+	TImageByteBuffer ByteBuffer((const uint8_t *)pFileData, (const uint8_t *)pFileData + FileSize);
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	uint8_t *pImgBuffer = nullptr;
+	EImageFormat ImageFormat;
+	if(!LoadPNG(ImageByteBuffer, pFileName, PngliteIncompatible, Image.m_Width, Image.m_Height, pImgBuffer, ImageFormat))
+	{
+		log_error("game/png", "failed to load file. filename='%s'", pFileName);
+		return false;
+	}
+
+	if(ImageFormat == IMAGE_FORMAT_RGB)
+		Image.m_Format = CImageInfo::FORMAT_RGB;
+	else if(ImageFormat == IMAGE_FORMAT_RGBA)
+		Image.m_Format = CImageInfo::FORMAT_RGBA;
+	else
+	{
+		free(pImgBuffer);
+		log_error("game/png", "image had unsupported image format. filename='%s' format='%d'", pFileName, (int)ImageFormat);
+		return false;
+	}
+	Image.m_pData = pImgBuffer;
+	return true;
+}
+
 static void WriteDataFromLoadedBytes(png_structp pPNGStruct, png_bytep pOutBytes, png_size_t ByteCountToWrite)
 {
 	if(ByteCountToWrite > 0)
@@ -5,6 +5,8 @@
 #include <cstdint>
 #include <vector>
 
+class CImageInfo;
+
 enum EImageFormat
 {
 	IMAGE_FORMAT_R = 0,
@@ -33,6 +35,11 @@ enum
 };
 
 bool LoadPNG(SImageByteBuffer &ByteLoader, const char *pFileName, int &PngliteIncompatible, int &Width, int &Height, uint8_t *&pImageBuff, EImageFormat &ImageFormat);
+// Decodes a PNG file into an RGB or RGBA image allocated with malloc. It
+// doesn't use the graphics backend and can be called from jobs, the pnglite
+// incompatibilities are reported by `IGraphics::WarnPngliteIncompatibility`
+// on the main thread.
+bool DecodePNG(const void *pFileData, size_t FileSize, const char *pFileName, CImageInfo &Image, int &PngliteIncompatible);
 bool SavePNG(EImageFormat ImageFormat, const uint8_t *pRawBuffer, SImageByteBuffer &WrittenBytes, int Width, int Height);
 
 #endif // ENGINE_GFX_IMAGE_LOADER_H
@@ -1,120 +1,330 @@
 #include "image_manipulation.h"
 #include <base/math.h>
 #include <base/system.h>
+#include <engine/shared/jobs.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the vectorized paths load a pixel as 32 bit value with the alpha in the
+// highest byte
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DILATE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define DILATE_NEON
+#include <arm_neon.h>
+#endif
+#endif
 
 #define TW_DILATE_ALPHA_THRESHOLD 10
 
-static void Dilate(int w, int h, const unsigned char *pSrc, unsigned char *pDest, unsigned char AlphaThreshold = TW_DILATE_ALPHA_THRESHOLD)
+enum
 {
-	const int BPP = 4; // RGBA assumed
-	int ix, iy;
-	const int aDirX[] = {0, -1, 1, 0};
-	const int aDirY[] = {-1, 0, 0, 1};
-
-	int AlphaCompIndex = BPP - 1;
+	DILATE_PASSES = 11,
+	// A pass only reads the neighboring rows, so a band is dilated together
+	// with this many rows above and below it to get the same result as
+	// dilating the whole image at once.
+	DILATE_BAND_BORDER = DILATE_PASSES,
+	DILATE_MIN_BAND_HEIGHT = 256,
+};
+
+static bool IsOpaque(const unsigned char *pPixel)
+{
+	return pPixel[3] > TW_DILATE_ALPHA_THRESHOLD;
+}
 
-	int m = 0;
-	for(int y = 0; y < h; y++)
+// A transparent pixel gets the color of its first opaque neighbor in the
+// order up, left, right, down and becomes opaque. Neighbors outside of the
+// image are clamped to the pixel itself, which is transparent.
+static void DilatePixels(const unsigned char *pUp, const unsigned char *pRow, const unsigned char *pDown, unsigned char *pDest, int w, int Start, int End)
+{
+	const int BPP = 4; // RGBA assumed
+	for(int x = Start; x < End; x++)
 	{
-		for(int x = 0; x < w; x++, m += BPP)
+		const int m = x * BPP;
+		const unsigned char *pPixel = &pRow[m];
+		if(!IsOpaque(pPixel))
 		{
-			for(int i = 0; i < BPP; ++i)
-				pDest[m + i] = pSrc[m + i];
-			if(pSrc[m + AlphaCompIndex] > AlphaThreshold)
-				continue;
-
-			int aSumOfOpaque[] = {0, 0, 0};
-			int Counter = 0;
-			for(int c = 0; c < 4; c++)
+			const unsigned char *apNeighbors[] = {&pUp[m], &pRow[maximum(x - 1, 0) * BPP], &pRow[minimum(x + 1, w - 1) * BPP], &pDown[m]};
+			for(const unsigned char *pNeighbor : apNeighbors)
 			{
-				ix = clamp(x + aDirX[c], 0, w - 1);
-				iy = clamp(y + aDirY[c], 0, h - 1);
-				int k = iy * w * BPP + ix * BPP;
-				if(pSrc[k + AlphaCompIndex] > AlphaThreshold)
+				if(IsOpaque(pNeighbor))
 				{
-					for(int p = 0; p < BPP - 1; ++p)
-						aSumOfOpaque[p] += pSrc[k + p];
-					++Counter;
+					pPixel = pNeighbor;
 					break;
 				}
 			}
-
-			if(Counter > 0)
-			{
-				for(int i = 0; i < BPP - 1; ++i)
-				{
-					aSumOfOpaque[i] /= Counter;
-					pDest[m + i] = (unsigned char)aSumOfOpaque[i];
-				}
-
-				pDest[m + AlphaCompIndex] = 255;
-			}
 		}
+		mem_copy(&pDest[m], pPixel, BPP);
+		if(pPixel != &pRow[m])
+			pDest[m + BPP - 1] = 255;
 	}
 }
 
-static void CopyColorValues(int w, int h, int BPP, const unsigned char *pSrc, unsigned char *pDest)
+#if defined(DILATE_SSE2)
+static __m128i LoadPixels(const unsigned char *pPixels)
+{
+	return _mm_loadu_si128((const __m128i *)pPixels);
+}
+
+static __m128i Select(__m128i Mask, __m128i A, __m128i B)
 {
-	int m = 0;
-	for(int y = 0; y < h; y++)
+	return _mm_or_si128(_mm_and_si128(Mask, A), _mm_andnot_si128(Mask, B));
+}
+#endif
+
+static void DilateRow(const unsigned char *pUp, const unsigned char *pRow, const unsigned char *pDown, unsigned char *pDest, int w)
+{
+	const int BPP = 4; // RGBA assumed
+	// the first pixel and the pixels at the end have clamped neighbors
+	int x = 1;
+#if defined(DILATE_SSE2)
+	const __m128i Threshold = _mm_set1_epi32(TW_DILATE_ALPHA_THRESHOLD);
+	const __m128i Alpha = _mm_set1_epi32((int)0xff000000u);
+	for(; x + 4 < w; x += 4)
 	{
-		for(int x = 0; x < w; x++, m += BPP)
+		const int m = x * BPP;
+		const __m128i Center = LoadPixels(&pRow[m]);
+		const __m128i CenterOpaque = _mm_cmpgt_epi32(_mm_srli_epi32(Center, 24), Threshold);
+		__m128i Result = Center;
+		// most pixels are opaque already
+		if(_mm_movemask_epi8(CenterOpaque) != 0xffff)
 		{
-			for(int i = 0; i < BPP - 1; ++i)
+			// the first opaque neighbor wins, so they are applied in reverse
+			// order
+			for(const unsigned char *pNeighbor : {&pDown[m], &pRow[m + BPP], &pRow[m - BPP], &pUp[m]})
+			{
+				const __m128i Neighbor = LoadPixels(pNeighbor);
+				Result = Select(_mm_cmpgt_epi32(_mm_srli_epi32(Neighbor, 24), Threshold), _mm_or_si128(Neighbor, Alpha), Result);
+			}
+			Result = Select(CenterOpaque, Center, Result);
+		}
+		_mm_storeu_si128((__m128i *)&pDest[m], Result);
+	}
+#elif defined(DILATE_NEON)
+	const uint32x4_t Threshold = vdupq_n_u32(TW_DILATE_ALPHA_THRESHOLD);
+	const uint32x4_t Alpha = vdupq_n_u32(0xff000000u);
+	for(; x + 4 < w; x += 4)
+	{
+		const int m = x * BPP;
+		const uint32x4_t Center = vld1q_u32((const uint32_t *)&pRow[m]);
+		const uint32x4_t CenterOpaque = vcgtq_u32(vshrq_n_u32(Center, 24), Threshold);
+		const uint32x2_t BothOpaque = vand_u32(vget_low_u32(CenterOpaque), vget_high_u32(CenterOpaque));
+		uint32x4_t Result = Center;
+		// most pixels are opaque already
+		if((vget_lane_u32(BothOpaque, 0) & vget_lane_u32(BothOpaque, 1)) == 0)
+		{
+			// the first opaque neighbor wins, so they are applied in reverse
+			// order
+			for(const unsigned char *pNeighbor : {&pDown[m], &pRow[m + BPP], &pRow[m - BPP], &pUp[m]})
 			{
-				if(pDest[m + 3] == 0)
-					pDest[m + i] = pSrc[m + i];
+				const uint32x4_t Neighbor = vld1q_u32((const uint32_t *)pNeighbor);
+				Result = vbslq_u32(vcgtq_u32(vshrq_n_u32(Neighbor, 24), Threshold), vorrq_u32(Neighbor, Alpha), Result);
 			}
+			Result = vbslq_u32(CenterOpaque, Center, Result);
 		}
+		vst1q_u32((uint32_t *)&pDest[m], Result);
 	}
+#endif
+	DilatePixels(pUp, pRow, pDown, pDest, w, 0, minimum(1, w));
+	DilatePixels(pUp, pRow, pDown, pDest, w, x, w);
 }
 
-void DilateImage(unsigned char *pImageBuff, int w, int h)
+// The color of fully transparent pixels is taken from the dilated row.
+static void CopyColorValues(const unsigned char *pDilated, unsigned char *pRow, int w)
 {
-	DilateImageSub(pImageBuff, w, h, 0, 0, w, h);
+	const int BPP = 4; // RGBA assumed
+	int x = 0;
+#if defined(DILATE_SSE2)
+	const __m128i Color = _mm_set1_epi32(0x00ffffff);
+	for(; x + 4 <= w; x += 4)
+	{
+		const __m128i Pixels = LoadPixels(&pRow[x * BPP]);
+		const __m128i Transparent = _mm_cmpeq_epi32(_mm_srli_epi32(Pixels, 24), _mm_setzero_si128());
+		const __m128i Dilated = _mm_and_si128(LoadPixels(&pDilated[x * BPP]), Color);
+		_mm_storeu_si128((__m128i *)&pRow[x * BPP], Select(Transparent, Dilated, Pixels));
+	}
+#elif defined(DILATE_NEON)
+	const uint32x4_t Color = vdupq_n_u32(0x00ffffff);
+	for(; x + 4 <= w; x += 4)
+	{
+		const uint32x4_t Pixels = vld1q_u32((const uint32_t *)&pRow[x * BPP]);
+		const uint32x4_t Transparent = vceqq_u32(vshrq_n_u32(Pixels, 24), vdupq_n_u32(0));
+		const uint32x4_t Dilated = vandq_u32(vld1q_u32((const uint32_t *)&pDilated[x * BPP]), Color);
+		vst1q_u32((uint32_t *)&pRow[x * BPP], vbslq_u32(Transparent, Dilated, Pixels));
+	}
+#endif
+	for(int m = x * BPP; m < w * BPP; m += BPP)
+	{
+		if(pRow[m + 3] == 0)
+		{
+			for(int i = 0; i < BPP - 1; ++i)
+				pRow[m + i] = pDilated[m + i];
+		}
+	}
 }
 
-void DilateImageSub(unsigned char *pImageBuff, int w, int h, int x, int y, int sw, int sh)
+// Hands out the row bands of the image to dilate one by one. Jobs that start
+// after all bands are taken return without touching the image.
+class CDilateState
 {
-	const int BPP = 4; // RGBA assumed
-	unsigned char *apBuffer[2] = {NULL, NULL};
-
-	apBuffer[0] = (unsigned char *)malloc((size_t)sw * sh * sizeof(unsigned char) * BPP);
-	apBuffer[1] = (unsigned char *)malloc((size_t)sw * sh * sizeof(unsigned char) * BPP);
-	unsigned char *pBufferOriginal = (unsigned char *)malloc((size_t)sw * sh * sizeof(unsigned char) * BPP);
+public:
+	CDilateState(unsigned char *pImageBuff, int w, int x, int y, int sw, int sh, int NumBands) :
+		m_pImageBuff(pImageBuff), m_w(w), m_x(x), m_y(y), m_sw(sw), m_sh(sh), m_NumBands(NumBands)
+	{
+		// the border rows of a band are written by the neighboring bands, so
+		// their original pixels are copied before any band starts
+		if(NumBands > 1)
+		{
+			m_vBorders.resize((size_t)NumBands * 2 * DILATE_BAND_BORDER * Pitch());
+			for(int Band = 0; Band < NumBands; Band++)
+			{
+				const int Y0 = BandStart(Band);
+				const int Y1 = BandStart(Band + 1);
+				for(int Y = maximum(Y0 - (int)DILATE_BAND_BORDER, 0); Y < Y0; Y++)
+					mem_copy(BorderRow(Band, Y0, Y1, Y), ImageRow(Y), Pitch());
+				for(int Y = Y1; Y < minimum(Y1 + (int)DILATE_BAND_BORDER, sh); Y++)
+					mem_copy(BorderRow(Band, Y0, Y1, Y), ImageRow(Y), Pitch());
+			}
+		}
+	}
 
-	unsigned char *pPixelBuff = (unsigned char *)pImageBuff;
+	void Process()
+	{
+		int NumDilated = 0;
+		while(true)
+		{
+			const int Band = m_NextBand.fetch_add(1);
+			if(Band >= m_NumBands)
+				break;
+			DilateBand(Band);
+			NumDilated++;
+		}
+		if(NumDilated)
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_NumDone += NumDilated;
+			if(m_NumDone == m_NumBands)
+				m_Done.notify_all();
+		}
+	}
 
-	for(int Y = 0; Y < sh; ++Y)
+	void Wait()
 	{
-		int SrcImgOffset = ((y + Y) * w * BPP) + (x * BPP);
-		int DstImgOffset = (Y * sw * BPP);
-		int CopySize = sw * BPP;
-		mem_copy(&pBufferOriginal[DstImgOffset], &pPixelBuff[SrcImgOffset], CopySize);
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_Done.wait(Lock, [this]() { return m_NumDone == m_NumBands; });
 	}
 
-	Dilate(sw, sh, pBufferOriginal, apBuffer[0]);
+private:
+	enum
+	{
+		BPP = 4, // RGBA assumed
+	};
 
-	for(int i = 0; i < 5; i++)
+	size_t Pitch() const { return (size_t)m_sw * BPP; }
+	int BandStart(int Band) const { return m_sh * Band / m_NumBands; }
+	unsigned char *ImageRow(int Y) { return &m_pImageBuff[(((size_t)m_y + Y) * m_w + m_x) * BPP]; }
+	unsigned char *BorderRow(int Band, int Y0, int Y1, int Y)
 	{
-		Dilate(sw, sh, apBuffer[0], apBuffer[1]);
-		Dilate(sw, sh, apBuffer[1], apBuffer[0]);
+		const int Row = Y < Y0 ? Y - (Y0 - DILATE_BAND_BORDER) : DILATE_BAND_BORDER + Y - Y1;
+		return &m_vBorders[((size_t)Band * 2 * DILATE_BAND_BORDER + Row) * Pitch()];
 	}
 
-	CopyColorValues(sw, sh, BPP, apBuffer[0], pBufferOriginal);
+	// Dilates the rows of a band with all passes at once. A row of a pass is
+	// dilated as soon as the rows of the previous pass around it are, and
+	// only the last three rows of every pass are kept, so the rows stay in the
+	// cache. The rows of the band are dilated in place, they are not read
+	// anymore when the last pass is done with them.
+	void DilateBand(int Band)
+	{
+		const int Y0 = BandStart(Band);
+		const int Y1 = BandStart(Band + 1);
+		const int Top = maximum(Y0 - (int)DILATE_BAND_BORDER, 0);
+		const int Bottom = minimum(Y1 + (int)DILATE_BAND_BORDER, m_sh);
+
+		std::vector<unsigned char> vRows(Pitch() * 3 * DILATE_PASSES);
+		auto &&PassRow = [&](int Pass, int Y) {
+			return &vRows[(Pass * 3 + Y % 3) * Pitch()];
+		};
+		auto &&SourceRow = [&](int Pass, int Y) -> const unsigned char * {
+			if(Pass > 0)
+				return PassRow(Pass - 1, Y);
+			return Y < Y0 || Y >= Y1 ? BorderRow(Band, Y0, Y1, Y) : ImageRow(Y);
+		};
+
+		for(int Step = Top; Step < Bottom + DILATE_PASSES - 1; Step++)
+		{
+			for(int Pass = 0; Pass < DILATE_PASSES; Pass++)
+			{
+				const int Y = Step - Pass;
+				if(Y < Top || Y >= Bottom)
+					continue;
+				// rows outside of the band with its border are clamped
+				DilateRow(SourceRow(Pass, maximum(Y - 1, Top)), SourceRow(Pass, Y), SourceRow(Pass, minimum(Y + 1, Bottom - 1)), PassRow(Pass, Y), m_sw);
+			}
+
+			const int Y = Step - (DILATE_PASSES - 1);
+			if(Y >= Y0 && Y < Y1)
+				CopyColorValues(PassRow(DILATE_PASSES - 1, Y), ImageRow(Y), m_sw);
+		}
+	}
 
-	free(apBuffer[0]);
-	free(apBuffer[1]);
+	unsigned char *m_pImageBuff;
+	int m_w;
+	int m_x;
+	int m_y;
+	int m_sw;
+	int m_sh;
+	int m_NumBands;
+	std::vector<unsigned char> m_vBorders;
+	std::atomic<int> m_NextBand{0};
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Done;
+	int m_NumDone = 0;
+};
+
+class CDilateJob : public IJob
+{
+	std::shared_ptr<CDilateState> m_pState;
 
-	for(int Y = 0; Y < sh; ++Y)
+	void Run() override
 	{
-		int SrcImgOffset = ((y + Y) * w * BPP) + (x * BPP);
-		int DstImgOffset = (Y * sw * BPP);
-		int CopySize = sw * BPP;
-		mem_copy(&pPixelBuff[SrcImgOffset], &pBufferOriginal[DstImgOffset], CopySize);
+		m_pState->Process();
 	}
 
-	free(pBufferOriginal);
+public:
+	CDilateJob(std::shared_ptr<CDilateState> pState) :
+		m_pState(std::move(pState)) {}
+};
+
+void DilateImage(unsigned char *pImageBuff, int w, int h, CJobPool *pJobPool)
+{
+	DilateImageSub(pImageBuff, w, h, 0, 0, w, h, pJobPool);
+}
+
+void DilateImageSub(unsigned char *pImageBuff, int w, int h, int x, int y, int sw, int sh, CJobPool *pJobPool)
+{
+	if(sw <= 0 || sh <= 0)
+		return;
+
+	// the bands are large enough that dilating their border rows twice
+	// costs little
+	const int NumBands = pJobPool ? maximum(sh / (int)DILATE_MIN_BAND_HEIGHT, 1) : 1;
+	auto pState = std::make_shared<CDilateState>(pImageBuff, w, x, y, sw, sh, NumBands);
+	if(pJobPool)
+	{
+		const int NumJobs = maximum(minimum<int>(NumBands, std::thread::hardware_concurrency()) - 1, 0);
+		for(int i = 0; i < NumJobs; i++)
+			pJobPool->Add(std::make_shared<CDilateJob>(pState));
+	}
+	pState->Process();
+	pState->Wait();
 }
 
 static float CubicHermite(float A, float B, float C, float D, float t)
@@ -3,9 +3,13 @@
 
 #include <cstdint>
 
+class CJobPool;
+
 // These functions assume that the image data is 4 bytes per pixel RGBA
-void DilateImage(unsigned char *pImageBuff, int w, int h);
-void DilateImageSub(unsigned char *pImageBuff, int w, int h, int x, int y, int sw, int sh);
+// With a job pool, large images are dilated in row bands on the pool and on
+// the calling thread. The result is the same as without it.
+void DilateImage(unsigned char *pImageBuff, int w, int h, CJobPool *pJobPool = nullptr);
+void DilateImageSub(unsigned char *pImageBuff, int w, int h, int x, int y, int sw, int sh, CJobPool *pJobPool = nullptr);
 
 // returned pointer is allocated with malloc
 uint8_t *ResizeImage(const uint8_t *pImageData, int Width, int Height, int NewWidth, int NewHeight, int BPP);
@@ -274,6 +274,8 @@ public:
 	int WindowHeight() const { return m_ScreenHeight / m_ScreenHiDPIScale; }
 
 	virtual void WarnPngliteIncompatibleImages(bool Warn) = 0;
+	// adds a warning if enabled, `PngliteIncompatible` is set by `DecodePNG`
+	virtual void WarnPngliteIncompatibility(const char *pFilename, int PngliteIncompatible) = 0;
 	virtual void SetWindowParams(int FullscreenMode, bool IsBorderless, bool AllowResizing) = 0;
 	virtual bool SetWindowScreen(int Index) = 0;
 	virtual bool SetVSync(bool State) = 0;
@@ -28,6 +28,8 @@ public:
 	virtual int FindItemIndex(int Type, int ID) = 0;
 	virtual void *FindItem(int Type, int ID) = 0;
 	virtual int NumItems() const = 0;
+
+	virtual SHA256_DIGEST Sha256() const = 0;
 };
 
 class IEngineMap : public IMap
@@ -39,7 +41,6 @@ public:
 	virtual bool IsLoaded() const = 0;
 	virtual IOHANDLE File() const = 0;
 
-	virtual SHA256_DIGEST Sha256() const = 0;
 	virtual unsigned Crc() const = 0;
 	virtual int MapSize() const = 0;
 };
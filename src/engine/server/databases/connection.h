@@ -4,10 +4,81 @@
 #include "connection_pool.h"
 #include <base/system.h>
 
+#include <chrono>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 class IConsole;
 
+// Keeps the prepared statements of a connection by their query text, so that
+// repeated queries don't have to be parsed and planned again. `TStmtPtr` is
+// a unique pointer freeing the statement.
+template<typename TStmtPtr>
+class CStatementCache
+{
+public:
+	typedef typename TStmtPtr::pointer TStmt;
+
+	enum
+	{
+		MAX_STATEMENTS = 32,
+	};
+
+	// returns nullptr if the query isn't cached
+	TStmt Find(const char *pQuery)
+	{
+		auto It = m_Statements.find(pQuery);
+		if(It == m_Statements.end())
+			return nullptr;
+		It->second.m_LastUse = ++m_UseCounter;
+		return It->second.m_pStmt.get();
+	}
+
+	// frees the least recently used statement if the cache is full
+	TStmt Add(const char *pQuery, TStmtPtr pStmt)
+	{
+		if(m_Statements.size() >= MAX_STATEMENTS)
+		{
+			auto Oldest = m_Statements.begin();
+			for(auto It = m_Statements.begin(); It != m_Statements.end(); ++It)
+			{
+				if(It->second.m_LastUse < Oldest->second.m_LastUse)
+					Oldest = It;
+			}
+			m_Statements.erase(Oldest);
+		}
+		CEntry &Entry = m_Statements[pQuery];
+		Entry.m_pStmt = std::move(pStmt);
+		Entry.m_LastUse = ++m_UseCounter;
+		return Entry.m_pStmt.get();
+	}
+
+	// keeps a statement outside of the cache until the next one-off query,
+	// so that queries with inlined values don't evict reusable statements
+	TStmt SetUncached(TStmtPtr pStmt)
+	{
+		m_pUncached = std::move(pStmt);
+		return m_pUncached.get();
+	}
+
+	void Clear()
+	{
+		m_Statements.clear();
+		m_pUncached = nullptr;
+	}
+
+private:
+	struct CEntry
+	{
+		TStmtPtr m_pStmt;
+		int64_t m_LastUse;
+	};
+	std::unordered_map<std::string, CEntry> m_Statements;
+	TStmtPtr m_pUncached;
+	int64_t m_UseCounter = 0;
+};
+
 // can hold one PreparedStatement with Results
 class IDbConnection
 {
@@ -20,6 +91,17 @@ public:
 	IDbConnection &operator=(const IDbConnection &) = delete;
 	virtual void Print(IConsole *pConsole, const char *pMode) = 0;
 
+	struct CPrepareStats
+	{
+		// statements reused from the statement cache
+		int64_t m_NumCached = 0;
+		// statements that had to be compiled
+		int64_t m_NumPrepared = 0;
+		std::chrono::nanoseconds m_PrepareTime{0};
+	};
+	// only to be read by the thread using the connection
+	const CPrepareStats &PrepareStats() const { return m_PrepareStats; }
+
 	// returns the database prefix
 	const char *GetPrefix() const { return m_aPrefix; }
 	virtual const char *BinaryCollate() const = 0;
@@ -48,9 +130,10 @@ public:
 	virtual void Disconnect() = 0;
 
 	// ? for Placeholders, connection has to be established, can overwrite previous prepared statements
+	// set Cache to false for query texts that are unlikely to repeat
 	//
 	// returns true on failure
-	virtual bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize) = 0;
+	virtual bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize, bool Cache = true) = 0;
 
 	// PrepareStatement has to be called beforehand,
 	virtual void BindString(int Idx, const char *pString) = 0;
@@ -81,6 +164,16 @@ public:
 	// returns number of bytes read into the buffer
 	virtual int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) = 0;
 
+	// groups the following statements into one transaction, which has to be
+	// ended by either committing or rolling back
+	//
+	// returns true on failure
+	virtual bool BeginTransaction(char *pError, int ErrorSize) = 0;
+	// returns true on failure
+	virtual bool CommitTransaction(char *pError, int ErrorSize) = 0;
+	// returns true on failure
+	virtual bool RollbackTransaction(char *pError, int ErrorSize) = 0;
+
 	// SQL statements, that can't be abstracted, has side effects to the result
 	virtual bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) = 0;
 
@@ -88,6 +181,8 @@ private:
 	char m_aPrefix[64];
 
 protected:
+	CPrepareStats m_PrepareStats;
+
 	void FormatCreateRace(char *aBuf, unsigned int BufferSize, bool Backup);
 	void FormatCreateTeamrace(char *aBuf, unsigned int BufferSize, const char *pIdType, bool Backup);
 	void FormatCreateMaps(char *aBuf, unsigned int BufferSize);
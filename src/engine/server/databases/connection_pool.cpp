@@ -1,18 +1,32 @@
 #include "connection_pool.h"
 #include "connection.h"
 
+#include <base/math.h>
 #include <base/system.h>
-#include <cstring>
+#include <base/tl/threading.h>
 #include <engine/console.h>
 
+#include <algorithm>
 #include <chrono>
-#include <iterator>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 using namespace std::chrono_literals;
 
+// registered database, each thread creates its own connection from it
+struct CDbConfig
+{
+	CDbConnectionPool::Mode m_Mode;
+	bool m_Mysql;
+	CMysqlConfig m_MysqlConfig;
+	char m_aFileName[64];
+};
+
 // helper struct to hold thread data
 struct CSqlExecData
 {
@@ -23,13 +37,8 @@ struct CSqlExecData
 	CSqlExecData(
 		CDbConnectionPool::FWrite pFunc,
 		std::unique_ptr<const ISqlData> pThreadData,
-		const char *pName);
-	CSqlExecData(
-		CDbConnectionPool::Mode m,
-		const char aFileName[64]);
-	CSqlExecData(
-		CDbConnectionPool::Mode m,
-		const CMysqlConfig *pMysqlConfig);
+		const char *pName,
+		const char *pShardKey);
 	CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m);
 	~CSqlExecData() = default;
 
@@ -37,8 +46,6 @@ struct CSqlExecData
 	{
 		READ_ACCESS,
 		WRITE_ACCESS,
-		ADD_MYSQL,
-		ADD_SQLITE,
 		PRINT,
 	} m_Mode;
 	union
@@ -46,16 +53,6 @@ struct CSqlExecData
 		CDbConnectionPool::FRead m_pReadFunc;
 		CDbConnectionPool::FWrite m_pWriteFunc;
 		struct
-		{
-			CDbConnectionPool::Mode m_Mode;
-			CMysqlConfig m_Config;
-		} m_MySql;
-		struct
-		{
-			CDbConnectionPool::Mode m_Mode;
-			char m_FileName[64];
-		} m_Sqlite;
-		struct
 		{
 			IConsole *m_pConsole;
 			CDbConnectionPool::Mode m_Mode;
@@ -64,6 +61,12 @@ struct CSqlExecData
 
 	std::unique_ptr<const ISqlData> m_pThreadData;
 	const char *m_pName;
+	// writes with the same hash are executed by the same worker
+	unsigned m_ShardHash = 0;
+	int m_JobNum = 0;
+	std::chrono::nanoseconds m_QueuedTime{0};
+	// statement preparation on all connections the query was executed on
+	IDbConnection::CPrepareStats m_PrepareStats;
 };
 
 CSqlExecData::CSqlExecData(
@@ -80,34 +83,16 @@ CSqlExecData::CSqlExecData(
 CSqlExecData::CSqlExecData(
 	CDbConnectionPool::FWrite pFunc,
 	std::unique_ptr<const ISqlData> pThreadData,
-	const char *pName) :
+	const char *pName,
+	const char *pShardKey) :
 	m_Mode(WRITE_ACCESS),
 	m_pThreadData(std::move(pThreadData)),
-	m_pName(pName)
+	m_pName(pName),
+	m_ShardHash(str_quickhash(pShardKey))
 {
 	m_Ptr.m_pWriteFunc = pFunc;
 }
 
-CSqlExecData::CSqlExecData(
-	CDbConnectionPool::Mode m,
-	const char aFileName[64]) :
-	m_Mode(ADD_SQLITE),
-	m_pThreadData(nullptr),
-	m_pName("add sqlite server")
-{
-	m_Ptr.m_Sqlite.m_Mode = m;
-	mem_copy(m_Ptr.m_Sqlite.m_FileName, aFileName, sizeof(m_Ptr.m_Sqlite.m_FileName));
-}
-CSqlExecData::CSqlExecData(CDbConnectionPool::Mode m,
-	const CMysqlConfig *pMysqlConfig) :
-	m_Mode(ADD_MYSQL),
-	m_pThreadData(nullptr),
-	m_pName("add mysql server")
-{
-	m_Ptr.m_MySql.m_Mode = m;
-	mem_copy(&m_Ptr.m_MySql.m_Config, pMysqlConfig, sizeof(m_Ptr.m_MySql.m_Config));
-}
-
 CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Mode(PRINT),
 	m_pThreadData(nullptr),
@@ -117,25 +102,244 @@ CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Ptr.m_Print.m_Mode = m;
 }
 
+// unbounded mpsc queue, a nullptr signals the consumer to stop
+class CQueryQueue
+{
+public:
+	void Push(std::unique_ptr<CSqlExecData> pData)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_vpQueries.push_back(std::move(pData));
+		}
+		m_NumQueries.Signal();
+	}
+	std::unique_ptr<CSqlExecData> Pop()
+	{
+		m_NumQueries.Wait();
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		std::unique_ptr<CSqlExecData> pData = std::move(m_vpQueries.front());
+		m_vpQueries.pop_front();
+		return pData;
+	}
+	bool Empty() { return m_NumQueries.GetApproximateValue() == 0; }
+
+	// number of queries queued or running on the worker owning the queue
+	std::atomic_int m_NumPending{0};
+
+private:
+	std::mutex m_Mutex;
+	std::deque<std::unique_ptr<CSqlExecData>> m_vpQueries;
+	CSemaphore m_NumQueries;
+};
+
+struct CQueryStats
+{
+	int64_t m_Count = 0;
+	int64_t m_NumItems = 0;
+	int64_t m_NumFailed = 0;
+	std::chrono::nanoseconds m_Total{0};
+	std::chrono::nanoseconds m_Max{0};
+	int64_t m_NumCached = 0;
+	int64_t m_NumPrepared = 0;
+	std::chrono::nanoseconds m_PrepareTime{0};
+	int64_t m_aBuckets[CDbConnectionPool::NUM_LATENCY_BUCKETS] = {0};
+};
+
+struct CDbConnectionPool::CSharedData
+{
+	// Used as signal that shutdown is in progress from main thread to
+	// speed up the queries by discarding read queries and writing to
+	// the sqlite file instead of the remote mysql server.
+	std::atomic_bool m_Shutdown{false};
+	// The workers decrement this after processing all of their queries
+	// when shutting down.
+	std::atomic_int m_NumRunningWorkers{0};
+
+	// Queries go first to the backup thread, which passes them on to the
+	// queue of a worker. The worker queues are only set before the threads
+	// are started.
+	CQueryQueue m_BackupQueue;
+	std::vector<std::unique_ptr<CQueryQueue>> m_vpWorkerQueues;
+
+	// registered databases, only appended to
+	std::mutex m_ConfigMutex;
+	std::vector<CDbConfig> m_vConfigs;
+
+	// latencies of read (0) and write (1) queries by query name
+	std::mutex m_StatsMutex;
+	std::map<std::string, CQueryStats> m_aStats[2];
+
+	void AddStats(const CSqlExecData *pData, bool Success);
+};
+
+void CDbConnectionPool::CSharedData::AddStats(const CSqlExecData *pData, bool Success)
+{
+	const std::chrono::nanoseconds Latency = time_get_nanoseconds() - pData->m_QueuedTime;
+	const int64_t Milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(Latency).count();
+	int Bucket = 0;
+	while(Bucket < NUM_LATENCY_BUCKETS - 1 && Milliseconds >= (int64_t(1) << Bucket))
+		Bucket++;
+
+	std::unique_lock<std::mutex> Lock(m_StatsMutex);
+	CQueryStats &Stats = m_aStats[pData->m_Mode == CSqlExecData::WRITE_ACCESS][pData->m_pName];
+	Stats.m_Count++;
+	Stats.m_NumItems += pData->m_pThreadData ? pData->m_pThreadData->NumItems() : 1;
+	if(!Success)
+		Stats.m_NumFailed++;
+	Stats.m_Total += Latency;
+	Stats.m_Max = std::max(Stats.m_Max, Latency);
+	Stats.m_NumCached += pData->m_PrepareStats.m_NumCached;
+	Stats.m_NumPrepared += pData->m_PrepareStats.m_NumPrepared;
+	Stats.m_PrepareTime += pData->m_PrepareStats.m_PrepareTime;
+	Stats.m_aBuckets[Bucket]++;
+}
+
+// The connections of a single thread. There are two possible configurations
+//  * sqlite mode: There exists exactly one READ and the same WRITE server
+//                 with no WRITE_BACKUP server
+//  * mysql mode: there can exist multiple READ server, there must be at
+//                most one WRITE server. The WRITE server for all DDNet
+//                Servers must be the same (to counteract double loads).
+//                There may be one WRITE_BACKUP sqlite server.
+class CDbConnections
+{
+public:
+	// creates the connections of databases registered since the last call
+	void Update(CDbConnectionPool::CSharedData *pShared);
+	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+
+	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
+	std::unique_ptr<IDbConnection> m_pWriteConnection;
+	std::unique_ptr<IDbConnection> m_pWriteBackup;
+
+private:
+	size_t m_NumConfigs = 0;
+};
+
+void CDbConnections::Update(CDbConnectionPool::CSharedData *pShared)
+{
+	std::unique_lock<std::mutex> Lock(pShared->m_ConfigMutex);
+	for(; m_NumConfigs < pShared->m_vConfigs.size(); m_NumConfigs++)
+	{
+		const CDbConfig &Config = pShared->m_vConfigs[m_NumConfigs];
+		std::unique_ptr<IDbConnection> pConnection;
+		if(Config.m_Mysql)
+			pConnection = CreateMysqlConnection(Config.m_MysqlConfig);
+		else
+			pConnection = CreateSqliteConnection(Config.m_aFileName, true);
+		switch(Config.m_Mode)
+		{
+		case CDbConnectionPool::Mode::READ:
+			m_vpReadConnections.push_back(std::move(pConnection));
+			break;
+		case CDbConnectionPool::Mode::WRITE:
+			m_pWriteConnection = std::move(pConnection);
+			break;
+		case CDbConnectionPool::Mode::WRITE_BACKUP:
+			m_pWriteBackup = std::move(pConnection);
+			break;
+		case CDbConnectionPool::Mode::NUM_MODES:
+			break;
+		}
+	}
+}
+
+void CDbConnections::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+{
+	if(DatabaseMode == CDbConnectionPool::Mode::READ)
+	{
+		for(auto &pReadConnection : m_vpReadConnections)
+			pReadConnection->Print(pConsole, "Read");
+		if(m_vpReadConnections.empty())
+			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+	}
+	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
+	{
+		if(m_pWriteConnection)
+			m_pWriteConnection->Print(pConsole, "Write");
+		else
+			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no write databases");
+	}
+	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE_BACKUP)
+	{
+		if(m_pWriteBackup)
+			m_pWriteBackup->Print(pConsole, "WriteBackup");
+		else
+			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no write backup databases");
+	}
+}
+
 void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
+}
+
+void CDbConnectionPool::PrintStats(IConsole *pConsole, Mode DatabaseMode)
+{
+	std::unique_lock<std::mutex> Lock(m_pShared->m_StatsMutex);
+	const auto &Stats = m_pShared->m_aStats[DatabaseMode != Mode::READ];
+	if(Stats.empty())
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", DatabaseMode == Mode::READ ? "No read queries executed" : "No write queries executed");
+		return;
+	}
+	for(const auto &[Name, QueryStats] : Stats)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "%s: %" PRId64 " queries, %" PRId64 " failed, avg %.2fms, max %.2fms",
+			Name.c_str(), QueryStats.m_Count, QueryStats.m_NumFailed,
+			QueryStats.m_Total.count() / 1e6 / QueryStats.m_Count, QueryStats.m_Max.count() / 1e6);
+		if(QueryStats.m_NumItems != QueryStats.m_Count)
+		{
+			char aItems[128];
+			str_format(aItems, sizeof(aItems), ", %" PRId64 " batched requests (%.1f per query)",
+				QueryStats.m_NumItems, (double)QueryStats.m_NumItems / QueryStats.m_Count);
+			str_append(aBuf, aItems, sizeof(aBuf));
+		}
+		if(QueryStats.m_NumPrepared + QueryStats.m_NumCached > 0)
+		{
+			char aPrepared[128];
+			str_format(aPrepared, sizeof(aPrepared), ", %" PRId64 " statements prepared (%.2fms), %" PRId64 " cached",
+				QueryStats.m_NumPrepared, QueryStats.m_PrepareTime.count() / 1e6, QueryStats.m_NumCached);
+			str_append(aBuf, aPrepared, sizeof(aBuf));
+		}
+		str_append(aBuf, " |", sizeof(aBuf));
+		for(int i = 0; i < NUM_LATENCY_BUCKETS; i++)
+		{
+			if(QueryStats.m_aBuckets[i] == 0)
+				continue;
+			char aBucket[64];
+			if(i == NUM_LATENCY_BUCKETS - 1)
+				str_format(aBucket, sizeof(aBucket), " >=%dms: %" PRId64, 1 << (i - 1), QueryStats.m_aBuckets[i]);
+			else
+				str_format(aBucket, sizeof(aBucket), " <%dms: %" PRId64, 1 << i, QueryStats.m_aBuckets[i]);
+			str_append(aBuf, aBucket, sizeof(aBuf));
+		}
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
 }
 
 void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	CDbConfig Config;
+	Config.m_Mode = DatabaseMode;
+	Config.m_Mysql = false;
+	mem_zero(&Config.m_MysqlConfig, sizeof(Config.m_MysqlConfig));
+	str_copy(Config.m_aFileName, aFileName, sizeof(Config.m_aFileName));
+	std::unique_lock<std::mutex> Lock(m_pShared->m_ConfigMutex);
+	m_pShared->m_vConfigs.push_back(Config);
 }
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	CDbConfig Config;
+	Config.m_Mode = DatabaseMode;
+	Config.m_Mysql = true;
+	mem_copy(&Config.m_MysqlConfig, pMysqlConfig, sizeof(Config.m_MysqlConfig));
+	Config.m_aFileName[0] = '\0';
+	std::unique_lock<std::mutex> Lock(m_pShared->m_ConfigMutex);
+	m_pShared->m_vConfigs.push_back(Config);
 }
 
 void CDbConnectionPool::Execute(
@@ -143,30 +347,36 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
 }
 
 void CDbConnectionPool::ExecuteWrite(
 	FWrite pFunc,
 	std::unique_ptr<const ISqlData> pSqlRequestData,
-	const char *pName)
+	const char *pName,
+	const char *pShardKey)
+{
+	Enqueue(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName, pShardKey));
+}
+
+void CDbConnectionPool::Enqueue(std::unique_ptr<CSqlExecData> pData)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	pData->m_JobNum = m_NextJobNum++;
+	pData->m_QueuedTime = time_get_nanoseconds();
+	m_pShared->m_BackupQueue.Push(std::move(pData));
 }
 
 void CDbConnectionPool::OnShutdown()
 {
 	if(m_Shutdown)
 		return;
+	// work through the queued queries even if the workers were never started
+	Start(1);
 	m_Shutdown = true;
 	m_pShared->m_Shutdown.store(true);
-	m_pShared->m_NumBackup.Signal();
+	m_pShared->m_BackupQueue.Push(nullptr);
 	int i = 0;
-	while(m_pShared->m_Shutdown.load())
+	while(m_pShared->m_NumRunningWorkers.load() > 0)
 	{
 		// print a log about every two seconds
 		if(i % 20 == 0 && i > 0)
@@ -180,7 +390,7 @@ void CDbConnectionPool::OnShutdown()
 
 // The backup worker thread looks at write queries and stores them
 // in the sqlite database (WRITE_BACKUP). It skips over read queries.
-// After processing the query, it gets passed on to the Worker thread.
+// After processing the query, it gets passed on to a worker thread.
 // This is done to not loose ranks when the server shuts down before all
 // queries are executed on the mysql server
 class CBackup
@@ -192,8 +402,10 @@ public:
 
 private:
 	void ProcessQueries();
+	// returns the index of the worker queue the query is passed on to
+	int ChooseWorker(const CSqlExecData *pData) const;
 
-	std::unique_ptr<IDbConnection> m_pWriteBackup;
+	CDbConnections m_Connections;
 
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
 };
@@ -208,60 +420,70 @@ void CBackup::Start(void *pUser)
 
 void CBackup::ProcessQueries()
 {
-	for(int JobNum = 0;; JobNum++)
+	while(true)
 	{
-		m_pShared->m_NumBackup.Wait();
-		CSqlExecData *pThreadData = m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)].get();
+		std::unique_ptr<CSqlExecData> pThreadData = m_pShared->m_BackupQueue.Pop();
 
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
 		{
-			m_pShared->m_NumWorker.Signal();
+			for(auto &pQueue : m_pShared->m_vpWorkerQueues)
+				pQueue->Push(nullptr);
 			return;
 		}
 
-		if(pThreadData->m_Mode == CSqlExecData::ADD_SQLITE &&
-			pThreadData->m_Ptr.m_Sqlite.m_Mode == CDbConnectionPool::Mode::WRITE_BACKUP)
+		if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS)
 		{
-			m_pWriteBackup = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
+			m_Connections.Update(m_pShared.get());
+			if(m_Connections.m_pWriteBackup)
+			{
+				bool Success = CDbConnectionPool::ExecSqlFunc(m_Connections.m_pWriteBackup.get(), pThreadData.get(), Write::BACKUP_FIRST);
+				dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", pThreadData->m_JobNum, pThreadData->m_pName, Success);
+			}
 		}
-		else if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && m_pWriteBackup.get())
+		CQueryQueue *pQueue = m_pShared->m_vpWorkerQueues[ChooseWorker(pThreadData.get())].get();
+		pQueue->m_NumPending.fetch_add(1);
+		pQueue->Push(std::move(pThreadData));
+	}
+}
+
+int CBackup::ChooseWorker(const CSqlExecData *pData) const
+{
+	const int NumWorkers = m_pShared->m_vpWorkerQueues.size();
+	if(pData->m_Mode == CSqlExecData::WRITE_ACCESS)
+		return pData->m_ShardHash % NumWorkers;
+
+	// reads go to the least busy worker
+	int Best = 0;
+	int BestPending = m_pShared->m_vpWorkerQueues[0]->m_NumPending.load();
+	for(int i = 1; i < NumWorkers; i++)
+	{
+		const int Pending = m_pShared->m_vpWorkerQueues[i]->m_NumPending.load();
+		if(Pending < BestPending)
 		{
-			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, Write::BACKUP_FIRST);
-			dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum, pThreadData->m_pName, Success);
+			Best = i;
+			BestPending = Pending;
 		}
-		m_pShared->m_NumWorker.Signal();
 	}
+	return Best;
 }
 
 // the worker threads executes queries on mysql or sqlite. If we write on
 // a mysql server and have a backup server configured, we'll remove the
 // entry from the backup server after completing it on the write server.
-// static void Worker(void *pUser);
 class CWorker
 {
 public:
-	CWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared) :
-		m_pShared(std::move(pShared)) {}
+	CWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, CQueryQueue *pQueue) :
+		m_pShared(std::move(pShared)), m_pQueue(pQueue) {}
 	static void Start(void *pUser);
 	void ProcessQueries();
 
 private:
-	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
-
-	// There are two possible configurations
-	//  * sqlite mode: There exists exactly one READ and the same WRITE server
-	//                 with no WRITE_BACKUP server
-	//  * mysql mode: there can exist multiple READ server, there must be at
-	//                most one WRITE server. The WRITE server for all DDNet
-	//                Servers must be the same (to counteract double loads).
-	//                There may be one WRITE_BACKUP sqlite server.
-	// This variable should only change, before the worker threads
-	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
-	std::unique_ptr<IDbConnection> m_pWriteConnection;
-	std::unique_ptr<IDbConnection> m_pWriteBackup;
+	CDbConnections m_Connections;
 
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
+	CQueryQueue *m_pQueue;
 };
 
 /* static */
@@ -274,31 +496,33 @@ void CWorker::Start(void *pUser)
 
 void CWorker::ProcessQueries()
 {
+	auto &vpReadConnections = m_Connections.m_vpReadConnections;
 	// remember last working server and try to connect to it first
 	int ReadServer = 0;
 	// enter fail mode when a sql request fails, skip read request during it and
 	// write to the backup database until all requests are handled
 	bool FailMode = false;
-	for(int JobNum = 0;; JobNum++)
+	while(true)
 	{
-		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
+		if(FailMode && m_pQueue->Empty())
 		{
 			FailMode = false;
 		}
-		m_pShared->m_NumWorker.Wait();
-		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
+		std::unique_ptr<CSqlExecData> pThreadData = m_pQueue->Pop();
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
 		{
-			m_pShared->m_Shutdown.store(false);
+			m_pShared->m_NumRunningWorkers.fetch_sub(1);
 			return;
 		}
+		m_Connections.Update(m_pShared.get());
+		const int JobNum = pThreadData->m_JobNum;
 		bool Success = false;
 		switch(pThreadData->m_Mode)
 		{
 		case CSqlExecData::READ_ACCESS:
 		{
-			for(size_t i = 0; i < m_vpReadConnections.size(); i++)
+			for(size_t i = 0; i < vpReadConnections.size(); i++)
 			{
 				if(m_pShared->m_Shutdown)
 				{
@@ -310,8 +534,8 @@ void CWorker::ProcessQueries()
 					dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
 					break;
 				}
-				int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
-				if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
+				int CurServer = (ReadServer + i) % (int)vpReadConnections.size();
+				if(CDbConnectionPool::ExecSqlFunc(vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
 				{
 					ReadServer = CurServer;
 					dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
@@ -327,15 +551,16 @@ void CWorker::ProcessQueries()
 		break;
 		case CSqlExecData::WRITE_ACCESS:
 		{
-			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
+			IDbConnection *pWriteBackup = m_Connections.m_pWriteBackup.get();
+			if(m_pShared->m_Shutdown && pWriteBackup != nullptr)
 			{
 				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
 			}
-			else if(FailMode && m_pWriteBackup != nullptr)
+			else if(FailMode && pWriteBackup != nullptr)
 			{
 				dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
 			}
-			else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
+			else if(CDbConnectionPool::ExecSqlFunc(m_Connections.m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
 			{
 				dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
 				Success = true;
@@ -343,90 +568,25 @@ void CWorker::ProcessQueries()
 			// enter fail mode if not successful
 			FailMode = FailMode || !Success;
 			const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
-			if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), w))
+			if(pWriteBackup && CDbConnectionPool::ExecSqlFunc(pWriteBackup, pThreadData.get(), w))
 			{
 				dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
 				Success = true;
 			}
 		}
 		break;
-		case CSqlExecData::ADD_MYSQL:
-		{
-			auto pMysql = CreateMysqlConnection(pThreadData->m_Ptr.m_MySql.m_Config);
-			switch(pThreadData->m_Ptr.m_MySql.m_Mode)
-			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pMysql));
-				break;
-			case CDbConnectionPool::Mode::WRITE:
-				m_pWriteConnection = std::move(pMysql);
-				break;
-			case CDbConnectionPool::Mode::WRITE_BACKUP:
-				m_pWriteBackup = std::move(pMysql);
-				break;
-			case CDbConnectionPool::Mode::NUM_MODES:
-				break;
-			}
-			Success = true;
-			break;
-		}
-		case CSqlExecData::ADD_SQLITE:
-		{
-			auto pSqlite = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
-			switch(pThreadData->m_Ptr.m_Sqlite.m_Mode)
-			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pSqlite));
-				break;
-			case CDbConnectionPool::Mode::WRITE:
-				m_pWriteConnection = std::move(pSqlite);
-				break;
-			case CDbConnectionPool::Mode::WRITE_BACKUP:
-				m_pWriteBackup = std::move(pSqlite);
-				break;
-			case CDbConnectionPool::Mode::NUM_MODES:
-				break;
-			}
-			Success = true;
-			break;
-		}
 		case CSqlExecData::PRINT:
-			Print(pThreadData->m_Ptr.m_Print.m_pConsole, pThreadData->m_Ptr.m_Print.m_Mode);
+			m_Connections.Print(pThreadData->m_Ptr.m_Print.m_pConsole, pThreadData->m_Ptr.m_Print.m_Mode);
 			Success = true;
 			break;
 		}
 		if(!Success)
 			dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
-		if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
-		{
-			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
-			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
-		}
-	}
-}
-
-void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
-{
-	if(DatabaseMode == CDbConnectionPool::Mode::READ)
-	{
-		for(auto &pReadConnection : m_vpReadConnections)
-			pReadConnection->Print(pConsole, "Read");
-		if(m_vpReadConnections.empty())
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
-	}
-	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
-	{
-		if(m_pWriteConnection)
-			m_pWriteConnection->Print(pConsole, "Write");
-		else
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no write databases");
-	}
-	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE_BACKUP)
-	{
-		if(m_pWriteBackup)
-			m_pWriteBackup->Print(pConsole, "WriteBackup");
-		else
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no write backup databases");
+		if(pThreadData->m_Mode != CSqlExecData::PRINT)
+			m_pShared->AddStats(pThreadData.get(), Success);
+		if(pThreadData->m_pThreadData != nullptr)
+			pThreadData->m_pThreadData->SetCompleted(Success);
+		m_pQueue->m_NumPending.fetch_sub(1);
 	}
 }
 
@@ -444,6 +604,7 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 		dbg_msg("sql", "failed connecting to db: %s", aError);
 		return false;
 	}
+	const IDbConnection::CPrepareStats PrepareStats = pConnection->PrepareStats();
 	bool Success = false;
 	switch(pData->m_Mode)
 	{
@@ -457,6 +618,9 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 		dbg_assert(false, "unreachable");
 	}
 	pConnection->Disconnect();
+	pData->m_PrepareStats.m_NumCached += pConnection->PrepareStats().m_NumCached - PrepareStats.m_NumCached;
+	pData->m_PrepareStats.m_NumPrepared += pConnection->PrepareStats().m_NumPrepared - PrepareStats.m_NumPrepared;
+	pData->m_PrepareStats.m_PrepareTime += pConnection->PrepareStats().m_PrepareTime - PrepareStats.m_PrepareTime;
 	if(!Success)
 	{
 		dbg_msg("sql", "%s failed: %s", pData->m_pName, aError);
@@ -467,15 +631,27 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 CDbConnectionPool::CDbConnectionPool()
 {
 	m_pShared = std::make_shared<CSharedData>();
-	m_pWorkerThread = thread_init(CWorker::Start, new CWorker(m_pShared), "database worker thread");
+}
+
+void CDbConnectionPool::Start(int NumWorkers)
+{
+	if(m_Started)
+		return;
+	m_Started = true;
+	NumWorkers = clamp(NumWorkers, 1, (int)MAX_WORKERS);
+	for(int i = 0; i < NumWorkers; i++)
+		m_pShared->m_vpWorkerQueues.push_back(std::make_unique<CQueryQueue>());
+	m_pShared->m_NumRunningWorkers.store(NumWorkers);
+	for(int i = 0; i < NumWorkers; i++)
+		m_vpWorkerThreads.push_back(thread_init(CWorker::Start, new CWorker(m_pShared, m_pShared->m_vpWorkerQueues[i].get()), "database worker thread"));
 	m_pBackupThread = thread_init(CBackup::Start, new CBackup(m_pShared), "database backup worker thread");
 }
 
 CDbConnectionPool::~CDbConnectionPool()
 {
 	OnShutdown();
-	if(m_pWorkerThread)
-		thread_wait(m_pWorkerThread);
+	for(void *pThread : m_vpWorkerThreads)
+		thread_wait(pThread);
 	if(m_pBackupThread)
 		thread_wait(m_pBackupThread);
 }
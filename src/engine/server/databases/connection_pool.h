@@ -2,7 +2,6 @@
 #define ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
 
 #include <atomic>
-#include <base/tl/threading.h>
 #include <memory>
 #include <vector>
 
@@ -28,6 +27,17 @@ struct ISqlData
 	}
 	virtual ~ISqlData() = default;
 
+	// called by the worker thread after the query is done on all databases
+	virtual void SetCompleted(bool Success) const
+	{
+		if(m_pResult == nullptr)
+			return;
+		m_pResult->m_Success = Success;
+		m_pResult->m_Completed.store(true);
+	}
+	// number of requests handled by the query, more than one if it is batched
+	virtual int NumItems() const { return 1; }
+
 	mutable std::shared_ptr<ISqlResult> m_pResult;
 };
 
@@ -57,6 +67,11 @@ struct CMysqlConfig
 	bool m_Setup;
 };
 
+// Executes the database queries on worker threads. Each worker holds its own
+// connections to the registered databases, so read queries can run
+// concurrently. Write queries are distributed by a shard key (usually the
+// player name or save code), so that writes with the same key are executed
+// in the order they were queued.
 class CDbConnectionPool
 {
 public:
@@ -76,7 +91,20 @@ public:
 		NUM_MODES,
 	};
 
+	enum
+	{
+		MAX_WORKERS = 16,
+		// query latencies are counted in buckets of [0, 1), [1, 2), [2, 4), ... milliseconds
+		NUM_LATENCY_BUCKETS = 14,
+	};
+
+	// Starts the worker threads. Queries queued before are executed once
+	// the workers are running. Only the first call has an effect.
+	void Start(int NumWorkers);
+
 	void Print(IConsole *pConsole, Mode DatabaseMode);
+	// prints the latency histograms of the read or write queries
+	void PrintStats(IConsole *pConsole, Mode DatabaseMode);
 
 	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
@@ -90,44 +118,30 @@ public:
 	void ExecuteWrite(
 		FWrite pFunc,
 		std::unique_ptr<const ISqlData> pSqlRequestData,
-		const char *pName);
+		const char *pName,
+		const char *pShardKey);
 
 	void OnShutdown();
 
 	friend class CWorker;
 	friend class CBackup;
+	friend class CDbConnections;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
 
-	// Only the main thread accesses this variable. It points to the index,
-	// where the next query is added to the queue.
-	int m_InsertIdx = 0;
+	void Enqueue(std::unique_ptr<struct CSqlExecData> pData);
 
+	// Only the main thread accesses these variables. The job number is
+	// only used to identify queries in the log.
+	int m_NextJobNum = 0;
+	bool m_Started = false;
 	bool m_Shutdown = false;
 
-	struct CSharedData
-	{
-		// Used as signal that shutdown is in progress from main thread to
-		// speed up the queries by discarding read queries and writing to
-		// the sqlite file instead of the remote mysql server.
-		// The worker thread signals the main thread that all queries are
-		// processed by setting this variable to false again.
-		std::atomic_bool m_Shutdown{false};
-		// Queries go first to the backup thread. This semaphore signals about
-		// new queries.
-		CSemaphore m_NumBackup;
-		// When the backup thread processed the query, it signals the main
-		// thread with this semaphore about the new query
-		CSemaphore m_NumWorker;
-
-		// spsc queue with additional backup worker to look at queries first.
-		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
-	};
-
+	struct CSharedData;
 	std::shared_ptr<CSharedData> m_pShared;
-	void *m_pWorkerThread = nullptr;
 	void *m_pBackupThread = nullptr;
+	std::vector<void *> m_vpWorkerThreads;
 };
 
 #endif // ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
@@ -82,7 +82,7 @@ public:
 	bool Connect(char *pError, int ErrorSize) override;
 	void Disconnect() override;
 
-	bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize) override;
+	bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize, bool Cache = true) override;
 
 	void BindString(int Idx, const char *pString) override;
 	void BindBlob(int Idx, unsigned char *pBlob, int Size) override;
@@ -101,6 +101,10 @@ public:
 	void GetString(int Col, char *pBuffer, int BufferSize) override;
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	bool RollbackTransaction(char *pError, int ErrorSize) override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 private:
@@ -114,7 +118,10 @@ private:
 	void StoreErrorMysql(const char *pContext);
 	void StoreErrorStmt(const char *pContext);
 	bool ConnectImpl();
+	// takes the statement from the cache or prepares it, returns true on failure
+	bool PrepareCached(const char *pStmt, bool Cache = true);
 	bool PrepareAndExecuteStatement(const char *pStmt);
+	void ClearStatements();
 	//static void DeleteResult(MYSQL_RES *pResult);
 
 	union UParameterExtra
@@ -127,7 +134,11 @@ private:
 	bool m_NewQuery = false;
 	bool m_HaveConnection = false;
 	MYSQL m_Mysql;
-	std::unique_ptr<MYSQL_STMT, CStmtDeleter> m_pStmt = nullptr;
+	// points into the statement cache
+	MYSQL_STMT *m_pStmt = nullptr;
+	CStatementCache<std::unique_ptr<MYSQL_STMT, CStmtDeleter>> m_StatementCache;
+	// the statements are lost when the client reconnects automatically
+	unsigned long m_ConnectionId = 0;
 	std::vector<MYSQL_BIND> m_vStmtParameters;
 	std::vector<UParameterExtra> m_vStmtParameterExtras;
 
@@ -157,6 +168,7 @@ CMysqlConnection::CMysqlConnection(CMysqlConfig Config) :
 
 CMysqlConnection::~CMysqlConnection()
 {
+	ClearStatements();
 	mysql_close(&m_Mysql);
 	g_MysqlNumConnections -= 1;
 }
@@ -168,17 +180,60 @@ void CMysqlConnection::StoreErrorMysql(const char *pContext)
 
 void CMysqlConnection::StoreErrorStmt(const char *pContext)
 {
-	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(m_pStmt.get()), mysql_stmt_error(m_pStmt.get()));
+	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(m_pStmt), mysql_stmt_error(m_pStmt));
 }
 
-bool CMysqlConnection::PrepareAndExecuteStatement(const char *pStmt)
+bool CMysqlConnection::PrepareCached(const char *pStmt, bool Cache)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	if(m_pStmt && mysql_stmt_free_result(m_pStmt))
+	{
+		StoreErrorStmt("free_result");
+		return true;
+	}
+	m_pStmt = Cache ? m_StatementCache.Find(pStmt) : nullptr;
+	if(m_pStmt != nullptr)
+	{
+		m_PrepareStats.m_NumCached++;
+		return false;
+	}
+
+	const std::chrono::nanoseconds Start = time_get_nanoseconds();
+	std::unique_ptr<MYSQL_STMT, CStmtDeleter> pNewStmt(mysql_stmt_init(&m_Mysql));
+	if(pNewStmt == nullptr)
+	{
+		StoreErrorMysql("stmt_init");
+		return true;
+	}
+	m_pStmt = pNewStmt.get();
+	bool Error = mysql_stmt_prepare(m_pStmt, pStmt, str_length(pStmt));
+	m_PrepareStats.m_NumPrepared++;
+	m_PrepareStats.m_PrepareTime += time_get_nanoseconds() - Start;
+	if(Error)
 	{
 		StoreErrorStmt("prepare");
+		m_pStmt = nullptr;
 		return true;
 	}
-	if(mysql_stmt_execute(m_pStmt.get()))
+	if(Cache)
+		m_pStmt = m_StatementCache.Add(pStmt, std::move(pNewStmt));
+	else
+		m_pStmt = m_StatementCache.SetUncached(std::move(pNewStmt));
+	return false;
+}
+
+void CMysqlConnection::ClearStatements()
+{
+	m_pStmt = nullptr;
+	m_StatementCache.Clear();
+}
+
+bool CMysqlConnection::PrepareAndExecuteStatement(const char *pStmt)
+{
+	if(PrepareCached(pStmt))
+	{
+		return true;
+	}
+	if(mysql_stmt_execute(m_pStmt))
 	{
 		StoreErrorStmt("execute");
 		return true;
@@ -221,7 +276,7 @@ bool CMysqlConnection::ConnectImpl()
 {
 	if(m_HaveConnection)
 	{
-		if(m_pStmt && mysql_stmt_free_result(m_pStmt.get()))
+		if(m_pStmt && mysql_stmt_free_result(m_pStmt))
 		{
 			StoreErrorStmt("free_result");
 			dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
@@ -229,16 +284,22 @@ bool CMysqlConnection::ConnectImpl()
 		if(!mysql_select_db(&m_Mysql, m_Config.m_aDatabase))
 		{
 			// Success.
+			if(mysql_thread_id(&m_Mysql) != m_ConnectionId)
+			{
+				ClearStatements();
+				m_ConnectionId = mysql_thread_id(&m_Mysql);
+			}
 			return false;
 		}
 		StoreErrorMysql("select_db");
 		dbg_msg("mysql", "ping error, trying to reconnect %s", m_aErrorDetail);
+		ClearStatements();
 		mysql_close(&m_Mysql);
 		mem_zero(&m_Mysql, sizeof(m_Mysql));
 		mysql_init(&m_Mysql);
 	}
 
-	m_pStmt = nullptr;
+	ClearStatements();
 	unsigned int OptConnectTimeout = 60;
 	unsigned int OptReadTimeout = 60;
 	unsigned int OptWriteTimeout = 120;
@@ -259,8 +320,7 @@ bool CMysqlConnection::ConnectImpl()
 		return true;
 	}
 	m_HaveConnection = true;
-
-	m_pStmt = std::unique_ptr<MYSQL_STMT, CStmtDeleter>(mysql_stmt_init(&m_Mysql));
+	m_ConnectionId = mysql_thread_id(&m_Mysql);
 
 	// Apparently MYSQL_SET_CHARSET_NAME is not enough
 	if(PrepareAndExecuteStatement("SET CHARACTER SET utf8mb4"))
@@ -318,16 +378,15 @@ void CMysqlConnection::Disconnect()
 	m_InUse.store(false);
 }
 
-bool CMysqlConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
+bool CMysqlConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize, bool Cache)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	if(PrepareCached(pStmt, Cache))
 	{
-		StoreErrorStmt("prepare");
 		str_copy(pError, m_aErrorDetail, ErrorSize);
 		return true;
 	}
 	m_NewQuery = true;
-	unsigned NumParameters = mysql_stmt_param_count(m_pStmt.get());
+	unsigned NumParameters = mysql_stmt_param_count(m_pStmt);
 	m_vStmtParameters.resize(NumParameters);
 	m_vStmtParameterExtras.resize(NumParameters);
 	mem_zero(&m_vStmtParameters[0], sizeof(m_vStmtParameters[0]) * m_vStmtParameters.size());
@@ -426,20 +485,20 @@ bool CMysqlConnection::Step(bool *pEnd, char *pError, int ErrorSize)
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), &m_vStmtParameters[0]))
+		if(mysql_stmt_bind_param(m_pStmt, &m_vStmtParameters[0]))
 		{
 			StoreErrorStmt("bind_param");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return true;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
 			StoreErrorStmt("execute");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return true;
 		}
 	}
-	int Result = mysql_stmt_fetch(m_pStmt.get());
+	int Result = mysql_stmt_fetch(m_pStmt);
 	if(Result == 1)
 	{
 		StoreErrorStmt("fetch");
@@ -457,19 +516,19 @@ bool CMysqlConnection::ExecuteUpdate(int *pNumUpdated, char *pError, int ErrorSi
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), &m_vStmtParameters[0]))
+		if(mysql_stmt_bind_param(m_pStmt, &m_vStmtParameters[0]))
 		{
 			StoreErrorStmt("bind_param");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return true;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
 			StoreErrorStmt("execute");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return true;
 		}
-		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt.get());
+		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt);
 		return false;
 	}
 	str_copy(pError, "tried to execute update without query", ErrorSize);
@@ -490,7 +549,7 @@ bool CMysqlConnection::IsNull(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:null");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -514,7 +573,7 @@ float CMysqlConnection::GetFloat(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:float");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -542,7 +601,7 @@ int CMysqlConnection::GetInt(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:int");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -570,7 +629,7 @@ int64_t CMysqlConnection::GetInt64(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:int64");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -605,7 +664,7 @@ void CMysqlConnection::GetString(int Col, char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:string");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -637,7 +696,7 @@ int CMysqlConnection::GetBlob(int Col, unsigned char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:blob");
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
@@ -666,6 +725,53 @@ const char *CMysqlConnection::MedianMapTime(char *pBuffer, int BufferSize) const
 	return pBuffer;
 }
 
+bool CMysqlConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	if(mysql_autocommit(&m_Mysql, false))
+	{
+		StoreErrorMysql("begin");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		return true;
+	}
+	return false;
+}
+
+bool CMysqlConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	if(mysql_commit(&m_Mysql))
+	{
+		StoreErrorMysql("commit");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		// the connection stays in the transaction until it is rolled back
+		return true;
+	}
+	if(mysql_autocommit(&m_Mysql, true))
+	{
+		StoreErrorMysql("autocommit");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		return true;
+	}
+	return false;
+}
+
+bool CMysqlConnection::RollbackTransaction(char *pError, int ErrorSize)
+{
+	bool Error = false;
+	if(mysql_rollback(&m_Mysql))
+	{
+		StoreErrorMysql("rollback");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		Error = true;
+	}
+	if(mysql_autocommit(&m_Mysql, true) && !Error)
+	{
+		StoreErrorMysql("autocommit");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		Error = true;
+	}
+	return Error;
+}
+
 bool CMysqlConnection::AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize)
 {
 	char aBuf[512];
@@ -6,6 +6,7 @@
 #include <engine/console.h>
 
 #include <atomic>
+#include <limits>
 
 class CSqliteConnection : public IDbConnection
 {
@@ -30,7 +31,7 @@ public:
 	bool Connect(char *pError, int ErrorSize) override;
 	void Disconnect() override;
 
-	bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize) override;
+	bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize, bool Cache = true) override;
 
 	void BindString(int Idx, const char *pString) override;
 	void BindBlob(int Idx, unsigned char *pBlob, int Size) override;
@@ -50,6 +51,10 @@ public:
 	// passing a negative buffer size is undefined behavior
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	bool RollbackTransaction(char *pError, int ErrorSize) override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 	// fail safe
@@ -60,11 +65,21 @@ private:
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	bool m_Setup;
 
+	class CStmtDeleter
+	{
+	public:
+		void operator()(sqlite3_stmt *pStmt) const { sqlite3_finalize(pStmt); }
+	};
+
 	sqlite3 *m_pDb;
+	// points into the statement cache
 	sqlite3_stmt *m_pStmt;
+	CStatementCache<std::unique_ptr<sqlite3_stmt, CStmtDeleter>> m_StatementCache;
 	bool m_Done; // no more rows available for Step
 	// returns false, if the query succeeded
 	bool Execute(const char *pQuery, char *pError, int ErrorSize);
+	// resets the current statement so that it can be reused
+	void ResetStatement();
 	// returns true on failure
 	bool ConnectImpl(char *pError, int ErrorSize);
 
@@ -88,8 +103,8 @@ CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup) :
 
 CSqliteConnection::~CSqliteConnection()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+	m_pStmt = nullptr;
+	m_StatementCache.Clear();
 	sqlite3_close(m_pDb);
 	m_pDb = nullptr;
 }
@@ -141,8 +156,9 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 		return true;
 	}
 
-	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors
-	sqlite3_busy_timeout(m_pDb, -1);
+	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors,
+	// a negative timeout would turn off the busy handler instead
+	sqlite3_busy_timeout(m_pDb, std::numeric_limits<int>::max());
 
 	if(m_Setup)
 	{
@@ -181,27 +197,52 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 
 void CSqliteConnection::Disconnect()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+	// keep the statement cached, but release its locks
+	ResetStatement();
 	m_pStmt = nullptr;
 	m_InUse.store(false);
 }
 
-bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
+void CSqliteConnection::ResetStatement()
 {
+	if(m_pStmt == nullptr)
+		return;
+	// the error of the last step was already reported
+	sqlite3_reset(m_pStmt);
+	sqlite3_clear_bindings(m_pStmt);
+}
+
+bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize, bool Cache)
+{
+	ResetStatement();
+	m_pStmt = Cache ? m_StatementCache.Find(pStmt) : nullptr;
 	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
-	m_pStmt = nullptr;
+	{
+		m_PrepareStats.m_NumCached++;
+		m_Done = false;
+		return false;
+	}
+
+	const std::chrono::nanoseconds Start = time_get_nanoseconds();
+	sqlite3_stmt *pNewStmt = nullptr;
 	int Result = sqlite3_prepare_v2(
 		m_pDb,
 		pStmt,
 		-1, // pStmt can be any length
-		&m_pStmt,
+		&pNewStmt,
 		NULL);
+	m_PrepareStats.m_NumPrepared++;
+	m_PrepareStats.m_PrepareTime += time_get_nanoseconds() - Start;
 	if(FormatError(Result, pError, ErrorSize))
 	{
+		sqlite3_finalize(pNewStmt);
 		return true;
 	}
+	std::unique_ptr<sqlite3_stmt, CStmtDeleter> pNewStmtPtr(pNewStmt);
+	if(Cache)
+		m_pStmt = m_StatementCache.Add(pStmt, std::move(pNewStmtPtr));
+	else
+		m_pStmt = m_StatementCache.SetUncached(std::move(pNewStmtPtr));
 	m_Done = false;
 	return false;
 }
@@ -354,6 +395,8 @@ const char *CSqliteConnection::MedianMapTime(char *pBuffer, int BufferSize) cons
 
 bool CSqliteConnection::Execute(const char *pQuery, char *pError, int ErrorSize)
 {
+	// a statement that is still running could keep the transaction open
+	ResetStatement();
 	char *pErrorMsg;
 	int Result = sqlite3_exec(m_pDb, pQuery, NULL, NULL, &pErrorMsg);
 	if(Result != SQLITE_OK)
@@ -385,6 +428,23 @@ void CSqliteConnection::AssertNoError(int Result)
 	}
 }
 
+bool CSqliteConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	// take the write lock right away, a deferred transaction can't wait for
+	// it when upgrading from a read lock
+	return Execute("BEGIN IMMEDIATE", pError, ErrorSize);
+}
+
+bool CSqliteConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	return Execute("COMMIT", pError, ErrorSize);
+}
+
+bool CSqliteConnection::RollbackTransaction(char *pError, int ErrorSize)
+{
+	return Execute("ROLLBACK", pError, ErrorSize);
+}
+
 bool CSqliteConnection::AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize)
 {
 	char aBuf[512];
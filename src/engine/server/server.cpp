@@ -314,8 +314,9 @@ CServer::CServer()
 {
 	m_pConfig = &g_Config;
 	for(int i = 0; i < MAX_CLIENTS; i++)
-		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true);
-	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_SnapshotDelta, false);
+		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true, &m_DemoRecordWriter);
+	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_SnapshotDelta, false, &m_DemoRecordWriter);
+	m_vSnapshotJobs.resize(MAX_CLIENTS);
 
 	m_pGameServer = 0;
 
@@ -977,6 +978,9 @@ void CServer::DoSnapshot()
 	}
 
 	// create snapshots for all clients
+	int aJobClientIDs[MAX_CLIENTS];
+	int aJobDeltaTicks[MAX_CLIENTS];
+	int NumJobs = 0;
 	for(int i = 0; i < MaxClients(); i++)
 	{
 		// client must be ingame to receive snapshots
@@ -1007,8 +1011,6 @@ void CServer::DoSnapshot()
 				m_aDemoRecorder[i].RecordSnapshot(Tick(), aData, SnapshotSize);
 			}
 
-			int Crc = pData->Crc();
-
 			// remove old snapshots
 			// keep 3 seconds worth of snapshots
 			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick - TickSpeed() * 3);
@@ -1019,70 +1021,89 @@ void CServer::DoSnapshot()
 			// find snapshot that we can perform delta against
 			int DeltaTick = -1;
 			const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+			int DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
+			if(DeltashotSize >= 0)
+				DeltaTick = m_aClients[i].m_LastAckedSnapshot;
+			else
 			{
-				int DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
+				DeltashotSize = sizeof(CSnapshot);
+
+				// no acked package found, force client to recover rate
+				if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
+					m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
 			}
 
-			// create delta
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, m_aClients[i].m_Sixup);
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, m_aClients[i].m_Sixup);
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			int DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			// the delta is created from the stored copy, which stays valid
+			// until the next tick
+			CSnapshotWorkers::CJob *pJob = &m_vSnapshotJobs[NumJobs];
+			pJob->m_Sixup = m_aClients[i].m_Sixup;
+			pJob->m_pFrom = pDeltashot;
+			pJob->m_FromSize = DeltashotSize;
+			pJob->m_FromTick = DeltaTick;
+			pJob->m_pTo = m_aClients[i].m_Snapshots.m_pLast->m_pSnap;
+			pJob->m_ToSize = SnapshotSize;
+			pJob->m_Crc = pData->Crc();
+			aJobClientIDs[NumJobs] = i;
+			aJobDeltaTicks[NumJobs] = DeltaTick;
+			NumJobs++;
+		}
+	}
 
-			if(DeltaSize)
-			{
-				// compress it
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+	// create deltas and compress them, possibly on the snapshot workers
+	if(m_SnapshotWorkers.NumThreads() != Config()->m_SvSnapshotThreads)
+		m_SnapshotWorkers.Init(Config()->m_SvSnapshotThreads);
+	m_SnapshotWorkers.Run(&m_SnapshotDelta, m_vSnapshotJobs.data(), NumJobs, Config()->m_SvSnapshotCache);
+
+	// send the snapshots
+	for(int Job = 0; Job < NumJobs; Job++)
+	{
+		const CSnapshotWorkers::CJob *pJob = m_vSnapshotJobs[Job].Payload();
+		const int i = aJobClientIDs[Job];
+		const int DeltaTick = aJobDeltaTicks[Job];
 
-				char aCompData[CSnapshot::MAX_SIZE];
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+		if(pJob->m_DeltaSize)
+		{
+			const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+			const int SnapshotSize = pJob->m_CompSize;
+			int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
-			}
-			else
+			for(int n = 0, Left = SnapshotSize; Left > 0; n++)
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
-				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick - DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				int Chunk = Left < MaxSize ? Left : MaxSize;
+				Left -= Chunk;
+
+				if(NumPackets == 1)
+				{
+					CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+					Msg.AddInt(m_CurrentGameTick);
+					Msg.AddInt(m_CurrentGameTick - DeltaTick);
+					Msg.AddInt(pJob->m_Crc);
+					Msg.AddInt(Chunk);
+					Msg.AddRaw(&pJob->m_aCompData[n * MaxSize], Chunk);
+					SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				}
+				else
+				{
+					CMsgPacker Msg(NETMSG_SNAP, true);
+					Msg.AddInt(m_CurrentGameTick);
+					Msg.AddInt(m_CurrentGameTick - DeltaTick);
+					Msg.AddInt(NumPackets);
+					Msg.AddInt(n);
+					Msg.AddInt(pJob->m_Crc);
+					Msg.AddInt(Chunk);
+					Msg.AddRaw(&pJob->m_aCompData[n * MaxSize], Chunk);
+					SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				}
 			}
 		}
+		else
+		{
+			CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+			Msg.AddInt(m_CurrentGameTick);
+			Msg.AddInt(m_CurrentGameTick - DeltaTick);
+			SendMsg(&Msg, MSGFLAG_FLUSH, i);
+		}
 	}
 
 	GameServer()->OnPostSnap();
@@ -2726,6 +2747,7 @@ int CServer::Run()
 			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFullPath);
 		}
 	}
+	DbPool()->Start(Config()->m_SvSqlWorkers);
 
 	// start server
 	NETADDR BindAddr;
@@ -2753,6 +2775,9 @@ int CServer::Run()
 	if(Port == 0)
 		dbg_msg("server", "using port %d", BindAddr.port);
 
+	if(Config()->m_SvNetBatchSend && !m_NetServer.SetSendBatching(true))
+		dbg_msg("server", "batched sending is not supported on this platform");
+
 #if defined(CONF_UPNP)
 	m_UPnP.Open(BindAddr);
 #endif
@@ -3007,6 +3032,9 @@ int CServer::Run()
 				}
 			}
 
+			// send everything queued in this tick before sleeping
+			m_NetServer.Flush();
+
 			// wait for incoming data
 			if(NonActive)
 			{
@@ -3063,6 +3091,8 @@ int CServer::Run()
 
 	m_Fifo.Shutdown();
 
+	m_SnapshotWorkers.Shutdown();
+
 	GameServer()->OnShutdown(nullptr);
 	m_pMap->Unload();
 
@@ -3146,6 +3176,12 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 		}
 		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 	}
+
+	if(pThis->Config()->m_SvSnapshotCache && !pName[0])
+	{
+		str_format(aBuf, sizeof(aBuf), "snapshot cache: hits=%" PRId64 " misses=%" PRId64, pThis->m_SnapshotWorkers.CacheHits(), pThis->m_SnapshotWorkers.CacheMisses());
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
 }
 
 static int GetAuthLevel(const char *pLevel)
@@ -3480,6 +3516,16 @@ void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_aDemoRecorder[MAX_CLIENTS].Stop();
 }
 
+void CServer::ConDumpDemoWriter(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	const CDemoRecordWriter::CStats Stats = pSelf->m_DemoRecordWriter.Stats();
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%" PRId64 " chunks queued, max %d KiB queued, waited %" PRId64 " times for %.2fms",
+		Stats.m_NumJobs, (int)(Stats.m_MaxQueuedBytes / 1024), Stats.m_NumStalls, Stats.m_StallTime.count() / 1e6);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
+}
+
 void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_MapReload = true;
@@ -3574,10 +3620,12 @@ void CServer::ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData)
 	{
 		pSelf->DbPool()->Print(pSelf->Console(), CDbConnectionPool::WRITE);
 		pSelf->DbPool()->Print(pSelf->Console(), CDbConnectionPool::WRITE_BACKUP);
+		pSelf->DbPool()->PrintStats(pSelf->Console(), CDbConnectionPool::WRITE);
 	}
 	else if(str_comp_nocase(pResult->GetString(0), "r") == 0)
 	{
 		pSelf->DbPool()->Print(pSelf->Console(), CDbConnectionPool::READ);
+		pSelf->DbPool()->PrintStats(pSelf->Console(), CDbConnectionPool::READ);
 	}
 	else
 	{
@@ -3817,11 +3865,12 @@ void CServer::RegisterCommands()
 
 	Console()->Register("record", "?s[file]", CFGFLAG_SERVER | CFGFLAG_STORE, ConRecord, this, "Record to a file");
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
+	Console()->Register("dump_demo_writer", "", CFGFLAG_SERVER, ConDumpDemoWriter, this, "Show how much the demo recordings had to wait for the demo writer thread");
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
 	Console()->Register("add_sqlserver", "s['r'|'w'] s[Database] s[Prefix] s[User] s[Password] s[IP] i[Port] ?i[SetUpDatabase ?]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAddSqlServer, this, "add a sqlserver");
-	Console()->Register("dump_sqlservers", "s['r'|'w']", CFGFLAG_SERVER, ConDumpSqlServers, this, "dumps all sqlservers readservers = r, writeservers = w");
+	Console()->Register("dump_sqlservers", "s['r'|'w']", CFGFLAG_SERVER, ConDumpSqlServers, this, "dumps all sqlservers readservers = r, writeservers = w, and the latencies of their queries");
 
 	Console()->Register("auth_add", "s[ident] s[level] r[pw]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAdd, this, "Add a rcon key");
 	Console()->Register("auth_add_p", "s[ident] s[level] s[hash] s[salt]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAddHashed, this, "Add a prehashed rcon key");
@@ -0,0 +1,141 @@
+#include "snapshot_workers.h"
+
+#include <base/system.h>
+
+#include <engine/shared/compression.h>
+
+#include <game/generated/protocol7.h>
+
+#include <zlib.h>
+
+CSnapshotWorkers::~CSnapshotWorkers()
+{
+	Shutdown();
+}
+
+void CSnapshotWorkers::Init(int NumThreads)
+{
+	Shutdown();
+
+	m_Shutdown.store(false);
+	for(int i = 0; i < NumThreads; i++)
+	{
+		m_vpWorkers.push_back(std::make_unique<CWorker>());
+		m_vpWorkers.back()->m_pPool = this;
+		m_vpThreads.push_back(thread_init(WorkerThread, m_vpWorkers.back().get(), "snapshot worker"));
+	}
+}
+
+void CSnapshotWorkers::Shutdown()
+{
+	if(m_vpThreads.empty())
+		return;
+
+	m_Shutdown.store(true);
+	for(auto &pWorker : m_vpWorkers)
+		pWorker->m_Start.Signal();
+	for(void *pThread : m_vpThreads)
+		thread_wait(pThread);
+	m_vpThreads.clear();
+	m_vpWorkers.clear();
+}
+
+uint64_t CSnapshotWorkers::PayloadKey(const CJob *pJob)
+{
+	const uint32_t Hash = crc32(pJob->m_Sixup, (const Bytef *)pJob->m_pTo, pJob->m_ToSize);
+	return ((uint64_t)Hash << 32) | (uint32_t)pJob->m_FromTick;
+}
+
+bool CSnapshotWorkers::SamePayload(const CJob *pFirst, const CJob *pSecond)
+{
+	if(pFirst->m_Sixup != pSecond->m_Sixup ||
+		pFirst->m_FromTick != pSecond->m_FromTick ||
+		pFirst->m_Crc != pSecond->m_Crc ||
+		pFirst->m_ToSize != pSecond->m_ToSize ||
+		pFirst->m_FromSize != pSecond->m_FromSize)
+		return false;
+	if(mem_comp(pFirst->m_pTo, pSecond->m_pTo, pFirst->m_ToSize) != 0)
+		return false;
+	return pFirst->m_pFrom == pSecond->m_pFrom || mem_comp(pFirst->m_pFrom, pSecond->m_pFrom, pFirst->m_FromSize) == 0;
+}
+
+void CSnapshotWorkers::Run(const CSnapshotDelta *pDelta, CJob *pJobs, int NumJobs, bool Cache)
+{
+	m_PayloadJobs.clear();
+	for(int i = 0; i < NumJobs; i++)
+	{
+		pJobs[i].m_pSource = nullptr;
+		if(!Cache)
+			continue;
+
+		// a job with a different payload but the same key keeps its own
+		auto Inserted = m_PayloadJobs.emplace(PayloadKey(&pJobs[i]), i);
+		if(!Inserted.second && SamePayload(&pJobs[Inserted.first->second], &pJobs[i]))
+			pJobs[i].m_pSource = &pJobs[Inserted.first->second];
+		if(pJobs[i].m_pSource)
+			m_CacheHits++;
+		else
+			m_CacheMisses++;
+	}
+
+	m_pJobs = pJobs;
+	m_NumJobs = NumJobs;
+	m_NextJob.store(0);
+
+	m_Delta.CopyStaticsizes(*pDelta);
+
+	// not worth waking up the workers for a single snapshot
+	if(m_vpWorkers.empty() || NumJobs <= 1)
+	{
+		ProcessJobs(&m_Delta);
+		return;
+	}
+
+	for(auto &pWorker : m_vpWorkers)
+	{
+		pWorker->m_Delta.CopyStaticsizes(*pDelta);
+		pWorker->m_Start.Signal();
+	}
+	ProcessJobs(&m_Delta);
+	for(size_t i = 0; i < m_vpWorkers.size(); i++)
+		m_Done.Wait();
+}
+
+void CSnapshotWorkers::ProcessJobs(CSnapshotDelta *pDelta)
+{
+	while(true)
+	{
+		const int Index = m_NextJob.fetch_add(1);
+		if(Index >= m_NumJobs)
+			break;
+		if(!m_pJobs[Index].m_pSource)
+			ProcessJob(pDelta, &m_pJobs[Index]);
+	}
+}
+
+void CSnapshotWorkers::ProcessJob(CSnapshotDelta *pDelta, CJob *pJob)
+{
+	pDelta->SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, pJob->m_Sixup);
+	pDelta->SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, pJob->m_Sixup);
+	char aDeltaData[CSnapshot::MAX_SIZE];
+	pJob->m_DeltaSize = pDelta->CreateDelta(pJob->m_pFrom, pJob->m_pTo, aDeltaData);
+
+	pJob->m_CompSize = 0;
+	if(pJob->m_DeltaSize)
+		pJob->m_CompSize = CVariableInt::Compress(aDeltaData, pJob->m_DeltaSize, pJob->m_aCompData, sizeof(pJob->m_aCompData));
+}
+
+void CSnapshotWorkers::WorkerThread(void *pUser)
+{
+	CWorker *pWorker = static_cast<CWorker *>(pUser);
+	CSnapshotWorkers *pPool = pWorker->m_pPool;
+
+	while(true)
+	{
+		pWorker->m_Start.Wait();
+		if(pPool->m_Shutdown.load())
+			break;
+		pPool->ProcessJobs(&pWorker->m_Delta);
+		pPool->m_Done.Signal();
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef ENGINE_SERVER_SNAPSHOT_WORKERS_H
+#define ENGINE_SERVER_SNAPSHOT_WORKERS_H
+
+#include <base/tl/threading.h>
+
+#include <engine/shared/snapshot.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Creates the snapshot deltas and compresses them for all clients of a tick.
+//
+// The snapshots themselves are still built on the main thread, because
+// `IGameServer::OnSnap` sends messages and updates game state. The delta
+// against the acked snapshot and the variable int compression only read the
+// finished snapshots and can be spread over worker threads. The packets are
+// sent afterwards by the main thread in the original client order.
+//
+// Clients with identical views (e.g. spectators) often get byte-identical
+// snapshots. If caching is enabled, jobs with the same snapshot and delta
+// base reuse the payload of the first such job instead of creating their
+// own. Jobs are looked up by a hash of the snapshot and the delta base tick,
+// only jobs with the same hash are compared byte by byte.
+class CSnapshotWorkers
+{
+public:
+	class CJob
+	{
+	public:
+		// input
+		bool m_Sixup;
+		const CSnapshot *m_pFrom;
+		int m_FromSize;
+		int m_FromTick;
+		const CSnapshot *m_pTo;
+		int m_ToSize;
+		int m_Crc;
+
+		// set if the payload of an earlier job can be used
+		const CJob *m_pSource;
+
+		// output
+		int m_DeltaSize;
+		int m_CompSize;
+		char m_aCompData[CSnapshot::MAX_SIZE];
+
+		const CJob *Payload() const { return m_pSource ? m_pSource : this; }
+	};
+
+	CSnapshotWorkers() = default;
+	~CSnapshotWorkers();
+	CSnapshotWorkers(const CSnapshotWorkers &) = delete;
+	CSnapshotWorkers &operator=(const CSnapshotWorkers &) = delete;
+
+	// Starts `NumThreads` worker threads, stopping previously started ones.
+	// With zero threads, all jobs are processed by the calling thread.
+	void Init(int NumThreads);
+	void Shutdown();
+	int NumThreads() const { return m_vpThreads.size(); }
+
+	// Processes all jobs and returns when they are done. The static item
+	// sizes are taken from `pDelta`.
+	void Run(const CSnapshotDelta *pDelta, CJob *pJobs, int NumJobs, bool Cache);
+
+	static void ProcessJob(CSnapshotDelta *pDelta, CJob *pJob);
+
+	int64_t CacheHits() const { return m_CacheHits; }
+	int64_t CacheMisses() const { return m_CacheMisses; }
+
+private:
+	class CWorker
+	{
+	public:
+		CSnapshotWorkers *m_pPool;
+		CSemaphore m_Start;
+		CSnapshotDelta m_Delta;
+	};
+
+	static void WorkerThread(void *pUser);
+	static uint64_t PayloadKey(const CJob *pJob);
+	static bool SamePayload(const CJob *pFirst, const CJob *pSecond);
+	void ProcessJobs(CSnapshotDelta *pDelta);
+
+	std::vector<void *> m_vpThreads;
+	std::vector<std::unique_ptr<CWorker>> m_vpWorkers;
+	CSemaphore m_Done;
+	std::atomic_bool m_Shutdown{false};
+
+	CSnapshotDelta m_Delta;
+	CJob *m_pJobs = nullptr;
+	int m_NumJobs = 0;
+	std::atomic_int m_NextJob{0};
+
+	// first job of each payload key in the current tick
+	std::unordered_map<uint64_t, int> m_PayloadJobs;
+
+	int64_t m_CacheHits = 0;
+	int64_t m_CacheMisses = 0;
+};
+
+#endif // ENGINE_SERVER_SNAPSHOT_WORKERS_H
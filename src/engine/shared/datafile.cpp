@@ -9,10 +9,15 @@
 #include <base/system.h>
 #include <engine/storage.h>
 
+#include "jobs.h"
 #include "uuid_manager.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <limits>
+#include <mutex>
+#include <thread>
 
 static const int DEBUG = 0;
 
@@ -342,8 +347,11 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 			// read the compressed data
 			void *pCompressedData = malloc(DataSize);
 			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, pCompressedData, DataSize);
+			{
+				std::unique_lock<std::mutex> Lock(m_FileMutex);
+				if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
+					ActualDataSize = io_read(m_pDataFile->m_File, pCompressedData, DataSize);
+			}
 			if(DataSize != ActualDataSize)
 			{
 				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
@@ -378,8 +386,11 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 			m_pDataFile->m_ppDataPtrs[Index] = static_cast<char *>(malloc(DataSize));
 			m_pDataFile->m_pDataSizes[Index] = DataSize;
 			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			{
+				std::unique_lock<std::mutex> Lock(m_FileMutex);
+				if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
+					ActualDataSize = io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			}
 			if(DataSize != ActualDataSize)
 			{
 				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
@@ -749,20 +760,50 @@ int CDataFileWriter::AddDataString(const char *pStr)
 	return AddData(str_length(pStr) + 1, pStr);
 }
 
-void CDataFileWriter::Finish()
+// Hands out the data blocks to compress one by one. Jobs that start after
+// all blocks are taken return without touching the writer, so the writer
+// only waits for blocks that are being compressed.
+class CDataFileWriter::CCompressionState
 {
-	dbg_assert((bool)m_File, "File not open");
+public:
+	CCompressionState(CDataInfo *pDatas, int NumDatas) :
+		m_pDatas(pDatas), m_NumDatas(NumDatas) {}
 
-	// Compress data. This takes the majority of the time when saving a datafile,
-	// so it's delayed until the end so it can be off-loaded to another thread.
-	for(CDataInfo &DataInfo : m_vDatas)
+	void Process()
 	{
-		unsigned long CompressedSize = compressBound(DataInfo.m_UncompressedSize);
-		DataInfo.m_pCompressedData = malloc(CompressedSize);
-		const int Result = compress2((Bytef *)DataInfo.m_pCompressedData, &CompressedSize, (Bytef *)DataInfo.m_pUncompressedData, DataInfo.m_UncompressedSize, DataInfo.m_CompressionLevel);
-		DataInfo.m_CompressedSize = CompressedSize;
-		free(DataInfo.m_pUncompressedData);
-		DataInfo.m_pUncompressedData = nullptr;
+		int NumCompressed = 0;
+		while(true)
+		{
+			const int Index = m_NextData.fetch_add(1);
+			if(Index >= m_NumDatas)
+				break;
+			Compress(&m_pDatas[Index]);
+			NumCompressed++;
+		}
+		if(NumCompressed)
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_NumDone += NumCompressed;
+			if(m_NumDone == m_NumDatas)
+				m_Done.notify_all();
+		}
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_Done.wait(Lock, [this]() { return m_NumDone == m_NumDatas; });
+	}
+
+private:
+	static void Compress(CDataInfo *pDataInfo)
+	{
+		unsigned long CompressedSize = compressBound(pDataInfo->m_UncompressedSize);
+		pDataInfo->m_pCompressedData = malloc(CompressedSize);
+		const int Result = compress2((Bytef *)pDataInfo->m_pCompressedData, &CompressedSize, (Bytef *)pDataInfo->m_pUncompressedData, pDataInfo->m_UncompressedSize, pDataInfo->m_CompressionLevel);
+		pDataInfo->m_CompressedSize = CompressedSize;
+		free(pDataInfo->m_pUncompressedData);
+		pDataInfo->m_pUncompressedData = nullptr;
 		if(Result != Z_OK)
 		{
 			char aError[32];
@@ -771,6 +812,60 @@ void CDataFileWriter::Finish()
 		}
 	}
 
+	CDataInfo *m_pDatas;
+	int m_NumDatas;
+	std::atomic<int> m_NextData{0};
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Done;
+	int m_NumDone = 0;
+};
+
+class CDataFileWriter::CCompressionJob : public IJob
+{
+	std::shared_ptr<CCompressionState> m_pState;
+
+	void Run() override
+	{
+		m_pState->Process();
+	}
+
+public:
+	CCompressionJob(std::shared_ptr<CCompressionState> pState) :
+		m_pState(std::move(pState)) {}
+};
+
+void CDataFileWriter::Finish(CJobPool *pJobPool)
+{
+	dbg_assert((bool)m_File, "File not open");
+
+	// Compress data. This takes the majority of the time when saving a datafile,
+	// so it's delayed until the end so it can be off-loaded to other threads.
+	{
+		const std::chrono::nanoseconds CompressStart = time_get_nanoseconds();
+		const int NumDatas = m_vDatas.size();
+		auto pState = std::make_shared<CCompressionState>(m_vDatas.data(), NumDatas);
+		int NumJobs = 0;
+		if(pJobPool)
+		{
+			NumJobs = maximum(minimum<int>(NumDatas, std::thread::hardware_concurrency()) - 1, 0);
+			for(int i = 0; i < NumJobs; i++)
+				pJobPool->Add(std::make_shared<CCompressionJob>(pState));
+		}
+		pState->Process();
+		pState->Wait();
+
+		size_t UncompressedSize = 0;
+		size_t CompressedSize = 0;
+		for(const CDataInfo &DataInfo : m_vDatas)
+		{
+			UncompressedSize += DataInfo.m_UncompressedSize;
+			CompressedSize += DataInfo.m_CompressedSize;
+		}
+		log_debug("datafile", "compressed %d data blocks from %" PRIzu " to %" PRIzu " bytes in %.2fms with %d helper jobs",
+			NumDatas, UncompressedSize, CompressedSize, (time_get_nanoseconds() - CompressStart).count() / 1e6, NumJobs);
+	}
+
 	// Calculate total size of items
 	size_t ItemSize = 0;
 	for(const CItemInfo &ItemInfo : m_vItems)
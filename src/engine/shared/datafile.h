@@ -9,10 +9,13 @@
 #include <base/system.h>
 
 #include <array>
+#include <mutex>
 #include <vector>
 
 #include <zlib.h>
 
+class CJobPool;
+
 enum
 {
 	ITEMTYPE_EX = 0xffff,
@@ -22,6 +25,8 @@ enum
 class CDataFileReader
 {
 	struct CDatafile *m_pDataFile;
+	// guards the file position when data is read from the file
+	std::mutex m_FileMutex;
 	void *GetDataImpl(int Index, bool Swap);
 	int GetFileDataSize(int Index) const;
 
@@ -46,6 +51,8 @@ public:
 	IOHANDLE File() const;
 
 	int GetDataSize(int Index) const;
+	// Loads the data on first use. Data with different indices can be
+	// loaded from multiple threads at the same time.
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	const char *GetDataString(int Index);
@@ -99,6 +106,9 @@ class CDataFileWriter
 		MAX_ITEM_TYPES = 0x10000,
 	};
 
+	class CCompressionState;
+	class CCompressionJob;
+
 	IOHANDLE m_File;
 	std::array<CItemTypeInfo, MAX_ITEM_TYPES> m_aItemTypes;
 	std::vector<CItemInfo> m_vItems;
@@ -126,7 +136,11 @@ public:
 	int AddData(size_t Size, const void *pData, int CompressionLevel = Z_DEFAULT_COMPRESSION);
 	int AddDataSwapped(size_t Size, const void *pData);
 	int AddDataString(const char *pStr);
-	void Finish();
+	// Compresses the data and writes the file. If a job pool is given,
+	// data blocks are compressed in parallel on it. The calling thread
+	// helps with the compression, so this may be called from a job of the
+	// same pool. The output does not depend on the number of threads.
+	void Finish(CJobPool *pJobPool = nullptr);
 };
 
 #endif
@@ -17,6 +17,9 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <algorithm>
+#include <string>
+
 const double g_aSpeeds[g_DemoSpeeds] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 20.0, 24.0, 28.0, 32.0, 40.0, 48.0, 56.0, 64.0};
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
@@ -28,29 +31,54 @@ static const unsigned char gs_Sha256Version = 6;
 static const unsigned char gs_VersionTickCompression = 5; // demo files with this version or higher will use `CHUNKTICKFLAG_TICK_COMPRESSED`
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
+static const CUuid gs_KeyFrameIndexUuid = CalculateUuid("demo-keyframe-index@ddnet.org");
 
 static const ColorRGBA gs_DemoPrintColor{0.75f, 0.7f, 0.7f, 1.0f};
 
-CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
+class CDemoRecordStream
 {
-	m_File = 0;
+public:
+	IOHANDLE m_File;
+	// copied when recording starts, so the writer thread doesn't read the
+	// delta of the recorder
+	CSnapshotDelta::CStaticsizes m_Staticsizes;
+	int m_LastTickMarker = -1;
+	int m_LastKeyFrame = -1;
+	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
+
+	CDemoRecordStream(IOHANDLE File, const CSnapshotDelta *pSnapshotDelta) :
+		m_File(File)
+	{
+		pSnapshotDelta->GetStaticsizes(&m_Staticsizes);
+	}
+
+	void WriteTickMarker(int Tick, bool Keyframe);
+	void Write(int Type, const void *pData, int Size);
+	void RecordSnapshot(CSnapshotDelta *pDelta, int Tick, const void *pData, int Size);
+	void Finish(int Length, const int *pTimelineMarkers, int NumTimelineMarkers);
+};
+
+CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData, CDemoRecordWriter *pWriter)
+{
+	m_pStream = nullptr;
 	m_aCurrentFilename[0] = '\0';
 	m_pfnFilter = nullptr;
 	m_pUser = nullptr;
 	m_LastTickMarker = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
+	m_pWriter = pWriter;
 	m_NoMapData = NoMapData;
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
-	dbg_assert(m_File == 0, "Demo recorder was not stopped");
+	dbg_assert(m_pStream == nullptr, "Demo recorder was not stopped");
 }
 
 // Record
 int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned Crc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	dbg_assert(m_File == 0, "Demo recorder already recording");
+	dbg_assert(m_pStream == nullptr, "Demo recorder already recording");
 
 	m_pfnFilter = pfnFilter;
 	m_pUser = pUser;
@@ -165,7 +193,6 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 			io_seek(MapFile, 0, IOSEEK_START);
 	}
 
-	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
@@ -176,7 +203,7 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 		str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf, gs_DemoPrintColor);
 	}
-	m_File = DemoFile;
+	m_pStream = new CDemoRecordStream(DemoFile, m_pSnapshotDelta);
 	str_copy(m_aCurrentFilename, pFilename);
 
 	return 0;
@@ -210,7 +237,7 @@ enum
 	CHUNKTYPE_DELTA = 3,
 };
 
-void CDemoRecorder::WriteTickMarker(int Tick, bool Keyframe)
+void CDemoRecordStream::WriteTickMarker(int Tick, bool Keyframe)
 {
 	if(m_LastTickMarker == -1 || Tick - m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
 	{
@@ -231,15 +258,10 @@ void CDemoRecorder::WriteTickMarker(int Tick, bool Keyframe)
 	}
 
 	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
 }
 
-void CDemoRecorder::Write(int Type, const void *pData, int Size)
+void CDemoRecordStream::Write(int Type, const void *pData, int Size)
 {
-	if(!m_File)
-		return;
-
 	if(Size > 64 * 1024)
 		return;
 
@@ -258,12 +280,14 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	if(Size < 0)
 		return;
 
-	unsigned char aChunk[3];
+	// the chunk header and data are written at once
+	unsigned char aChunk[3 + sizeof(aBuffer2)];
+	int HeaderSize;
 	aChunk[0] = ((Type & 0x3) << 5);
 	if(Size < 30)
 	{
 		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
+		HeaderSize = 1;
 	}
 	else
 	{
@@ -271,21 +295,22 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		{
 			aChunk[0] |= 30;
 			aChunk[1] = Size & 0xff;
-			io_write(m_File, aChunk, 2);
+			HeaderSize = 2;
 		}
 		else
 		{
 			aChunk[0] |= 31;
 			aChunk[1] = Size & 0xff;
 			aChunk[2] = Size >> 8;
-			io_write(m_File, aChunk, 3);
+			HeaderSize = 3;
 		}
 	}
 
-	io_write(m_File, aBuffer2, Size);
+	mem_copy(aChunk + HeaderSize, aBuffer2, Size);
+	io_write(m_File, aChunk, HeaderSize + Size);
 }
 
-void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+void CDemoRecordStream::RecordSnapshot(CSnapshotDelta *pDelta, int Tick, const void *pData, int Size)
 {
 	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
 	{
@@ -305,7 +330,7 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 		// create delta
 		char aDeltaData[CSnapshot::MAX_SIZE + sizeof(int)];
-		const int DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
+		const int DeltaSize = pDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
 		if(DeltaSize)
 		{
 			// record delta
@@ -315,43 +340,97 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 	}
 }
 
-void CDemoRecorder::RecordMessage(const void *pData, int Size)
-{
-	if(m_pfnFilter)
-	{
-		if(m_pfnFilter(pData, Size, m_pUser))
-		{
-			return;
-		}
-	}
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
-}
-
-int CDemoRecorder::Stop()
+void CDemoRecordStream::Finish(int Length, const int *pTimelineMarkers, int NumTimelineMarkers)
 {
-	if(!m_File)
-		return -1;
-
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	unsigned char aLength[sizeof(int32_t)];
-	uint_to_bytes_be(aLength, Length());
+	uint_to_bytes_be(aLength, Length);
 	io_write(m_File, aLength, sizeof(aLength));
 
 	// add the timeline markers to the header
 	io_seek(m_File, gs_NumMarkersOffset, IOSEEK_START);
 	unsigned char aNumMarkers[sizeof(int32_t)];
-	uint_to_bytes_be(aNumMarkers, m_NumTimelineMarkers);
+	uint_to_bytes_be(aNumMarkers, NumTimelineMarkers);
 	io_write(m_File, aNumMarkers, sizeof(aNumMarkers));
-	for(int i = 0; i < m_NumTimelineMarkers; i++)
+	for(int i = 0; i < NumTimelineMarkers; i++)
 	{
 		unsigned char aMarker[sizeof(int32_t)];
-		uint_to_bytes_be(aMarker, m_aTimelineMarkers[i]);
+		uint_to_bytes_be(aMarker, pTimelineMarkers[i]);
 		io_write(m_File, aMarker, sizeof(aMarker));
 	}
 
 	io_close(m_File);
 	m_File = 0;
+}
+
+void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_pStream)
+		return;
+
+	m_LastTickMarker = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+
+	if(m_pWriter)
+	{
+		CDemoRecordWriter::CJob Job;
+		Job.m_pStream = m_pStream;
+		Job.m_Type = CDemoRecordWriter::JOB_SNAPSHOT;
+		Job.m_Tick = Tick;
+		Job.m_vData.assign((const unsigned char *)pData, (const unsigned char *)pData + Size);
+		m_pWriter->Push(std::move(Job));
+	}
+	else
+	{
+		m_pStream->RecordSnapshot(m_pSnapshotDelta, Tick, pData, Size);
+	}
+}
+
+void CDemoRecorder::RecordMessage(const void *pData, int Size)
+{
+	if(!m_pStream)
+		return;
+
+	if(m_pfnFilter)
+	{
+		if(m_pfnFilter(pData, Size, m_pUser))
+		{
+			return;
+		}
+	}
+
+	if(m_pWriter)
+	{
+		CDemoRecordWriter::CJob Job;
+		Job.m_pStream = m_pStream;
+		Job.m_Type = CDemoRecordWriter::JOB_MESSAGE;
+		Job.m_Tick = -1;
+		Job.m_vData.assign((const unsigned char *)pData, (const unsigned char *)pData + Size);
+		m_pWriter->Push(std::move(Job));
+	}
+	else
+	{
+		m_pStream->Write(CHUNKTYPE_MESSAGE, pData, Size);
+	}
+}
+
+int CDemoRecorder::Stop()
+{
+	if(!m_pStream)
+		return -1;
+
+	if(m_pWriter)
+	{
+		m_pWriter->Finish(m_pStream, Length(), m_aTimelineMarkers, m_NumTimelineMarkers);
+	}
+	else
+	{
+		m_pStream->Finish(Length(), m_aTimelineMarkers, m_NumTimelineMarkers);
+		delete m_pStream;
+	}
+	m_pStream = nullptr;
 	if(m_pConsole)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording", gs_DemoPrintColor);
 
@@ -385,6 +464,255 @@ void CDemoRecorder::AddDemoMarker(int Tick)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Added timeline marker", gs_DemoPrintColor);
 }
 
+CDemoRecordWriter::CDemoRecordWriter(size_t MaxQueuedBytes) :
+	m_MaxQueuedBytes(MaxQueuedBytes)
+{
+	m_pThread = thread_init(ThreadFunc, this, "demo writer");
+}
+
+CDemoRecordWriter::~CDemoRecordWriter()
+{
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_Shutdown = true;
+	}
+	m_NewJob.notify_one();
+	thread_wait(m_pThread);
+	dbg_assert(m_Jobs.empty(), "Demo recorder was not stopped");
+}
+
+CDemoRecordWriter::CStats CDemoRecordWriter::Stats()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	return m_Stats;
+}
+
+void CDemoRecordWriter::Push(CJob &&Job)
+{
+	const size_t Size = Job.m_vData.size();
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		if(!m_Jobs.empty() && m_QueuedBytes + Size > m_MaxQueuedBytes)
+		{
+			const std::chrono::nanoseconds StallStart = time_get_nanoseconds();
+			m_JobDone.wait(Lock, [&]() { return m_Jobs.empty() || m_QueuedBytes + Size <= m_MaxQueuedBytes; });
+			m_Stats.m_NumStalls++;
+			m_Stats.m_StallTime += time_get_nanoseconds() - StallStart;
+		}
+		m_Jobs.push_back(std::move(Job));
+		m_QueuedBytes += Size;
+		m_Stats.m_NumJobs++;
+		m_Stats.m_MaxQueuedBytes = std::max(m_Stats.m_MaxQueuedBytes, m_QueuedBytes);
+	}
+	m_NewJob.notify_one();
+}
+
+void CDemoRecordWriter::Finish(CDemoRecordStream *pStream, int Length, const int *pTimelineMarkers, int NumTimelineMarkers)
+{
+	bool Done = false;
+	CJob Job;
+	Job.m_pStream = pStream;
+	Job.m_Type = JOB_FINISH;
+	Job.m_Tick = Length;
+	Job.m_vData.assign((const unsigned char *)pTimelineMarkers, (const unsigned char *)(pTimelineMarkers + NumTimelineMarkers));
+	Job.m_pDone = &Done;
+	{
+		// move the jobs of the stream to the front of the queue, so stopping
+		// doesn't wait for the other recordings
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		auto End = std::stable_partition(m_Jobs.begin(), m_Jobs.end(), [&](const CJob &Other) { return Other.m_pStream == pStream; });
+		m_QueuedBytes += Job.m_vData.size();
+		m_Jobs.insert(End, std::move(Job));
+		m_Stats.m_NumJobs++;
+	}
+	m_NewJob.notify_one();
+
+	// the file may be renamed or removed right after stopping
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_JobDone.wait(Lock, [&]() { return Done; });
+}
+
+void CDemoRecordWriter::ThreadFunc(void *pUser)
+{
+	static_cast<CDemoRecordWriter *>(pUser)->Run();
+}
+
+void CDemoRecordWriter::Run()
+{
+	while(true)
+	{
+		CJob Job;
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_NewJob.wait(Lock, [this]() { return !m_Jobs.empty() || m_Shutdown; });
+			if(m_Jobs.empty())
+				break;
+			Job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+
+		switch(Job.m_Type)
+		{
+		case JOB_SNAPSHOT:
+			m_Delta.SetStaticsizes(Job.m_pStream->m_Staticsizes);
+			Job.m_pStream->RecordSnapshot(&m_Delta, Job.m_Tick, Job.m_vData.data(), Job.m_vData.size());
+			break;
+		case JOB_MESSAGE:
+			Job.m_pStream->Write(CHUNKTYPE_MESSAGE, Job.m_vData.data(), Job.m_vData.size());
+			break;
+		case JOB_FINISH:
+			Job.m_pStream->Finish(Job.m_Tick, (const int *)Job.m_vData.data(), Job.m_vData.size() / sizeof(int));
+			delete Job.m_pStream;
+			break;
+		default:
+			dbg_assert(false, "unreachable");
+		}
+
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_QueuedBytes -= Job.m_vData.size();
+			if(Job.m_Type == JOB_FINISH)
+				*Job.m_pDone = true;
+		}
+		m_JobDone.notify_all();
+	}
+}
+
+// reads the data of a chunk and decompresses it into `pOut`, returns an
+// error message on failure
+static const char *ReadChunkData(IOHANDLE File, int ChunkSize, unsigned char *pCompressed, unsigned char *pDecompressed, unsigned char *pOut, int *pDataSize)
+{
+	if(io_read(File, pCompressed, ChunkSize) != (unsigned)ChunkSize)
+		return "Error reading chunk data";
+
+	int DataSize = CNetBase::Decompress(pCompressed, ChunkSize, pDecompressed, CSnapshot::MAX_SIZE);
+	if(DataSize < 0)
+		return "Error during network decompression";
+
+	DataSize = CVariableInt::Decompress(pDecompressed, DataSize, pOut, CSnapshot::MAX_SIZE);
+	if(DataSize < 0)
+		return "Error during intpack decompression";
+
+	*pDataSize = DataSize;
+	return nullptr;
+}
+
+class CDemoPlayer::CPrefetcher
+{
+public:
+	// starts reading at the current position of `File`
+	CPrefetcher(const CDemoPlayer *pPlayer, IOHANDLE File, int MaxTicks) :
+		m_pPlayer(pPlayer), m_File(File), m_MaxTicks(MaxTicks)
+	{
+		m_pThread = thread_init(ThreadFunc, this, "demo prefetch");
+	}
+
+	~CPrefetcher()
+	{
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_Shutdown = true;
+		}
+		m_ChunkDone.notify_one();
+		thread_wait(m_pThread);
+	}
+
+	EReadChunkHeaderResult Pop(int *pType, int *pTick, unsigned char *pData, int *pDataSize, const char **ppError)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_NewChunk.wait(Lock, [this]() { return !m_Chunks.empty(); });
+		const CChunk &Chunk = m_Chunks.front();
+		*pType = Chunk.m_Type;
+		*pTick = Chunk.m_Tick;
+		*ppError = Chunk.m_pError;
+		*pDataSize = Chunk.m_vData.size();
+		if(!Chunk.m_vData.empty())
+			mem_copy(pData, Chunk.m_vData.data(), Chunk.m_vData.size());
+		const EReadChunkHeaderResult Result = Chunk.m_Result;
+
+		// the end of the file or an error is returned on every later call
+		if(Result == CHUNKHEADER_SUCCESS && !Chunk.m_pError)
+		{
+			if(Chunk.m_Type & CHUNKTYPEFLAG_TICKMARKER)
+				m_QueuedTicks--;
+			m_Chunks.pop_front();
+			Lock.unlock();
+			m_ChunkDone.notify_one();
+		}
+		return Result;
+	}
+
+private:
+	struct CChunk
+	{
+		EReadChunkHeaderResult m_Result;
+		int m_Type;
+		int m_Tick;
+		const char *m_pError;
+		std::vector<unsigned char> m_vData;
+	};
+
+	static void ThreadFunc(void *pUser)
+	{
+		static_cast<CPrefetcher *>(pUser)->Run();
+	}
+
+	void Run()
+	{
+		int Tick = -1;
+		while(true)
+		{
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_ChunkDone.wait(Lock, [this]() { return m_Shutdown || m_QueuedTicks < m_MaxTicks; });
+				if(m_Shutdown)
+					break;
+			}
+
+			CChunk Chunk;
+			int ChunkSize;
+			Chunk.m_Result = m_pPlayer->ReadChunkHeader(m_File, &Chunk.m_Type, &ChunkSize, &Tick);
+			Chunk.m_Tick = Tick;
+			Chunk.m_pError = nullptr;
+			if(Chunk.m_Result == CHUNKHEADER_SUCCESS && ChunkSize)
+			{
+				int DataSize;
+				Chunk.m_pError = ReadChunkData(m_File, ChunkSize, m_aCompressed, m_aDecompressed, m_aData, &DataSize);
+				if(!Chunk.m_pError)
+					Chunk.m_vData.assign(m_aData, m_aData + DataSize);
+			}
+			const bool Last = Chunk.m_Result != CHUNKHEADER_SUCCESS || Chunk.m_pError;
+
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				if(Chunk.m_Result == CHUNKHEADER_SUCCESS && (Chunk.m_Type & CHUNKTYPEFLAG_TICKMARKER))
+					m_QueuedTicks++;
+				m_Chunks.push_back(std::move(Chunk));
+			}
+			m_NewChunk.notify_one();
+			if(Last)
+				break;
+		}
+	}
+
+	const CDemoPlayer *m_pPlayer;
+	IOHANDLE m_File;
+	int m_MaxTicks;
+	void *m_pThread;
+
+	// only used by the prefetch thread
+	unsigned char m_aCompressed[CSnapshot::MAX_SIZE];
+	unsigned char m_aDecompressed[CSnapshot::MAX_SIZE];
+	unsigned char m_aData[CSnapshot::MAX_SIZE];
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NewChunk;
+	std::condition_variable m_ChunkDone;
+	std::deque<CChunk> m_Chunks;
+	int m_QueuedTicks = 0;
+	bool m_Shutdown = false;
+};
+
 CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta, bool UseVideo, TUpdateIntraTimesFunc &&UpdateIntraTimesFunc)
 {
 	Construct(pSnapshotDelta, UseVideo);
@@ -405,6 +733,9 @@ CDemoPlayer::~CDemoPlayer()
 void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta, bool UseVideo)
 {
 	m_File = 0;
+	m_PrefetchFile = 0;
+	m_PrefetchTicks = 0;
+	m_KeyFrameIndexFiles = 0;
 	m_SpeedIndex = 4;
 
 	m_pSnapshotDelta = pSnapshotDelta;
@@ -421,13 +752,13 @@ void CDemoPlayer::SetListener(IListener *pListener)
 	m_pListener = pListener;
 }
 
-CDemoPlayer::EReadChunkHeaderResult CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
+CDemoPlayer::EReadChunkHeaderResult CDemoPlayer::ReadChunkHeader(IOHANDLE File, int *pType, int *pSize, int *pTick) const
 {
 	*pSize = 0;
 	*pType = 0;
 
 	unsigned char Chunk = 0;
-	if(io_read(m_File, &Chunk, sizeof(Chunk)) != sizeof(Chunk))
+	if(io_read(File, &Chunk, sizeof(Chunk)) != sizeof(Chunk))
 		return CHUNKHEADER_EOF;
 
 	if(Chunk & CHUNKTYPEFLAG_TICKMARKER)
@@ -453,7 +784,7 @@ CDemoPlayer::EReadChunkHeaderResult CDemoPlayer::ReadChunkHeader(int *pType, int
 		else
 		{
 			unsigned char aTickdata[sizeof(int32_t)];
-			if(io_read(m_File, aTickdata, sizeof(aTickdata)) != sizeof(aTickdata))
+			if(io_read(File, aTickdata, sizeof(aTickdata)) != sizeof(aTickdata))
 				return CHUNKHEADER_ERROR;
 			NewTick = bytes_be_to_uint(aTickdata);
 		}
@@ -470,14 +801,14 @@ CDemoPlayer::EReadChunkHeaderResult CDemoPlayer::ReadChunkHeader(int *pType, int
 		if(*pSize == 30)
 		{
 			unsigned char aSizedata[1];
-			if(io_read(m_File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
+			if(io_read(File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
 				return CHUNKHEADER_ERROR;
 			*pSize = aSizedata[0];
 		}
 		else if(*pSize == 31)
 		{
 			unsigned char aSizedata[2];
-			if(io_read(m_File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
+			if(io_read(File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
 				return CHUNKHEADER_ERROR;
 			*pSize = (aSizedata[1] << 8) | aSizedata[0];
 		}
@@ -504,7 +835,7 @@ bool CDemoPlayer::ScanFile()
 		}
 
 		int ChunkType, ChunkSize;
-		const EReadChunkHeaderResult Result = ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick);
+		const EReadChunkHeaderResult Result = ReadChunkHeader(m_File, &ChunkType, &ChunkSize, &ChunkTick);
 		if(Result == CHUNKHEADER_EOF)
 		{
 			break;
@@ -544,6 +875,160 @@ bool CDemoPlayer::ScanFile()
 	return true;
 }
 
+CDemoPlayer::EReadChunkHeaderResult CDemoPlayer::ReadChunk(int *pType, int *pDataSize, int *pTick, const char **ppError)
+{
+	*pDataSize = 0;
+	*ppError = nullptr;
+	if(m_pPrefetcher)
+		return m_pPrefetcher->Pop(pType, pTick, m_aCurrentSnapshotData, pDataSize, ppError);
+
+	int ChunkSize;
+	const EReadChunkHeaderResult Result = ReadChunkHeader(m_File, pType, &ChunkSize, pTick);
+	if(Result == CHUNKHEADER_SUCCESS && ChunkSize)
+		*ppError = ReadChunkData(m_File, ChunkSize, m_aCompressedSnapshotData, m_aDecompressedSnapshotData, m_aCurrentSnapshotData, pDataSize);
+	return Result;
+}
+
+bool CDemoPlayer::SeekChunks(long Filepos)
+{
+	// the prefetcher reads from `m_PrefetchFile`, so it has to be stopped
+	// before moving that handle
+	m_pPrefetcher = nullptr;
+	if(m_PrefetchFile)
+	{
+		if(io_seek(m_PrefetchFile, Filepos, IOSEEK_START) != 0)
+			return false;
+		m_pPrefetcher = std::make_unique<CPrefetcher>(this, m_PrefetchFile, m_PrefetchTicks);
+		return true;
+	}
+	return io_seek(m_File, Filepos, IOSEEK_START) == 0;
+}
+
+// The key frame index cache is stored as "demoindex/<sha256 of path>.idx".
+// It holds a magic UUID, the size and modification time of the demo, the
+// first and last tick and the key frames, all as big-endian integers.
+static void KeyFrameIndexFilename(const char *pPath, char *pBuffer, size_t BufferSize)
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(sha256(pPath, str_length(pPath)), aSha256, sizeof(aSha256));
+	str_format(pBuffer, BufferSize, "demoindex/%s.idx", aSha256);
+}
+
+static bool DemoFileStamp(IOHANDLE File, const char *pPath, int64_t *pSize, int64_t *pModified)
+{
+	time_t Created, Modified;
+	if(fs_file_time(pPath, &Created, &Modified) != 0)
+		return false;
+	*pSize = io_length(File);
+	*pModified = Modified;
+	return *pSize >= 0;
+}
+
+enum
+{
+	KEYFRAME_INDEX_HEADER_SIZE = sizeof(CUuid) + 7 * sizeof(int32_t),
+	KEYFRAME_INDEX_ENTRY_SIZE = 3 * sizeof(int32_t),
+};
+
+bool CDemoPlayer::LoadKeyFrameIndex(IStorage *pStorage, const char *pPath)
+{
+	int64_t Size, Modified;
+	if(!DemoFileStamp(m_PrefetchFile, pPath, &Size, &Modified))
+		return false;
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	KeyFrameIndexFilename(pPath, aFilename, sizeof(aFilename));
+	void *pData;
+	unsigned DataSize;
+	if(!pStorage->ReadFile(aFilename, IStorage::TYPE_SAVE, &pData, &DataSize))
+		return false;
+	const unsigned char *pBytes = static_cast<const unsigned char *>(pData);
+
+	bool Valid = DataSize >= (unsigned)KEYFRAME_INDEX_HEADER_SIZE && mem_comp(pBytes, &gs_KeyFrameIndexUuid, sizeof(CUuid)) == 0;
+	const unsigned char *pHeader = pBytes + sizeof(CUuid);
+	const int64_t NumKeyFrames = Valid ? bytes_be_to_uint(pHeader + 24) : 0;
+	Valid = Valid &&
+		((int64_t)bytes_be_to_uint(pHeader) << 32 | bytes_be_to_uint(pHeader + 4)) == Size &&
+		((int64_t)bytes_be_to_uint(pHeader + 8) << 32 | bytes_be_to_uint(pHeader + 12)) == Modified &&
+		DataSize == KEYFRAME_INDEX_HEADER_SIZE + NumKeyFrames * KEYFRAME_INDEX_ENTRY_SIZE;
+	if(Valid)
+	{
+		m_Info.m_Info.m_FirstTick = (int)bytes_be_to_uint(pHeader + 16);
+		m_Info.m_Info.m_LastTick = (int)bytes_be_to_uint(pHeader + 20);
+		m_vKeyFrames.clear();
+		m_vKeyFrames.reserve(NumKeyFrames);
+		for(const unsigned char *pEntry = pBytes + KEYFRAME_INDEX_HEADER_SIZE; pEntry < pBytes + DataSize; pEntry += KEYFRAME_INDEX_ENTRY_SIZE)
+		{
+			const int64_t Filepos = (int64_t)bytes_be_to_uint(pEntry) << 32 | bytes_be_to_uint(pEntry + 4);
+			m_vKeyFrames.emplace_back(Filepos, (int)bytes_be_to_uint(pEntry + 8));
+		}
+	}
+	free(pData);
+	return Valid;
+}
+
+void CDemoPlayer::SaveKeyFrameIndex(IStorage *pStorage, const char *pPath)
+{
+	int64_t Size, Modified;
+	if(!DemoFileStamp(m_PrefetchFile, pPath, &Size, &Modified))
+		return;
+
+	std::vector<unsigned char> vData(KEYFRAME_INDEX_HEADER_SIZE + m_vKeyFrames.size() * KEYFRAME_INDEX_ENTRY_SIZE);
+	mem_copy(vData.data(), &gs_KeyFrameIndexUuid, sizeof(CUuid));
+	unsigned char *pHeader = vData.data() + sizeof(CUuid);
+	uint_to_bytes_be(pHeader, Size >> 32);
+	uint_to_bytes_be(pHeader + 4, Size);
+	uint_to_bytes_be(pHeader + 8, Modified >> 32);
+	uint_to_bytes_be(pHeader + 12, Modified);
+	uint_to_bytes_be(pHeader + 16, m_Info.m_Info.m_FirstTick);
+	uint_to_bytes_be(pHeader + 20, m_Info.m_Info.m_LastTick);
+	uint_to_bytes_be(pHeader + 24, m_vKeyFrames.size());
+	unsigned char *pEntry = vData.data() + KEYFRAME_INDEX_HEADER_SIZE;
+	for(const SKeyFrame &KeyFrame : m_vKeyFrames)
+	{
+		uint_to_bytes_be(pEntry, (int64_t)KeyFrame.m_Filepos >> 32);
+		uint_to_bytes_be(pEntry + 4, KeyFrame.m_Filepos);
+		uint_to_bytes_be(pEntry + 8, KeyFrame.m_Tick);
+		pEntry += KEYFRAME_INDEX_ENTRY_SIZE;
+	}
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	KeyFrameIndexFilename(pPath, aFilename, sizeof(aFilename));
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+	io_write(File, vData.data(), vData.size());
+	io_close(File);
+	PruneKeyFrameIndex(pStorage, m_KeyFrameIndexFiles);
+}
+
+void CDemoPlayer::PruneKeyFrameIndex(IStorage *pStorage, int MaxFiles)
+{
+	struct SIndexFile
+	{
+		std::string m_Name;
+		time_t m_Time;
+	};
+	std::vector<SIndexFile> vFiles;
+	pStorage->ListDirectoryInfo(
+		IStorage::TYPE_SAVE, "demoindex", [](const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser) {
+			if(!IsDir && str_endswith(pInfo->m_pName, ".idx"))
+				static_cast<std::vector<SIndexFile> *>(pUser)->push_back({pInfo->m_pName, pInfo->m_TimeModified});
+			return 0;
+		},
+		&vFiles);
+	if((int)vFiles.size() <= MaxFiles)
+		return;
+
+	std::sort(vFiles.begin(), vFiles.end(), [](const SIndexFile &Left, const SIndexFile &Right) { return Left.m_Time > Right.m_Time; });
+	for(size_t i = MaxFiles; i < vFiles.size(); i++)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "demoindex/%s", vFiles[i].m_Name.c_str());
+		pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+	}
+}
+
 void CDemoPlayer::DoTick()
 {
 	// update ticks
@@ -563,8 +1048,9 @@ void CDemoPlayer::DoTick()
 	bool GotSnapshot = false;
 	while(true)
 	{
-		int ChunkType, ChunkSize;
-		const EReadChunkHeaderResult Result = ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick);
+		int ChunkType, DataSize;
+		const char *pError;
+		const EReadChunkHeaderResult Result = ReadChunk(&ChunkType, &DataSize, &ChunkTick, &pError);
 		if(Result == CHUNKHEADER_EOF)
 		{
 			if(m_Info.m_PreviousTick == -1)
@@ -588,29 +1074,10 @@ void CDemoPlayer::DoTick()
 			break;
 		}
 
-		// read the chunk
-		int DataSize = 0;
-		if(ChunkSize)
+		else if(pError)
 		{
-			if(io_read(m_File, m_aCompressedSnapshotData, ChunkSize) != (unsigned)ChunkSize)
-			{
-				Stop("Error reading chunk data");
-				break;
-			}
-
-			DataSize = CNetBase::Decompress(m_aCompressedSnapshotData, ChunkSize, m_aDecompressedSnapshotData, sizeof(m_aDecompressedSnapshotData));
-			if(DataSize < 0)
-			{
-				Stop("Error during network decompression");
-				break;
-			}
-
-			DataSize = CVariableInt::Decompress(m_aDecompressedSnapshotData, DataSize, m_aCurrentSnapshotData, sizeof(m_aCurrentSnapshotData));
-			if(DataSize < 0)
-			{
-				Stop("Error during intpack decompression");
-				break;
-			}
+			Stop(pError);
+			break;
 		}
 
 		if(ChunkType == CHUNKTYPE_DELTA)
@@ -763,13 +1230,42 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 		}
 	}
 
-	// scan the file for interesting points
-	if(!ScanFile())
+	// the path is needed to identify the demo in the key frame index cache
+	char aPath[IO_MAX_PATH_LENGTH];
+	m_PrefetchFile = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aPath, sizeof(aPath));
+	if(!m_PrefetchFile)
 	{
-		Stop("Error scanning demo file");
+		Stop("Error reopening demo file");
 		return -1;
 	}
 
+	// scan the file for interesting points, unless a previous scan is cached
+	if(m_KeyFrameIndexFiles <= 0 || !LoadKeyFrameIndex(pStorage, aPath))
+	{
+		if(!ScanFile())
+		{
+			Stop("Error scanning demo file");
+			return -1;
+		}
+		if(m_KeyFrameIndexFiles > 0)
+			SaveKeyFrameIndex(pStorage, aPath);
+	}
+
+	if(m_PrefetchTicks > 0)
+	{
+		const long Filepos = io_tell(m_File);
+		if(Filepos < 0 || !SeekChunks(Filepos))
+		{
+			Stop("Error starting demo prefetch");
+			return -1;
+		}
+	}
+	else
+	{
+		io_close(m_PrefetchFile);
+		m_PrefetchFile = 0;
+	}
+
 	// reset slice markers
 	g_Config.m_ClDemoSliceBegin = -1;
 	g_Config.m_ClDemoSliceEnd = -1;
@@ -925,16 +1421,22 @@ int CDemoPlayer::SetPos(int WantedTick)
 	while(KeyFrame > 0 && m_vKeyFrames[KeyFrame].m_Tick > KeyFrameWantedTick)
 		KeyFrame--;
 
-	// seek to the correct key frame
-	if(io_seek(m_File, m_vKeyFrames[KeyFrame].m_Filepos, IOSEEK_START) != 0)
+	// when scrubbing forward past no newer key frame, keep decoding from
+	// the current position instead of going back to the key frame
+	const bool Continue = m_Info.m_PreviousTick != -1 && m_Info.m_NextTick < WantedTick && m_vKeyFrames[KeyFrame].m_Tick <= m_Info.m_NextTick;
+	if(!Continue)
 	{
-		Stop("Error seeking keyframe position");
-		return -1;
-	}
+		// seek to the correct key frame
+		if(!SeekChunks(m_vKeyFrames[KeyFrame].m_Filepos))
+		{
+			Stop("Error seeking keyframe position");
+			return -1;
+		}
 
-	m_Info.m_NextTick = -1;
-	m_Info.m_Info.m_CurrentTick = -1;
-	m_Info.m_PreviousTick = -1;
+		m_Info.m_NextTick = -1;
+		m_Info.m_Info.m_CurrentTick = -1;
+		m_Info.m_PreviousTick = -1;
+	}
 
 	// playback everything until we hit our tick
 	while(m_Info.m_NextTick < WantedTick && IsPlaying())
@@ -1023,6 +1525,12 @@ void CDemoPlayer::Stop(const char *pErrorMessage)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_player", aBuf);
 	}
 
+	m_pPrefetcher = nullptr;
+	if(m_PrefetchFile)
+	{
+		io_close(m_PrefetchFile);
+		m_PrefetchFile = 0;
+	}
 	io_close(m_File);
 	m_File = 0;
 	m_vKeyFrames.clear();
@@ -8,23 +8,99 @@
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "snapshot.h"
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+// the file and delta state of a single recording
+class CDemoRecordStream;
+
+// Writes the chunks of demo recordings on a background thread.
+//
+// The recorders only copy the snapshots and messages into a queue, the
+// deltas, the compression and the file writes happen on the writer
+// thread. If more than `MaxQueuedBytes` are waiting, recording blocks
+// until the writer has caught up.
+class CDemoRecordWriter
+{
+public:
+	class CStats
+	{
+	public:
+		int64_t m_NumJobs = 0;
+		size_t m_MaxQueuedBytes = 0;
+		// how often and how long recording had to wait for the writer
+		int64_t m_NumStalls = 0;
+		std::chrono::nanoseconds m_StallTime{0};
+	};
+
+	CDemoRecordWriter(size_t MaxQueuedBytes = 16 * 1024 * 1024);
+	~CDemoRecordWriter();
+	CDemoRecordWriter(const CDemoRecordWriter &) = delete;
+	CDemoRecordWriter &operator=(const CDemoRecordWriter &) = delete;
+
+	CStats Stats();
+
+private:
+	friend class CDemoRecorder;
+
+	enum
+	{
+		JOB_SNAPSHOT,
+		JOB_MESSAGE,
+		JOB_FINISH,
+	};
+	class CJob
+	{
+	public:
+		CDemoRecordStream *m_pStream;
+		int m_Type;
+		// the tick of snapshots, the demo length when finishing
+		int m_Tick;
+		// the snapshot or message, the timeline markers when finishing
+		std::vector<unsigned char> m_vData;
+		bool *m_pDone = nullptr;
+	};
+
+	void Push(CJob &&Job);
+	// writes the jobs of the stream before those of other streams, waits
+	// until they are done and closes it
+	void Finish(CDemoRecordStream *pStream, int Length, const int *pTimelineMarkers, int NumTimelineMarkers);
+
+	static void ThreadFunc(void *pUser);
+	void Run();
+
+	size_t m_MaxQueuedBytes;
+	void *m_pThread;
+	// only used by the writer thread
+	CSnapshotDelta m_Delta;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NewJob;
+	std::condition_variable m_JobDone;
+	std::deque<CJob> m_Jobs;
+	size_t m_QueuedBytes = 0;
+	bool m_Shutdown = false;
+	CStats m_Stats;
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
 	class IConsole *m_pConsole;
-	IOHANDLE m_File;
+	CDemoRecordStream *m_pStream;
 	char m_aCurrentFilename[IO_MAX_PATH_LENGTH];
 	int m_LastTickMarker;
-	int m_LastKeyFrame;
 	int m_FirstTick;
-	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
+	CDemoRecordWriter *m_pWriter;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
 	bool m_NoMapData;
@@ -33,11 +109,10 @@ class CDemoRecorder : public IDemoRecorder
 	DEMOFUNC_FILTER m_pfnFilter;
 	void *m_pUser;
 
-	void WriteTickMarker(int Tick, bool Keyframe);
-	void Write(int Type, const void *pData, int Size);
-
 public:
-	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
+	// Recordings are written on the thread of `pWriter` if given, else
+	// by the calling thread.
+	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false, CDemoRecordWriter *pWriter = nullptr);
 	CDemoRecorder() {}
 	~CDemoRecorder() override;
 
@@ -50,7 +125,7 @@ public:
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
 
-	bool IsRecording() const override { return m_File != nullptr; }
+	bool IsRecording() const override { return m_pStream != nullptr; }
 	char *GetCurrentFilename() override { return m_aCurrentFilename; }
 	void ClearCurrentFilename() { m_aCurrentFilename[0] = '\0'; }
 
@@ -103,10 +178,18 @@ private:
 		}
 	};
 
+	// reads and decompresses chunks ahead of playback on a separate thread
+	class CPrefetcher;
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
 	long m_MapOffset;
 	char m_aFilename[IO_MAX_PATH_LENGTH];
+	// second handle of the demo file, used by the prefetcher
+	IOHANDLE m_PrefetchFile;
+	int m_PrefetchTicks;
+	int m_KeyFrameIndexFiles;
+	std::unique_ptr<CPrefetcher> m_pPrefetcher;
 	char m_aErrorMessage[256];
 	std::vector<SKeyFrame> m_vKeyFrames;
 	CMapInfo m_MapInfo;
@@ -132,9 +215,15 @@ private:
 		CHUNKHEADER_ERROR,
 		CHUNKHEADER_EOF,
 	};
-	EReadChunkHeaderResult ReadChunkHeader(int *pType, int *pSize, int *pTick);
+	EReadChunkHeaderResult ReadChunkHeader(IOHANDLE File, int *pType, int *pSize, int *pTick) const;
+	// reads the next chunk into `m_aCurrentSnapshotData`, `*ppError` is
+	// set if its data could not be read
+	EReadChunkHeaderResult ReadChunk(int *pType, int *pDataSize, int *pTick, const char **ppError);
 	void DoTick();
 	bool ScanFile();
+	bool LoadKeyFrameIndex(class IStorage *pStorage, const char *pPath);
+	void SaveKeyFrameIndex(class IStorage *pStorage, const char *pPath);
+	bool SeekChunks(long Filepos);
 
 	int64_t Time();
 
@@ -146,6 +235,14 @@ public:
 	void Construct(class CSnapshotDelta *pSnapshotDelta, bool UseVideo);
 
 	void SetListener(IListener *pListener);
+	// Decodes up to `Ticks` ticks ahead of playback on a separate thread,
+	// 0 reads the file on demand. Takes effect with the next `Load`.
+	void SetPrefetchTicks(int Ticks) { m_PrefetchTicks = Ticks; }
+	// Keeps the key frames of up to `MaxFiles` scanned demos in "demoindex",
+	// 0 scans every demo again. Takes effect with the next `Load`.
+	void SetKeyFrameIndexFiles(int MaxFiles) { m_KeyFrameIndexFiles = MaxFiles; }
+	// removes the oldest key frame index files if there are more than `MaxFiles`
+	static void PruneKeyFrameIndex(class IStorage *pStorage, int MaxFiles);
 
 	int Load(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, int StorageType);
 	unsigned char *GetMapData(class IStorage *pStorage);
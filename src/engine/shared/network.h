@@ -411,6 +411,11 @@ public:
 	int Send(CNetChunk *pChunk);
 	int Update();
 
+	// queues the sent packets until `Flush` is called, returns false if
+	// this is not supported on this platform
+	bool SetSendBatching(bool Enabled);
+	void Flush();
+
 	//
 	int Drop(int ClientID, const char *pReason);
 
@@ -97,6 +97,16 @@ int CNetServer::Close()
 	return net_udp_close(m_Socket);
 }
 
+bool CNetServer::SetSendBatching(bool Enabled)
+{
+	return net_udp_set_send_batching(m_Socket, Enabled) == 0;
+}
+
+void CNetServer::Flush()
+{
+	net_udp_flush(m_Socket);
+}
+
 int CNetServer::Drop(int ClientID, const char *pReason)
 {
 	// TODO: insert lots of checks here
@@ -4,6 +4,7 @@
 #include "compression.h"
 #include "uuid_manager.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 
@@ -56,7 +57,7 @@ int CSnapshot::GetExternalItemType(int InternalType) const
 
 int CSnapshot::GetItemIndex(int Key) const
 {
-	// TODO: OPT: this should not be a linear search. very bad
+	// linear search, use CSnapshotItemIndex for repeated lookups
 	for(int i = 0; i < m_NumItems; i++)
 	{
 		if(GetItem(i)->Key() == Key)
@@ -146,6 +147,90 @@ bool CSnapshot::IsValid(size_t ActualSize) const
 	return true;
 }
 
+// CSnapshotItemIndex
+
+void CSnapshotItemIndex::Build(const CSnapshot *pSnap)
+{
+	m_pSnap = pSnap;
+
+	const int NumItems = pSnap->NumItems();
+	m_vIndices.resize(NumItems);
+	for(int i = 0; i < NumItems; i++)
+		m_vIndices[i] = i;
+	std::stable_sort(m_vIndices.begin(), m_vIndices.end(), [pSnap](int a, int b) {
+		return pSnap->GetItem(a)->Key() < pSnap->GetItem(b)->Key();
+	});
+	m_vKeys.resize(NumItems);
+	for(int i = 0; i < NumItems; i++)
+		m_vKeys[i] = pSnap->GetItem(m_vIndices[i])->Key();
+
+	// resolve the UUIDs of the NETOBJTYPE_EX items, first item wins like in
+	// a linear search
+	m_vExtendedTypes.clear();
+	for(int i = 0; i < NumItems; i++)
+	{
+		const CSnapshotItem *pItem = pSnap->GetItem(i);
+		if(pItem->Type() != 0 || pItem->ID() < CSnapshot::OFFSET_UUID_TYPE)
+			continue;
+		if(std::any_of(m_vExtendedTypes.begin(), m_vExtendedTypes.end(), [pItem](const CExtendedType &Type) { return Type.m_InternalType == pItem->ID(); }))
+			continue;
+		CExtendedType Type;
+		Type.m_InternalType = pItem->ID();
+		Type.m_ExternalType = pSnap->GetExternalItemType(pItem->ID());
+		m_vExtendedTypes.push_back(Type);
+	}
+}
+
+void CSnapshotItemIndex::Clear()
+{
+	m_pSnap = nullptr;
+	m_vKeys.clear();
+	m_vIndices.clear();
+	m_vExtendedTypes.clear();
+}
+
+int CSnapshotItemIndex::GetItemIndex(int Key) const
+{
+	auto It = std::lower_bound(m_vKeys.begin(), m_vKeys.end(), Key);
+	if(It == m_vKeys.end() || *It != Key)
+		return -1;
+	return m_vIndices[It - m_vKeys.begin()];
+}
+
+int CSnapshotItemIndex::GetItemType(int Index) const
+{
+	return GetExternalItemType(m_pSnap->GetItem(Index)->Type());
+}
+
+int CSnapshotItemIndex::GetExternalItemType(int InternalType) const
+{
+	if(InternalType < CSnapshot::OFFSET_UUID_TYPE)
+		return InternalType;
+
+	for(const CExtendedType &Type : m_vExtendedTypes)
+	{
+		if(Type.m_InternalType == InternalType)
+			return Type.m_ExternalType;
+	}
+	return InternalType;
+}
+
+const void *CSnapshotItemIndex::FindItem(int Type, int ID) const
+{
+	int InternalType = Type;
+	if(Type >= OFFSET_UUID)
+	{
+		// the cached types are in item order, so this finds the same
+		// item as CSnapshot::FindItem
+		auto It = std::find_if(m_vExtendedTypes.begin(), m_vExtendedTypes.end(), [Type](const CExtendedType &ExtendedType) { return ExtendedType.m_ExternalType == Type; });
+		if(It == m_vExtendedTypes.end())
+			return nullptr;
+		InternalType = It->m_InternalType;
+	}
+	int Index = GetItemIndex((InternalType << 16) | ID);
+	return Index < 0 ? nullptr : m_pSnap->GetItem(Index)->Data();
+}
+
 // CSnapshotDelta
 
 enum
@@ -263,13 +348,28 @@ void CSnapshotDelta::SetStaticsize(int ItemType, int Size)
 	m_aItemSizes[ItemType] = Size;
 }
 
+void CSnapshotDelta::CopyStaticsizes(const CSnapshotDelta &Other)
+{
+	mem_copy(m_aItemSizes, Other.m_aItemSizes, sizeof(m_aItemSizes));
+}
+
+void CSnapshotDelta::GetStaticsizes(CStaticsizes *pStaticsizes) const
+{
+	mem_copy(pStaticsizes->m_aItemSizes, m_aItemSizes, sizeof(m_aItemSizes));
+}
+
+void CSnapshotDelta::SetStaticsizes(const CStaticsizes &Staticsizes)
+{
+	mem_copy(m_aItemSizes, Staticsizes.m_aItemSizes, sizeof(m_aItemSizes));
+}
+
 const CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta() const
 {
 	return &m_Empty;
 }
 
 // TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_aData;
@@ -368,6 +468,9 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 	CSnapshotBuilder Builder;
 	Builder.Init();
 
+	CSnapshotItemIndex FromIndex;
+	FromIndex.Build(pFrom);
+
 	// unpack deleted stuff
 	int *pDeleted = pData;
 	if(pDelta->m_NumDeletedItems < 0)
@@ -376,22 +479,18 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 	if(pData > pEnd)
 		return -101;
 
-	// copy all non deleted stuff
+	std::vector<int> vDeletedKeys(pDeleted, pDeleted + pDelta->m_NumDeletedItems);
+	std::sort(vDeletedKeys.begin(), vDeletedKeys.end());
+
+	// copy all non deleted stuff, remembering where the items ended up in
+	// the builder
+	std::vector<int> vBuilderIndices(pFrom->NumItems(), -1);
 	for(int i = 0; i < pFrom->NumItems(); i++)
 	{
 		const CSnapshotItem *pFromItem = pFrom->GetItem(i);
 		const int ItemSize = pFrom->GetItemSize(i);
-		bool Keep = true;
-		for(int d = 0; d < pDelta->m_NumDeletedItems; d++)
-		{
-			if(pDeleted[d] == pFromItem->Key())
-			{
-				Keep = false;
-				break;
-			}
-		}
 
-		if(Keep)
+		if(!std::binary_search(vDeletedKeys.begin(), vDeletedKeys.end(), pFromItem->Key()))
 		{
 			void *pObj = Builder.NewItem(pFromItem->Type(), pFromItem->ID(), ItemSize);
 			if(!pObj)
@@ -399,8 +498,10 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 
 			// keep it
 			mem_copy(pObj, pFromItem->Data(), ItemSize);
+			vBuilderIndices[i] = Builder.NumItems() - 1;
 		}
 	}
+	const int NumKeptItems = Builder.NumItems();
 
 	// unpack updated stuff
 	for(int i = 0; i < pDelta->m_NumUpdateItems; i++)
@@ -432,20 +533,25 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 			return -205;
 
 		const int Key = (Type << 16) | ID;
+		const int FromItemIndex = FromIndex.GetItemIndex(Key);
 
-		// create the item if needed
-		int *pNewData = Builder.GetItemData(Key);
+		// create the item if needed, kept items are found through the index
+		// and only the new items have to be searched
+		int *pNewData = nullptr;
+		if(FromItemIndex != -1 && vBuilderIndices[FromItemIndex] != -1)
+			pNewData = Builder.GetItem(vBuilderIndices[FromItemIndex])->Data();
+		else
+			pNewData = Builder.GetItemData(Key, NumKeptItems);
 		if(!pNewData)
 			pNewData = (int *)Builder.NewItem(Type, ID, ItemSize);
 
 		if(!pNewData)
 			return -302;
 
-		const int FromIndex = pFrom->GetItemIndex(Key);
-		if(FromIndex != -1)
+		if(FromItemIndex != -1)
 		{
 			// we got an update so we need to apply the diff
-			UndiffItem(pFrom->GetItem(FromIndex)->Data(), pData, pNewData, ItemSize / sizeof(int32_t), &m_aSnapshotDataRate[Type]);
+			UndiffItem(pFrom->GetItem(FromItemIndex)->Data(), pData, pNewData, ItemSize / sizeof(int32_t), &m_aSnapshotDataRate[Type]);
 		}
 		else // no previous, just copy the pData
 		{
@@ -598,9 +704,9 @@ CSnapshotItem *CSnapshotBuilder::GetItem(int Index)
 	return (CSnapshotItem *)&(m_aData[m_aOffsets[Index]]);
 }
 
-int *CSnapshotBuilder::GetItemData(int Key)
+int *CSnapshotBuilder::GetItemData(int Key, int FirstIndex)
 {
-	for(int i = 0; i < m_NumItems; i++)
+	for(int i = FirstIndex; i < m_NumItems; i++)
 	{
 		if(GetItem(i)->Key() == Key)
 			return GetItem(i)->Data();
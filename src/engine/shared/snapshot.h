@@ -5,12 +5,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 // CSnapshot
 
 class CSnapshotItem
 {
 	friend class CSnapshotBuilder;
+	friend class CSnapshotDelta;
 
 	int *Data() { return (int *)(this + 1); }
 
@@ -63,6 +65,39 @@ public:
 	static const CSnapshot *EmptySnapshot() { return &ms_EmptySnapshot; }
 };
 
+// CSnapshotItemIndex
+
+// Key index over the items of a snapshot, for snapshots that are searched
+// many times. `GetItemIndex` is a binary search instead of a linear one and
+// the UUID types of extended items are resolved once when building.
+// The index must be rebuilt when the snapshot changes.
+class CSnapshotItemIndex
+{
+	const CSnapshot *m_pSnap = nullptr;
+
+	// item keys and their indices, sorted by key and then index
+	std::vector<int> m_vKeys;
+	std::vector<int> m_vIndices;
+
+	class CExtendedType
+	{
+	public:
+		int m_InternalType;
+		int m_ExternalType;
+	};
+	std::vector<CExtendedType> m_vExtendedTypes;
+
+public:
+	void Build(const CSnapshot *pSnap);
+	void Clear();
+	const CSnapshot *Snapshot() const { return m_pSnap; }
+
+	int GetItemIndex(int Key) const;
+	int GetItemType(int Index) const;
+	int GetExternalItemType(int InternalType) const;
+	const void *FindItem(int Type, int ID) const;
+};
+
 // CSnapshotDelta
 
 class CSnapshotDelta
@@ -77,11 +112,19 @@ public:
 		int m_aData[1];
 	};
 
-private:
 	enum
 	{
 		MAX_NETOBJSIZES = 64
 	};
+
+	// a copy of the static item sizes, for deltas on other threads
+	class CStaticsizes
+	{
+	public:
+		short m_aItemSizes[MAX_NETOBJSIZES];
+	};
+
+private:
 	short m_aItemSizes[MAX_NETOBJSIZES];
 	int m_aSnapshotDataRate[CSnapshot::MAX_TYPE + 1];
 	int m_aSnapshotDataUpdates[CSnapshot::MAX_TYPE + 1];
@@ -96,8 +139,11 @@ public:
 	int GetDataRate(int Index) const { return m_aSnapshotDataRate[Index]; }
 	int GetDataUpdates(int Index) const { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
+	void CopyStaticsizes(const CSnapshotDelta &Other);
+	void GetStaticsizes(CStaticsizes *pStaticsizes) const;
+	void SetStaticsizes(const CStaticsizes &Staticsizes);
 	const CData *EmptyDelta() const;
-	int CreateDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData);
+	int CreateDelta(const class CSnapshot *pFrom, const class CSnapshot *pTo, void *pDstData);
 	int UnpackDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, const void *pSrcData, int DataSize);
 };
 
@@ -163,8 +209,9 @@ public:
 
 	void *NewItem(int Type, int ID, int Size);
 
+	int NumItems() const { return m_NumItems; }
 	CSnapshotItem *GetItem(int Index);
-	int *GetItemData(int Key);
+	int *GetItemData(int Key, int FirstIndex = 0);
 
 	int Finish(void *pSnapdata);
 };
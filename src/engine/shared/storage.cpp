@@ -92,6 +92,8 @@ public:
 				CreateFolder("downloadedmaps", TYPE_SAVE);
 				CreateFolder("skins", TYPE_SAVE);
 				CreateFolder("downloadedskins", TYPE_SAVE);
+				CreateFolder("skincache", TYPE_SAVE);
+				CreateFolder("mapcache", TYPE_SAVE);
 				CreateFolder("themes", TYPE_SAVE);
 				CreateFolder("communityicons", TYPE_SAVE);
 				CreateFolder("assets", TYPE_SAVE);
@@ -110,6 +112,7 @@ public:
 			CreateFolder("demos/auto", TYPE_SAVE);
 			CreateFolder("demos/auto/race", TYPE_SAVE);
 			CreateFolder("demos/replays", TYPE_SAVE);
+			CreateFolder("demoindex", TYPE_SAVE);
 			CreateFolder("editor", TYPE_SAVE);
 			CreateFolder("ghosts", TYPE_SAVE);
 			CreateFolder("teehistorian", TYPE_SAVE);
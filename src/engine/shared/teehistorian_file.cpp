@@ -0,0 +1,200 @@
+#include "teehistorian_file.h"
+
+#include <base/math.h>
+
+// deflateInit2 and inflateInit2 use the gzip format with this window size
+static const int GZIP_WINDOW_BITS = 15 + 16;
+
+CTeeHistorianCompressor::~CTeeHistorianCompressor()
+{
+	if(m_Initialized)
+		deflateEnd(&m_Stream);
+}
+
+bool CTeeHistorianCompressor::Init(int Level)
+{
+	if(m_Initialized)
+		deflateEnd(&m_Stream);
+	mem_zero(&m_Stream, sizeof(m_Stream));
+	m_Initialized = deflateInit2(&m_Stream, Level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	m_UnflushedBytes = 0;
+	m_LastFlush = time_get_nanoseconds();
+	return !m_Initialized;
+}
+
+bool CTeeHistorianCompressor::Write(IOHANDLE File, const void *pData, unsigned Size, bool Finish)
+{
+	if(!m_Initialized)
+		return true;
+
+	m_UnflushedBytes += Size;
+	int Flush = Z_NO_FLUSH;
+	if(Finish)
+	{
+		Flush = Z_FINISH;
+	}
+	else if(m_UnflushedBytes >= FLUSH_BYTES || time_get_nanoseconds() - m_LastFlush >= FLUSH_INTERVAL)
+	{
+		Flush = Z_FULL_FLUSH;
+		m_UnflushedBytes = 0;
+		m_LastFlush = time_get_nanoseconds();
+	}
+
+	m_Stream.next_in = (Bytef *)pData;
+	m_Stream.avail_in = Size;
+	while(true)
+	{
+		unsigned char aOutput[64 * 1024];
+		m_Stream.next_out = aOutput;
+		m_Stream.avail_out = sizeof(aOutput);
+		const int Result = deflate(&m_Stream, Flush);
+		if(Result == Z_STREAM_ERROR)
+			return true;
+		const unsigned OutputSize = sizeof(aOutput) - m_Stream.avail_out;
+		if(OutputSize > 0 && io_write(File, aOutput, OutputSize) != OutputSize)
+			return true;
+		// the output buffer wasn't filled, so all input is consumed and
+		// the flush is complete
+		if(m_Stream.avail_out != 0 || Result == Z_STREAM_END)
+			break;
+	}
+	if(Finish)
+	{
+		deflateEnd(&m_Stream);
+		m_Initialized = false;
+	}
+	return false;
+}
+
+int CTeeHistorianCompressor::AioWrite(IOHANDLE File, const void *pData, unsigned Size, int Finish, void *pUser)
+{
+	return static_cast<CTeeHistorianCompressor *>(pUser)->Write(File, pData, Size, Finish);
+}
+
+CTeeHistorianFileReader::~CTeeHistorianFileReader()
+{
+	Close();
+}
+
+bool CTeeHistorianFileReader::Open(IOHANDLE File)
+{
+	Close();
+	m_File = File;
+	m_Offset = 0;
+	m_StreamEnd = false;
+
+	// gzip streams start with 0x1f 0x8b, uncompressed files with the
+	// teehistorian uuid
+	unsigned char aMagic[2];
+	const bool Gzip = io_read(m_File, aMagic, sizeof(aMagic)) == sizeof(aMagic) && aMagic[0] == 0x1f && aMagic[1] == 0x8b;
+	if(io_seek(m_File, 0, IOSEEK_START) != 0)
+	{
+		Close();
+		return true;
+	}
+
+	m_Compressed = Gzip;
+	if(m_Compressed)
+	{
+		mem_zero(&m_Stream, sizeof(m_Stream));
+		if(inflateInit2(&m_Stream, GZIP_WINDOW_BITS) != Z_OK)
+		{
+			m_Compressed = false;
+			Close();
+			return true;
+		}
+	}
+	return false;
+}
+
+void CTeeHistorianFileReader::Close()
+{
+	if(!m_File)
+		return;
+	if(m_Compressed)
+		inflateEnd(&m_Stream);
+	io_close(m_File);
+	m_File = nullptr;
+	m_Compressed = false;
+}
+
+int CTeeHistorianFileReader::Read(void *pBuffer, unsigned Size)
+{
+	if(!m_File)
+		return -1;
+	if(!m_Compressed)
+	{
+		const unsigned Read = io_read(m_File, pBuffer, Size);
+		m_Offset += Read;
+		return Read;
+	}
+	if(m_StreamEnd || Size == 0)
+		return 0;
+
+	m_Stream.next_out = (Bytef *)pBuffer;
+	m_Stream.avail_out = Size;
+	while(m_Stream.avail_out > 0)
+	{
+		if(m_Stream.avail_in == 0)
+		{
+			const unsigned Read = io_read(m_File, m_aInput, sizeof(m_aInput));
+			if(Read == 0)
+			{
+				// truncated file, return what was decompressed so far
+				if(m_Stream.avail_out == Size)
+					return -1;
+				break;
+			}
+			m_Stream.next_in = m_aInput;
+			m_Stream.avail_in = Read;
+		}
+		const int Result = inflate(&m_Stream, Z_NO_FLUSH);
+		if(Result == Z_STREAM_END)
+		{
+			m_StreamEnd = true;
+			break;
+		}
+		if(Result != Z_OK && Result != Z_BUF_ERROR)
+			return -1;
+	}
+	m_Offset += Size - m_Stream.avail_out;
+	return Size - m_Stream.avail_out;
+}
+
+bool CTeeHistorianFileReader::Seek(int64_t Offset)
+{
+	if(!m_File || Offset < 0)
+		return true;
+	if(!m_Compressed)
+	{
+		// `io_seek` only takes an int
+		if(io_seek(m_File, 0, IOSEEK_START) != 0)
+			return true;
+		for(int64_t Left = Offset; Left > 0;)
+		{
+			const int Step = minimum<int64_t>(Left, 1 << 30);
+			if(io_seek(m_File, Step, IOSEEK_CUR) != 0)
+				return true;
+			Left -= Step;
+		}
+		m_Offset = Offset;
+		return false;
+	}
+
+	if(Offset < m_Offset)
+	{
+		// deflate streams can only be read forward, start over
+		if(io_seek(m_File, 0, IOSEEK_START) != 0 || inflateReset(&m_Stream) != Z_OK)
+			return true;
+		m_Stream.avail_in = 0;
+		m_Offset = 0;
+		m_StreamEnd = false;
+	}
+	while(m_Offset < Offset)
+	{
+		unsigned char aDiscard[16 * 1024];
+		if(Read(aDiscard, minimum<int64_t>(Offset - m_Offset, sizeof(aDiscard))) <= 0)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,78 @@
+#ifndef ENGINE_SHARED_TEEHISTORIAN_FILE_H
+#define ENGINE_SHARED_TEEHISTORIAN_FILE_H
+
+#include <base/system.h>
+
+#include <chrono>
+
+#include <zlib.h>
+
+// Compresses teehistorian files into a gzip stream, so they can also be
+// read with `zcat`.
+//
+// Meant to be used as the write function of an ASYNCIO, so the
+// compression happens on the aio thread. A full flush point is written
+// after every `FLUSH_BYTES` of input or `FLUSH_INTERVAL`, so the file
+// can be read up to the last flush point if the server crashes.
+class CTeeHistorianCompressor
+{
+public:
+	enum
+	{
+		FLUSH_BYTES = 1024 * 1024,
+	};
+	static constexpr std::chrono::seconds FLUSH_INTERVAL{10};
+
+	CTeeHistorianCompressor() = default;
+	~CTeeHistorianCompressor();
+	CTeeHistorianCompressor(const CTeeHistorianCompressor &) = delete;
+	CTeeHistorianCompressor &operator=(const CTeeHistorianCompressor &) = delete;
+
+	// returns true on error
+	bool Init(int Level);
+	// returns true on error
+	bool Write(IOHANDLE File, const void *pData, unsigned Size, bool Finish);
+
+	// ASYNCIO_WRITE_FUNC
+	static int AioWrite(IOHANDLE File, const void *pData, unsigned Size, int Finish, void *pUser);
+
+private:
+	bool m_Initialized = false;
+	z_stream m_Stream;
+	unsigned m_UnflushedBytes = 0;
+	std::chrono::nanoseconds m_LastFlush{0};
+};
+
+// Reads teehistorian files, decompressing them if they are compressed.
+class CTeeHistorianFileReader
+{
+public:
+	CTeeHistorianFileReader() = default;
+	~CTeeHistorianFileReader();
+	CTeeHistorianFileReader(const CTeeHistorianFileReader &) = delete;
+	CTeeHistorianFileReader &operator=(const CTeeHistorianFileReader &) = delete;
+
+	// takes ownership of the file, returns true on error
+	bool Open(IOHANDLE File);
+	void Close();
+	bool Compressed() const { return m_Compressed; }
+
+	// Returns the number of bytes read, 0 at the end of the file and -1
+	// on errors. Truncated compressed files are read up to where they
+	// were cut off before reporting an error.
+	int Read(void *pBuffer, unsigned Size);
+	// Moves to `Offset` in the uncompressed data, returns true on error.
+	// Compressed files are decompressed up to that point.
+	bool Seek(int64_t Offset);
+	int64_t Offset() const { return m_Offset; }
+
+private:
+	IOHANDLE m_File = nullptr;
+	int64_t m_Offset = 0;
+	bool m_Compressed = false;
+	bool m_StreamEnd = false;
+	z_stream m_Stream;
+	unsigned char m_aInput[64 * 1024];
+};
+
+#endif // ENGINE_SHARED_TEEHISTORIAN_FILE_H
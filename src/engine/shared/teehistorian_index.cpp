@@ -0,0 +1,445 @@
+#include "teehistorian_index.h"
+
+#include "compression.h"
+#include "packer.h"
+#include "teehistorian_file.h"
+
+#include <algorithm>
+
+static const CUuid TEEHISTORIAN_UUID = CalculateUuid("teehistorian@ddnet.tw");
+const CUuid CTeeHistorianIndex::ms_IndexUuid = CalculateUuid("teehistorian-index@ddnet.tw");
+
+#define UUID(id, name) static const CUuid UUID_##id = CalculateUuid(name);
+#include "teehistorian_ex_chunks.h"
+#undef UUID
+
+static void AddInt(std::vector<unsigned char> *pvData, int Value)
+{
+	unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
+	const unsigned char *pEnd = CVariableInt::Pack(aBuf, Value, sizeof(aBuf));
+	pvData->insert(pvData->end(), (const unsigned char *)aBuf, pEnd);
+}
+
+void CTeeHistorianKeyframe::Reset()
+{
+	m_Tick = 0;
+	m_LastTick = 0;
+	m_Offset = 0;
+	for(auto &Player : m_aPlayers)
+	{
+		Player.m_Alive = false;
+		Player.m_X = 0;
+		Player.m_Y = 0;
+		Player.m_HaveInput = false;
+		mem_zero(Player.m_aInput, sizeof(Player.m_aInput));
+		Player.m_Team = 0;
+	}
+	for(bool &Practice : m_aTeamPractice)
+		Practice = false;
+}
+
+void CTeeHistorianKeyframe::Pack(std::vector<unsigned char> *pvData) const
+{
+	AddInt(pvData, m_Tick);
+	AddInt(pvData, m_LastTick);
+	AddInt(pvData, (int)(m_Offset & 0xffffffff));
+	AddInt(pvData, (int)(m_Offset >> 32));
+
+	// only players that aren't in the default state
+	int NumPlayers = 0;
+	for(const auto &Player : m_aPlayers)
+		NumPlayers += Player.m_Alive || Player.m_HaveInput || Player.m_Team != 0;
+	AddInt(pvData, NumPlayers);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CPlayer &Player = m_aPlayers[i];
+		if(!Player.m_Alive && !Player.m_HaveInput && Player.m_Team == 0)
+			continue;
+		AddInt(pvData, i);
+		AddInt(pvData, Player.m_Alive);
+		AddInt(pvData, Player.m_X);
+		AddInt(pvData, Player.m_Y);
+		AddInt(pvData, Player.m_Team);
+		AddInt(pvData, Player.m_HaveInput);
+		if(Player.m_HaveInput)
+		{
+			for(int Input : Player.m_aInput)
+				AddInt(pvData, Input);
+		}
+	}
+
+	int NumPractice = 0;
+	for(bool Practice : m_aTeamPractice)
+		NumPractice += Practice;
+	AddInt(pvData, NumPractice);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_aTeamPractice[i])
+			AddInt(pvData, i);
+	}
+}
+
+bool CTeeHistorianKeyframe::Unpack(CUnpacker *pUnpacker)
+{
+	Reset();
+	m_Tick = pUnpacker->GetInt();
+	m_LastTick = pUnpacker->GetInt();
+	const unsigned OffsetLow = pUnpacker->GetInt();
+	const int OffsetHigh = pUnpacker->GetInt();
+	m_Offset = ((int64_t)OffsetHigh << 32) | OffsetLow;
+
+	const int NumPlayers = pUnpacker->GetInt();
+	if(NumPlayers < 0 || NumPlayers > MAX_CLIENTS)
+		return true;
+	for(int i = 0; i < NumPlayers; i++)
+	{
+		const int ClientID = pUnpacker->GetInt();
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS)
+			return true;
+		CPlayer &Player = m_aPlayers[ClientID];
+		Player.m_Alive = pUnpacker->GetInt();
+		Player.m_X = pUnpacker->GetInt();
+		Player.m_Y = pUnpacker->GetInt();
+		Player.m_Team = pUnpacker->GetInt();
+		Player.m_HaveInput = pUnpacker->GetInt();
+		if(Player.m_HaveInput)
+		{
+			for(int &Input : Player.m_aInput)
+				Input = pUnpacker->GetInt();
+		}
+	}
+
+	const int NumPractice = pUnpacker->GetInt();
+	if(NumPractice < 0 || NumPractice > MAX_CLIENTS)
+		return true;
+	for(int i = 0; i < NumPractice; i++)
+	{
+		const int Team = pUnpacker->GetInt();
+		if(Team < 0 || Team >= MAX_CLIENTS)
+			return true;
+		m_aTeamPractice[Team] = true;
+	}
+	return pUnpacker->Error() || m_Offset < 0;
+}
+
+void CTeeHistorianIndex::PackHeader(std::vector<unsigned char> *pvData, CUuid GameUuid, int KeyframeInterval)
+{
+	pvData->insert(pvData->end(), ms_IndexUuid.m_aData, ms_IndexUuid.m_aData + sizeof(ms_IndexUuid.m_aData));
+	pvData->insert(pvData->end(), GameUuid.m_aData, GameUuid.m_aData + sizeof(GameUuid.m_aData));
+	AddInt(pvData, KeyframeInterval);
+}
+
+void CTeeHistorianIndex::PackKeyframe(std::vector<unsigned char> *pvData, const CTeeHistorianKeyframe &Keyframe)
+{
+	std::vector<unsigned char> vKeyframe;
+	Keyframe.Pack(&vKeyframe);
+	AddInt(pvData, (int)vKeyframe.size());
+	pvData->insert(pvData->end(), vKeyframe.begin(), vKeyframe.end());
+}
+
+bool CTeeHistorianIndex::Load(IOHANDLE File)
+{
+	m_vData.clear();
+	m_vEntries.clear();
+
+	void *pData;
+	unsigned DataSize;
+	io_read_all(File, &pData, &DataSize);
+	m_vData.assign((unsigned char *)pData, (unsigned char *)pData + DataSize);
+	free(pData);
+
+	const int HeaderSize = sizeof(ms_IndexUuid) + sizeof(m_GameUuid);
+	if(m_vData.size() < (size_t)HeaderSize || mem_comp(m_vData.data(), &ms_IndexUuid, sizeof(ms_IndexUuid)) != 0)
+		return true;
+	mem_copy(&m_GameUuid, m_vData.data() + sizeof(ms_IndexUuid), sizeof(m_GameUuid));
+
+	const unsigned char *pStart = m_vData.data();
+	const unsigned char *pEnd = pStart + m_vData.size();
+	const unsigned char *pCur = CVariableInt::Unpack(pStart + HeaderSize, &m_KeyframeInterval, pEnd - pStart - HeaderSize);
+	if(!pCur)
+		return true;
+
+	// only read the sizes and ticks, keyframes are unpacked on demand
+	while(pCur < pEnd)
+	{
+		CEntry Entry;
+		const unsigned char *pKeyframe = CVariableInt::Unpack(pCur, &Entry.m_Size, pEnd - pCur);
+		if(!pKeyframe || Entry.m_Size <= 0 || Entry.m_Size > pEnd - pKeyframe)
+			break; // truncated by a crash
+		if(!CVariableInt::Unpack(pKeyframe, &Entry.m_Tick, Entry.m_Size))
+			break;
+		if(!m_vEntries.empty() && Entry.m_Tick <= m_vEntries.back().m_Tick)
+			return true;
+		Entry.m_DataOffset = pKeyframe - pStart;
+		m_vEntries.push_back(Entry);
+		pCur = pKeyframe + Entry.m_Size;
+	}
+	return false;
+}
+
+bool CTeeHistorianIndex::Find(int Tick, CTeeHistorianKeyframe *pKeyframe) const
+{
+	auto It = std::upper_bound(m_vEntries.begin(), m_vEntries.end(), Tick, [](int Value, const CEntry &Entry) {
+		return Value < Entry.m_Tick;
+	});
+	if(It == m_vEntries.begin())
+		return true;
+	return Get(It - m_vEntries.begin() - 1, pKeyframe);
+}
+
+bool CTeeHistorianIndex::Get(int Index, CTeeHistorianKeyframe *pKeyframe) const
+{
+	const CEntry &Entry = m_vEntries[Index];
+	CUnpacker Unpacker;
+	Unpacker.Reset(m_vData.data() + Entry.m_DataOffset, Entry.m_Size);
+	return pKeyframe->Unpack(&Unpacker);
+}
+
+CTeeHistorianDecoder::CTeeHistorianDecoder(CTeeHistorianFileReader *pReader) :
+	m_pReader(pReader)
+{
+	m_BufferPos = 0;
+	m_BufferSize = 0;
+	m_Offset = 0;
+	m_State.Reset();
+	m_LastClientID = MAX_CLIENTS;
+}
+
+bool CTeeHistorianDecoder::ReadByte(unsigned char *pByte)
+{
+	if(m_BufferPos == m_BufferSize)
+	{
+		const int Read = m_pReader->Read(m_aBuffer, sizeof(m_aBuffer));
+		if(Read <= 0)
+			return true;
+		m_BufferPos = 0;
+		m_BufferSize = Read;
+	}
+	*pByte = m_aBuffer[m_BufferPos++];
+	m_Offset++;
+	return false;
+}
+
+bool CTeeHistorianDecoder::ReadInt(int *pInt)
+{
+	unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
+	int Size = 0;
+	do
+	{
+		if(ReadByte(&aBuf[Size]))
+			return true;
+		Size++;
+	} while(aBuf[Size - 1] & 0x80 && Size < (int)sizeof(aBuf));
+	return !CVariableInt::Unpack(aBuf, pInt, Size);
+}
+
+bool CTeeHistorianDecoder::ReadRaw(int Size)
+{
+	if(Size < 0)
+		return true;
+	m_vChunkData.resize(Size);
+	for(int i = 0; i < Size; i++)
+	{
+		if(ReadByte(&m_vChunkData[i]))
+			return true;
+	}
+	return false;
+}
+
+bool CTeeHistorianDecoder::ReadString(std::string *pString)
+{
+	pString->clear();
+	while(true)
+	{
+		unsigned char Char;
+		if(ReadByte(&Char))
+			return true;
+		if(Char == 0)
+			return false;
+		pString->push_back(Char);
+	}
+}
+
+bool CTeeHistorianDecoder::ReadHeader()
+{
+	if(ReadRaw(sizeof(TEEHISTORIAN_UUID)) || mem_comp(m_vChunkData.data(), &TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID)) != 0)
+		return true;
+	if(ReadString(&m_Header))
+		return true;
+	// tick 0 is implicit at the start
+	m_State.Reset();
+	m_LastClientID = MAX_CLIENTS;
+	return false;
+}
+
+bool CTeeHistorianDecoder::Seek(const CTeeHistorianKeyframe &Keyframe)
+{
+	if(m_pReader->Seek(Keyframe.m_Offset))
+		return true;
+	m_BufferPos = 0;
+	m_BufferSize = 0;
+	m_Offset = Keyframe.m_Offset;
+	m_State = Keyframe;
+	m_State.m_Tick = Keyframe.m_LastTick;
+	// the first player chunk after a keyframe begins a new tick
+	m_LastClientID = MAX_CLIENTS;
+	return false;
+}
+
+bool CTeeHistorianDecoder::ReadPlayerChunk(int ClientID)
+{
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS)
+		return true;
+	// player chunks are ordered by client id, a lower one means that the
+	// next tick started implicitly
+	if(ClientID <= m_LastClientID)
+		m_State.m_Tick++;
+	m_LastClientID = ClientID;
+	return false;
+}
+
+bool CTeeHistorianDecoder::ReadChunk(CChunk *pChunk)
+{
+	pChunk->m_ClientID = -1;
+	pChunk->m_Uuid = UUID_ZEROED;
+	pChunk->m_pData = nullptr;
+	pChunk->m_DataSize = 0;
+	pChunk->m_pString = nullptr;
+
+	int Type;
+	if(ReadInt(&Type))
+		return true;
+	if(Type >= 0)
+	{
+		pChunk->m_Type = CHUNK_PLAYER_DIFF;
+		pChunk->m_ClientID = Type;
+		int Dx, Dy;
+		if(ReadInt(&Dx) || ReadInt(&Dy) || ReadPlayerChunk(Type))
+			return true;
+		m_State.m_aPlayers[Type].m_X += Dx;
+		m_State.m_aPlayers[Type].m_Y += Dy;
+		return false;
+	}
+
+	pChunk->m_Type = -Type;
+	switch(pChunk->m_Type)
+	{
+	case TEEHISTORIAN_FINISH:
+		return false;
+	case TEEHISTORIAN_TICK_SKIP:
+	{
+		int Dt;
+		if(ReadInt(&Dt) || Dt < 0)
+			return true;
+		m_State.m_Tick += Dt + 1;
+		m_LastClientID = -1;
+		return false;
+	}
+	case TEEHISTORIAN_PLAYER_NEW:
+	{
+		int ClientID, X, Y;
+		if(ReadInt(&ClientID) || ReadInt(&X) || ReadInt(&Y) || ReadPlayerChunk(ClientID))
+			return true;
+		pChunk->m_ClientID = ClientID;
+		CTeeHistorianKeyframe::CPlayer &Player = m_State.m_aPlayers[ClientID];
+		Player.m_Alive = true;
+		Player.m_X = X;
+		Player.m_Y = Y;
+		return false;
+	}
+	case TEEHISTORIAN_PLAYER_OLD:
+	{
+		if(ReadInt(&pChunk->m_ClientID) || ReadPlayerChunk(pChunk->m_ClientID))
+			return true;
+		CTeeHistorianKeyframe::CPlayer &Player = m_State.m_aPlayers[pChunk->m_ClientID];
+		Player.m_Alive = false;
+		Player.m_X = 0;
+		Player.m_Y = 0;
+		return false;
+	}
+	case TEEHISTORIAN_INPUT_DIFF:
+	case TEEHISTORIAN_INPUT_NEW:
+	{
+		int aInput[CTeeHistorianKeyframe::INPUT_SIZE];
+		if(ReadInt(&pChunk->m_ClientID))
+			return true;
+		for(int &Input : aInput)
+		{
+			if(ReadInt(&Input))
+				return true;
+		}
+		if(pChunk->m_ClientID < 0 || pChunk->m_ClientID >= MAX_CLIENTS)
+			return true;
+		CTeeHistorianKeyframe::CPlayer &Player = m_State.m_aPlayers[pChunk->m_ClientID];
+		for(int i = 0; i < CTeeHistorianKeyframe::INPUT_SIZE; i++)
+		{
+			if(pChunk->m_Type == TEEHISTORIAN_INPUT_DIFF)
+				Player.m_aInput[i] += aInput[i];
+			else
+				Player.m_aInput[i] = aInput[i];
+		}
+		Player.m_HaveInput = true;
+		return false;
+	}
+	case TEEHISTORIAN_MESSAGE:
+		if(ReadInt(&pChunk->m_ClientID) || ReadInt(&pChunk->m_DataSize) || ReadRaw(pChunk->m_DataSize))
+			return true;
+		pChunk->m_pData = m_vChunkData.data();
+		return false;
+	case TEEHISTORIAN_JOIN:
+		return ReadInt(&pChunk->m_ClientID);
+	case TEEHISTORIAN_DROP:
+		if(ReadInt(&pChunk->m_ClientID) || ReadString(&m_String))
+			return true;
+		pChunk->m_pString = m_String.c_str();
+		return false;
+	case TEEHISTORIAN_CONSOLE_COMMAND:
+	{
+		int FlagMask, NumArgs;
+		if(ReadInt(&pChunk->m_ClientID) || ReadInt(&FlagMask) || ReadString(&m_String) || ReadInt(&NumArgs))
+			return true;
+		for(int i = 0; i < NumArgs; i++)
+		{
+			std::string Arg;
+			if(ReadString(&Arg))
+				return true;
+			m_String += " " + Arg;
+		}
+		pChunk->m_pString = m_String.c_str();
+		return false;
+	}
+	case TEEHISTORIAN_EX:
+	{
+		if(ReadRaw(sizeof(pChunk->m_Uuid)))
+			return true;
+		mem_copy(&pChunk->m_Uuid, m_vChunkData.data(), sizeof(pChunk->m_Uuid));
+		if(ReadInt(&pChunk->m_DataSize) || ReadRaw(pChunk->m_DataSize))
+			return true;
+		pChunk->m_pData = m_vChunkData.data();
+
+		// the only extra chunks that change the tracked state
+		CUnpacker Unpacker;
+		Unpacker.Reset(pChunk->m_pData, pChunk->m_DataSize);
+		if(pChunk->m_Uuid == UUID_TEEHISTORIAN_PLAYER_TEAM)
+		{
+			const int ClientID = Unpacker.GetInt();
+			const int Team = Unpacker.GetInt();
+			if(Unpacker.Error() || ClientID < 0 || ClientID >= MAX_CLIENTS)
+				return true;
+			pChunk->m_ClientID = ClientID;
+			m_State.m_aPlayers[ClientID].m_Team = Team;
+		}
+		else if(pChunk->m_Uuid == UUID_TEEHISTORIAN_TEAM_PRACTICE)
+		{
+			const int Team = Unpacker.GetInt();
+			const int Practice = Unpacker.GetInt();
+			if(Unpacker.Error() || Team < 0 || Team >= MAX_CLIENTS)
+				return true;
+			m_State.m_aTeamPractice[Team] = Practice;
+		}
+		return false;
+	}
+	default:
+		return true;
+	}
+}
@@ -0,0 +1,180 @@
+#ifndef ENGINE_SHARED_TEEHISTORIAN_INDEX_H
+#define ENGINE_SHARED_TEEHISTORIAN_INDEX_H
+
+#include <base/system.h>
+
+#include "protocol.h"
+#include "uuid_manager.h"
+
+#include <string>
+#include <vector>
+
+class CTeeHistorianFileReader;
+class CUnpacker;
+
+// chunk types of the teehistorian stream, written negated
+enum
+{
+	TEEHISTORIAN_NONE,
+	TEEHISTORIAN_FINISH,
+	TEEHISTORIAN_TICK_SKIP,
+	TEEHISTORIAN_PLAYER_NEW,
+	TEEHISTORIAN_PLAYER_OLD,
+	TEEHISTORIAN_INPUT_DIFF,
+	TEEHISTORIAN_INPUT_NEW,
+	TEEHISTORIAN_MESSAGE,
+	TEEHISTORIAN_JOIN,
+	TEEHISTORIAN_DROP,
+	TEEHISTORIAN_CONSOLE_COMMAND,
+	TEEHISTORIAN_EX,
+};
+
+// Player and team state of a teehistorian stream at the start of a tick.
+// Decoding can start at a keyframe instead of the start of the file.
+class CTeeHistorianKeyframe
+{
+public:
+	enum
+	{
+		// number of ints in `CNetObj_PlayerInput`
+		INPUT_SIZE = 10,
+	};
+
+	struct CPlayer
+	{
+		bool m_Alive;
+		int m_X;
+		int m_Y;
+
+		bool m_HaveInput;
+		int m_aInput[INPUT_SIZE];
+
+		// DDNet team
+		int m_Team;
+	};
+
+	// first tick whose data starts at `m_Offset`
+	int m_Tick;
+	// last tick written before `m_Offset`
+	int m_LastTick;
+	// position in the uncompressed teehistorian stream
+	int64_t m_Offset;
+
+	CPlayer m_aPlayers[MAX_CLIENTS];
+	bool m_aTeamPractice[MAX_CLIENTS];
+
+	void Reset();
+	void Pack(std::vector<unsigned char> *pvData) const;
+	// returns true on error
+	bool Unpack(CUnpacker *pUnpacker);
+};
+
+// Sidecar index of a teehistorian file, holding a keyframe every few
+// ticks.
+//
+// The file starts with the index UUID, the game UUID of the teehistorian
+// file and the keyframe interval, followed by the keyframes. Keyframes are
+// appended while the game is running, so the index of a crashed server
+// is usable up to its last complete keyframe.
+class CTeeHistorianIndex
+{
+public:
+	static const CUuid ms_IndexUuid;
+
+	// append the index header or a keyframe to `pvData`
+	static void PackHeader(std::vector<unsigned char> *pvData, CUuid GameUuid, int KeyframeInterval);
+	static void PackKeyframe(std::vector<unsigned char> *pvData, const CTeeHistorianKeyframe &Keyframe);
+
+	// returns true on error
+	bool Load(IOHANDLE File);
+
+	CUuid GameUuid() const { return m_GameUuid; }
+	int KeyframeInterval() const { return m_KeyframeInterval; }
+	int NumKeyframes() const { return m_vEntries.size(); }
+
+	// Finds the last keyframe at or before `Tick` with a binary search.
+	// Returns true if there is none.
+	bool Find(int Tick, CTeeHistorianKeyframe *pKeyframe) const;
+	// returns true on error
+	bool Get(int Index, CTeeHistorianKeyframe *pKeyframe) const;
+
+private:
+	struct CEntry
+	{
+		int m_Tick;
+		int m_DataOffset;
+		int m_Size;
+	};
+
+	CUuid m_GameUuid;
+	int m_KeyframeInterval;
+	std::vector<unsigned char> m_vData;
+	std::vector<CEntry> m_vEntries;
+};
+
+// Decodes a teehistorian stream chunk by chunk and keeps track of the
+// player state, starting after the header or at a keyframe.
+class CTeeHistorianDecoder
+{
+public:
+	enum
+	{
+		// player position diff, the only chunk without a type
+		CHUNK_PLAYER_DIFF = -1,
+	};
+
+	struct CChunk
+	{
+		int m_Type;
+		int m_ClientID;
+
+		// TEEHISTORIAN_EX
+		CUuid m_Uuid;
+		// TEEHISTORIAN_MESSAGE and TEEHISTORIAN_EX
+		const unsigned char *m_pData;
+		int m_DataSize;
+		// drop reason or console command
+		const char *m_pString;
+	};
+
+	// does not take ownership of the reader
+	CTeeHistorianDecoder(CTeeHistorianFileReader *pReader);
+
+	// reads the magic and the JSON header, returns true on error
+	bool ReadHeader();
+	const char *Header() const { return m_Header.c_str(); }
+
+	// continues decoding at the keyframe, returns true on error
+	bool Seek(const CTeeHistorianKeyframe &Keyframe);
+
+	// returns true on error, the chunk type is TEEHISTORIAN_FINISH at the
+	// end of the stream
+	bool ReadChunk(CChunk *pChunk);
+
+	int Tick() const { return m_State.m_Tick; }
+	int64_t Offset() const { return m_Offset; }
+	// `m_Offset` and `m_LastTick` are not kept up to date
+	const CTeeHistorianKeyframe &State() const { return m_State; }
+
+private:
+	bool ReadByte(unsigned char *pByte);
+	bool ReadInt(int *pInt);
+	bool ReadRaw(int Size);
+	bool ReadString(std::string *pString);
+	bool ReadPlayerChunk(int ClientID);
+
+	CTeeHistorianFileReader *m_pReader;
+	unsigned char m_aBuffer[16 * 1024];
+	int m_BufferPos;
+	int m_BufferSize;
+	int64_t m_Offset;
+
+	std::string m_Header;
+	std::vector<unsigned char> m_vChunkData;
+	std::string m_String;
+
+	CTeeHistorianKeyframe m_State;
+	int m_LastClientID;
+};
+
+#endif // ENGINE_SHARED_TEEHISTORIAN_INDEX_H
@@ -4,6 +4,8 @@
 
 #include <base/log.h>
 
+#include <engine/engine.h>
+#include <engine/gfx/image_loader.h>
 #include <engine/graphics.h>
 #include <engine/map.h>
 #include <engine/storage.h>
@@ -15,6 +17,14 @@
 #include <game/localization.h>
 #include <game/mapitems.h>
 
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
 const char *const gs_apModEntitiesNames[] = {
 	"ddnet",
 	"ddrace",
@@ -102,16 +112,21 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 	}
 
 	const int TextureLoadFlag = Graphics()->Uses2DTextureArrays() ? IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE : IGraphics::TEXLOAD_TO_3D_TEXTURE;
+	const auto StartTime = time_get_nanoseconds();
 
-	// load new textures
+	// read the names first, the data of the images is loaded on the job
+	// pool and must not be accessed from here at the same time
 	bool ShowWarning = false;
+	std::vector<std::string> vNames(m_Count);
+	std::vector<int> vNameIndices;
+	std::vector<std::shared_ptr<CMapImageLoadJob>> vpJobs(m_Count);
 	for(int i = 0; i < m_Count; i++)
 	{
-		const int LoadFlag = (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 1) != 0) ? TextureLoadFlag : 0) | (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 2) != 0) ? 0 : (Graphics()->HasTextureArraysSupport() ? IGraphics::TEXLOAD_NO_2D_TEXTURE : 0));
 		const CMapItemImage_v2 *pImg = (CMapItemImage_v2 *)pMap->GetItem(Start + i);
 		const CImageInfo::EImageFormat Format = pImg->m_Version < CMapItemImage_v2::CURRENT_VERSION ? CImageInfo::FORMAT_RGBA : CImageInfo::ImageFormatFromInt(pImg->m_Format);
 
 		const char *pName = pMap->GetDataString(pImg->m_ImageName);
+		vNameIndices.push_back(pImg->m_ImageName);
 		if(pName == nullptr || pName[0] == '\0')
 		{
 			if(pImg->m_External)
@@ -122,30 +137,113 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 			}
 			pName = "(error)";
 		}
+		vNames[i] = pName;
 
 		if(pImg->m_External)
 		{
 			char aPath[IO_MAX_PATH_LENGTH];
 			str_format(aPath, sizeof(aPath), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(aPath, IStorage::TYPE_ALL, LoadFlag);
+			vpJobs[i] = std::make_shared<CMapImageLoadJob>(Storage(), aPath);
 		}
 		else if(Format == CImageInfo::FORMAT_RGBA)
 		{
-			void *pData = pMap->GetData(pImg->m_ImageData);
+			// images sharing their data also share the job loading it
+			for(int j = 0; j < i && !vpJobs[i]; j++)
+			{
+				const CMapItemImage_v2 *pOther = (CMapItemImage_v2 *)pMap->GetItem(Start + j);
+				if(vpJobs[j] && !pOther->m_External && pOther->m_ImageData == pImg->m_ImageData)
+					vpJobs[i] = vpJobs[j];
+			}
+			if(!vpJobs[i])
+				vpJobs[i] = std::make_shared<CMapImageLoadJob>(pMap, pImg->m_ImageData);
+		}
+	}
+	for(int i = 0; i < m_Count; i++)
+	{
+		if(vpJobs[i] && std::find(vpJobs.begin(), vpJobs.begin() + i, vpJobs[i]) == vpJobs.begin() + i)
+			Engine()->AddJob(vpJobs[i]);
+	}
+
+	// upload the images in order as soon as they are loaded
+	for(int i = 0; i < m_Count; i++)
+	{
+		if(!vpJobs[i])
+			continue;
+		const std::shared_ptr<CMapImageLoadJob> pJob = vpJobs[i];
+		while(pJob->Status() != IJob::STATE_DONE)
+			std::this_thread::sleep_for(1ms);
+
+		const int LoadFlag = (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 1) != 0) ? TextureLoadFlag : 0) | (((m_aTextureUsedByTileOrQuadLayerFlag[i] & 2) != 0) ? 0 : (Graphics()->HasTextureArraysSupport() ? IGraphics::TEXLOAD_NO_2D_TEXTURE : 0));
+		const CMapItemImage_v2 *pImg = (CMapItemImage_v2 *)pMap->GetItem(Start + i);
+		if(pImg->m_External)
+		{
+			Graphics()->WarnPngliteIncompatibility(pJob->m_aPath, pJob->m_PngliteIncompatible);
+			if(pJob->m_Image.m_pData)
+				m_aTextures[i] = Graphics()->LoadTextureRaw(pJob->m_Image.m_Width, pJob->m_Image.m_Height, pJob->m_Image.m_Format, pJob->m_Image.m_pData, LoadFlag, pJob->m_aPath);
+			else
+				m_aTextures[i] = Graphics()->NullTexture();
+		}
+		else
+		{
 			char aTexName[IO_MAX_PATH_LENGTH];
-			str_format(aTexName, sizeof(aTexName), "embedded: %s", pName);
-			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, Format, pData, LoadFlag, aTexName);
-			pMap->UnloadData(pImg->m_ImageData);
+			str_format(aTexName, sizeof(aTexName), "embedded: %s", vNames[i].c_str());
+			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pJob->m_Image.m_pData, LoadFlag, aTexName);
+			// the data isn't needed anymore after the last image using it
+			if(std::find(vpJobs.begin() + i + 1, vpJobs.end(), pJob) == vpJobs.end())
+				pMap->UnloadData(pImg->m_ImageData);
 		}
-		pMap->UnloadData(pImg->m_ImageName);
 		ShowWarning = ShowWarning || m_aTextures[i].IsNullTexture();
 	}
+	for(int NameIndex : vNameIndices)
+		pMap->UnloadData(NameIndex);
+	log_debug("mapimages", "loaded %d images in %.2fms", m_Count, (time_get_nanoseconds() - StartTime).count() / 1000000.0);
 	if(ShowWarning)
 	{
 		Client()->AddWarning(SWarning(Localize("Some map images could not be loaded. Check the local console for details.")));
 	}
 }
 
+CMapImages::CMapImageLoadJob::CMapImageLoadJob(IStorage *pStorage, const char *pPath) :
+	m_pStorage(pStorage),
+	m_pMap(nullptr),
+	m_DataIndex(-1)
+{
+	str_copy(m_aPath, pPath);
+}
+
+CMapImages::CMapImageLoadJob::CMapImageLoadJob(IMap *pMap, int DataIndex) :
+	m_pStorage(nullptr),
+	m_pMap(pMap),
+	m_DataIndex(DataIndex)
+{
+	m_aPath[0] = '\0';
+}
+
+CMapImages::CMapImageLoadJob::~CMapImageLoadJob()
+{
+	if(m_pStorage)
+		free(m_Image.m_pData);
+}
+
+void CMapImages::CMapImageLoadJob::Run()
+{
+	if(m_pMap)
+	{
+		m_Image.m_pData = m_pMap->GetData(m_DataIndex);
+		return;
+	}
+
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(m_aPath, IStorage::TYPE_ALL, &pFileData, &FileSize))
+	{
+		log_error("mapimages", "failed to open file. filename='%s'", m_aPath);
+		return;
+	}
+	DecodePNG(pFileData, FileSize, m_aPath, m_Image, m_PngliteIncompatible);
+	free(pFileData);
+}
+
 void CMapImages::OnMapLoad()
 {
 	IMap *pMap = Kernel()->RequestInterface<IMap>();
@@ -4,10 +4,13 @@
 #define GAME_CLIENT_COMPONENTS_MAPIMAGES_H
 
 #include <engine/graphics.h>
+#include <engine/shared/jobs.h>
 
 #include <game/client/component.h>
 #include <game/mapitems.h>
 
+#include <memory>
+
 enum EMapImageEntityLayerType
 {
 	MAP_IMAGE_ENTITY_LAYER_TYPE_ALL_EXCEPT_SWITCH = 0,
@@ -31,6 +34,9 @@ enum EMapImageModType
 
 extern const char *const gs_apModEntitiesNames[];
 
+class IMap;
+class IStorage;
+
 class CMapImages : public CComponent
 {
 	friend class CBackground;
@@ -42,6 +48,28 @@ class CMapImages : public CComponent
 
 	char m_aEntitiesPath[IO_MAX_PATH_LENGTH];
 
+	// decodes an external map image or loads the data of an embedded one
+	class CMapImageLoadJob : public IJob
+	{
+		IStorage *m_pStorage;
+		IMap *m_pMap;
+		int m_DataIndex;
+
+	protected:
+		void Run() override;
+
+	public:
+		CMapImageLoadJob(IStorage *pStorage, const char *pPath);
+		CMapImageLoadJob(IMap *pMap, int DataIndex);
+		~CMapImageLoadJob();
+
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		// owned by the job for external images, by the map otherwise,
+		// `m_pData` is null if loading failed
+		CImageInfo m_Image;
+		int m_PngliteIncompatible = 0;
+	};
+
 	bool HasFrontLayer(EMapImageModType ModType);
 	bool HasSpeedupLayer(EMapImageModType ModType);
 	bool HasSwitchLayer(EMapImageModType ModType);
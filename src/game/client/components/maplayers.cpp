@@ -1,6 +1,9 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/log.h>
+
 #include <engine/demo.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/keys.h>
 #include <engine/serverbrowser.h>
@@ -20,7 +23,9 @@
 
 #include "maplayers.h"
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 using namespace std::chrono_literals;
 
@@ -114,7 +119,7 @@ void CMapLayers::EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels
 					 MinTick * TickToNanoSeconds;
 			}
 		}
-		CRenderTools::RenderEvalEnvelope(&EnvelopePoints, 4, s_Time + (int64_t)TimeOffsetMillis * std::chrono::nanoseconds(1ms), Channels);
+		pThis->EvalMapEnvelope(Env, &EnvelopePoints, s_Time + (int64_t)TimeOffsetMillis * std::chrono::nanoseconds(1ms), Channels);
 	}
 	else
 	{
@@ -139,171 +144,37 @@ void CMapLayers::EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels
 			s_Time += CurTime - s_LastLocalTime;
 			s_LastLocalTime = CurTime;
 		}
-		CRenderTools::RenderEvalEnvelope(&EnvelopePoints, 4, s_Time + std::chrono::nanoseconds(std::chrono::milliseconds(TimeOffsetMillis)), Channels);
+		pThis->EvalMapEnvelope(Env, &EnvelopePoints, s_Time + std::chrono::nanoseconds(std::chrono::milliseconds(TimeOffsetMillis)), Channels);
 	}
 }
 
-void FillTmpTile(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, unsigned char Flags, unsigned char Index, int x, int y, const ivec2 &Offset, int Scale, CMapItemGroup *pGroup)
+CMapLayers::CLayerPrepareJob::CLayerPrepareJob(STileLayerVisuals *pVisuals, const STileLayerSource &Source) :
+	m_TileSource(Source), m_pQuads(nullptr), m_NumQuads(0), m_pTileVisuals(pVisuals), m_pQuadVisuals(nullptr), m_Textured(Source.m_DoTextureCoords)
 {
-	if(pTmpTex)
-	{
-		unsigned char x0 = 0;
-		unsigned char y0 = 0;
-		unsigned char x1 = x0 + 1;
-		unsigned char y1 = y0;
-		unsigned char x2 = x0 + 1;
-		unsigned char y2 = y0 + 1;
-		unsigned char x3 = x0;
-		unsigned char y3 = y0 + 1;
-
-		if(Flags & TILEFLAG_XFLIP)
-		{
-			x0 = x2;
-			x1 = x3;
-			x2 = x3;
-			x3 = x0;
-		}
-
-		if(Flags & TILEFLAG_YFLIP)
-		{
-			y0 = y3;
-			y2 = y1;
-			y3 = y1;
-			y1 = y0;
-		}
-
-		if(Flags & TILEFLAG_ROTATE)
-		{
-			unsigned char Tmp = x0;
-			x0 = x3;
-			x3 = x2;
-			x2 = x1;
-			x1 = Tmp;
-			Tmp = y0;
-			y0 = y3;
-			y3 = y2;
-			y2 = y1;
-			y1 = Tmp;
-		}
-
-		pTmpTex->m_TexCoordTopLeft.x = x0;
-		pTmpTex->m_TexCoordTopLeft.y = y0;
-		pTmpTex->m_TexCoordBottomLeft.x = x3;
-		pTmpTex->m_TexCoordBottomLeft.y = y3;
-		pTmpTex->m_TexCoordTopRight.x = x1;
-		pTmpTex->m_TexCoordTopRight.y = y1;
-		pTmpTex->m_TexCoordBottomRight.x = x2;
-		pTmpTex->m_TexCoordBottomRight.y = y2;
-
-		pTmpTex->m_TexCoordTopLeft.z = Index;
-		pTmpTex->m_TexCoordBottomLeft.z = Index;
-		pTmpTex->m_TexCoordTopRight.z = Index;
-		pTmpTex->m_TexCoordBottomRight.z = Index;
-
-		bool HasRotation = (Flags & TILEFLAG_ROTATE) != 0;
-		pTmpTex->m_TexCoordTopLeft.w = HasRotation;
-		pTmpTex->m_TexCoordBottomLeft.w = HasRotation;
-		pTmpTex->m_TexCoordTopRight.w = HasRotation;
-		pTmpTex->m_TexCoordBottomRight.w = HasRotation;
-	}
-
-	pTmpTile->m_TopLeft.x = x * Scale + Offset.x;
-	pTmpTile->m_TopLeft.y = y * Scale + Offset.y;
-	pTmpTile->m_BottomLeft.x = x * Scale + Offset.x;
-	pTmpTile->m_BottomLeft.y = y * Scale + Scale + Offset.y;
-	pTmpTile->m_TopRight.x = x * Scale + Scale + Offset.x;
-	pTmpTile->m_TopRight.y = y * Scale + Offset.y;
-	pTmpTile->m_BottomRight.x = x * Scale + Scale + Offset.x;
-	pTmpTile->m_BottomRight.y = y * Scale + Scale + Offset.y;
-}
-
-void FillTmpTileSpeedup(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, unsigned char Flags, unsigned char Index, int x, int y, const ivec2 &Offset, int Scale, CMapItemGroup *pGroup, short AngleRotate)
-{
-	int Angle = AngleRotate % 360;
-	FillTmpTile(pTmpTile, pTmpTex, Angle >= 270 ? ROTATION_270 : (Angle >= 180 ? ROTATION_180 : (Angle >= 90 ? ROTATION_90 : 0)), AngleRotate % 90, x, y, Offset, Scale, pGroup);
 }
 
-bool CMapLayers::STileLayerVisuals::Init(unsigned int Width, unsigned int Height)
+CMapLayers::CLayerPrepareJob::CLayerPrepareJob(SQuadLayerVisuals *pVisuals, const CQuad *pQuads, int NumQuads, bool Textured) :
+	m_TileSource(), m_pQuads(pQuads), m_NumQuads(NumQuads), m_pTileVisuals(nullptr), m_pQuadVisuals(pVisuals), m_Textured(Textured)
 {
-	m_Width = Width;
-	m_Height = Height;
-	if(Width == 0 || Height == 0)
-		return false;
-	if constexpr(sizeof(unsigned int) >= sizeof(ptrdiff_t))
-		if(Width >= std::numeric_limits<std::ptrdiff_t>::max() || Height >= std::numeric_limits<std::ptrdiff_t>::max())
-			return false;
-
-	m_pTilesOfLayer = new CMapLayers::STileLayerVisuals::STileVisual[Height * Width];
-
-	m_vBorderTop.resize(Width);
-	m_vBorderBottom.resize(Width);
-
-	m_vBorderLeft.resize(Height);
-	m_vBorderRight.resize(Height);
-	return true;
 }
 
-CMapLayers::STileLayerVisuals::~STileLayerVisuals()
+CMapLayers::CLayerPrepareJob::~CLayerPrepareJob()
 {
-	delete[] m_pTilesOfLayer;
-
-	m_pTilesOfLayer = NULL;
+	free(m_Vertices.m_pData);
 }
 
-bool AddTile(std::vector<SGraphicTile> &vTmpTiles, std::vector<SGraphicTileTexureCoords> &vTmpTileTexCoords, unsigned char Index, unsigned char Flags, int x, int y, CMapItemGroup *pGroup, bool DoTextureCoords, bool FillSpeedup = false, int AngleRotate = -1, const ivec2 &Offset = ivec2{0, 0}, int Scale = 32)
+void CMapLayers::CLayerPrepareJob::Run()
 {
-	if(Index)
+	if(!m_pTileVisuals)
 	{
-		vTmpTiles.emplace_back();
-		SGraphicTile &Tile = vTmpTiles.back();
-		SGraphicTileTexureCoords *pTileTex = NULL;
-		if(DoTextureCoords)
-		{
-			vTmpTileTexCoords.emplace_back();
-			SGraphicTileTexureCoords &TileTex = vTmpTileTexCoords.back();
-			pTileTex = &TileTex;
-		}
-		if(FillSpeedup)
-			FillTmpTileSpeedup(&Tile, pTileTex, Flags, 0, x, y, Offset, Scale, pGroup, AngleRotate);
-		else
-			FillTmpTile(&Tile, pTileTex, Flags, Index, x, y, Offset, Scale, pGroup);
-
-		return true;
-	}
-	return false;
-}
-
-struct STmpQuadVertexTextured
-{
-	float m_X, m_Y, m_CenterX, m_CenterY;
-	unsigned char m_R, m_G, m_B, m_A;
-	float m_U, m_V;
-};
-
-struct STmpQuadVertex
-{
-	float m_X, m_Y, m_CenterX, m_CenterY;
-	unsigned char m_R, m_G, m_B, m_A;
-};
-
-struct STmpQuad
-{
-	STmpQuadVertex m_aVertices[4];
-};
-
-struct STmpQuadTextured
-{
-	STmpQuadVertexTextured m_aVertices[4];
-};
-
-void mem_copy_special(void *pDest, void *pSource, size_t Size, size_t Count, size_t Steps)
-{
-	size_t CurStep = 0;
-	for(size_t i = 0; i < Count; ++i)
-	{
-		mem_copy(((char *)pDest) + CurStep + i * Size, ((char *)pSource) + i * Size, Size);
-		CurStep += Steps;
+		PrepareQuadLayerVertices(m_pQuads, m_NumQuads, m_Textured, &m_Vertices);
+		return;
 	}
+	if(m_pCache && m_pCache->GetLayer(m_CacheIndex, *m_pTileVisuals, &m_Vertices))
+		return;
+	PrepareTileLayerVisuals(*m_pTileVisuals, m_TileSource, &m_Vertices);
+	if(m_WriteCache)
+		CTileLayerCache::SerializeLayer(*m_pTileVisuals, m_Vertices, &m_vCacheData);
 }
 
 CMapLayers::~CMapLayers()
@@ -327,8 +198,40 @@ CMapLayers::~CMapLayers()
 	}
 }
 
+void CMapLayers::BakeEnvelopes()
+{
+	m_vEnvelopeTables.clear();
+	if(!g_Config.m_ClEnvelopeTables)
+		return;
+
+	const auto StartTime = time_get_nanoseconds();
+	int EnvStart, EnvNum;
+	m_pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &EnvStart, &EnvNum);
+	CMapBasedEnvelopePointAccess EnvelopePoints(m_pLayers->Map());
+	m_vEnvelopeTables.resize(EnvNum);
+	int NumSamples = 0;
+	for(int Env = 0; Env < EnvNum; Env++)
+	{
+		const CMapItemEnvelope *pItem = (CMapItemEnvelope *)m_pLayers->Map()->GetItem(EnvStart + Env);
+		EnvelopePoints.SetPointsRange(pItem->m_StartPoint, pItem->m_NumPoints);
+		if(m_vEnvelopeTables[Env].Bake(&EnvelopePoints, 4))
+			NumSamples += m_vEnvelopeTables[Env].NumSamples();
+	}
+	log_debug("maplayers", "baked %d envelopes with %d samples in %.2fms", EnvNum, NumSamples, (time_get_nanoseconds() - StartTime).count() / 1000000.0);
+}
+
+void CMapLayers::EvalMapEnvelope(int Env, const IEnvelopePointAccess *pPoints, std::chrono::nanoseconds TimeNanos, ColorRGBA &Channels) const
+{
+	if(g_Config.m_ClEnvelopeTables && Env < (int)m_vEnvelopeTables.size() && m_vEnvelopeTables[Env].Valid())
+		m_vEnvelopeTables[Env].Eval(TimeNanos, Channels);
+	else
+		CRenderTools::RenderEvalEnvelope(pPoints, 4, TimeNanos, Channels);
+}
+
 void CMapLayers::OnMapLoad()
 {
+	BakeEnvelopes();
+
 	if(!Graphics()->IsTileBufferingEnabled() && !Graphics()->IsQuadBufferingEnabled())
 		return;
 
@@ -367,24 +270,92 @@ void CMapLayers::OnMapLoad()
 		RenderLoading();
 	}
 
-	bool PassedGameLayer = false;
-	//prepare all visuals for all tile layers
-	std::vector<SGraphicTile> vtmpTiles;
-	std::vector<SGraphicTileTexureCoords> vtmpTileTexCoords;
-	std::vector<SGraphicTile> vtmpBorderTopTiles;
-	std::vector<SGraphicTileTexureCoords> vtmpBorderTopTilesTexCoords;
-	std::vector<SGraphicTile> vtmpBorderLeftTiles;
-	std::vector<SGraphicTileTexureCoords> vtmpBorderLeftTilesTexCoords;
-	std::vector<SGraphicTile> vtmpBorderRightTiles;
-	std::vector<SGraphicTileTexureCoords> vtmpBorderRightTilesTexCoords;
-	std::vector<SGraphicTile> vtmpBorderBottomTiles;
-	std::vector<SGraphicTileTexureCoords> vtmpBorderBottomTilesTexCoords;
-	std::vector<SGraphicTile> vtmpBorderCorners;
-	std::vector<SGraphicTileTexureCoords> vtmpBorderCornersTexCoords;
-
-	std::vector<STmpQuad> vtmpQuads;
-	std::vector<STmpQuadTextured> vtmpQuadsTextured;
+	std::vector<std::shared_ptr<CLayerPrepareJob>> vpJobs;
+	CreateLayerPrepareJobs(vpJobs);
+	const int NumTileLayers = std::count_if(vpJobs.begin(), vpJobs.end(), [](const std::shared_ptr<CLayerPrepareJob> &pJob) { return pJob->m_pTileVisuals != nullptr; });
+
+	// the prepared tile layers are cached by the map and the layers this
+	// instance renders
+	CTileLayerCache Cache;
+	bool UseCache = false;
+	IOHANDLE CacheFile = nullptr;
+	char aCachePath[IO_MAX_PATH_LENGTH];
+	char aCacheTmpPath[IO_MAX_PATH_LENGTH];
+	if(g_Config.m_ClMapLayerCache > 0 && NumTileLayers > 0)
+	{
+		CTileLayerCache::FormatPath(aCachePath, sizeof(aCachePath), m_pLayers->Map()->Sha256(), m_Type);
+		UseCache = Cache.Load(Storage(), aCachePath) && Cache.NumLayers() == NumTileLayers;
+		// a cache that doesn't match all layers is rewritten as a whole
+		int LayerIndex = 0;
+		for(const auto &pJob : vpJobs)
+		{
+			if(UseCache && pJob->m_pTileVisuals)
+				UseCache = Cache.MatchesLayer(LayerIndex++, *pJob->m_pTileVisuals);
+		}
+		if(!UseCache)
+		{
+			Cache.Unload();
+			IStorage::FormatTmpPath(aCacheTmpPath, sizeof(aCacheTmpPath), aCachePath);
+			CacheFile = Storage()->OpenFile(aCacheTmpPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		}
+	}
+	bool CacheWritten = CacheFile != nullptr;
+	if(CacheFile)
+	{
+		std::vector<unsigned char> vHeader;
+		CTileLayerCache::SerializeHeader(NumTileLayers, &vHeader);
+		CacheWritten = io_write(CacheFile, vHeader.data(), vHeader.size()) == vHeader.size();
+	}
 
+	// the vertices of all layers are built on the job pool, upload them
+	// in the order of the layers as soon as they are ready
+	int CacheIndex = 0;
+	for(auto &pJob : vpJobs)
+	{
+		if(pJob->m_pTileVisuals)
+		{
+			pJob->m_pCache = UseCache ? &Cache : nullptr;
+			pJob->m_CacheIndex = CacheIndex++;
+			pJob->m_WriteCache = CacheFile != nullptr;
+		}
+		Engine()->AddJob(pJob);
+	}
+	for(auto &pJob : vpJobs)
+	{
+		while(pJob->Status() != IJob::STATE_DONE)
+		{
+			RenderLoading();
+			std::this_thread::sleep_for(1ms);
+		}
+		if(pJob->m_pTileVisuals)
+		{
+			if(CacheFile)
+				CacheWritten = CacheWritten && io_write(CacheFile, pJob->m_vCacheData.data(), pJob->m_vCacheData.size()) == pJob->m_vCacheData.size();
+			pJob->m_vCacheData.clear();
+			pJob->m_vCacheData.shrink_to_fit();
+			UploadTileLayer(*pJob->m_pTileVisuals, pJob->m_Vertices);
+		}
+		else
+		{
+			UploadQuadLayer(*pJob->m_pQuadVisuals, pJob->m_Textured, pJob->m_Vertices);
+		}
+		RenderLoading();
+	}
+
+	if(CacheFile)
+	{
+		io_close(CacheFile);
+		if(CacheWritten && Storage()->RenameFile(aCacheTmpPath, aCachePath, IStorage::TYPE_SAVE))
+			CTileLayerCache::Prune(Storage(), g_Config.m_ClMapLayerCache);
+		else
+			Storage()->RemoveFile(aCacheTmpPath, IStorage::TYPE_SAVE);
+	}
+	log_debug("maplayers", "prepared %d layers in %.2fms%s", (int)vpJobs.size(), (time_get_nanoseconds() - CurTime).count() / 1000000.0, UseCache ? " from the cache" : "");
+}
+
+void CMapLayers::CreateLayerPrepareJobs(std::vector<std::shared_ptr<CLayerPrepareJob>> &vpJobs)
+{
+	bool PassedGameLayer = false;
 	for(int g = 0; g < m_pLayers->NumGroups(); g++)
 	{
 		CMapItemGroup *pGroup = m_pLayers->GetGroup(g);
@@ -404,12 +375,10 @@ void CMapLayers::OnMapLoad()
 			bool IsTeleLayer = false;
 			bool IsSpeedupLayer = false;
 			bool IsTuneLayer = false;
-			bool IsGameLayer = false;
 			bool IsEntityLayer = false;
 
 			if(pLayer == (CMapItemLayer *)m_pLayers->GameLayer())
 			{
-				IsGameLayer = true;
 				IsEntityLayer = true;
 				PassedGameLayer = true;
 			}
@@ -454,338 +423,66 @@ void CMapLayers::OnMapLoad()
 
 				int DataIndex = 0;
 				unsigned int TileSize = 0;
-				int OverlayCount = 0;
+				int Type = STileLayerSource::TYPE_DESIGN;
 				if(IsFrontLayer)
 				{
 					DataIndex = pTMap->m_Front;
 					TileSize = sizeof(CTile);
+					Type = STileLayerSource::TYPE_FRONT;
 				}
 				else if(IsSwitchLayer)
 				{
 					DataIndex = pTMap->m_Switch;
 					TileSize = sizeof(CSwitchTile);
-					OverlayCount = 2;
+					Type = STileLayerSource::TYPE_SWITCH;
 				}
 				else if(IsTeleLayer)
 				{
 					DataIndex = pTMap->m_Tele;
 					TileSize = sizeof(CTeleTile);
-					OverlayCount = 1;
+					Type = STileLayerSource::TYPE_TELE;
 				}
 				else if(IsSpeedupLayer)
 				{
 					DataIndex = pTMap->m_Speedup;
 					TileSize = sizeof(CSpeedupTile);
-					OverlayCount = 2;
+					Type = STileLayerSource::TYPE_SPEEDUP;
 				}
 				else if(IsTuneLayer)
 				{
 					DataIndex = pTMap->m_Tune;
 					TileSize = sizeof(CTuneTile);
+					Type = STileLayerSource::TYPE_TUNE;
 				}
 				else
 				{
 					DataIndex = pTMap->m_Data;
 					TileSize = sizeof(CTile);
+					if(IsEntityLayer)
+						Type = STileLayerSource::TYPE_GAME;
 				}
 				unsigned int Size = m_pLayers->Map()->GetDataSize(DataIndex);
 				void *pTiles = m_pLayers->Map()->GetData(DataIndex);
 
 				if(Size >= pTMap->m_Width * pTMap->m_Height * TileSize)
 				{
-					int CurOverlay = 0;
-					while(CurOverlay < OverlayCount + 1)
+					for(int CurOverlay = 0; CurOverlay < STileLayerSource::NumOverlays(Type) + 1; ++CurOverlay)
 					{
 						// We can later just count the tile layers to get the idx in the vector
 						m_vpTileLayerVisuals.push_back(new STileLayerVisuals());
-						STileLayerVisuals &Visuals = *m_vpTileLayerVisuals.back();
-						if(!Visuals.Init(pTMap->m_Width, pTMap->m_Height))
-						{
-							++CurOverlay;
+						STileLayerVisuals *pVisuals = m_vpTileLayerVisuals.back();
+						if(!pVisuals->Init(pTMap->m_Width, pTMap->m_Height))
 							continue;
-						}
-						Visuals.m_IsTextured = DoTextureCoords;
-
-						vtmpTiles.clear();
-						vtmpTileTexCoords.clear();
-
-						vtmpBorderTopTiles.clear();
-						vtmpBorderLeftTiles.clear();
-						vtmpBorderRightTiles.clear();
-						vtmpBorderBottomTiles.clear();
-						vtmpBorderCorners.clear();
-						vtmpBorderTopTilesTexCoords.clear();
-						vtmpBorderLeftTilesTexCoords.clear();
-						vtmpBorderRightTilesTexCoords.clear();
-						vtmpBorderBottomTilesTexCoords.clear();
-						vtmpBorderCornersTexCoords.clear();
-
-						if(!DoTextureCoords)
-						{
-							vtmpTiles.reserve((size_t)pTMap->m_Width * pTMap->m_Height);
-							vtmpBorderTopTiles.reserve((size_t)pTMap->m_Width);
-							vtmpBorderBottomTiles.reserve((size_t)pTMap->m_Width);
-							vtmpBorderLeftTiles.reserve((size_t)pTMap->m_Height);
-							vtmpBorderRightTiles.reserve((size_t)pTMap->m_Height);
-							vtmpBorderCorners.reserve((size_t)4);
-						}
-						else
-						{
-							vtmpTileTexCoords.reserve((size_t)pTMap->m_Width * pTMap->m_Height);
-							vtmpBorderTopTilesTexCoords.reserve((size_t)pTMap->m_Width);
-							vtmpBorderBottomTilesTexCoords.reserve((size_t)pTMap->m_Width);
-							vtmpBorderLeftTilesTexCoords.reserve((size_t)pTMap->m_Height);
-							vtmpBorderRightTilesTexCoords.reserve((size_t)pTMap->m_Height);
-							vtmpBorderCornersTexCoords.reserve((size_t)4);
-						}
-
-						int x = 0;
-						int y = 0;
-						for(y = 0; y < pTMap->m_Height; ++y)
-						{
-							for(x = 0; x < pTMap->m_Width; ++x)
-							{
-								unsigned char Index = 0;
-								unsigned char Flags = 0;
-								int AngleRotate = -1;
-								if(IsEntityLayer)
-								{
-									if(IsGameLayer)
-									{
-										Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
-										Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
-									}
-									if(IsFrontLayer)
-									{
-										Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
-										Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
-									}
-									if(IsSwitchLayer)
-									{
-										Flags = 0;
-										Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
-										if(CurOverlay == 0)
-										{
-											Flags = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
-											if(Index == TILE_SWITCHTIMEDOPEN)
-												Index = 8;
-										}
-										else if(CurOverlay == 1)
-											Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Number;
-										else if(CurOverlay == 2)
-											Index = ((CSwitchTile *)pTiles)[y * pTMap->m_Width + x].m_Delay;
-									}
-									if(IsTeleLayer)
-									{
-										Index = ((CTeleTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
-										Flags = 0;
-										if(CurOverlay == 1)
-										{
-											if(IsTeleTileNumberUsed(Index))
-												Index = ((CTeleTile *)pTiles)[y * pTMap->m_Width + x].m_Number;
-											else
-												Index = 0;
-										}
-									}
-									if(IsSpeedupLayer)
-									{
-										Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
-										Flags = 0;
-										AngleRotate = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Angle;
-										if(((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Force == 0)
-											Index = 0;
-										else if(CurOverlay == 1)
-											Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_Force;
-										else if(CurOverlay == 2)
-											Index = ((CSpeedupTile *)pTiles)[y * pTMap->m_Width + x].m_MaxSpeed;
-									}
-									if(IsTuneLayer)
-									{
-										Index = ((CTuneTile *)pTiles)[y * pTMap->m_Width + x].m_Type;
-										Flags = 0;
-									}
-								}
-								else
-								{
-									Index = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Index;
-									Flags = ((CTile *)pTiles)[y * pTMap->m_Width + x].m_Flags;
-								}
-
-								//the amount of tiles handled before this tile
-								int TilesHandledCount = vtmpTiles.size();
-								Visuals.m_pTilesOfLayer[y * pTMap->m_Width + x].SetIndexBufferByteOffset((offset_ptr32)(TilesHandledCount));
-
-								bool AddAsSpeedup = false;
-								if(IsSpeedupLayer && CurOverlay == 0)
-									AddAsSpeedup = true;
-
-								if(AddTile(vtmpTiles, vtmpTileTexCoords, Index, Flags, x, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate))
-									Visuals.m_pTilesOfLayer[y * pTMap->m_Width + x].Draw(true);
-
-								//do the border tiles
-								if(x == 0)
-								{
-									if(y == 0)
-									{
-										Visuals.m_BorderTopLeft.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
-										if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, -32}))
-											Visuals.m_BorderTopLeft.Draw(true);
-									}
-									else if(y == pTMap->m_Height - 1)
-									{
-										Visuals.m_BorderBottomLeft.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
-										if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, 0}))
-											Visuals.m_BorderBottomLeft.Draw(true);
-									}
-									Visuals.m_vBorderLeft[y].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderLeftTiles.size()));
-									if(AddTile(vtmpBorderLeftTiles, vtmpBorderLeftTilesTexCoords, Index, Flags, 0, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, 0}))
-										Visuals.m_vBorderLeft[y].Draw(true);
-								}
-								else if(x == pTMap->m_Width - 1)
-								{
-									if(y == 0)
-									{
-										Visuals.m_BorderTopRight.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
-										if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, -32}))
-											Visuals.m_BorderTopRight.Draw(true);
-									}
-									else if(y == pTMap->m_Height - 1)
-									{
-										Visuals.m_BorderBottomRight.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
-										if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
-											Visuals.m_BorderBottomRight.Draw(true);
-									}
-									Visuals.m_vBorderRight[y].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderRightTiles.size()));
-									if(AddTile(vtmpBorderRightTiles, vtmpBorderRightTilesTexCoords, Index, Flags, 0, y, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
-										Visuals.m_vBorderRight[y].Draw(true);
-								}
-								if(y == 0)
-								{
-									Visuals.m_vBorderTop[x].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderTopTiles.size()));
-									if(AddTile(vtmpBorderTopTiles, vtmpBorderTopTilesTexCoords, Index, Flags, x, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, -32}))
-										Visuals.m_vBorderTop[x].Draw(true);
-								}
-								else if(y == pTMap->m_Height - 1)
-								{
-									Visuals.m_vBorderBottom[x].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderBottomTiles.size()));
-									if(AddTile(vtmpBorderBottomTiles, vtmpBorderBottomTilesTexCoords, Index, Flags, x, 0, pGroup, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
-										Visuals.m_vBorderBottom[x].Draw(true);
-								}
-							}
-						}
-
-						//append one kill tile to the gamelayer
-						if(IsGameLayer)
-						{
-							Visuals.m_BorderKillTile.SetIndexBufferByteOffset((offset_ptr32)(vtmpTiles.size()));
-							if(AddTile(vtmpTiles, vtmpTileTexCoords, TILE_DEATH, 0, 0, 0, pGroup, DoTextureCoords))
-								Visuals.m_BorderKillTile.Draw(true);
-						}
-
-						//add the border corners, then the borders and fix their byte offsets
-						int TilesHandledCount = vtmpTiles.size();
-						Visuals.m_BorderTopLeft.AddIndexBufferByteOffset(TilesHandledCount);
-						Visuals.m_BorderTopRight.AddIndexBufferByteOffset(TilesHandledCount);
-						Visuals.m_BorderBottomLeft.AddIndexBufferByteOffset(TilesHandledCount);
-						Visuals.m_BorderBottomRight.AddIndexBufferByteOffset(TilesHandledCount);
-						//add the Corners to the tiles
-						vtmpTiles.insert(vtmpTiles.end(), vtmpBorderCorners.begin(), vtmpBorderCorners.end());
-						vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderCornersTexCoords.begin(), vtmpBorderCornersTexCoords.end());
-
-						//now the borders
-						TilesHandledCount = vtmpTiles.size();
-						if(pTMap->m_Width > 0)
-						{
-							for(int i = 0; i < pTMap->m_Width; ++i)
-							{
-								Visuals.m_vBorderTop[i].AddIndexBufferByteOffset(TilesHandledCount);
-							}
-						}
-						vtmpTiles.insert(vtmpTiles.end(), vtmpBorderTopTiles.begin(), vtmpBorderTopTiles.end());
-						vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderTopTilesTexCoords.begin(), vtmpBorderTopTilesTexCoords.end());
-
-						TilesHandledCount = vtmpTiles.size();
-						if(pTMap->m_Width > 0)
-						{
-							for(int i = 0; i < pTMap->m_Width; ++i)
-							{
-								Visuals.m_vBorderBottom[i].AddIndexBufferByteOffset(TilesHandledCount);
-							}
-						}
-						vtmpTiles.insert(vtmpTiles.end(), vtmpBorderBottomTiles.begin(), vtmpBorderBottomTiles.end());
-						vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderBottomTilesTexCoords.begin(), vtmpBorderBottomTilesTexCoords.end());
-
-						TilesHandledCount = vtmpTiles.size();
-						if(pTMap->m_Height > 0)
-						{
-							for(int i = 0; i < pTMap->m_Height; ++i)
-							{
-								Visuals.m_vBorderLeft[i].AddIndexBufferByteOffset(TilesHandledCount);
-							}
-						}
-						vtmpTiles.insert(vtmpTiles.end(), vtmpBorderLeftTiles.begin(), vtmpBorderLeftTiles.end());
-						vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderLeftTilesTexCoords.begin(), vtmpBorderLeftTilesTexCoords.end());
-
-						TilesHandledCount = vtmpTiles.size();
-						if(pTMap->m_Height > 0)
-						{
-							for(int i = 0; i < pTMap->m_Height; ++i)
-							{
-								Visuals.m_vBorderRight[i].AddIndexBufferByteOffset(TilesHandledCount);
-							}
-						}
-						vtmpTiles.insert(vtmpTiles.end(), vtmpBorderRightTiles.begin(), vtmpBorderRightTiles.end());
-						vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderRightTilesTexCoords.begin(), vtmpBorderRightTilesTexCoords.end());
-
-						//setup params
-						float *pTmpTiles = vtmpTiles.empty() ? NULL : (float *)vtmpTiles.data();
-						unsigned char *pTmpTileTexCoords = vtmpTileTexCoords.empty() ? NULL : (unsigned char *)vtmpTileTexCoords.data();
-
-						Visuals.m_BufferContainerIndex = -1;
-						size_t UploadDataSize = vtmpTileTexCoords.size() * sizeof(SGraphicTileTexureCoords) + vtmpTiles.size() * sizeof(SGraphicTile);
-						if(UploadDataSize > 0)
-						{
-							char *pUploadData = (char *)malloc(sizeof(char) * UploadDataSize);
-
-							mem_copy_special(pUploadData, pTmpTiles, sizeof(vec2), vtmpTiles.size() * 4, (DoTextureCoords ? sizeof(ubvec4) : 0));
-							if(DoTextureCoords)
-							{
-								mem_copy_special(pUploadData + sizeof(vec2), pTmpTileTexCoords, sizeof(ubvec4), vtmpTiles.size() * 4, sizeof(vec2));
-							}
-
-							// first create the buffer object
-							int BufferObjectIndex = Graphics()->CreateBufferObject(UploadDataSize, pUploadData, 0, true);
-
-							// then create the buffer container
-							SBufferContainerInfo ContainerInfo;
-							ContainerInfo.m_Stride = (DoTextureCoords ? (sizeof(float) * 2 + sizeof(ubvec4)) : 0);
-							ContainerInfo.m_VertBufferBindingIndex = BufferObjectIndex;
-							ContainerInfo.m_vAttributes.emplace_back();
-							SBufferContainerInfo::SAttribute *pAttr = &ContainerInfo.m_vAttributes.back();
-							pAttr->m_DataTypeCount = 2;
-							pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
-							pAttr->m_Normalized = false;
-							pAttr->m_pOffset = 0;
-							pAttr->m_FuncType = 0;
-							if(DoTextureCoords)
-							{
-								ContainerInfo.m_vAttributes.emplace_back();
-								pAttr = &ContainerInfo.m_vAttributes.back();
-								pAttr->m_DataTypeCount = 4;
-								pAttr->m_Type = GRAPHICS_TYPE_UNSIGNED_BYTE;
-								pAttr->m_Normalized = false;
-								pAttr->m_pOffset = (void *)(sizeof(vec2));
-								pAttr->m_FuncType = 1;
-							}
-
-							Visuals.m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
-							// and finally inform the backend how many indices are required
-							Graphics()->IndicesNumRequiredNotify(vtmpTiles.size() * 6);
-
-							RenderLoading();
-						}
-
-						++CurOverlay;
+						pVisuals->m_IsTextured = DoTextureCoords;
+
+						STileLayerSource Source;
+						Source.m_Type = Type;
+						Source.m_pTiles = pTiles;
+						Source.m_Width = pTMap->m_Width;
+						Source.m_Height = pTMap->m_Height;
+						Source.m_Overlay = CurOverlay;
+						Source.m_DoTextureCoords = DoTextureCoords;
+						vpJobs.push_back(std::make_shared<CLayerPrepareJob>(pVisuals, Source));
 					}
 				}
 			}
@@ -797,108 +494,94 @@ void CMapLayers::OnMapLoad()
 				SQuadLayerVisuals *pQLayerVisuals = m_vpQuadLayerVisuals.back();
 
 				bool Textured = (pQLayer->m_Image != -1);
-
-				vtmpQuads.clear();
-				vtmpQuadsTextured.clear();
-
-				if(Textured)
-					vtmpQuadsTextured.resize(pQLayer->m_NumQuads);
-				else
-					vtmpQuads.resize(pQLayer->m_NumQuads);
-
-				CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
-				for(int i = 0; i < pQLayer->m_NumQuads; ++i)
+				if(pQLayer->m_NumQuads > 0)
 				{
-					CQuad *pQuad = &pQuads[i];
-					for(int j = 0; j < 4; ++j)
-					{
-						int QuadIDX = j;
-						if(j == 2)
-							QuadIDX = 3;
-						else if(j == 3)
-							QuadIDX = 2;
-						if(!Textured)
-						{
-							// ignore the conversion for the position coordinates
-							vtmpQuads[i].m_aVertices[j].m_X = (pQuad->m_aPoints[QuadIDX].x);
-							vtmpQuads[i].m_aVertices[j].m_Y = (pQuad->m_aPoints[QuadIDX].y);
-							vtmpQuads[i].m_aVertices[j].m_CenterX = (pQuad->m_aPoints[4].x);
-							vtmpQuads[i].m_aVertices[j].m_CenterY = (pQuad->m_aPoints[4].y);
-							vtmpQuads[i].m_aVertices[j].m_R = (unsigned char)pQuad->m_aColors[QuadIDX].r;
-							vtmpQuads[i].m_aVertices[j].m_G = (unsigned char)pQuad->m_aColors[QuadIDX].g;
-							vtmpQuads[i].m_aVertices[j].m_B = (unsigned char)pQuad->m_aColors[QuadIDX].b;
-							vtmpQuads[i].m_aVertices[j].m_A = (unsigned char)pQuad->m_aColors[QuadIDX].a;
-						}
-						else
-						{
-							// ignore the conversion for the position coordinates
-							vtmpQuadsTextured[i].m_aVertices[j].m_X = (pQuad->m_aPoints[QuadIDX].x);
-							vtmpQuadsTextured[i].m_aVertices[j].m_Y = (pQuad->m_aPoints[QuadIDX].y);
-							vtmpQuadsTextured[i].m_aVertices[j].m_CenterX = (pQuad->m_aPoints[4].x);
-							vtmpQuadsTextured[i].m_aVertices[j].m_CenterY = (pQuad->m_aPoints[4].y);
-							vtmpQuadsTextured[i].m_aVertices[j].m_U = fx2f(pQuad->m_aTexcoords[QuadIDX].x);
-							vtmpQuadsTextured[i].m_aVertices[j].m_V = fx2f(pQuad->m_aTexcoords[QuadIDX].y);
-							vtmpQuadsTextured[i].m_aVertices[j].m_R = (unsigned char)pQuad->m_aColors[QuadIDX].r;
-							vtmpQuadsTextured[i].m_aVertices[j].m_G = (unsigned char)pQuad->m_aColors[QuadIDX].g;
-							vtmpQuadsTextured[i].m_aVertices[j].m_B = (unsigned char)pQuad->m_aColors[QuadIDX].b;
-							vtmpQuadsTextured[i].m_aVertices[j].m_A = (unsigned char)pQuad->m_aColors[QuadIDX].a;
-						}
-					}
+					const CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+					vpJobs.push_back(std::make_shared<CLayerPrepareJob>(pQLayerVisuals, pQuads, pQLayer->m_NumQuads, Textured));
 				}
+			}
+		}
+	}
+}
 
-				size_t UploadDataSize = 0;
-				if(Textured)
-					UploadDataSize = vtmpQuadsTextured.size() * sizeof(STmpQuadTextured);
-				else
-					UploadDataSize = vtmpQuads.size() * sizeof(STmpQuad);
+void CMapLayers::UploadTileLayer(STileLayerVisuals &Visuals, SPreparedLayerVertices &Vertices)
+{
+	Visuals.m_BufferContainerIndex = -1;
+	if(Vertices.m_DataSize == 0)
+		return;
 
-				if(UploadDataSize > 0)
-				{
-					void *pUploadData = NULL;
-					if(Textured)
-						pUploadData = vtmpQuadsTextured.data();
-					else
-						pUploadData = vtmpQuads.data();
-					// create the buffer object
-					int BufferObjectIndex = Graphics()->CreateBufferObject(UploadDataSize, pUploadData, 0);
-					// then create the buffer container
-					SBufferContainerInfo ContainerInfo;
-					ContainerInfo.m_Stride = (Textured ? (sizeof(STmpQuadTextured) / 4) : (sizeof(STmpQuad) / 4));
-					ContainerInfo.m_VertBufferBindingIndex = BufferObjectIndex;
-					ContainerInfo.m_vAttributes.emplace_back();
-					SBufferContainerInfo::SAttribute *pAttr = &ContainerInfo.m_vAttributes.back();
-					pAttr->m_DataTypeCount = 4;
-					pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
-					pAttr->m_Normalized = false;
-					pAttr->m_pOffset = 0;
-					pAttr->m_FuncType = 0;
-					ContainerInfo.m_vAttributes.emplace_back();
-					pAttr = &ContainerInfo.m_vAttributes.back();
-					pAttr->m_DataTypeCount = 4;
-					pAttr->m_Type = GRAPHICS_TYPE_UNSIGNED_BYTE;
-					pAttr->m_Normalized = true;
-					pAttr->m_pOffset = (void *)(sizeof(float) * 4);
-					pAttr->m_FuncType = 0;
-					if(Textured)
-					{
-						ContainerInfo.m_vAttributes.emplace_back();
-						pAttr = &ContainerInfo.m_vAttributes.back();
-						pAttr->m_DataTypeCount = 2;
-						pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
-						pAttr->m_Normalized = false;
-						pAttr->m_pOffset = (void *)(sizeof(float) * 4 + sizeof(unsigned char) * 4);
-						pAttr->m_FuncType = 0;
-					}
+	// first create the buffer object, it takes over the vertices
+	int BufferObjectIndex = Graphics()->CreateBufferObject(Vertices.m_DataSize, Vertices.m_pData, 0, true);
+	Vertices.m_pData = nullptr;
+
+	// then create the buffer container
+	SBufferContainerInfo ContainerInfo;
+	ContainerInfo.m_Stride = (Visuals.m_IsTextured ? (sizeof(float) * 2 + sizeof(ubvec4)) : 0);
+	ContainerInfo.m_VertBufferBindingIndex = BufferObjectIndex;
+	ContainerInfo.m_vAttributes.emplace_back();
+	SBufferContainerInfo::SAttribute *pAttr = &ContainerInfo.m_vAttributes.back();
+	pAttr->m_DataTypeCount = 2;
+	pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
+	pAttr->m_Normalized = false;
+	pAttr->m_pOffset = 0;
+	pAttr->m_FuncType = 0;
+	if(Visuals.m_IsTextured)
+	{
+		ContainerInfo.m_vAttributes.emplace_back();
+		pAttr = &ContainerInfo.m_vAttributes.back();
+		pAttr->m_DataTypeCount = 4;
+		pAttr->m_Type = GRAPHICS_TYPE_UNSIGNED_BYTE;
+		pAttr->m_Normalized = false;
+		pAttr->m_pOffset = (void *)(sizeof(vec2));
+		pAttr->m_FuncType = 1;
+	}
 
-					pQLayerVisuals->m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
-					// and finally inform the backend how many indices are required
-					Graphics()->IndicesNumRequiredNotify(pQLayer->m_NumQuads * 6);
+	Visuals.m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
+	// and finally inform the backend how many indices are required
+	Graphics()->IndicesNumRequiredNotify(Vertices.m_NumQuads * 6);
+}
 
-					RenderLoading();
-				}
-			}
-		}
+void CMapLayers::UploadQuadLayer(SQuadLayerVisuals &Visuals, bool Textured, SPreparedLayerVertices &Vertices)
+{
+	if(Vertices.m_DataSize == 0)
+		return;
+
+	// create the buffer object, it takes over the vertices
+	int BufferObjectIndex = Graphics()->CreateBufferObject(Vertices.m_DataSize, Vertices.m_pData, 0, true);
+	Vertices.m_pData = nullptr;
+
+	// then create the buffer container
+	SBufferContainerInfo ContainerInfo;
+	ContainerInfo.m_Stride = (Textured ? (sizeof(STmpQuadTextured) / 4) : (sizeof(STmpQuad) / 4));
+	ContainerInfo.m_VertBufferBindingIndex = BufferObjectIndex;
+	ContainerInfo.m_vAttributes.emplace_back();
+	SBufferContainerInfo::SAttribute *pAttr = &ContainerInfo.m_vAttributes.back();
+	pAttr->m_DataTypeCount = 4;
+	pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
+	pAttr->m_Normalized = false;
+	pAttr->m_pOffset = 0;
+	pAttr->m_FuncType = 0;
+	ContainerInfo.m_vAttributes.emplace_back();
+	pAttr = &ContainerInfo.m_vAttributes.back();
+	pAttr->m_DataTypeCount = 4;
+	pAttr->m_Type = GRAPHICS_TYPE_UNSIGNED_BYTE;
+	pAttr->m_Normalized = true;
+	pAttr->m_pOffset = (void *)(sizeof(float) * 4);
+	pAttr->m_FuncType = 0;
+	if(Textured)
+	{
+		ContainerInfo.m_vAttributes.emplace_back();
+		pAttr = &ContainerInfo.m_vAttributes.back();
+		pAttr->m_DataTypeCount = 2;
+		pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
+		pAttr->m_Normalized = false;
+		pAttr->m_pOffset = (void *)(sizeof(float) * 4 + sizeof(unsigned char) * 4);
+		pAttr->m_FuncType = 0;
 	}
+
+	Visuals.m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
+	// and finally inform the backend how many indices are required
+	Graphics()->IndicesNumRequiredNotify(Vertices.m_NumQuads * 6);
 }
 
 void CMapLayers::RenderTileLayer(int LayerIndex, ColorRGBA &Color, CMapItemLayerTilemap *pTileLayer, CMapItemGroup *pGroup)
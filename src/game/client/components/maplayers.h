@@ -2,19 +2,20 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
+#include <engine/shared/jobs.h>
+
 #include <game/client/component.h>
+#include <game/client/envelope_eval.h>
+#include <game/client/layer_visuals.h>
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #define INDEX_BUFFER_GROUP_WIDTH 12
 #define INDEX_BUFFER_GROUP_HEIGHT 9
 #define INDEX_BORDER_BUFFER_GROUP_SIZE 20
 
-typedef char *offset_ptr_size;
-typedef uintptr_t offset_ptr;
-typedef unsigned int offset_ptr32;
-
 class CCamera;
 class CLayers;
 class CMapImages;
@@ -37,74 +38,12 @@ class CMapLayers : public CComponent
 
 	bool m_OnlineOnly;
 
-	struct STileLayerVisuals
-	{
-		STileLayerVisuals() :
-			m_pTilesOfLayer(nullptr)
-		{
-			m_Width = 0;
-			m_Height = 0;
-			m_BufferContainerIndex = -1;
-			m_IsTextured = false;
-		}
-
-		bool Init(unsigned int Width, unsigned int Height);
-
-		~STileLayerVisuals();
-
-		struct STileVisual
-		{
-			STileVisual() :
-				m_IndexBufferByteOffset(0) {}
-
-		private:
-			offset_ptr32 m_IndexBufferByteOffset;
-
-		public:
-			bool DoDraw()
-			{
-				return (m_IndexBufferByteOffset & 0x10000000) != 0;
-			}
-
-			void Draw(bool SetDraw)
-			{
-				m_IndexBufferByteOffset = (SetDraw ? 0x10000000 : (offset_ptr32)0) | (m_IndexBufferByteOffset & 0xEFFFFFFF);
-			}
-
-			offset_ptr IndexBufferByteOffset()
-			{
-				return ((offset_ptr)(m_IndexBufferByteOffset & 0xEFFFFFFF) * 6 * sizeof(uint32_t));
-			}
-
-			void SetIndexBufferByteOffset(offset_ptr32 IndexBufferByteOff)
-			{
-				m_IndexBufferByteOffset = IndexBufferByteOff | (m_IndexBufferByteOffset & 0x10000000);
-			}
-
-			void AddIndexBufferByteOffset(offset_ptr32 IndexBufferByteOff)
-			{
-				m_IndexBufferByteOffset = ((m_IndexBufferByteOffset & 0xEFFFFFFF) + IndexBufferByteOff) | (m_IndexBufferByteOffset & 0x10000000);
-			}
-		};
-		STileVisual *m_pTilesOfLayer;
-
-		STileVisual m_BorderTopLeft;
-		STileVisual m_BorderTopRight;
-		STileVisual m_BorderBottomRight;
-		STileVisual m_BorderBottomLeft;
-
-		STileVisual m_BorderKillTile; //end of map kill tile -- game layer only
+	// baked envelopes of the map if cl_envelope_tables was set when loading
+	// it, empty otherwise
+	std::vector<CEnvelopeTable> m_vEnvelopeTables;
+	void BakeEnvelopes();
+	void EvalMapEnvelope(int Env, const IEnvelopePointAccess *pPoints, std::chrono::nanoseconds TimeNanos, ColorRGBA &Channels) const;
 
-		std::vector<STileVisual> m_vBorderTop;
-		std::vector<STileVisual> m_vBorderLeft;
-		std::vector<STileVisual> m_vBorderRight;
-		std::vector<STileVisual> m_vBorderBottom;
-
-		unsigned int m_Width;
-		unsigned int m_Height;
-		int m_BufferContainerIndex;
-		bool m_IsTextured;
-	};
 	std::vector<STileLayerVisuals *> m_vpTileLayerVisuals;
 
 	struct SQuadLayerVisuals
@@ -128,6 +67,37 @@ class CMapLayers : public CComponent
 	};
 	std::vector<SQuadLayerVisuals *> m_vpQuadLayerVisuals;
 
+	// builds the vertices of a tile or quad layer
+	class CLayerPrepareJob : public IJob
+	{
+		STileLayerSource m_TileSource;
+		const CQuad *m_pQuads;
+		int m_NumQuads;
+
+	protected:
+		void Run() override;
+
+	public:
+		CLayerPrepareJob(STileLayerVisuals *pVisuals, const STileLayerSource &Source);
+		CLayerPrepareJob(SQuadLayerVisuals *pVisuals, const CQuad *pQuads, int NumQuads, bool Textured);
+		~CLayerPrepareJob();
+
+		STileLayerVisuals *m_pTileVisuals;
+		SQuadLayerVisuals *m_pQuadVisuals;
+		bool m_Textured;
+		SPreparedLayerVertices m_Vertices;
+
+		// tile layers are copied from the cache if there is one, otherwise
+		// they can be serialized into `m_vCacheData`
+		const CTileLayerCache *m_pCache = nullptr;
+		int m_CacheIndex = -1;
+		bool m_WriteCache = false;
+		std::vector<unsigned char> m_vCacheData;
+	};
+	void CreateLayerPrepareJobs(std::vector<std::shared_ptr<CLayerPrepareJob>> &vpJobs);
+	void UploadTileLayer(STileLayerVisuals &Visuals, SPreparedLayerVertices &Vertices);
+	void UploadQuadLayer(SQuadLayerVisuals &Visuals, bool Textured, SPreparedLayerVertices &Vertices);
+
 	virtual CCamera *GetCurCamera();
 
 	void LayersOfGroupCount(CMapItemGroup *pGroup, int &TileLayerCount, int &QuadLayerCount, bool &PassedGameLayer);
@@ -22,18 +22,8 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
-	{
-		m_aParticles[i].m_PrevPart = i - 1;
-		m_aParticles[i].m_NextPart = i + 1;
-	}
-
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES - 1].m_NextPart = -1;
-	m_FirstFree = 0;
-
-	for(int &FirstPart : m_aFirstPart)
-		FirstPart = -1;
+	for(auto &Group : m_aGroups)
+		Group.Reset();
 }
 
 void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
@@ -50,27 +40,13 @@ void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
 			return;
 	}
 
-	if(m_FirstFree == -1)
+	int NumParticles = 0;
+	for(const auto &ParticleGroup : m_aGroups)
+		NumParticles += ParticleGroup.Num();
+	if(NumParticles >= MAX_PARTICLES)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
-
-	// copy data
-	m_aParticles[Id] = *pPart;
-
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
-
-	// set some parameters
-	m_aParticles[Id].m_Life = TimePassed;
+	m_aGroups[Group].Add(*pPart, TimePassed);
 }
 
 void CParticles::Update(float TimePassed)
@@ -91,56 +67,8 @@ void CParticles::Update(float TimePassed)
 		FrictionFraction -= 0.05f;
 	}
 
-	for(int &FirstPart : m_aFirstPart)
-	{
-		int i = FirstPart;
-		while(i != -1)
-		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity * TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel * TimePassed;
-			if(m_aParticles[i].m_Collides)
-			{
-				Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, random_float(0.1f, 1.0f), NULL);
-			}
-			else
-			{
-				m_aParticles[i].m_Pos += Vel;
-			}
-			m_aParticles[i].m_Vel = Vel * (1.0f / TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
-
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
-			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					FirstPart = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
-			}
-
-			i = Next;
-		}
-	}
+	for(auto &Group : m_aGroups)
+		Group.Update(TimePassed, FrictionCount, Collision());
 }
 
 void CParticles::OnRender()
@@ -216,10 +144,13 @@ void CParticles::RenderGroup(int Group)
 		ParticleQuadContainerIndex = m_ExtraParticleQuadContainerIndex;
 	}
 
+	// newest particles are drawn first
+	const CParticlePool &Particles = m_aGroups[Group];
+
 	// don't use the buffer methods here, else the old renderer gets many draw calls
 	if(Graphics()->IsQuadContainerBufferingEnabled())
 	{
-		int i = m_aFirstPart[Group];
+		int i = Particles.Num() - 1;
 
 		static IGraphics::SRenderSpriteInfo s_aParticleRenderInfo[MAX_PARTICLES];
 
@@ -231,42 +162,35 @@ void CParticles::RenderGroup(int Group)
 
 		if(i != -1)
 		{
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
-			{
-				float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
-			}
-			LastColor.r = m_aParticles[i].m_Color.r;
-			LastColor.g = m_aParticles[i].m_Color.g;
-			LastColor.b = m_aParticles[i].m_Color.b;
+			const ColorRGBA &Color = Particles.Color(i);
+			float Alpha = Particles.Alpha(i, Particles.Age(i));
+			LastColor.r = Color.r;
+			LastColor.g = Color.g;
+			LastColor.b = Color.b;
 			LastColor.a = Alpha;
 
 			Graphics()->SetColor(
-				m_aParticles[i].m_Color.r,
-				m_aParticles[i].m_Color.g,
-				m_aParticles[i].m_Color.b,
+				Color.r,
+				Color.g,
+				Color.b,
 				Alpha);
 
-			LastQuadOffset = m_aParticles[i].m_Spr;
+			LastQuadOffset = Particles.Sprite(i);
 		}
 
-		while(i != -1)
+		for(; i >= 0; i--)
 		{
-			int QuadOffset = m_aParticles[i].m_Spr;
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
-			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
-			}
+			int QuadOffset = Particles.Sprite(i);
+			float a = Particles.Age(i);
+			vec2 p = Particles.Pos(i);
+			float Size = Particles.Size(i, a);
+			const ColorRGBA &Color = Particles.Color(i);
+			float Alpha = Particles.Alpha(i, a);
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != m_aParticles[i].m_Color.r || LastColor.g != m_aParticles[i].m_Color.g || LastColor.b != m_aParticles[i].m_Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
+				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != Color.r || LastColor.g != Color.g || LastColor.b != Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
 				{
 					Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
 					Graphics()->RenderQuadContainerAsSpriteMultiple(ParticleQuadContainerIndex, LastQuadOffset - FirstParticleOffset, CurParticleRenderCount, s_aParticleRenderInfo);
@@ -274,26 +198,24 @@ void CParticles::RenderGroup(int Group)
 					LastQuadOffset = QuadOffset;
 
 					Graphics()->SetColor(
-						m_aParticles[i].m_Color.r,
-						m_aParticles[i].m_Color.g,
-						m_aParticles[i].m_Color.b,
+						Color.r,
+						Color.g,
+						Color.b,
 						Alpha);
 
-					LastColor.r = m_aParticles[i].m_Color.r;
-					LastColor.g = m_aParticles[i].m_Color.g;
-					LastColor.b = m_aParticles[i].m_Color.b;
+					LastColor.r = Color.r;
+					LastColor.g = Color.g;
+					LastColor.b = Color.b;
 					LastColor.a = Alpha;
 				}
 
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[0] = p.x;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[1] = p.y;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Scale = Size;
-				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = m_aParticles[i].m_Rot;
+				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = Particles.Rot(i);
 
 				++CurParticleRenderCount;
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 
 		Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
@@ -301,42 +223,35 @@ void CParticles::RenderGroup(int Group)
 	}
 	else
 	{
-		int i = m_aFirstPart[Group];
-
 		Graphics()->BlendNormal();
 		Graphics()->WrapClamp();
 
-		while(i != -1)
+		for(int i = Particles.Num() - 1; i >= 0; i--)
 		{
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
-			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
-			}
+			float a = Particles.Age(i);
+			vec2 p = Particles.Pos(i);
+			float Size = Particles.Size(i, a);
+			const ColorRGBA &Color = Particles.Color(i);
+			float Alpha = Particles.Alpha(i, a);
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				Graphics()->TextureSet(aParticles[m_aParticles[i].m_Spr - FirstParticleOffset]);
+				Graphics()->TextureSet(aParticles[Particles.Sprite(i) - FirstParticleOffset]);
 				Graphics()->QuadsBegin();
 
-				Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+				Graphics()->QuadsSetRotation(Particles.Rot(i));
 
 				Graphics()->SetColor(
-					m_aParticles[i].m_Color.r,
-					m_aParticles[i].m_Color.g,
-					m_aParticles[i].m_Color.b,
+					Color.r,
+					Color.g,
+					Color.b,
 					Alpha);
 
 				IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
 				Graphics()->QuadsDraw(&QuadItem, 1);
 				Graphics()->QuadsEnd();
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 		Graphics()->WrapNormal();
 		Graphics()->BlendNormal();
@@ -4,60 +4,7 @@
 #define GAME_CLIENT_COMPONENTS_PARTICLES_H
 #include <base/vmath.h>
 #include <game/client/component.h>
-
-// particles
-struct CParticle
-{
-	void SetDefault()
-	{
-		m_Pos = vec2(0, 0);
-		m_Vel = vec2(0, 0);
-		m_LifeSpan = 0;
-		m_StartSize = 32;
-		m_EndSize = 32;
-		m_UseAlphaFading = false;
-		m_StartAlpha = 1;
-		m_EndAlpha = 1;
-		m_Rot = 0;
-		m_Rotspeed = 0;
-		m_Gravity = 0;
-		m_Friction = 0;
-		m_FlowAffected = 1.0f;
-		m_Color = ColorRGBA(1, 1, 1, 1);
-		m_Collides = true;
-	}
-
-	vec2 m_Pos;
-	vec2 m_Vel;
-
-	int m_Spr;
-
-	float m_FlowAffected;
-
-	float m_LifeSpan;
-
-	float m_StartSize;
-	float m_EndSize;
-
-	bool m_UseAlphaFading;
-	float m_StartAlpha;
-	float m_EndAlpha;
-
-	float m_Rot;
-	float m_Rotspeed;
-
-	float m_Gravity;
-	float m_Friction;
-
-	ColorRGBA m_Color;
-
-	bool m_Collides;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
-};
+#include <game/client/particle_pool.h>
 
 class CParticles : public CComponent
 {
@@ -91,9 +38,8 @@ private:
 		MAX_PARTICLES = 1024 * 8,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// all groups together have at most `MAX_PARTICLES` particles
+	CParticlePool m_aGroups[NUM_GROUPS] = {MAX_PARTICLES, MAX_PARTICLES, MAX_PARTICLES, MAX_PARTICLES};
 
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
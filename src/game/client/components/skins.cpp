@@ -1,10 +1,13 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <base/hash.h>
 #include <base/math.h>
 #include <base/system.h>
 
 #include <engine/engine.h>
+#include <engine/gfx/image_loader.h>
+#include <engine/gfx/image_manipulation.h>
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
 #include <engine/storage.h>
@@ -16,6 +19,12 @@
 
 #include "skins.h"
 
+#include <chrono>
+#include <thread>
+#include <unordered_set>
+
+using namespace std::chrono_literals;
+
 bool CSkins::IsVanillaSkin(const char *pName)
 {
 	return std::any_of(std::begin(VANILLA_SKINS), std::end(VANILLA_SKINS), [pName](const char *pVanillaSkin) { return str_comp(pName, pVanillaSkin) == 0; });
@@ -41,10 +50,11 @@ CSkins::CGetPngFile::CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pSt
 	LogProgress(HTTPLOG::NONE);
 }
 
-struct SSkinScanUser
+struct CSkins::SSkinScanUser
 {
 	CSkins *m_pThis;
-	CSkins::TSkinLoadedCBFunc m_SkinLoadedFunc;
+	std::vector<std::shared_ptr<CSkinLoadJob>> m_vpJobs;
+	std::unordered_set<std::string> m_Names;
 };
 
 int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
@@ -64,13 +74,13 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 
 	// Don't add duplicate skins (one from user's config directory, other from
 	// client itself)
-	if(pSelf->m_Skins.find(aNameWithoutPng) != pSelf->m_Skins.end())
+	if(!pUserReal->m_Names.insert(aNameWithoutPng).second)
 		return 0;
 
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
-	pSelf->LoadSkin(aNameWithoutPng, aBuf, DirType);
-	pUserReal->m_SkinLoadedFunc((int)pSelf->m_Skins.size());
+	pUserReal->m_vpJobs.push_back(std::make_shared<CSkinLoadJob>(pSelf->Storage(), aNameWithoutPng, aBuf, DirType, g_Config.m_ClSkinCache > 0));
+	pSelf->m_pClient->Engine()->AddJob(pUserReal->m_vpJobs.back());
 	return 0;
 }
 
@@ -109,53 +119,20 @@ static void CheckMetrics(CSkin::SSkinMetricVariable &Metrics, const uint8_t *pIm
 	Metrics.m_MaxHeight = CheckHeight;
 }
 
-const CSkin *CSkins::LoadSkin(const char *pName, const char *pPath, int DirType)
+static void SkinBodySize(const CImageInfo &Info, int *pWidth, int *pHeight)
 {
-	CImageInfo Info;
-	if(!LoadSkinPNG(Info, pName, pPath, DirType))
-		return 0;
-	return LoadSkin(pName, Info);
+	*pWidth = g_pData->m_aSprites[SPRITE_TEE_BODY].m_W * (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx);
+	*pHeight = g_pData->m_aSprites[SPRITE_TEE_BODY].m_H * (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy);
 }
 
-bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType)
+CSkins::CSkinLoadData::~CSkinLoadData()
 {
-	char aBuf[512];
-	if(!Graphics()->LoadPNG(&Info, pPath, DirType))
-	{
-		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
-		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return false;
-	}
-	return true;
+	free(m_InfoGrayscale.m_pData);
 }
 
-const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
+bool CSkins::CSkinLoadData::ComputeMetrics()
 {
-	char aBuf[512];
-
-	if(!Graphics()->CheckImageDivisibility(pName, Info, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy, true))
-	{
-		str_format(aBuf, sizeof(aBuf), "skin failed image divisibility: %s", pName);
-		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return nullptr;
-	}
-	if(!Graphics()->IsImageFormatRGBA(pName, Info))
-	{
-		str_format(aBuf, sizeof(aBuf), "skin format is not RGBA: %s", pName);
-		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return nullptr;
-	}
-
-	CSkin Skin{pName};
-	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
-
-	for(int i = 0; i < 6; ++i)
-		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+	const CImageInfo &Info = m_Info;
 
 	int FeetGridPixelsWidth = (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridx);
 	int FeetGridPixelsHeight = (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridy);
@@ -181,47 +158,56 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	int BodyOutlineOffsetX = g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE].m_X * BodyOutlineGridPixelsWidth;
 	int BodyOutlineOffsetY = g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE].m_Y * BodyOutlineGridPixelsHeight;
 
-	int BodyWidth = g_pData->m_aSprites[SPRITE_TEE_BODY].m_W * (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx); // body width
-	int BodyHeight = g_pData->m_aSprites[SPRITE_TEE_BODY].m_H * (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy); // body height
+	int BodyWidth, BodyHeight;
+	SkinBodySize(Info, &BodyWidth, &BodyHeight);
 	if(BodyWidth > Info.m_Width || BodyHeight > Info.m_Height)
-		return nullptr;
-	unsigned char *pData = (unsigned char *)Info.m_pData;
+		return false;
+	const unsigned char *pData = (const unsigned char *)Info.m_pData;
 	const int PixelStep = 4;
 	int Pitch = Info.m_Width * PixelStep;
 
 	// dig out blood color
-	{
-		int aColors[3] = {0};
-		for(int y = 0; y < BodyHeight; y++)
-			for(int x = 0; x < BodyWidth; x++)
+	for(int y = 0; y < BodyHeight; y++)
+		for(int x = 0; x < BodyWidth; x++)
+		{
+			uint8_t AlphaValue = pData[y * Pitch + x * PixelStep + 3];
+			if(AlphaValue > 128)
 			{
-				uint8_t AlphaValue = pData[y * Pitch + x * PixelStep + 3];
-				if(AlphaValue > 128)
-				{
-					aColors[0] += pData[y * Pitch + x * PixelStep + 0];
-					aColors[1] += pData[y * Pitch + x * PixelStep + 1];
-					aColors[2] += pData[y * Pitch + x * PixelStep + 2];
-				}
+				m_aBloodColor[0] += pData[y * Pitch + x * PixelStep + 0];
+				m_aBloodColor[1] += pData[y * Pitch + x * PixelStep + 1];
+				m_aBloodColor[2] += pData[y * Pitch + x * PixelStep + 2];
 			}
-		if(aColors[0] != 0 && aColors[1] != 0 && aColors[2] != 0)
-			Skin.m_BloodColor = ColorRGBA(normalize(vec3(aColors[0], aColors[1], aColors[2])));
-		else
-			Skin.m_BloodColor = ColorRGBA(0, 0, 0, 1);
-	}
+		}
 
-	CheckMetrics(Skin.m_Metrics.m_Body, pData, Pitch, 0, 0, BodyWidth, BodyHeight);
+	CheckMetrics(m_Metrics.m_Body, pData, Pitch, 0, 0, BodyWidth, BodyHeight);
 
 	// body outline metrics
-	CheckMetrics(Skin.m_Metrics.m_Body, pData, Pitch, BodyOutlineOffsetX, BodyOutlineOffsetY, BodyOutlineWidth, BodyOutlineHeight);
+	CheckMetrics(m_Metrics.m_Body, pData, Pitch, BodyOutlineOffsetX, BodyOutlineOffsetY, BodyOutlineWidth, BodyOutlineHeight);
 
 	// get feet size
-	CheckMetrics(Skin.m_Metrics.m_Feet, pData, Pitch, FeetOffsetX, FeetOffsetY, FeetWidth, FeetHeight);
+	CheckMetrics(m_Metrics.m_Feet, pData, Pitch, FeetOffsetX, FeetOffsetY, FeetWidth, FeetHeight);
 
 	// get feet outline size
-	CheckMetrics(Skin.m_Metrics.m_Feet, pData, Pitch, FeetOutlineOffsetX, FeetOutlineOffsetY, FeetOutlineWidth, FeetOutlineHeight);
+	CheckMetrics(m_Metrics.m_Feet, pData, Pitch, FeetOutlineOffsetX, FeetOutlineOffsetY, FeetOutlineWidth, FeetOutlineHeight);
+	return true;
+}
+
+void CSkins::CSkinLoadData::CreateGrayscale()
+{
+	const size_t DataSize = (size_t)m_Info.m_Width * m_Info.m_Height * m_Info.PixelSize();
+	free(m_InfoGrayscale.m_pData);
+	m_InfoGrayscale = m_Info;
+	m_InfoGrayscale.m_pData = malloc(DataSize);
+	mem_copy(m_InfoGrayscale.m_pData, m_Info.m_pData, DataSize);
+
+	int BodyWidth, BodyHeight;
+	SkinBodySize(m_InfoGrayscale, &BodyWidth, &BodyHeight);
+	unsigned char *pData = (unsigned char *)m_InfoGrayscale.m_pData;
+	const int PixelStep = 4;
+	int Pitch = m_InfoGrayscale.m_Width * PixelStep;
 
 	// make the texture gray scale
-	for(int i = 0; i < Info.m_Width * Info.m_Height; i++)
+	for(int i = 0; i < m_InfoGrayscale.m_Width * m_InfoGrayscale.m_Height; i++)
 	{
 		int v = (pData[i * PixelStep] + pData[i * PixelStep + 1] + pData[i * PixelStep + 2]) / 3;
 		pData[i * PixelStep] = v;
@@ -266,22 +252,183 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 			pData[y * Pitch + x * PixelStep + 1] = v;
 			pData[y * Pitch + x * PixelStep + 2] = v;
 		}
+}
 
-	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+ColorRGBA CSkins::CSkinLoadData::BloodColor() const
+{
+	if(m_aBloodColor[0] != 0 && m_aBloodColor[1] != 0 && m_aBloodColor[2] != 0)
+		return ColorRGBA(normalize(vec3(m_aBloodColor[0], m_aBloodColor[1], m_aBloodColor[2])));
+	return ColorRGBA(0, 0, 0, 1);
+}
+
+CSkins::CSkinLoadJob::CSkinLoadJob(IStorage *pStorage, const char *pName, const char *pPath, int StorageType, bool UseCache) :
+	m_pStorage(pStorage),
+	m_StorageType(StorageType),
+	m_UseCache(UseCache)
+{
+	str_copy(m_aName, pName);
+	str_copy(m_aPath, pPath);
+}
+
+void CSkins::CSkinLoadJob::Run()
+{
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(m_aPath, m_StorageType, &pFileData, &FileSize))
+		return;
+
+	char aCachePath[IO_MAX_PATH_LENGTH];
+	CSkinCacheData::FormatPath(aCachePath, sizeof(aCachePath), sha256(pFileData, FileSize));
+	const int GridX = g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx;
+	const int GridY = g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy;
+	if(m_UseCache && m_Data.Load(m_pStorage, aCachePath, GridX, GridY))
+	{
+		free(pFileData);
+		m_Decoded.m_Width = m_Data.m_DecodedWidth;
+		m_Decoded.m_Height = m_Data.m_DecodedHeight;
+		m_Decoded.m_Format = CImageInfo::FORMAT_RGBA;
+	}
+	else
+	{
+		const bool Decoded = Decode(pFileData, FileSize);
+		free(pFileData);
+		if(!Decoded)
+			return;
+		if(!m_Data.ComputeMetrics())
+		{
+			m_Result = RESULT_INVALID;
+			return;
+		}
+		// skins with the same content share a cache entry, the temporary
+		// file is named after the skin so jobs don't write to the same file
+		if(m_UseCache)
+			m_Data.Save(m_pStorage, aCachePath, m_aName);
+	}
+
+	m_Data.CreateGrayscale();
+	m_Result = RESULT_OK;
+}
+
+bool CSkins::CSkinLoadJob::Decode(const void *pFileData, unsigned FileSize)
+{
+	if(!DecodePNG(pFileData, FileSize, m_aPath, m_Decoded, m_PngliteIncompatible))
+		return false;
+	// `m_Decoded` only describes the skin file, `m_Data` owns the image
+	uint8_t *pImgBuffer = static_cast<uint8_t *>(m_Decoded.m_pData);
+	m_Decoded.m_pData = nullptr;
+	if(m_Decoded.m_Format != CImageInfo::FORMAT_RGBA)
+	{
+		free(pImgBuffer);
+		m_Result = RESULT_NOT_RGBA;
+		return false;
+	}
+
+	m_Data.m_Info = m_Decoded;
+	m_Data.m_Info.m_pData = pImgBuffer;
+	m_Data.m_DecodedWidth = m_Decoded.m_Width;
+	m_Data.m_DecodedHeight = m_Decoded.m_Height;
+
+	// same as `IGraphics::CheckImageDivisibility`, the warning is shown on
+	// the main thread
+	const int DivX = g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx;
+	const int DivY = g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy;
+	const bool WidthBroken = m_Decoded.m_Width == 0 || (m_Decoded.m_Width % DivX) != 0;
+	const bool HeightBroken = m_Decoded.m_Height == 0 || (m_Decoded.m_Height % DivY) != 0;
+	if(WidthBroken || HeightBroken)
+	{
+		if(m_Decoded.m_Width <= 0 || m_Decoded.m_Height <= 0)
+		{
+			m_Result = RESULT_NOT_DIVISIBLE;
+			return false;
+		}
+		int NewWidth, NewHeight;
+		if(WidthBroken)
+		{
+			NewWidth = maximum<int>(HighestBit(m_Decoded.m_Width), DivX);
+			NewHeight = (NewWidth / DivX) * DivY;
+		}
+		else
+		{
+			NewHeight = maximum<int>(HighestBit(m_Decoded.m_Height), DivY);
+			NewWidth = (NewHeight / DivY) * DivX;
+		}
+		uint8_t *pNewImg = ResizeImage(pImgBuffer, m_Decoded.m_Width, m_Decoded.m_Height, NewWidth, NewHeight, m_Data.m_Info.PixelSize());
+		free(pImgBuffer);
+		m_Data.m_Info.m_pData = pNewImg;
+		m_Data.m_Info.m_Width = NewWidth;
+		m_Data.m_Info.m_Height = NewHeight;
+	}
+	return true;
+}
+
+bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType)
+{
+	char aBuf[512];
+	if(!Graphics()->LoadPNG(&Info, pPath, DirType))
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return false;
+	}
+	return true;
+}
+
+const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
+{
+	char aBuf[512];
+
+	if(!Graphics()->CheckImageDivisibility(pName, Info, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy, true))
+	{
+		str_format(aBuf, sizeof(aBuf), "skin failed image divisibility: %s", pName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return nullptr;
+	}
+	if(!Graphics()->IsImageFormatRGBA(pName, Info))
+	{
+		str_format(aBuf, sizeof(aBuf), "skin format is not RGBA: %s", pName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return nullptr;
+	}
+
+	CSkinLoadData Data;
+	Data.m_Info = Info;
+	Info.m_pData = nullptr;
+	if(!Data.ComputeMetrics())
+		return nullptr;
+	Data.CreateGrayscale();
+	return LoadSkin(pName, Data);
+}
+
+const CSkin *CSkins::LoadSkin(const char *pName, CSkinLoadData &Data)
+{
+	CSkin Skin{pName};
+	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
 
 	for(int i = 0; i < 6; ++i)
-		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Data.m_Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
 
-	Graphics()->FreePNG(&Info);
+	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+
+	for(int i = 0; i < 6; ++i)
+		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Data.m_InfoGrayscale, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+
+	Skin.m_BloodColor = Data.BloodColor();
+	Skin.m_Metrics = Data.m_Metrics;
 
 	// set skin data
 	if(g_Config.m_Debug)
 	{
+		char aBuf[512];
 		str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.GetName());
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 	}
@@ -292,6 +439,37 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	return SkinInsertIt.first->second.get();
 }
 
+void CSkins::FinishSkinLoad(CSkinLoadJob &Job)
+{
+	char aBuf[512];
+	Graphics()->WarnPngliteIncompatibility(Job.m_aName, Job.m_PngliteIncompatible);
+	if(Job.m_Result == CSkinLoadJob::RESULT_LOAD_FAILED)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", Job.m_aName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return;
+	}
+
+	// the job already resized the image if needed, these only add the
+	// warnings about the skin file
+	Graphics()->CheckImageDivisibility(Job.m_aName, Job.m_Decoded, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx, g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy, false);
+	if(Job.m_Result == CSkinLoadJob::RESULT_NOT_DIVISIBLE)
+	{
+		str_format(aBuf, sizeof(aBuf), "skin failed image divisibility: %s", Job.m_aName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return;
+	}
+	if(!Graphics()->IsImageFormatRGBA(Job.m_aName, Job.m_Decoded))
+	{
+		str_format(aBuf, sizeof(aBuf), "skin format is not RGBA: %s", Job.m_aName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		return;
+	}
+
+	if(Job.m_Result == CSkinLoadJob::RESULT_OK)
+		LoadSkin(Job.m_aName, Job.m_Data);
+}
+
 void CSkins::OnInit()
 {
 	m_aEventSkinPrefix[0] = '\0';
@@ -337,10 +515,34 @@ void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
 	m_Skins.clear();
 	m_DownloadSkins.clear();
 	m_DownloadingSkins = 0;
+
+	// the skins are decoded on the job pool, their textures are created
+	// here as the jobs finish
 	SSkinScanUser SkinScanUser;
 	SkinScanUser.m_pThis = this;
-	SkinScanUser.m_SkinLoadedFunc = SkinLoadedFunc;
 	Storage()->ListDirectory(IStorage::TYPE_ALL, "skins", SkinScan, &SkinScanUser);
+	std::vector<std::shared_ptr<CSkinLoadJob>> &vpJobs = SkinScanUser.m_vpJobs;
+	while(!vpJobs.empty())
+	{
+		bool Finished = false;
+		for(auto It = vpJobs.begin(); It != vpJobs.end();)
+		{
+			if((*It)->Status() != IJob::STATE_DONE)
+			{
+				++It;
+				continue;
+			}
+			FinishSkinLoad(**It);
+			It = vpJobs.erase(It);
+			SkinLoadedFunc((int)m_Skins.size());
+			Finished = true;
+		}
+		if(!Finished)
+			std::this_thread::sleep_for(1ms);
+	}
+	if(g_Config.m_ClSkinCache > 0)
+		CSkinCacheData::Prune(Storage(), g_Config.m_ClSkinCache);
+
 	if(m_Skins.empty())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
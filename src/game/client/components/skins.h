@@ -5,8 +5,10 @@
 
 #include <base/system.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 #include <game/client/skin.h>
+#include <game/client/skin_cache.h>
 #include <string_view>
 #include <unordered_map>
 
@@ -77,14 +79,70 @@ public:
 		"twinbop", "twintri", "warpaint", "x_ninja", "x_spec"};
 
 private:
+	// skin image with the data computed from it, prepared off the main
+	// thread before the textures are created
+	class CSkinLoadData : public CSkinCacheData
+	{
+	public:
+		CImageInfo m_InfoGrayscale;
+
+		~CSkinLoadData();
+
+		// computes blood color and metrics from `m_Info`, returns false if
+		// the body does not fit into the image
+		bool ComputeMetrics();
+		// fills `m_InfoGrayscale` with the colorable variant of `m_Info`
+		void CreateGrayscale();
+		ColorRGBA BloodColor() const;
+	};
+
+	// Decodes a skin file and prepares its variants. With `UseCache`, the
+	// decoded image and its metrics are read from and written to the skin
+	// cache.
+	class CSkinLoadJob : public IJob
+	{
+	public:
+		enum
+		{
+			RESULT_LOAD_FAILED,
+			RESULT_NOT_RGBA,
+			RESULT_NOT_DIVISIBLE,
+			RESULT_INVALID,
+			RESULT_OK,
+		};
+
+		CSkinLoadJob(IStorage *pStorage, const char *pName, const char *pPath, int StorageType, bool UseCache);
+
+		char m_aName[24];
+		int m_Result = RESULT_LOAD_FAILED;
+		// size and format of the image as stored in the skin file, it is
+		// resized if it is not divisible into the sprite grid
+		CImageInfo m_Decoded;
+		CSkinLoadData m_Data;
+		// not set if the skin was loaded from the skin cache
+		int m_PngliteIncompatible = 0;
+
+	private:
+		IStorage *m_pStorage;
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		int m_StorageType;
+		bool m_UseCache;
+
+		void Run() override;
+		bool Decode(const void *pFileData, unsigned FileSize);
+	};
+
+	struct SSkinScanUser;
+
 	std::unordered_map<std::string_view, std::unique_ptr<CSkin>> m_Skins;
 	std::unordered_map<std::string_view, std::unique_ptr<CDownloadSkin>> m_DownloadSkins;
 	size_t m_DownloadingSkins = 0;
 	char m_aEventSkinPrefix[24];
 
 	bool LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType);
-	const CSkin *LoadSkin(const char *pName, const char *pPath, int DirType);
 	const CSkin *LoadSkin(const char *pName, CImageInfo &Info);
+	const CSkin *LoadSkin(const char *pName, CSkinLoadData &Data);
+	void FinishSkinLoad(CSkinLoadJob &Job);
 	const CSkin *FindImpl(const char *pName);
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
 };
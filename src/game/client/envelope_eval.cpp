@@ -0,0 +1,499 @@
+#include "envelope_eval.h"
+
+#include <base/math.h>
+#include <base/vmath.h>
+
+#include <engine/map.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/map.h>
+
+#include <game/mapitems.h>
+#include <game/mapitems_ex.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std::chrono_literals;
+
+CMapBasedEnvelopePointAccess::CMapBasedEnvelopePointAccess(CDataFileReader *pReader)
+{
+	bool FoundBezierEnvelope = false;
+	int EnvStart, EnvNum;
+	pReader->GetType(MAPITEMTYPE_ENVELOPE, &EnvStart, &EnvNum);
+	for(int EnvIndex = 0; EnvIndex < EnvNum; EnvIndex++)
+	{
+		CMapItemEnvelope *pEnvelope = static_cast<CMapItemEnvelope *>(pReader->GetItem(EnvStart + EnvIndex));
+		if(pEnvelope->m_Version >= CMapItemEnvelope_v3::CURRENT_VERSION)
+		{
+			FoundBezierEnvelope = true;
+			break;
+		}
+	}
+
+	if(FoundBezierEnvelope)
+	{
+		m_pPoints = nullptr;
+		m_pPointsBezier = nullptr;
+
+		int EnvPointStart, FakeEnvPointNum;
+		pReader->GetType(MAPITEMTYPE_ENVPOINTS, &EnvPointStart, &FakeEnvPointNum);
+		if(FakeEnvPointNum > 0)
+			m_pPointsBezierUpstream = static_cast<CEnvPointBezier_upstream *>(pReader->GetItem(EnvPointStart));
+		else
+			m_pPointsBezierUpstream = nullptr;
+
+		m_NumPointsMax = pReader->GetItemSize(EnvPointStart) / sizeof(CEnvPointBezier_upstream);
+	}
+	else
+	{
+		int EnvPointStart, FakeEnvPointNum;
+		pReader->GetType(MAPITEMTYPE_ENVPOINTS, &EnvPointStart, &FakeEnvPointNum);
+		if(FakeEnvPointNum > 0)
+			m_pPoints = static_cast<CEnvPoint *>(pReader->GetItem(EnvPointStart));
+		else
+			m_pPoints = nullptr;
+
+		m_NumPointsMax = pReader->GetItemSize(EnvPointStart) / sizeof(CEnvPoint);
+
+		int EnvPointBezierStart, FakeEnvPointBezierNum;
+		pReader->GetType(MAPITEMTYPE_ENVPOINTS_BEZIER, &EnvPointBezierStart, &FakeEnvPointBezierNum);
+		const int NumPointsBezier = pReader->GetItemSize(EnvPointBezierStart) / sizeof(CEnvPointBezier);
+		if(FakeEnvPointBezierNum > 0 && m_NumPointsMax == NumPointsBezier)
+			m_pPointsBezier = static_cast<CEnvPointBezier *>(pReader->GetItem(EnvPointBezierStart));
+		else
+			m_pPointsBezier = nullptr;
+
+		m_pPointsBezierUpstream = nullptr;
+	}
+
+	SetPointsRange(0, m_NumPointsMax);
+}
+
+CMapBasedEnvelopePointAccess::CMapBasedEnvelopePointAccess(IMap *pMap) :
+	CMapBasedEnvelopePointAccess(static_cast<CMap *>(pMap)->GetReader())
+{
+}
+
+void CMapBasedEnvelopePointAccess::SetPointsRange(int StartPoint, int NumPoints)
+{
+	m_StartPoint = clamp(StartPoint, 0, m_NumPointsMax);
+	m_NumPoints = clamp(NumPoints, 0, maximum(m_NumPointsMax - StartPoint, 0));
+}
+
+int CMapBasedEnvelopePointAccess::StartPoint() const
+{
+	return m_StartPoint;
+}
+
+int CMapBasedEnvelopePointAccess::NumPoints() const
+{
+	return m_NumPoints;
+}
+
+int CMapBasedEnvelopePointAccess::NumPointsMax() const
+{
+	return m_NumPointsMax;
+}
+
+const CEnvPoint *CMapBasedEnvelopePointAccess::GetPoint(int Index) const
+{
+	if(Index < 0 || Index >= m_NumPoints)
+		return nullptr;
+	if(m_pPoints != nullptr)
+		return &m_pPoints[Index + m_StartPoint];
+	if(m_pPointsBezierUpstream != nullptr)
+		return &m_pPointsBezierUpstream[Index + m_StartPoint];
+	return nullptr;
+}
+
+const CEnvPointBezier *CMapBasedEnvelopePointAccess::GetBezier(int Index) const
+{
+	if(Index < 0 || Index >= m_NumPoints)
+		return nullptr;
+	if(m_pPointsBezier != nullptr)
+		return &m_pPointsBezier[Index + m_StartPoint];
+	if(m_pPointsBezierUpstream != nullptr)
+		return &m_pPointsBezierUpstream[Index + m_StartPoint].m_Bezier;
+	return nullptr;
+}
+
+static void ValidateFCurve(const vec2 &p0, vec2 &p1, vec2 &p2, const vec2 &p3)
+{
+	// validate the bezier curve
+	p1.x = clamp(p1.x, p0.x, p3.x);
+	p2.x = clamp(p2.x, p0.x, p3.x);
+}
+
+static double CubicRoot(double x)
+{
+	if(x == 0.0)
+		return 0.0;
+	else if(x < 0.0)
+		return -std::exp(std::log(-x) / 3.0);
+	else
+		return std::exp(std::log(x) / 3.0);
+}
+
+static float SolveBezier(float x, float p0, float p1, float p2, float p3)
+{
+	// check for valid f-curve
+	// we only take care of monotonic bezier curves, so there has to be exactly 1 real solution
+	if(!(p0 <= x && x <= p3) || !(p0 <= p1 && p1 <= p3) || !(p0 <= p2 && p2 <= p3))
+		return 0.0f;
+
+	const double x3 = -p0 + 3.0 * p1 - 3.0 * p2 + p3;
+	const double x2 = 3.0 * p0 - 6.0 * p1 + 3.0 * p2;
+	const double x1 = -3.0 * p0 + 3.0 * p1;
+	const double x0 = p0 - x;
+
+	if(x3 == 0.0 && x2 == 0.0)
+	{
+		// linear
+		// a * t + b = 0
+		const double a = x1;
+		const double b = x0;
+
+		if(a == 0.0)
+			return 0.0f;
+		return -b / a;
+	}
+	else if(x3 == 0.0)
+	{
+		// quadratic
+		// t * t + b * t +c = 0
+		const double b = x1 / x2;
+		const double c = x0 / x2;
+
+		if(c == 0.0)
+			return 0.0f;
+
+		const double D = b * b - 4.0 * c;
+		const double SqrtD = std::sqrt(D);
+
+		const double t = (-b + SqrtD) / 2.0;
+
+		if(0.0 <= t && t <= 1.0001f)
+			return t;
+		return (-b - SqrtD) / 2.0;
+	}
+	else
+	{
+		// cubic
+		// t * t * t + a * t * t + b * t * t + c = 0
+		const double a = x2 / x3;
+		const double b = x1 / x3;
+		const double c = x0 / x3;
+
+		// substitute t = y - a / 3
+		const double sub = a / 3.0;
+
+		// depressed form x^3 + px + q = 0
+		// cardano's method
+		const double p = b / 3.0 - a * a / 9.0;
+		const double q = (2.0 * a * a * a / 27.0 - a * b / 3.0 + c) / 2.0;
+
+		const double D = q * q + p * p * p;
+
+		if(D > 0.0)
+		{
+			// only one 'real' solution
+			const double s = std::sqrt(D);
+			return CubicRoot(s - q) - CubicRoot(s + q) - sub;
+		}
+		else if(D == 0.0)
+		{
+			// one single, one double solution or triple solution
+			const double s = CubicRoot(-q);
+			const double t = 2.0 * s - sub;
+
+			if(0.0 <= t && t <= 1.0001f)
+				return t;
+			return (-s - sub);
+		}
+		else
+		{
+			// Casus irreductibilis ... ,_,
+			const double phi = std::acos(-q / std::sqrt(-(p * p * p))) / 3.0;
+			const double s = 2.0 * std::sqrt(-p);
+
+			const double t1 = s * std::cos(phi) - sub;
+
+			if(0.0 <= t1 && t1 <= 1.0001f)
+				return t1;
+
+			const double t2 = -s * std::cos(phi + pi / 3.0) - sub;
+
+			if(0.0 <= t2 && t2 <= 1.0001f)
+				return t2;
+			return -s * std::cos(phi - pi / 3.0) - sub;
+		}
+	}
+}
+
+
+static float ApplyCurve(int Curvetype, float a)
+{
+	switch(Curvetype)
+	{
+	case CURVETYPE_STEP:
+		return 0.0f;
+
+	case CURVETYPE_SLOW:
+		return a * a * a;
+
+	case CURVETYPE_FAST:
+		a = 1.0f - a;
+		return 1.0f - a * a * a;
+
+	case CURVETYPE_SMOOTH:
+		return -2.0f * a * a * a + 3.0f * a * a; // second hermite basis
+
+	case CURVETYPE_LINEAR: [[fallthrough]];
+	default:
+		return a;
+	}
+}
+
+static float EvalBezierSegment(const CEnvPoint *pCurrentPoint, const CEnvPoint *pNextPoint, const CEnvPointBezier *pCurrentPointBezier, const CEnvPointBezier *pNextPointBezier, int Channel, double TimeMillis)
+{
+	// monotonic 2d cubic bezier curve
+	const vec2 p0 = vec2(pCurrentPoint->m_Time / 1000.0f, fx2f(pCurrentPoint->m_aValues[Channel]));
+	const vec2 p3 = vec2(pNextPoint->m_Time / 1000.0f, fx2f(pNextPoint->m_aValues[Channel]));
+
+	const vec2 OutTang = vec2(pCurrentPointBezier->m_aOutTangentDeltaX[Channel] / 1000.0f, fx2f(pCurrentPointBezier->m_aOutTangentDeltaY[Channel]));
+	const vec2 InTang = -vec2(pNextPointBezier->m_aInTangentDeltaX[Channel] / 1000.0f, fx2f(pNextPointBezier->m_aInTangentDeltaY[Channel]));
+	vec2 p1 = p0 + OutTang;
+	vec2 p2 = p3 - InTang;
+
+	// validate bezier curve
+	ValidateFCurve(p0, p1, p2, p3);
+
+	// solve x(a) = time for a
+	const float a = clamp(SolveBezier(TimeMillis / 1000.0f, p0.x, p1.x, p2.x, p3.x), 0.0f, 1.0f);
+
+	// value = y(t)
+	return bezier(p0.y, p1.y, p2.y, p3.y, a);
+}
+
+void EvalEnvelope(const IEnvelopePointAccess *pPoints, int Channels, std::chrono::nanoseconds TimeNanos, ColorRGBA &Result)
+{
+	const int NumPoints = pPoints->NumPoints();
+	if(NumPoints == 0)
+	{
+		Result = ColorRGBA();
+		return;
+	}
+
+	if(NumPoints == 1)
+	{
+		const CEnvPoint *pFirstPoint = pPoints->GetPoint(0);
+		Result.r = fx2f(pFirstPoint->m_aValues[0]);
+		Result.g = fx2f(pFirstPoint->m_aValues[1]);
+		Result.b = fx2f(pFirstPoint->m_aValues[2]);
+		Result.a = fx2f(pFirstPoint->m_aValues[3]);
+		return;
+	}
+
+	const CEnvPoint *pLastPoint = pPoints->GetPoint(NumPoints - 1);
+	const int64_t MaxPointTime = (int64_t)pLastPoint->m_Time * std::chrono::nanoseconds(1ms).count();
+	if(MaxPointTime > 0) // TODO: remove this check when implementing a IO check for maps(in this case broken envelopes)
+		TimeNanos = std::chrono::nanoseconds(TimeNanos.count() % MaxPointTime);
+	else
+		TimeNanos = decltype(TimeNanos)::zero();
+
+	const double TimeMillis = TimeNanos.count() / (double)std::chrono::nanoseconds(1ms).count();
+	for(int i = 0; i < NumPoints - 1; i++)
+	{
+		const CEnvPoint *pCurrentPoint = pPoints->GetPoint(i);
+		const CEnvPoint *pNextPoint = pPoints->GetPoint(i + 1);
+		if(TimeMillis >= pCurrentPoint->m_Time && TimeMillis <= pNextPoint->m_Time)
+		{
+			if(pCurrentPoint->m_Curvetype == CURVETYPE_BEZIER)
+			{
+				const CEnvPointBezier *pCurrentPointBezier = pPoints->GetBezier(i);
+				const CEnvPointBezier *pNextPointBezier = pPoints->GetBezier(i + 1);
+				if(pCurrentPointBezier != nullptr && pNextPointBezier != nullptr)
+				{
+					for(int c = 0; c < Channels; c++)
+						Result[c] = EvalBezierSegment(pCurrentPoint, pNextPoint, pCurrentPointBezier, pNextPointBezier, c, TimeMillis);
+					return;
+				}
+				// fallback to linear
+			}
+
+			const float Delta = pNextPoint->m_Time - pCurrentPoint->m_Time;
+			const float a = ApplyCurve(pCurrentPoint->m_Curvetype, (float)(TimeMillis - pCurrentPoint->m_Time) / Delta);
+			for(int c = 0; c < Channels; c++)
+			{
+				const float v0 = fx2f(pCurrentPoint->m_aValues[c]);
+				const float v1 = fx2f(pNextPoint->m_aValues[c]);
+				Result[c] = v0 + (v1 - v0) * a;
+			}
+
+			return;
+		}
+	}
+
+	Result.r = fx2f(pLastPoint->m_aValues[0]);
+	Result.g = fx2f(pLastPoint->m_aValues[1]);
+	Result.b = fx2f(pLastPoint->m_aValues[2]);
+	Result.a = fx2f(pLastPoint->m_aValues[3]);
+}
+
+bool CEnvelopeTable::Bake(const IEnvelopePointAccess *pPoints, int Channels)
+{
+	m_Valid = false;
+	m_Channels = Channels;
+	m_vPoints.clear();
+	m_vSamples.clear();
+
+	const int NumPoints = pPoints->NumPoints();
+	m_vPoints.reserve(NumPoints);
+	for(int i = 0; i < NumPoints; i++)
+	{
+		const CEnvPoint *pPoint = pPoints->GetPoint(i);
+		// the segment is found with a binary search
+		if(i > 0 && pPoint->m_Time < m_vPoints.back().m_Time)
+			return false;
+
+		SPoint Point;
+		Point.m_Time = pPoint->m_Time;
+		Point.m_Curvetype = pPoint->m_Curvetype;
+		for(int c = 0; c < CEnvPoint::MAX_CHANNELS; c++)
+			Point.m_aValues[c] = fx2f(pPoint->m_aValues[c]);
+		Point.m_FirstSample = -1;
+		Point.m_NumSamples = 0;
+		m_vPoints.push_back(Point);
+	}
+
+	std::vector<float> vSegment;
+	std::vector<float> vMidpoints;
+	for(int i = 0; i < NumPoints - 1; i++)
+	{
+		SPoint &Point = m_vPoints[i];
+		if(Point.m_Curvetype != CURVETYPE_BEZIER)
+			continue;
+
+		const CEnvPoint *pCurrentPoint = pPoints->GetPoint(i);
+		const CEnvPoint *pNextPoint = pPoints->GetPoint(i + 1);
+		const CEnvPointBezier *pCurrentPointBezier = pPoints->GetBezier(i);
+		const CEnvPointBezier *pNextPointBezier = pPoints->GetBezier(i + 1);
+		if(pCurrentPointBezier == nullptr || pNextPointBezier == nullptr)
+		{
+			Point.m_Curvetype = CURVETYPE_LINEAR;
+			continue;
+		}
+		const int Delta = pNextPoint->m_Time - pCurrentPoint->m_Time;
+		if(Delta == 0)
+			return false;
+
+		// the samples must not be further off the curve than this
+		float aTolerance[CEnvPoint::MAX_CHANNELS];
+		for(int c = 0; c < Channels; c++)
+			aTolerance[c] = maximum(1.0f, std::fabs(Point.m_aValues[c]), std::fabs(m_vPoints[i + 1].m_aValues[c])) / 2048.0f;
+
+		// double the samples until the linear interpolation between them is
+		// close enough to the curve in the middle between each of them
+		int NumSamples = MIN_SEGMENT_SAMPLES;
+		vSegment.resize((NumSamples + 1) * Channels);
+		for(int s = 0; s <= NumSamples; s++)
+		{
+			const double TimeMillis = pCurrentPoint->m_Time + Delta * (double)s / NumSamples;
+			for(int c = 0; c < Channels; c++)
+				vSegment[s * Channels + c] = EvalBezierSegment(pCurrentPoint, pNextPoint, pCurrentPointBezier, pNextPointBezier, c, TimeMillis);
+		}
+		while(NumSamples < MAX_SEGMENT_SAMPLES)
+		{
+			bool CloseEnough = true;
+			vMidpoints.resize(NumSamples * Channels);
+			for(int s = 0; s < NumSamples; s++)
+			{
+				const double TimeMillis = pCurrentPoint->m_Time + Delta * (s + 0.5) / NumSamples;
+				for(int c = 0; c < Channels; c++)
+				{
+					const float Value = EvalBezierSegment(pCurrentPoint, pNextPoint, pCurrentPointBezier, pNextPointBezier, c, TimeMillis);
+					const float Interpolated = (vSegment[s * Channels + c] + vSegment[(s + 1) * Channels + c]) / 2.0f;
+					if(std::fabs(Value - Interpolated) > aTolerance[c])
+						CloseEnough = false;
+					vMidpoints[s * Channels + c] = Value;
+				}
+			}
+			if(CloseEnough)
+				break;
+
+			std::vector<float> vRefined;
+			vRefined.reserve((2 * NumSamples + 1) * Channels);
+			for(int s = 0; s < NumSamples; s++)
+			{
+				vRefined.insert(vRefined.end(), vSegment.begin() + s * Channels, vSegment.begin() + (s + 1) * Channels);
+				vRefined.insert(vRefined.end(), vMidpoints.begin() + s * Channels, vMidpoints.begin() + (s + 1) * Channels);
+			}
+			vRefined.insert(vRefined.end(), vSegment.end() - Channels, vSegment.end());
+			vSegment.swap(vRefined);
+			NumSamples *= 2;
+		}
+
+		Point.m_FirstSample = m_vSamples.size() / Channels;
+		Point.m_NumSamples = NumSamples;
+		m_vSamples.insert(m_vSamples.end(), vSegment.begin(), vSegment.end());
+	}
+
+	m_vSamples.shrink_to_fit();
+	m_Valid = true;
+	return true;
+}
+
+void CEnvelopeTable::Eval(std::chrono::nanoseconds TimeNanos, ColorRGBA &Result) const
+{
+	const int NumPoints = m_vPoints.size();
+	if(NumPoints == 0)
+	{
+		Result = ColorRGBA();
+		return;
+	}
+
+	if(NumPoints == 1)
+	{
+		Result = ColorRGBA(m_vPoints[0].m_aValues[0], m_vPoints[0].m_aValues[1], m_vPoints[0].m_aValues[2], m_vPoints[0].m_aValues[3]);
+		return;
+	}
+
+	const SPoint &LastPoint = m_vPoints.back();
+	const int64_t MaxPointTime = (int64_t)LastPoint.m_Time * std::chrono::nanoseconds(1ms).count();
+	if(MaxPointTime > 0)
+		TimeNanos = std::chrono::nanoseconds(TimeNanos.count() % MaxPointTime);
+	else
+		TimeNanos = decltype(TimeNanos)::zero();
+
+	// the first segment ending at or after the time, like the linear search
+	// of `EvalEnvelope` finds it
+	const double TimeMillis = TimeNanos.count() / (double)std::chrono::nanoseconds(1ms).count();
+	const auto pNextPoint = std::lower_bound(m_vPoints.begin() + 1, m_vPoints.end(), TimeMillis, [](const SPoint &Point, double Time) { return Point.m_Time < Time; });
+	if(pNextPoint == m_vPoints.end() || TimeMillis < (pNextPoint - 1)->m_Time)
+	{
+		Result = ColorRGBA(LastPoint.m_aValues[0], LastPoint.m_aValues[1], LastPoint.m_aValues[2], LastPoint.m_aValues[3]);
+		return;
+	}
+	const SPoint &CurrentPoint = *(pNextPoint - 1);
+	const SPoint &NextPoint = *pNextPoint;
+
+	if(CurrentPoint.m_FirstSample >= 0)
+	{
+		const float Pos = (float)(TimeMillis - CurrentPoint.m_Time) / (NextPoint.m_Time - CurrentPoint.m_Time) * CurrentPoint.m_NumSamples;
+		const int Sample = clamp((int)Pos, 0, CurrentPoint.m_NumSamples - 1);
+		const float Fraction = Pos - Sample;
+		const float *pSample = &m_vSamples[(CurrentPoint.m_FirstSample + Sample) * m_Channels];
+		for(int c = 0; c < m_Channels; c++)
+			Result[c] = mix(pSample[c], pSample[m_Channels + c], Fraction);
+		return;
+	}
+
+	const float Delta = NextPoint.m_Time - CurrentPoint.m_Time;
+	const float a = ApplyCurve(CurrentPoint.m_Curvetype, (float)(TimeMillis - CurrentPoint.m_Time) / Delta);
+	for(int c = 0; c < m_Channels; c++)
+	{
+		const float v0 = CurrentPoint.m_aValues[c];
+		const float v1 = NextPoint.m_aValues[c];
+		Result[c] = v0 + (v1 - v0) * a;
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef GAME_CLIENT_ENVELOPE_EVAL_H
+#define GAME_CLIENT_ENVELOPE_EVAL_H
+
+#include <base/color.h>
+
+#include <chrono>
+#include <vector>
+
+class CDataFileReader;
+class IMap;
+struct CEnvPoint;
+struct CEnvPointBezier;
+struct CEnvPointBezier_upstream;
+
+class IEnvelopePointAccess
+{
+public:
+	virtual ~IEnvelopePointAccess() = default;
+	virtual int NumPoints() const = 0;
+	virtual const CEnvPoint *GetPoint(int Index) const = 0;
+	virtual const CEnvPointBezier *GetBezier(int Index) const = 0;
+};
+
+class CMapBasedEnvelopePointAccess : public IEnvelopePointAccess
+{
+	int m_StartPoint;
+	int m_NumPoints;
+	int m_NumPointsMax;
+	CEnvPoint *m_pPoints;
+	CEnvPointBezier *m_pPointsBezier;
+	CEnvPointBezier_upstream *m_pPointsBezierUpstream;
+
+public:
+	CMapBasedEnvelopePointAccess(CDataFileReader *pReader);
+	CMapBasedEnvelopePointAccess(IMap *pMap);
+	void SetPointsRange(int StartPoint, int NumPoints);
+	int StartPoint() const;
+	int NumPoints() const override;
+	int NumPointsMax() const;
+	const CEnvPoint *GetPoint(int Index) const override;
+	const CEnvPointBezier *GetBezier(int Index) const override;
+};
+
+void EvalEnvelope(const IEnvelopePointAccess *pPoints, int Channels, std::chrono::nanoseconds TimeNanos, ColorRGBA &Result);
+
+// Envelope baked at map load, so evaluating it doesn't need to solve the
+// bezier curves again every frame.
+//
+// Bezier segments are sampled with as many samples as needed to get close
+// to the exact curve and interpolated linearly between them. All other
+// curve types are cheap and evaluated exactly, the same way as
+// `EvalEnvelope` does, so step curves still jump at the exact point times.
+class CEnvelopeTable
+{
+public:
+	enum
+	{
+		MIN_SEGMENT_SAMPLES = 8,
+		MAX_SEGMENT_SAMPLES = 256,
+	};
+
+	// Returns false if the envelope can't be baked, e.g. because its points
+	// aren't sorted by time. `EvalEnvelope` has to be used for it then.
+	bool Bake(const IEnvelopePointAccess *pPoints, int Channels);
+	bool Valid() const { return m_Valid; }
+	// gives the same results as `EvalEnvelope` on the baked points, apart
+	// from the bezier segments which are within a small tolerance
+	void Eval(std::chrono::nanoseconds TimeNanos, ColorRGBA &Result) const;
+
+	int NumSamples() const { return m_Channels > 0 ? m_vSamples.size() / m_Channels : 0; }
+
+private:
+	struct SPoint
+	{
+		int m_Time;
+		int m_Curvetype;
+		float m_aValues[4];
+		// index of the first sample of a bezier segment starting at this
+		// point, -1 if it isn't sampled
+		int m_FirstSample;
+		int m_NumSamples;
+	};
+
+	bool m_Valid = false;
+	int m_Channels = 0;
+	std::vector<SPoint> m_vPoints;
+	std::vector<float> m_vSamples;
+};
+
+#endif
@@ -0,0 +1,665 @@
+#include "layer_visuals.h"
+
+#include <base/system.h>
+
+#include <engine/graphics.h>
+#include <engine/shared/uuid_manager.h>
+#include <engine/storage.h>
+
+#include <game/mapitems.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+static void FillTmpTile(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, unsigned char Flags, unsigned char Index, int x, int y, const ivec2 &Offset, int Scale)
+{
+	if(pTmpTex)
+	{
+		unsigned char x0 = 0;
+		unsigned char y0 = 0;
+		unsigned char x1 = x0 + 1;
+		unsigned char y1 = y0;
+		unsigned char x2 = x0 + 1;
+		unsigned char y2 = y0 + 1;
+		unsigned char x3 = x0;
+		unsigned char y3 = y0 + 1;
+
+		if(Flags & TILEFLAG_XFLIP)
+		{
+			x0 = x2;
+			x1 = x3;
+			x2 = x3;
+			x3 = x0;
+		}
+
+		if(Flags & TILEFLAG_YFLIP)
+		{
+			y0 = y3;
+			y2 = y1;
+			y3 = y1;
+			y1 = y0;
+		}
+
+		if(Flags & TILEFLAG_ROTATE)
+		{
+			unsigned char Tmp = x0;
+			x0 = x3;
+			x3 = x2;
+			x2 = x1;
+			x1 = Tmp;
+			Tmp = y0;
+			y0 = y3;
+			y3 = y2;
+			y2 = y1;
+			y1 = Tmp;
+		}
+
+		pTmpTex->m_TexCoordTopLeft.x = x0;
+		pTmpTex->m_TexCoordTopLeft.y = y0;
+		pTmpTex->m_TexCoordBottomLeft.x = x3;
+		pTmpTex->m_TexCoordBottomLeft.y = y3;
+		pTmpTex->m_TexCoordTopRight.x = x1;
+		pTmpTex->m_TexCoordTopRight.y = y1;
+		pTmpTex->m_TexCoordBottomRight.x = x2;
+		pTmpTex->m_TexCoordBottomRight.y = y2;
+
+		pTmpTex->m_TexCoordTopLeft.z = Index;
+		pTmpTex->m_TexCoordBottomLeft.z = Index;
+		pTmpTex->m_TexCoordTopRight.z = Index;
+		pTmpTex->m_TexCoordBottomRight.z = Index;
+
+		bool HasRotation = (Flags & TILEFLAG_ROTATE) != 0;
+		pTmpTex->m_TexCoordTopLeft.w = HasRotation;
+		pTmpTex->m_TexCoordBottomLeft.w = HasRotation;
+		pTmpTex->m_TexCoordTopRight.w = HasRotation;
+		pTmpTex->m_TexCoordBottomRight.w = HasRotation;
+	}
+
+	pTmpTile->m_TopLeft.x = x * Scale + Offset.x;
+	pTmpTile->m_TopLeft.y = y * Scale + Offset.y;
+	pTmpTile->m_BottomLeft.x = x * Scale + Offset.x;
+	pTmpTile->m_BottomLeft.y = y * Scale + Scale + Offset.y;
+	pTmpTile->m_TopRight.x = x * Scale + Scale + Offset.x;
+	pTmpTile->m_TopRight.y = y * Scale + Offset.y;
+	pTmpTile->m_BottomRight.x = x * Scale + Scale + Offset.x;
+	pTmpTile->m_BottomRight.y = y * Scale + Scale + Offset.y;
+}
+
+static void FillTmpTileSpeedup(SGraphicTile *pTmpTile, SGraphicTileTexureCoords *pTmpTex, unsigned char Flags, unsigned char Index, int x, int y, const ivec2 &Offset, int Scale, short AngleRotate)
+{
+	int Angle = AngleRotate % 360;
+	FillTmpTile(pTmpTile, pTmpTex, Angle >= 270 ? ROTATION_270 : (Angle >= 180 ? ROTATION_180 : (Angle >= 90 ? ROTATION_90 : 0)), AngleRotate % 90, x, y, Offset, Scale);
+}
+
+bool STileLayerVisuals::Init(unsigned int Width, unsigned int Height)
+{
+	m_Width = Width;
+	m_Height = Height;
+	if(Width == 0 || Height == 0)
+		return false;
+	if constexpr(sizeof(unsigned int) >= sizeof(ptrdiff_t))
+		if(Width >= std::numeric_limits<std::ptrdiff_t>::max() || Height >= std::numeric_limits<std::ptrdiff_t>::max())
+			return false;
+
+	m_pTilesOfLayer = new STileLayerVisuals::STileVisual[Height * Width];
+
+	m_vBorderTop.resize(Width);
+	m_vBorderBottom.resize(Width);
+
+	m_vBorderLeft.resize(Height);
+	m_vBorderRight.resize(Height);
+	return true;
+}
+
+STileLayerVisuals::~STileLayerVisuals()
+{
+	delete[] m_pTilesOfLayer;
+
+	m_pTilesOfLayer = NULL;
+}
+
+static bool AddTile(std::vector<SGraphicTile> &vTmpTiles, std::vector<SGraphicTileTexureCoords> &vTmpTileTexCoords, unsigned char Index, unsigned char Flags, int x, int y, bool DoTextureCoords, bool FillSpeedup = false, int AngleRotate = -1, const ivec2 &Offset = ivec2{0, 0}, int Scale = 32)
+{
+	if(Index)
+	{
+		vTmpTiles.emplace_back();
+		SGraphicTile &Tile = vTmpTiles.back();
+		SGraphicTileTexureCoords *pTileTex = NULL;
+		if(DoTextureCoords)
+		{
+			vTmpTileTexCoords.emplace_back();
+			SGraphicTileTexureCoords &TileTex = vTmpTileTexCoords.back();
+			pTileTex = &TileTex;
+		}
+		if(FillSpeedup)
+			FillTmpTileSpeedup(&Tile, pTileTex, Flags, 0, x, y, Offset, Scale, AngleRotate);
+		else
+			FillTmpTile(&Tile, pTileTex, Flags, Index, x, y, Offset, Scale);
+
+		return true;
+	}
+	return false;
+}
+
+static void mem_copy_special(void *pDest, void *pSource, size_t Size, size_t Count, size_t Steps)
+{
+	size_t CurStep = 0;
+	for(size_t i = 0; i < Count; ++i)
+	{
+		mem_copy(((char *)pDest) + CurStep + i * Size, ((char *)pSource) + i * Size, Size);
+		CurStep += Steps;
+	}
+}
+
+int STileLayerSource::NumOverlays(int Type)
+{
+	switch(Type)
+	{
+	case TYPE_SWITCH: return 2;
+	case TYPE_TELE: return 1;
+	case TYPE_SPEEDUP: return 2;
+	default: return 0;
+	}
+}
+
+void PrepareTileLayerVisuals(STileLayerVisuals &Visuals, const STileLayerSource &Source, SPreparedLayerVertices *pVertices)
+{
+	const bool DoTextureCoords = Source.m_DoTextureCoords;
+	const bool IsEntityLayer = Source.m_Type != STileLayerSource::TYPE_DESIGN;
+	const bool IsGameLayer = Source.m_Type == STileLayerSource::TYPE_GAME;
+	const bool IsFrontLayer = Source.m_Type == STileLayerSource::TYPE_FRONT;
+	const bool IsSwitchLayer = Source.m_Type == STileLayerSource::TYPE_SWITCH;
+	const bool IsTeleLayer = Source.m_Type == STileLayerSource::TYPE_TELE;
+	const bool IsSpeedupLayer = Source.m_Type == STileLayerSource::TYPE_SPEEDUP;
+	const bool IsTuneLayer = Source.m_Type == STileLayerSource::TYPE_TUNE;
+	const int CurOverlay = Source.m_Overlay;
+	const void *pTiles = Source.m_pTiles;
+
+	std::vector<SGraphicTile> vtmpTiles;
+	std::vector<SGraphicTileTexureCoords> vtmpTileTexCoords;
+	std::vector<SGraphicTile> vtmpBorderTopTiles;
+	std::vector<SGraphicTileTexureCoords> vtmpBorderTopTilesTexCoords;
+	std::vector<SGraphicTile> vtmpBorderLeftTiles;
+	std::vector<SGraphicTileTexureCoords> vtmpBorderLeftTilesTexCoords;
+	std::vector<SGraphicTile> vtmpBorderRightTiles;
+	std::vector<SGraphicTileTexureCoords> vtmpBorderRightTilesTexCoords;
+	std::vector<SGraphicTile> vtmpBorderBottomTiles;
+	std::vector<SGraphicTileTexureCoords> vtmpBorderBottomTilesTexCoords;
+	std::vector<SGraphicTile> vtmpBorderCorners;
+	std::vector<SGraphicTileTexureCoords> vtmpBorderCornersTexCoords;
+
+	// every tile can be drawn, the textured layers also need the texture
+	// coordinates
+	vtmpTiles.reserve((size_t)Source.m_Width * Source.m_Height);
+	vtmpBorderTopTiles.reserve((size_t)Source.m_Width);
+	vtmpBorderBottomTiles.reserve((size_t)Source.m_Width);
+	vtmpBorderLeftTiles.reserve((size_t)Source.m_Height);
+	vtmpBorderRightTiles.reserve((size_t)Source.m_Height);
+	vtmpBorderCorners.reserve((size_t)4);
+	if(DoTextureCoords)
+	{
+		vtmpTileTexCoords.reserve((size_t)Source.m_Width * Source.m_Height);
+		vtmpBorderTopTilesTexCoords.reserve((size_t)Source.m_Width);
+		vtmpBorderBottomTilesTexCoords.reserve((size_t)Source.m_Width);
+		vtmpBorderLeftTilesTexCoords.reserve((size_t)Source.m_Height);
+		vtmpBorderRightTilesTexCoords.reserve((size_t)Source.m_Height);
+		vtmpBorderCornersTexCoords.reserve((size_t)4);
+	}
+
+	int x = 0;
+	int y = 0;
+	for(y = 0; y < Source.m_Height; ++y)
+	{
+		for(x = 0; x < Source.m_Width; ++x)
+		{
+			unsigned char Index = 0;
+			unsigned char Flags = 0;
+			int AngleRotate = -1;
+			if(IsEntityLayer)
+			{
+				if(IsGameLayer)
+				{
+					Index = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Index;
+					Flags = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Flags;
+				}
+				if(IsFrontLayer)
+				{
+					Index = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Index;
+					Flags = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Flags;
+				}
+				if(IsSwitchLayer)
+				{
+					Flags = 0;
+					Index = ((const CSwitchTile *)pTiles)[y * Source.m_Width + x].m_Type;
+					if(CurOverlay == 0)
+					{
+						Flags = ((const CSwitchTile *)pTiles)[y * Source.m_Width + x].m_Flags;
+						if(Index == TILE_SWITCHTIMEDOPEN)
+							Index = 8;
+					}
+					else if(CurOverlay == 1)
+						Index = ((const CSwitchTile *)pTiles)[y * Source.m_Width + x].m_Number;
+					else if(CurOverlay == 2)
+						Index = ((const CSwitchTile *)pTiles)[y * Source.m_Width + x].m_Delay;
+				}
+				if(IsTeleLayer)
+				{
+					Index = ((const CTeleTile *)pTiles)[y * Source.m_Width + x].m_Type;
+					Flags = 0;
+					if(CurOverlay == 1)
+					{
+						if(IsTeleTileNumberUsed(Index))
+							Index = ((const CTeleTile *)pTiles)[y * Source.m_Width + x].m_Number;
+						else
+							Index = 0;
+					}
+				}
+				if(IsSpeedupLayer)
+				{
+					Index = ((const CSpeedupTile *)pTiles)[y * Source.m_Width + x].m_Type;
+					Flags = 0;
+					AngleRotate = ((const CSpeedupTile *)pTiles)[y * Source.m_Width + x].m_Angle;
+					if(((const CSpeedupTile *)pTiles)[y * Source.m_Width + x].m_Force == 0)
+						Index = 0;
+					else if(CurOverlay == 1)
+						Index = ((const CSpeedupTile *)pTiles)[y * Source.m_Width + x].m_Force;
+					else if(CurOverlay == 2)
+						Index = ((const CSpeedupTile *)pTiles)[y * Source.m_Width + x].m_MaxSpeed;
+				}
+				if(IsTuneLayer)
+				{
+					Index = ((const CTuneTile *)pTiles)[y * Source.m_Width + x].m_Type;
+					Flags = 0;
+				}
+			}
+			else
+			{
+				Index = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Index;
+				Flags = ((const CTile *)pTiles)[y * Source.m_Width + x].m_Flags;
+			}
+
+			//the amount of tiles handled before this tile
+			int TilesHandledCount = vtmpTiles.size();
+			Visuals.m_pTilesOfLayer[y * Source.m_Width + x].SetIndexBufferByteOffset((offset_ptr32)(TilesHandledCount));
+
+			bool AddAsSpeedup = false;
+			if(IsSpeedupLayer && CurOverlay == 0)
+				AddAsSpeedup = true;
+
+			if(AddTile(vtmpTiles, vtmpTileTexCoords, Index, Flags, x, y, DoTextureCoords, AddAsSpeedup, AngleRotate))
+				Visuals.m_pTilesOfLayer[y * Source.m_Width + x].Draw(true);
+
+			//do the border tiles
+			if(x == 0)
+			{
+				if(y == 0)
+				{
+					Visuals.m_BorderTopLeft.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
+					if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, -32}))
+						Visuals.m_BorderTopLeft.Draw(true);
+				}
+				else if(y == Source.m_Height - 1)
+				{
+					Visuals.m_BorderBottomLeft.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
+					if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, 0}))
+						Visuals.m_BorderBottomLeft.Draw(true);
+				}
+				Visuals.m_vBorderLeft[y].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderLeftTiles.size()));
+				if(AddTile(vtmpBorderLeftTiles, vtmpBorderLeftTilesTexCoords, Index, Flags, 0, y, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{-32, 0}))
+					Visuals.m_vBorderLeft[y].Draw(true);
+			}
+			else if(x == Source.m_Width - 1)
+			{
+				if(y == 0)
+				{
+					Visuals.m_BorderTopRight.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
+					if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, -32}))
+						Visuals.m_BorderTopRight.Draw(true);
+				}
+				else if(y == Source.m_Height - 1)
+				{
+					Visuals.m_BorderBottomRight.SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderCorners.size()));
+					if(AddTile(vtmpBorderCorners, vtmpBorderCornersTexCoords, Index, Flags, 0, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
+						Visuals.m_BorderBottomRight.Draw(true);
+				}
+				Visuals.m_vBorderRight[y].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderRightTiles.size()));
+				if(AddTile(vtmpBorderRightTiles, vtmpBorderRightTilesTexCoords, Index, Flags, 0, y, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
+					Visuals.m_vBorderRight[y].Draw(true);
+			}
+			if(y == 0)
+			{
+				Visuals.m_vBorderTop[x].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderTopTiles.size()));
+				if(AddTile(vtmpBorderTopTiles, vtmpBorderTopTilesTexCoords, Index, Flags, x, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, -32}))
+					Visuals.m_vBorderTop[x].Draw(true);
+			}
+			else if(y == Source.m_Height - 1)
+			{
+				Visuals.m_vBorderBottom[x].SetIndexBufferByteOffset((offset_ptr32)(vtmpBorderBottomTiles.size()));
+				if(AddTile(vtmpBorderBottomTiles, vtmpBorderBottomTilesTexCoords, Index, Flags, x, 0, DoTextureCoords, AddAsSpeedup, AngleRotate, ivec2{0, 0}))
+					Visuals.m_vBorderBottom[x].Draw(true);
+			}
+		}
+	}
+
+	//append one kill tile to the gamelayer
+	if(IsGameLayer)
+	{
+		Visuals.m_BorderKillTile.SetIndexBufferByteOffset((offset_ptr32)(vtmpTiles.size()));
+		if(AddTile(vtmpTiles, vtmpTileTexCoords, TILE_DEATH, 0, 0, 0, DoTextureCoords))
+			Visuals.m_BorderKillTile.Draw(true);
+	}
+
+	//add the border corners, then the borders and fix their byte offsets
+	int TilesHandledCount = vtmpTiles.size();
+	Visuals.m_BorderTopLeft.AddIndexBufferByteOffset(TilesHandledCount);
+	Visuals.m_BorderTopRight.AddIndexBufferByteOffset(TilesHandledCount);
+	Visuals.m_BorderBottomLeft.AddIndexBufferByteOffset(TilesHandledCount);
+	Visuals.m_BorderBottomRight.AddIndexBufferByteOffset(TilesHandledCount);
+	//add the Corners to the tiles
+	vtmpTiles.insert(vtmpTiles.end(), vtmpBorderCorners.begin(), vtmpBorderCorners.end());
+	vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderCornersTexCoords.begin(), vtmpBorderCornersTexCoords.end());
+
+	//now the borders
+	TilesHandledCount = vtmpTiles.size();
+	if(Source.m_Width > 0)
+	{
+		for(int i = 0; i < Source.m_Width; ++i)
+		{
+			Visuals.m_vBorderTop[i].AddIndexBufferByteOffset(TilesHandledCount);
+		}
+	}
+	vtmpTiles.insert(vtmpTiles.end(), vtmpBorderTopTiles.begin(), vtmpBorderTopTiles.end());
+	vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderTopTilesTexCoords.begin(), vtmpBorderTopTilesTexCoords.end());
+
+	TilesHandledCount = vtmpTiles.size();
+	if(Source.m_Width > 0)
+	{
+		for(int i = 0; i < Source.m_Width; ++i)
+		{
+			Visuals.m_vBorderBottom[i].AddIndexBufferByteOffset(TilesHandledCount);
+		}
+	}
+	vtmpTiles.insert(vtmpTiles.end(), vtmpBorderBottomTiles.begin(), vtmpBorderBottomTiles.end());
+	vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderBottomTilesTexCoords.begin(), vtmpBorderBottomTilesTexCoords.end());
+
+	TilesHandledCount = vtmpTiles.size();
+	if(Source.m_Height > 0)
+	{
+		for(int i = 0; i < Source.m_Height; ++i)
+		{
+			Visuals.m_vBorderLeft[i].AddIndexBufferByteOffset(TilesHandledCount);
+		}
+	}
+	vtmpTiles.insert(vtmpTiles.end(), vtmpBorderLeftTiles.begin(), vtmpBorderLeftTiles.end());
+	vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderLeftTilesTexCoords.begin(), vtmpBorderLeftTilesTexCoords.end());
+
+	TilesHandledCount = vtmpTiles.size();
+	if(Source.m_Height > 0)
+	{
+		for(int i = 0; i < Source.m_Height; ++i)
+		{
+			Visuals.m_vBorderRight[i].AddIndexBufferByteOffset(TilesHandledCount);
+		}
+	}
+	vtmpTiles.insert(vtmpTiles.end(), vtmpBorderRightTiles.begin(), vtmpBorderRightTiles.end());
+	vtmpTileTexCoords.insert(vtmpTileTexCoords.end(), vtmpBorderRightTilesTexCoords.begin(), vtmpBorderRightTilesTexCoords.end());
+
+	//setup params
+	float *pTmpTiles = vtmpTiles.empty() ? NULL : (float *)vtmpTiles.data();
+	unsigned char *pTmpTileTexCoords = vtmpTileTexCoords.empty() ? NULL : (unsigned char *)vtmpTileTexCoords.data();
+
+	pVertices->m_pData = nullptr;
+	pVertices->m_DataSize = vtmpTileTexCoords.size() * sizeof(SGraphicTileTexureCoords) + vtmpTiles.size() * sizeof(SGraphicTile);
+	pVertices->m_NumQuads = vtmpTiles.size();
+	if(pVertices->m_DataSize > 0)
+	{
+		char *pUploadData = (char *)malloc(sizeof(char) * pVertices->m_DataSize);
+
+		mem_copy_special(pUploadData, pTmpTiles, sizeof(vec2), vtmpTiles.size() * 4, (DoTextureCoords ? sizeof(ubvec4) : 0));
+		if(DoTextureCoords)
+		{
+			mem_copy_special(pUploadData + sizeof(vec2), pTmpTileTexCoords, sizeof(ubvec4), vtmpTiles.size() * 4, sizeof(vec2));
+		}
+		pVertices->m_pData = pUploadData;
+	}
+}
+
+void PrepareQuadLayerVertices(const CQuad *pQuads, int NumQuads, bool Textured, SPreparedLayerVertices *pVertices)
+{
+	pVertices->m_NumQuads = NumQuads;
+	pVertices->m_DataSize = NumQuads * (Textured ? sizeof(STmpQuadTextured) : sizeof(STmpQuad));
+	pVertices->m_pData = nullptr;
+	if(pVertices->m_DataSize == 0)
+		return;
+	pVertices->m_pData = malloc(pVertices->m_DataSize);
+
+	STmpQuad *pTmpQuads = (STmpQuad *)pVertices->m_pData;
+	STmpQuadTextured *pTmpQuadsTextured = (STmpQuadTextured *)pVertices->m_pData;
+	for(int i = 0; i < NumQuads; ++i)
+	{
+		const CQuad *pQuad = &pQuads[i];
+		for(int j = 0; j < 4; ++j)
+		{
+			int QuadIDX = j;
+			if(j == 2)
+				QuadIDX = 3;
+			else if(j == 3)
+				QuadIDX = 2;
+			if(!Textured)
+			{
+				// ignore the conversion for the position coordinates
+				pTmpQuads[i].m_aVertices[j].m_X = (pQuad->m_aPoints[QuadIDX].x);
+				pTmpQuads[i].m_aVertices[j].m_Y = (pQuad->m_aPoints[QuadIDX].y);
+				pTmpQuads[i].m_aVertices[j].m_CenterX = (pQuad->m_aPoints[4].x);
+				pTmpQuads[i].m_aVertices[j].m_CenterY = (pQuad->m_aPoints[4].y);
+				pTmpQuads[i].m_aVertices[j].m_R = (unsigned char)pQuad->m_aColors[QuadIDX].r;
+				pTmpQuads[i].m_aVertices[j].m_G = (unsigned char)pQuad->m_aColors[QuadIDX].g;
+				pTmpQuads[i].m_aVertices[j].m_B = (unsigned char)pQuad->m_aColors[QuadIDX].b;
+				pTmpQuads[i].m_aVertices[j].m_A = (unsigned char)pQuad->m_aColors[QuadIDX].a;
+			}
+			else
+			{
+				// ignore the conversion for the position coordinates
+				pTmpQuadsTextured[i].m_aVertices[j].m_X = (pQuad->m_aPoints[QuadIDX].x);
+				pTmpQuadsTextured[i].m_aVertices[j].m_Y = (pQuad->m_aPoints[QuadIDX].y);
+				pTmpQuadsTextured[i].m_aVertices[j].m_CenterX = (pQuad->m_aPoints[4].x);
+				pTmpQuadsTextured[i].m_aVertices[j].m_CenterY = (pQuad->m_aPoints[4].y);
+				pTmpQuadsTextured[i].m_aVertices[j].m_U = fx2f(pQuad->m_aTexcoords[QuadIDX].x);
+				pTmpQuadsTextured[i].m_aVertices[j].m_V = fx2f(pQuad->m_aTexcoords[QuadIDX].y);
+				pTmpQuadsTextured[i].m_aVertices[j].m_R = (unsigned char)pQuad->m_aColors[QuadIDX].r;
+				pTmpQuadsTextured[i].m_aVertices[j].m_G = (unsigned char)pQuad->m_aColors[QuadIDX].g;
+				pTmpQuadsTextured[i].m_aVertices[j].m_B = (unsigned char)pQuad->m_aColors[QuadIDX].b;
+				pTmpQuadsTextured[i].m_aVertices[j].m_A = (unsigned char)pQuad->m_aColors[QuadIDX].a;
+			}
+		}
+	}
+}
+
+static const CUuid gs_TileLayerCacheUuid = CalculateUuid("tile-layer-cache@ddnet.org");
+
+enum
+{
+	// width, height, texture coordinates, number of tiles, vertex data size
+	TILE_LAYER_CACHE_LAYER_HEADER_SIZE = 5 * 4,
+	// corners and kill tile
+	TILE_LAYER_CACHE_NUM_SINGLE_VISUALS = 5,
+};
+
+static_assert(sizeof(STileLayerVisuals::STileVisual) == sizeof(offset_ptr32), "visuals are cached as they are");
+
+// number of visuals of a layer in the cache
+static size_t NumCachedVisuals(size_t Width, size_t Height)
+{
+	return Width * Height + 2 * Width + 2 * Height + TILE_LAYER_CACHE_NUM_SINGLE_VISUALS;
+}
+
+void CTileLayerCache::FormatPath(char *pBuf, int BufSize, const SHA256_DIGEST &MapSha256, int LayerSet)
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(MapSha256, aSha256, sizeof(aSha256));
+	str_format(pBuf, BufSize, "mapcache/%s_%d.layers", aSha256, LayerSet);
+}
+
+void CTileLayerCache::SerializeHeader(int NumLayers, std::vector<unsigned char> *pvData)
+{
+	const size_t Start = pvData->size();
+	pvData->resize(Start + sizeof(CUuid) + 4);
+	mem_copy(pvData->data() + Start, &gs_TileLayerCacheUuid, sizeof(CUuid));
+	uint_to_bytes_be(pvData->data() + Start + sizeof(CUuid), NumLayers);
+}
+
+void CTileLayerCache::SerializeLayer(const STileLayerVisuals &Visuals, const SPreparedLayerVertices &Vertices, std::vector<unsigned char> *pvData)
+{
+	const size_t VisualsSize = NumCachedVisuals(Visuals.m_Width, Visuals.m_Height) * sizeof(offset_ptr32);
+	size_t Pos = pvData->size();
+	pvData->resize(Pos + TILE_LAYER_CACHE_LAYER_HEADER_SIZE + VisualsSize + Vertices.m_DataSize);
+	unsigned char *pData = pvData->data();
+
+	for(const unsigned Value : {Visuals.m_Width, Visuals.m_Height, (unsigned)Visuals.m_IsTextured, (unsigned)Vertices.m_NumQuads, (unsigned)Vertices.m_DataSize})
+	{
+		uint_to_bytes_be(pData + Pos, Value);
+		Pos += 4;
+	}
+	auto &&Write = [&](const void *pSource, size_t Size) {
+		mem_copy(pData + Pos, pSource, Size);
+		Pos += Size;
+	};
+	Write(Visuals.m_pTilesOfLayer, (size_t)Visuals.m_Width * Visuals.m_Height * sizeof(offset_ptr32));
+	Write(Visuals.m_vBorderTop.data(), Visuals.m_Width * sizeof(offset_ptr32));
+	Write(Visuals.m_vBorderBottom.data(), Visuals.m_Width * sizeof(offset_ptr32));
+	Write(Visuals.m_vBorderLeft.data(), Visuals.m_Height * sizeof(offset_ptr32));
+	Write(Visuals.m_vBorderRight.data(), Visuals.m_Height * sizeof(offset_ptr32));
+	for(const STileLayerVisuals::STileVisual *pVisual : {&Visuals.m_BorderTopLeft, &Visuals.m_BorderTopRight, &Visuals.m_BorderBottomRight, &Visuals.m_BorderBottomLeft, &Visuals.m_BorderKillTile})
+		Write(pVisual, sizeof(offset_ptr32));
+	if(Vertices.m_DataSize > 0)
+		Write(Vertices.m_pData, Vertices.m_DataSize);
+}
+
+void CTileLayerCache::Prune(IStorage *pStorage, int MaxFiles)
+{
+	struct SCacheFile
+	{
+		std::string m_Name;
+		time_t m_Time;
+	};
+	std::vector<SCacheFile> vFiles;
+	pStorage->ListDirectoryInfo(
+		IStorage::TYPE_SAVE, "mapcache", [](const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser) {
+			if(!IsDir && str_endswith(pInfo->m_pName, ".layers"))
+				static_cast<std::vector<SCacheFile> *>(pUser)->push_back({pInfo->m_pName, pInfo->m_TimeModified});
+			return 0;
+		},
+		&vFiles);
+	if((int)vFiles.size() <= MaxFiles)
+		return;
+
+	std::sort(vFiles.begin(), vFiles.end(), [](const SCacheFile &Left, const SCacheFile &Right) { return Left.m_Time > Right.m_Time; });
+	for(size_t i = MaxFiles; i < vFiles.size(); i++)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "mapcache/%s", vFiles[i].m_Name.c_str());
+		pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+	}
+}
+
+CTileLayerCache::~CTileLayerCache()
+{
+	Unload();
+}
+
+bool CTileLayerCache::Load(IStorage *pStorage, const char *pPath)
+{
+	Unload();
+
+	IOHANDLE File = pStorage->OpenFile(pPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	m_pData = static_cast<unsigned char *>(io_mmap(File, &m_DataSize));
+	io_close(File);
+	if(!m_pData)
+		return false;
+
+	if(m_DataSize < sizeof(CUuid) + 4 || mem_comp(m_pData, &gs_TileLayerCacheUuid, sizeof(CUuid)) != 0)
+	{
+		Unload();
+		return false;
+	}
+	const int NumLayers = bytes_be_to_uint(m_pData + sizeof(CUuid));
+	size_t Pos = sizeof(CUuid) + 4;
+	for(int i = 0; i < NumLayers; i++)
+	{
+		if(m_DataSize - Pos < TILE_LAYER_CACHE_LAYER_HEADER_SIZE)
+			break;
+		SLayer Layer;
+		Layer.m_Width = bytes_be_to_uint(m_pData + Pos);
+		Layer.m_Height = bytes_be_to_uint(m_pData + Pos + 4);
+		Layer.m_IsTextured = bytes_be_to_uint(m_pData + Pos + 8) != 0;
+		Layer.m_NumQuads = bytes_be_to_uint(m_pData + Pos + 12);
+		Layer.m_DataSize = bytes_be_to_uint(m_pData + Pos + 16);
+		Pos += TILE_LAYER_CACHE_LAYER_HEADER_SIZE;
+		Layer.m_Offset = Pos;
+
+		const size_t Left = m_DataSize - Pos;
+		if((uint64_t)Layer.m_Width * Layer.m_Height > Left || Layer.m_DataSize > Left)
+			break;
+		const size_t LayerSize = NumCachedVisuals(Layer.m_Width, Layer.m_Height) * sizeof(offset_ptr32) + Layer.m_DataSize;
+		if(LayerSize > Left)
+			break;
+		Pos += LayerSize;
+		m_vLayers.push_back(Layer);
+	}
+	if((int)m_vLayers.size() != NumLayers || Pos != m_DataSize)
+	{
+		Unload();
+		return false;
+	}
+	return true;
+}
+
+void CTileLayerCache::Unload()
+{
+	if(m_pData)
+		io_munmap(m_pData, m_DataSize);
+	m_pData = nullptr;
+	m_DataSize = 0;
+	m_vLayers.clear();
+}
+
+bool CTileLayerCache::MatchesLayer(int Index, const STileLayerVisuals &Visuals) const
+{
+	if(Index < 0 || Index >= NumLayers())
+		return false;
+	const SLayer &Layer = m_vLayers[Index];
+	return Layer.m_Width == Visuals.m_Width && Layer.m_Height == Visuals.m_Height && Layer.m_IsTextured == Visuals.m_IsTextured;
+}
+
+bool CTileLayerCache::GetLayer(int Index, STileLayerVisuals &Visuals, SPreparedLayerVertices *pVertices) const
+{
+	if(!MatchesLayer(Index, Visuals))
+		return false;
+	const SLayer &Layer = m_vLayers[Index];
+
+	const unsigned char *pData = m_pData + Layer.m_Offset;
+	auto &&Read = [&](void *pDest, size_t Size) {
+		mem_copy(pDest, pData, Size);
+		pData += Size;
+	};
+	Read(Visuals.m_pTilesOfLayer, (size_t)Visuals.m_Width * Visuals.m_Height * sizeof(offset_ptr32));
+	Read(Visuals.m_vBorderTop.data(), Visuals.m_Width * sizeof(offset_ptr32));
+	Read(Visuals.m_vBorderBottom.data(), Visuals.m_Width * sizeof(offset_ptr32));
+	Read(Visuals.m_vBorderLeft.data(), Visuals.m_Height * sizeof(offset_ptr32));
+	Read(Visuals.m_vBorderRight.data(), Visuals.m_Height * sizeof(offset_ptr32));
+	for(STileLayerVisuals::STileVisual *pVisual : {&Visuals.m_BorderTopLeft, &Visuals.m_BorderTopRight, &Visuals.m_BorderBottomRight, &Visuals.m_BorderBottomLeft, &Visuals.m_BorderKillTile})
+		Read(pVisual, sizeof(offset_ptr32));
+
+	pVertices->m_NumQuads = Layer.m_NumQuads;
+	pVertices->m_DataSize = Layer.m_DataSize;
+	pVertices->m_pData = nullptr;
+	if(Layer.m_DataSize > 0)
+	{
+		pVertices->m_pData = malloc(Layer.m_DataSize);
+		Read(pVertices->m_pData, Layer.m_DataSize);
+	}
+	return true;
+}
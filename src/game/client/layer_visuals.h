@@ -0,0 +1,204 @@
+#ifndef GAME_CLIENT_LAYER_VISUALS_H
+#define GAME_CLIENT_LAYER_VISUALS_H
+
+#include <base/hash.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+typedef char *offset_ptr_size;
+typedef uintptr_t offset_ptr;
+typedef unsigned int offset_ptr32;
+
+class IStorage;
+struct CQuad;
+
+struct STileLayerVisuals
+{
+	STileLayerVisuals() :
+		m_pTilesOfLayer(nullptr)
+	{
+		m_Width = 0;
+		m_Height = 0;
+		m_BufferContainerIndex = -1;
+		m_IsTextured = false;
+	}
+
+	bool Init(unsigned int Width, unsigned int Height);
+
+	~STileLayerVisuals();
+
+	struct STileVisual
+	{
+		STileVisual() :
+			m_IndexBufferByteOffset(0) {}
+
+	private:
+		offset_ptr32 m_IndexBufferByteOffset;
+
+	public:
+		bool DoDraw()
+		{
+			return (m_IndexBufferByteOffset & 0x10000000) != 0;
+		}
+
+		void Draw(bool SetDraw)
+		{
+			m_IndexBufferByteOffset = (SetDraw ? 0x10000000 : (offset_ptr32)0) | (m_IndexBufferByteOffset & 0xEFFFFFFF);
+		}
+
+		offset_ptr IndexBufferByteOffset()
+		{
+			return ((offset_ptr)(m_IndexBufferByteOffset & 0xEFFFFFFF) * 6 * sizeof(uint32_t));
+		}
+
+		void SetIndexBufferByteOffset(offset_ptr32 IndexBufferByteOff)
+		{
+			m_IndexBufferByteOffset = IndexBufferByteOff | (m_IndexBufferByteOffset & 0x10000000);
+		}
+
+		void AddIndexBufferByteOffset(offset_ptr32 IndexBufferByteOff)
+		{
+			m_IndexBufferByteOffset = ((m_IndexBufferByteOffset & 0xEFFFFFFF) + IndexBufferByteOff) | (m_IndexBufferByteOffset & 0x10000000);
+		}
+	};
+	STileVisual *m_pTilesOfLayer;
+
+	STileVisual m_BorderTopLeft;
+	STileVisual m_BorderTopRight;
+	STileVisual m_BorderBottomRight;
+	STileVisual m_BorderBottomLeft;
+
+	STileVisual m_BorderKillTile; //end of map kill tile -- game layer only
+
+	std::vector<STileVisual> m_vBorderTop;
+	std::vector<STileVisual> m_vBorderLeft;
+	std::vector<STileVisual> m_vBorderRight;
+	std::vector<STileVisual> m_vBorderBottom;
+
+	unsigned int m_Width;
+	unsigned int m_Height;
+	int m_BufferContainerIndex;
+	bool m_IsTextured;
+};
+
+// vertex layout of the quad layer buffers
+struct STmpQuadVertexTextured
+{
+	float m_X, m_Y, m_CenterX, m_CenterY;
+	unsigned char m_R, m_G, m_B, m_A;
+	float m_U, m_V;
+};
+
+struct STmpQuadVertex
+{
+	float m_X, m_Y, m_CenterX, m_CenterY;
+	unsigned char m_R, m_G, m_B, m_A;
+};
+
+struct STmpQuad
+{
+	STmpQuadVertex m_aVertices[4];
+};
+
+struct STmpQuadTextured
+{
+	STmpQuadVertexTextured m_aVertices[4];
+};
+
+// tiles of a layer whose visuals are prepared, `m_pTiles` holds
+// `m_Width` * `m_Height` tiles of the format of `m_Type`
+struct STileLayerSource
+{
+	enum
+	{
+		TYPE_DESIGN,
+		TYPE_GAME,
+		TYPE_FRONT,
+		TYPE_SWITCH,
+		TYPE_TELE,
+		TYPE_SPEEDUP,
+		TYPE_TUNE,
+	};
+
+	int m_Type;
+	const void *m_pTiles;
+	int m_Width;
+	int m_Height;
+	// switch, tele and speedup layers are drawn again for each number
+	// shown on their tiles
+	int m_Overlay;
+	bool m_DoTextureCoords;
+
+	static int NumOverlays(int Type);
+};
+
+// vertex data of a layer, ready to be uploaded into a buffer object
+struct SPreparedLayerVertices
+{
+	// allocated with malloc, passed on to the graphics backend
+	void *m_pData = nullptr;
+	size_t m_DataSize = 0;
+	// tiles or quads, each of them needs six indices
+	size_t m_NumQuads = 0;
+};
+
+// Sets the buffer offsets of `Visuals`, which must be initialized to the
+// size of the layer, and builds the vertex data of the layer. Doesn't use
+// the graphics, so layers can be prepared on the job pool.
+void PrepareTileLayerVisuals(STileLayerVisuals &Visuals, const STileLayerSource &Source, SPreparedLayerVertices *pVertices);
+void PrepareQuadLayerVertices(const CQuad *pQuads, int NumQuads, bool Textured, SPreparedLayerVertices *pVertices);
+
+// Cache of the prepared tile layers of a map on disk, so loading the same
+// map again only needs to copy them.
+//
+// The file starts with a UUID and the number of layers, followed by the
+// size, the visuals and the vertex data of each layer in the order they
+// were prepared. The visuals and vertices are stored in host byte order,
+// the cache isn't meant to be shared between computers.
+class CTileLayerCache
+{
+public:
+	CTileLayerCache() = default;
+	CTileLayerCache(const CTileLayerCache &Other) = delete;
+	CTileLayerCache &operator=(const CTileLayerCache &Other) = delete;
+	~CTileLayerCache();
+
+	// `LayerSet` tells apart the layers used by different renderers of the
+	// same map
+	static void FormatPath(char *pBuf, int BufSize, const SHA256_DIGEST &MapSha256, int LayerSet);
+	static void SerializeHeader(int NumLayers, std::vector<unsigned char> *pvData);
+	static void SerializeLayer(const STileLayerVisuals &Visuals, const SPreparedLayerVertices &Vertices, std::vector<unsigned char> *pvData);
+
+	// removes the oldest cache files if there are more than `MaxFiles`
+	static void Prune(IStorage *pStorage, int MaxFiles);
+
+	// Maps the file into memory, returns false if it doesn't exist or is
+	// invalid.
+	bool Load(IStorage *pStorage, const char *pPath);
+	void Unload();
+	int NumLayers() const { return m_vLayers.size(); }
+	// whether the cached layer has the size and the texturing of `Visuals`
+	bool MatchesLayer(int Index, const STileLayerVisuals &Visuals) const;
+	// Copies the visuals and the vertices of a layer. `Visuals` must be
+	// initialized, returns false if the cached layer doesn't match it.
+	bool GetLayer(int Index, STileLayerVisuals &Visuals, SPreparedLayerVertices *pVertices) const;
+
+private:
+	struct SLayer
+	{
+		unsigned m_Width;
+		unsigned m_Height;
+		bool m_IsTextured;
+		size_t m_NumQuads;
+		size_t m_DataSize;
+		// start of the visuals in `m_pData`
+		size_t m_Offset;
+	};
+	unsigned char *m_pData = nullptr;
+	unsigned m_DataSize = 0;
+	std::vector<SLayer> m_vLayers;
+};
+
+#endif
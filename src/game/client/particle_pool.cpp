@@ -0,0 +1,139 @@
+#include "particle_pool.h"
+
+#include <base/math.h>
+
+#include <game/collision.h>
+
+CParticlePool::CParticlePool(int Capacity)
+{
+	for(auto *pvArray : {&m_vPosX, &m_vPosY, &m_vVelX, &m_vVelY, &m_vLife, &m_vRot, &m_vLifeSpan, &m_vRotspeed, &m_vGravity, &m_vFriction, &m_vStartSize, &m_vEndSize, &m_vStartAlpha, &m_vEndAlpha})
+		pvArray->resize(Capacity);
+	m_vCollides.resize(Capacity);
+	m_vSprite.resize(Capacity);
+	m_vUseAlphaFading.resize(Capacity);
+	m_vColor.resize(Capacity);
+}
+
+bool CParticlePool::Add(const CParticle &Particle, float Life)
+{
+	if(m_Num == Capacity())
+		return false;
+
+	const int Index = m_Num++;
+	m_vPosX[Index] = Particle.m_Pos.x;
+	m_vPosY[Index] = Particle.m_Pos.y;
+	m_vVelX[Index] = Particle.m_Vel.x;
+	m_vVelY[Index] = Particle.m_Vel.y;
+	m_vLife[Index] = Life;
+	m_vRot[Index] = Particle.m_Rot;
+	m_vLifeSpan[Index] = Particle.m_LifeSpan;
+	m_vRotspeed[Index] = Particle.m_Rotspeed;
+	m_vGravity[Index] = Particle.m_Gravity;
+	m_vFriction[Index] = Particle.m_Friction;
+	m_vCollides[Index] = Particle.m_Collides;
+	m_vSprite[Index] = Particle.m_Spr;
+	m_vStartSize[Index] = Particle.m_StartSize;
+	m_vEndSize[Index] = Particle.m_EndSize;
+	m_vUseAlphaFading[Index] = Particle.m_UseAlphaFading;
+	m_vStartAlpha[Index] = Particle.m_StartAlpha;
+	m_vEndAlpha[Index] = Particle.m_EndAlpha;
+	m_vColor[Index] = Particle.m_Color;
+	return true;
+}
+
+void CParticlePool::Update(float TimePassed, int FrictionCount, const CCollision *pCollision)
+{
+	const int Num = m_Num;
+	float *pPosX = m_vPosX.data();
+	float *pPosY = m_vPosY.data();
+	float *pVelX = m_vVelX.data();
+	float *pVelY = m_vVelY.data();
+	float *pLife = m_vLife.data();
+	float *pRot = m_vRot.data();
+	const float *pRotspeed = m_vRotspeed.data();
+	const float *pGravity = m_vGravity.data();
+	const float *pFriction = m_vFriction.data();
+	const unsigned char *pCollides = m_vCollides.data();
+
+	// the loops over all particles have no dependencies between the
+	// particles, so they can be vectorized
+
+	for(int i = 0; i < Num; i++)
+		pVelY[i] += pGravity[i] * TimePassed;
+
+	for(int f = 0; f < FrictionCount; f++) // apply friction
+	{
+		for(int i = 0; i < Num; i++)
+		{
+			pVelX[i] *= pFriction[i];
+			pVelY[i] *= pFriction[i];
+		}
+	}
+
+	// the velocity is the movement of this update until the particles are
+	// moved
+	for(int i = 0; i < Num; i++)
+	{
+		pVelX[i] *= TimePassed;
+		pVelY[i] *= TimePassed;
+		pPosX[i] = pCollides[i] ? pPosX[i] : pPosX[i] + pVelX[i];
+		pPosY[i] = pCollides[i] ? pPosY[i] : pPosY[i] + pVelY[i];
+	}
+
+	for(int i = 0; i < Num; i++)
+	{
+		if(!pCollides[i])
+			continue;
+		vec2 Pos = vec2(pPosX[i], pPosY[i]);
+		vec2 Vel = vec2(pVelX[i], pVelY[i]);
+		pCollision->MovePoint(&Pos, &Vel, random_float(0.1f, 1.0f), nullptr);
+		pPosX[i] = Pos.x;
+		pPosY[i] = Pos.y;
+		pVelX[i] = Vel.x;
+		pVelY[i] = Vel.y;
+	}
+
+	const float InvTimePassed = 1.0f / TimePassed;
+	for(int i = 0; i < Num; i++)
+	{
+		pVelX[i] *= InvTimePassed;
+		pVelY[i] *= InvTimePassed;
+		pLife[i] += TimePassed;
+		pRot[i] += TimePassed * pRotspeed[i];
+	}
+
+	RemoveDead();
+}
+
+void CParticlePool::RemoveDead()
+{
+	for(int i = 0; i < m_Num;)
+	{
+		if(m_vLife[i] <= m_vLifeSpan[i])
+		{
+			i++;
+			continue;
+		}
+
+		// move the last particle into its place
+		const int Last = --m_Num;
+		m_vPosX[i] = m_vPosX[Last];
+		m_vPosY[i] = m_vPosY[Last];
+		m_vVelX[i] = m_vVelX[Last];
+		m_vVelY[i] = m_vVelY[Last];
+		m_vLife[i] = m_vLife[Last];
+		m_vRot[i] = m_vRot[Last];
+		m_vLifeSpan[i] = m_vLifeSpan[Last];
+		m_vRotspeed[i] = m_vRotspeed[Last];
+		m_vGravity[i] = m_vGravity[Last];
+		m_vFriction[i] = m_vFriction[Last];
+		m_vCollides[i] = m_vCollides[Last];
+		m_vSprite[i] = m_vSprite[Last];
+		m_vStartSize[i] = m_vStartSize[Last];
+		m_vEndSize[i] = m_vEndSize[Last];
+		m_vUseAlphaFading[i] = m_vUseAlphaFading[Last];
+		m_vStartAlpha[i] = m_vStartAlpha[Last];
+		m_vEndAlpha[i] = m_vEndAlpha[Last];
+		m_vColor[i] = m_vColor[Last];
+	}
+}
@@ -0,0 +1,120 @@
+#ifndef GAME_CLIENT_PARTICLE_POOL_H
+#define GAME_CLIENT_PARTICLE_POOL_H
+
+#include <base/color.h>
+#include <base/vmath.h>
+
+#include <vector>
+
+class CCollision;
+
+// particles
+struct CParticle
+{
+	void SetDefault()
+	{
+		m_Pos = vec2(0, 0);
+		m_Vel = vec2(0, 0);
+		m_LifeSpan = 0;
+		m_StartSize = 32;
+		m_EndSize = 32;
+		m_UseAlphaFading = false;
+		m_StartAlpha = 1;
+		m_EndAlpha = 1;
+		m_Rot = 0;
+		m_Rotspeed = 0;
+		m_Gravity = 0;
+		m_Friction = 0;
+		m_FlowAffected = 1.0f;
+		m_Color = ColorRGBA(1, 1, 1, 1);
+		m_Collides = true;
+	}
+
+	vec2 m_Pos;
+	vec2 m_Vel;
+
+	int m_Spr;
+
+	float m_FlowAffected;
+
+	float m_LifeSpan;
+
+	float m_StartSize;
+	float m_EndSize;
+
+	bool m_UseAlphaFading;
+	float m_StartAlpha;
+	float m_EndAlpha;
+
+	float m_Rot;
+	float m_Rotspeed;
+
+	float m_Gravity;
+	float m_Friction;
+
+	ColorRGBA m_Color;
+
+	bool m_Collides;
+
+	// set by the particle system
+	float m_Life;
+};
+
+// Particles of one group, stored as one array per attribute so updating
+// them can be vectorized by the compiler. Dead particles are replaced by the
+// last particle, so the particles are only roughly in the order they were
+// added in.
+class CParticlePool
+{
+public:
+	CParticlePool(int Capacity);
+
+	void Reset() { m_Num = 0; }
+	int Num() const { return m_Num; }
+	int Capacity() const { return m_vPosX.size(); }
+	// returns false if the pool is full
+	bool Add(const CParticle &Particle, float Life);
+	// Moves the particles and removes the dead ones. `FrictionCount` is the
+	// number of times the friction is applied. Particles that collide are
+	// moved with `pCollision`.
+	void Update(float TimePassed, int FrictionCount, const CCollision *pCollision);
+
+	vec2 Pos(int Index) const { return vec2(m_vPosX[Index], m_vPosY[Index]); }
+	vec2 Vel(int Index) const { return vec2(m_vVelX[Index], m_vVelY[Index]); }
+	float Rot(int Index) const { return m_vRot[Index]; }
+	int Sprite(int Index) const { return m_vSprite[Index]; }
+	const ColorRGBA &Color(int Index) const { return m_vColor[Index]; }
+	// fraction of the life span that has passed
+	float Age(int Index) const { return m_vLife[Index] / m_vLifeSpan[Index]; }
+	float Size(int Index, float Age) const { return mix(m_vStartSize[Index], m_vEndSize[Index], Age); }
+	float Alpha(int Index, float Age) const { return m_vUseAlphaFading[Index] ? mix(m_vStartAlpha[Index], m_vEndAlpha[Index], Age) : m_vColor[Index].a; }
+
+private:
+	int m_Num = 0;
+
+	// changed by the update
+	std::vector<float> m_vPosX;
+	std::vector<float> m_vPosY;
+	std::vector<float> m_vVelX;
+	std::vector<float> m_vVelY;
+	std::vector<float> m_vLife;
+	std::vector<float> m_vRot;
+
+	// set when the particle is added
+	std::vector<float> m_vLifeSpan;
+	std::vector<float> m_vRotspeed;
+	std::vector<float> m_vGravity;
+	std::vector<float> m_vFriction;
+	std::vector<unsigned char> m_vCollides;
+	std::vector<int> m_vSprite;
+	std::vector<float> m_vStartSize;
+	std::vector<float> m_vEndSize;
+	std::vector<unsigned char> m_vUseAlphaFading;
+	std::vector<float> m_vStartAlpha;
+	std::vector<float> m_vEndAlpha;
+	std::vector<ColorRGBA> m_vColor;
+
+	void RemoveDead();
+};
+
+#endif
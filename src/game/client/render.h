@@ -6,6 +6,7 @@
 #include <base/color.h>
 #include <base/vmath.h>
 
+#include <game/client/envelope_eval.h>
 #include <game/client/skin.h>
 #include <game/client/ui_rect.h>
 
@@ -19,9 +20,6 @@ namespace client_data7 {
 struct CDataSprite;
 }
 struct CDataSprite;
-struct CEnvPoint;
-struct CEnvPointBezier;
-struct CEnvPointBezier_upstream;
 struct CMapItemGroup;
 struct CQuad;
 
@@ -83,35 +81,6 @@ enum
 	TILERENDERFLAG_EXTEND = 4,
 };
 
-class IEnvelopePointAccess
-{
-public:
-	virtual ~IEnvelopePointAccess() = default;
-	virtual int NumPoints() const = 0;
-	virtual const CEnvPoint *GetPoint(int Index) const = 0;
-	virtual const CEnvPointBezier *GetBezier(int Index) const = 0;
-};
-
-class CMapBasedEnvelopePointAccess : public IEnvelopePointAccess
-{
-	int m_StartPoint;
-	int m_NumPoints;
-	int m_NumPointsMax;
-	CEnvPoint *m_pPoints;
-	CEnvPointBezier *m_pPointsBezier;
-	CEnvPointBezier_upstream *m_pPointsBezierUpstream;
-
-public:
-	CMapBasedEnvelopePointAccess(class CDataFileReader *pReader);
-	CMapBasedEnvelopePointAccess(class IMap *pMap);
-	void SetPointsRange(int StartPoint, int NumPoints);
-	int StartPoint() const;
-	int NumPoints() const override;
-	int NumPointsMax() const;
-	const CEnvPoint *GetPoint(int Index) const override;
-	const CEnvPointBezier *GetBezier(int Index) const override;
-};
-
 typedef void (*ENVELOPE_EVAL)(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser);
 
 class CRenderTools
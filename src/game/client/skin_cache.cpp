@@ -0,0 +1,166 @@
+#include "skin_cache.h"
+
+#include <base/system.h>
+
+#include <engine/shared/uuid_manager.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// changing the layout of the skin cache requires a new uuid
+static const CUuid gs_SkinCacheUuid = CalculateUuid("skin-cache@ddnet.org");
+
+enum
+{
+	// uuid, size of the image in the skin file, size of the cached image,
+	// blood color, body and feet metrics
+	SKIN_CACHE_HEADER_SIZE = sizeof(CUuid) + (2 + 2 + 3 + 2 * 6) * 4,
+};
+
+CSkinCacheData::~CSkinCacheData()
+{
+	free(m_Info.m_pData);
+}
+
+void CSkinCacheData::FormatPath(char *pBuf, int BufSize, const SHA256_DIGEST &SkinSha256)
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(SkinSha256, aSha256, sizeof(aSha256));
+	str_format(pBuf, BufSize, "skincache/%s.skin", aSha256);
+}
+
+void CSkinCacheData::Prune(IStorage *pStorage, int MaxFiles)
+{
+	struct SCacheFile
+	{
+		std::string m_Name;
+		time_t m_Time;
+	};
+	std::vector<SCacheFile> vFiles;
+	pStorage->ListDirectoryInfo(
+		IStorage::TYPE_SAVE, "skincache", [](const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser) {
+			if(!IsDir && str_endswith(pInfo->m_pName, ".skin"))
+				static_cast<std::vector<SCacheFile> *>(pUser)->push_back({pInfo->m_pName, pInfo->m_TimeModified});
+			return 0;
+		},
+		&vFiles);
+	if((int)vFiles.size() <= MaxFiles)
+		return;
+
+	std::sort(vFiles.begin(), vFiles.end(), [](const SCacheFile &Left, const SCacheFile &Right) { return Left.m_Time > Right.m_Time; });
+	for(size_t i = MaxFiles; i < vFiles.size(); i++)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "skincache/%s", vFiles[i].m_Name.c_str());
+		pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+	}
+}
+
+bool CSkinCacheData::Load(IStorage *pStorage, const char *pPath, int GridX, int GridY)
+{
+	Reset();
+	IOHANDLE File = pStorage->OpenFile(pPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	// `io_length` seeks back to the start of the file
+	const int64_t FileSize = io_length(File);
+
+	unsigned char aHeader[SKIN_CACHE_HEADER_SIZE];
+	bool Valid = io_read(File, aHeader, sizeof(aHeader)) == sizeof(aHeader) && mem_comp(aHeader, &gs_SkinCacheUuid, sizeof(CUuid)) == 0;
+	if(Valid)
+	{
+		const unsigned char *pInt = aHeader + sizeof(CUuid);
+		auto ReadInt = [&pInt]() {
+			const int Value = (int)bytes_be_to_uint(pInt);
+			pInt += 4;
+			return Value;
+		};
+		m_DecodedWidth = ReadInt();
+		m_DecodedHeight = ReadInt();
+		m_Info.m_Width = ReadInt();
+		m_Info.m_Height = ReadInt();
+		m_Info.m_Format = CImageInfo::FORMAT_RGBA;
+		for(int &Color : m_aBloodColor)
+			Color = ReadInt();
+		for(CSkin::SSkinMetricVariable *pMetrics : {&m_Metrics.m_Body, &m_Metrics.m_Feet})
+		{
+			pMetrics->m_Width = ReadInt();
+			pMetrics->m_Height = ReadInt();
+			pMetrics->m_OffsetX = ReadInt();
+			pMetrics->m_OffsetY = ReadInt();
+			pMetrics->m_MaxWidth = ReadInt();
+			pMetrics->m_MaxHeight = ReadInt();
+		}
+
+		const int Width = m_Info.m_Width;
+		const int Height = m_Info.m_Height;
+		const int64_t DataSize = (int64_t)Width * Height * 4;
+		Valid = Width > 0 && Height > 0 && Width % GridX == 0 && Height % GridY == 0 && FileSize == SKIN_CACHE_HEADER_SIZE + DataSize;
+		if(Valid)
+		{
+			m_Info.m_pData = malloc(DataSize);
+			Valid = io_read(File, m_Info.m_pData, DataSize) == (unsigned)DataSize;
+		}
+	}
+	io_close(File);
+
+	if(!Valid)
+		Reset();
+	return Valid;
+}
+
+bool CSkinCacheData::Save(IStorage *pStorage, const char *pPath, const char *pWriterName) const
+{
+	std::vector<unsigned char> vHeader(SKIN_CACHE_HEADER_SIZE);
+	mem_copy(vHeader.data(), &gs_SkinCacheUuid, sizeof(CUuid));
+	unsigned char *pInt = vHeader.data() + sizeof(CUuid);
+	auto WriteInt = [&pInt](int Value) {
+		uint_to_bytes_be(pInt, Value);
+		pInt += 4;
+	};
+	WriteInt(m_DecodedWidth);
+	WriteInt(m_DecodedHeight);
+	WriteInt(m_Info.m_Width);
+	WriteInt(m_Info.m_Height);
+	for(int Color : m_aBloodColor)
+		WriteInt(Color);
+	for(const CSkin::SSkinMetricVariable *pMetrics : {&m_Metrics.m_Body, &m_Metrics.m_Feet})
+	{
+		WriteInt(pMetrics->m_Width);
+		WriteInt(pMetrics->m_Height);
+		WriteInt(pMetrics->m_OffsetX);
+		WriteInt(pMetrics->m_OffsetY);
+		WriteInt(pMetrics->m_MaxWidth);
+		WriteInt(pMetrics->m_MaxHeight);
+	}
+
+	char aBuf[IO_MAX_PATH_LENGTH];
+	char aTmpPath[IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "%s.%s", pPath, pWriterName);
+	IStorage::FormatTmpPath(aTmpPath, sizeof(aTmpPath), aBuf);
+	IOHANDLE File = pStorage->OpenFile(aTmpPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	const unsigned DataSize = m_Info.m_Width * m_Info.m_Height * m_Info.PixelSize();
+	bool Written = io_write(File, vHeader.data(), vHeader.size()) == vHeader.size();
+	Written = Written && io_write(File, m_Info.m_pData, DataSize) == DataSize;
+	io_close(File);
+	if(!Written || !pStorage->RenameFile(aTmpPath, pPath, IStorage::TYPE_SAVE))
+	{
+		pStorage->RemoveFile(aTmpPath, IStorage::TYPE_SAVE);
+		return false;
+	}
+	return true;
+}
+
+void CSkinCacheData::Reset()
+{
+	free(m_Info.m_pData);
+	m_Info = CImageInfo();
+	m_DecodedWidth = 0;
+	m_DecodedHeight = 0;
+	m_aBloodColor[0] = m_aBloodColor[1] = m_aBloodColor[2] = 0;
+	m_Metrics.Reset();
+}
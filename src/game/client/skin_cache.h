@@ -0,0 +1,49 @@
+#ifndef GAME_CLIENT_SKIN_CACHE_H
+#define GAME_CLIENT_SKIN_CACHE_H
+
+#include <base/hash.h>
+
+#include <engine/graphics.h>
+
+#include <game/client/skin.h>
+
+class IStorage;
+
+// The decoded image of a skin and the values computed from it. They are
+// cached in "skincache/", keyed by the SHA256 of the skin file, so the PNG
+// is only decoded the first time a skin is seen.
+//
+// The file starts with a UUID and the sizes, the blood color and the
+// metrics as big-endian integers, followed by the RGBA image.
+class CSkinCacheData
+{
+public:
+	// size of the image in the skin file, `m_Info` is resized if it is not
+	// divisible into the sprite grid
+	int m_DecodedWidth = 0;
+	int m_DecodedHeight = 0;
+	// RGBA image allocated with malloc, freed by the destructor
+	CImageInfo m_Info;
+	int m_aBloodColor[3] = {0, 0, 0};
+	CSkin::SSkinMetrics m_Metrics;
+
+	CSkinCacheData() = default;
+	CSkinCacheData(const CSkinCacheData &) = delete;
+	CSkinCacheData &operator=(const CSkinCacheData &) = delete;
+	~CSkinCacheData();
+
+	static void FormatPath(char *pBuf, int BufSize, const SHA256_DIGEST &SkinSha256);
+	// removes the oldest cache files if there are more than `MaxFiles`
+	static void Prune(IStorage *pStorage, int MaxFiles);
+
+	// Reads a cache file whose image is divisible into a sprite grid of
+	// `GridX` by `GridY`. Returns false and resets the data if the file
+	// doesn't exist or is invalid.
+	bool Load(IStorage *pStorage, const char *pPath, int GridX, int GridY);
+	// Writes the file through a temporary file named after `pWriterName`,
+	// so that different writers of the same entry don't collide.
+	bool Save(IStorage *pStorage, const char *pPath, const char *pWriterName) const;
+	void Reset();
+};
+
+#endif
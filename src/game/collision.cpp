@@ -7,6 +7,9 @@
 #include <antibot/antibot_data.h>
 
 #include <cmath>
+#include <limits>
+#include <utility>
+
 #include <engine/map.h>
 
 #include <game/collision.h>
@@ -42,6 +45,7 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	m_MoveBoxTestAllSteps = false;
 
 	m_pTele = 0;
 	m_pSpeedup = 0;
@@ -131,6 +135,70 @@ void CCollision::Init(class CLayers *pLayers)
 			}
 		}
 	}
+
+	if(m_pTele || m_pSpeedup || m_pSwitch || m_pTune)
+	{
+		m_vTileAttributes.resize((size_t)m_Width * m_Height);
+		for(int i = 0; i < m_Width * m_Height; i++)
+		{
+			CTileAttributes &Attributes = m_vTileAttributes[i];
+			mem_zero(&Attributes, sizeof(Attributes));
+			if(m_pTele)
+			{
+				Attributes.m_TeleType = m_pTele[i].m_Type;
+				Attributes.m_TeleNumber = m_pTele[i].m_Number;
+			}
+			if(m_pSwitch)
+			{
+				Attributes.m_SwitchType = m_pSwitch[i].m_Type;
+				Attributes.m_SwitchNumber = m_pSwitch[i].m_Number;
+				Attributes.m_SwitchDelay = m_pSwitch[i].m_Delay;
+			}
+			if(m_pSpeedup)
+			{
+				Attributes.m_SpeedupForce = m_pSpeedup[i].m_Force;
+				Attributes.m_SpeedupMaxSpeed = m_pSpeedup[i].m_MaxSpeed;
+				Attributes.m_SpeedupAngle = m_pSpeedup[i].m_Angle;
+			}
+			if(m_pTune && m_pTune[i].m_Type)
+				Attributes.m_TuneNumber = m_pTune[i].m_Number;
+		}
+	}
+
+	m_TeleOuts.Init(m_pTele, m_Width, m_Height, TILE_TELEOUT);
+	m_TeleCheckOuts.Init(m_pTele, m_Width, m_Height, TILE_TELECHECKOUT);
+}
+
+void CTeleOuts::Init(const CTeleTile *pTele, int Width, int Height, int Type)
+{
+	Clear();
+	if(!pTele)
+		return;
+
+	// count the tele outs of each number first, so they can be put into
+	// their place right away
+	for(int i = 0; i < Width * Height; i++)
+	{
+		if(pTele[i].m_Type == Type && pTele[i].m_Number > 0)
+			m_aOffsets[pTele[i].m_Number + 1]++;
+	}
+	for(int Number = 0; Number < NUM_NUMBERS; Number++)
+		m_aOffsets[Number + 1] += m_aOffsets[Number];
+
+	int aNext[NUM_NUMBERS];
+	mem_copy(aNext, m_aOffsets, sizeof(aNext));
+	m_vPositions.resize(m_aOffsets[NUM_NUMBERS]);
+	for(int i = 0; i < Width * Height; i++)
+	{
+		if(pTele[i].m_Type == Type && pTele[i].m_Number > 0)
+			m_vPositions[aNext[pTele[i].m_Number]++] = vec2(i % Width * 32.0f + 16.0f, i / Width * 32.0f + 16.0f);
+	}
+}
+
+void CTeleOuts::Clear()
+{
+	mem_zero(m_aOffsets, sizeof(m_aOffsets));
+	m_vPositions.clear();
 }
 
 void CCollision::FillAntibot(CAntibotMapData *pMapData)
@@ -288,16 +356,99 @@ int CCollision::GetTile(int x, int y) const
 	return 0;
 }
 
-// TODO: rewrite this smarter!
+// The line checks test the points `mix(Pos0, Pos1, i / Scale)`, which are
+// about one pixel apart. All points with the same key (usually the tile they
+// are in) give the same result, so only the first point of each tile is
+// checked before skipping to the first point of the next one, similar to the
+// traversal by Amanatides and Woo. The points are still computed in the same
+// way, which keeps the results identical to checking every point.
+class CLinePoints
+{
+	vec2 m_Pos0;
+	vec2 m_Pos1;
+	float m_Scale;
+	int m_Last;
+
+	static double Crossing(float Pos0, float Pos1, float Pos, float Scale)
+	{
+		// tiles are entered at `32 * n - 0.5` after rounding
+		const float Delta = Pos1 - Pos0;
+		if(Delta == 0.0f)
+			return std::numeric_limits<double>::infinity();
+		const double Tile = std::floor((Pos + 0.5) / 32.0);
+		const double Boundary = (Delta > 0.0f ? Tile + 1.0 : Tile) * 32.0 - 0.5;
+		return (Boundary - Pos0) / Delta * Scale;
+	}
+
+public:
+	CLinePoints(vec2 Pos0, vec2 Pos1, float Scale, int Last) :
+		m_Pos0(Pos0), m_Pos1(Pos1), m_Scale(Scale), m_Last(Last)
+	{
+	}
+
+	vec2 Point(int i) const
+	{
+		float a = i / m_Scale;
+		return mix(m_Pos0, m_Pos1, a);
+	}
+
+	// Returns the last point that has the same key as the point `First`.
+	// Each coordinate of the point has to map monotonically to the key, which
+	// makes the points with the same key contiguous.
+	template<typename TKey>
+	int LastWithKey(int First, const TKey &Key) const
+	{
+		const vec2 FirstPos = Point(First);
+		const auto FirstKey = Key(FirstPos);
+
+		// estimate where the line leaves the tile, then search the exact point
+		const double Next = std::ceil(minimum(Crossing(m_Pos0.x, m_Pos1.x, FirstPos.x, m_Scale), Crossing(m_Pos0.y, m_Pos1.y, FirstPos.y, m_Scale)));
+		int Guess = m_Last;
+		if(Next <= First)
+			Guess = First;
+		else if(Next <= m_Last)
+			Guess = (int)Next - 1;
+
+		int Low = First;
+		int High = m_Last + 1;
+		if(Key(Point(Guess)) == FirstKey)
+		{
+			Low = Guess;
+			for(int Step = 1; Low + Step < High; Step *= 2)
+			{
+				if(Key(Point(Low + Step)) != FirstKey)
+				{
+					High = Low + Step;
+					break;
+				}
+				Low += Step;
+			}
+		}
+		else
+		{
+			High = Guess;
+		}
+		while(High - Low > 1)
+		{
+			const int Middle = Low + (High - Low) / 2;
+			if(Key(Point(Middle)) == FirstKey)
+				Low = Middle;
+			else
+				High = Middle;
+		}
+		return Low;
+	}
+};
+
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
-	vec2 Last = Pos0;
-	for(int i = 0; i <= End; i++)
+	const CLinePoints Points(Pos0, Pos1, End, End);
+	const auto TileKey = [this](vec2 Pos) { return GetPureMapIndex(Pos); };
+	for(int i = 0; i <= End; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
 		// Temporary position for checking collision
 		int ix = round_to_int(Pos.x);
 		int iy = round_to_int(Pos.y);
@@ -307,11 +458,9 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i == 0 ? Pos0 : Points.Point(i - 1);
 			return GetCollisionAt(ix, iy);
 		}
-
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -324,13 +473,18 @@ int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision,
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
-	vec2 Last = Pos0;
 	int dx = 0, dy = 0; // Offset for checking the "through" tile
 	ThroughOffset(Pos0, Pos1, &dx, &dy);
-	for(int i = 0; i <= End; i++)
+	const CLinePoints Points(Pos0, Pos1, End, End);
+	// the "through" tile can be in a different tile column or row
+	const auto TileKey = [this, dx, dy](vec2 Pos) {
+		return std::make_pair(GetPureMapIndex(Pos), GetPureMapIndex(round_to_int(Pos.x) + dx, round_to_int(Pos.y) + dy));
+	};
+	*pTeleNr = 0;
+	for(int i = 0; i <= End; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
+		vec2 Last = i == 0 ? Pos0 : Points.Point(i - 1);
 		// Temporary position for checking collision
 		int ix = round_to_int(Pos.x);
 		int iy = round_to_int(Pos.y);
@@ -367,8 +521,6 @@ int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision,
 				*pOutBeforeCollision = Last;
 			return hit;
 		}
-
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -381,11 +533,13 @@ int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollisio
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
-	vec2 Last = Pos0;
-	for(int i = 0; i <= End; i++)
+	const CLinePoints Points(Pos0, Pos1, End, End);
+	const auto TileKey = [this](vec2 Pos) { return GetPureMapIndex(Pos); };
+	*pTeleNr = 0;
+	for(int i = 0; i <= End; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
+		vec2 Last = i == 0 ? Pos0 : Points.Point(i - 1);
 		// Temporary position for checking collision
 		int ix = round_to_int(Pos.x);
 		int iy = round_to_int(Pos.y);
@@ -412,8 +566,6 @@ int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollisio
 				*pOutBeforeCollision = Last;
 			return GetCollisionAt(ix, iy);
 		}
-
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -490,6 +642,17 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elast
 		float ElasticityX = clamp(Elasticity.x, -1.0f, 1.0f);
 		float ElasticityY = clamp(Elasticity.y, -1.0f, 1.0f);
 
+		// Ranges that keep the corners of the box in the tiles of the last
+		// box that was free of collision. Boxes with their corners in the
+		// same tiles are free as well, so most steps don't have to look at
+		// the tiles at all.
+		const vec2 HalfSize = Size * 0.5f;
+		bool HaveFreeTiles = false;
+		vec2 FreeMinLow = vec2(0, 0);
+		vec2 FreeMinHigh = vec2(0, 0);
+		vec2 FreeMaxLow = vec2(0, 0);
+		vec2 FreeMaxHigh = vec2(0, 0);
+
 		for(int i = 0; i <= Max; i++)
 		{
 			// Early break as optimization to stop checking for collisions for
@@ -509,8 +672,19 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elast
 				break;
 			}
 
+			const vec2 NewMin = NewPos - HalfSize;
+			const vec2 NewMax = NewPos + HalfSize;
+			if(HaveFreeTiles && !m_MoveBoxTestAllSteps &&
+				NewMin.x >= FreeMinLow.x && NewMin.x <= FreeMinHigh.x && NewMax.x >= FreeMaxLow.x && NewMax.x <= FreeMaxHigh.x &&
+				NewMin.y >= FreeMinLow.y && NewMin.y <= FreeMinHigh.y && NewMax.y >= FreeMaxLow.y && NewMax.y <= FreeMaxHigh.y)
+			{
+				Pos = NewPos;
+				continue;
+			}
+
 			if(TestBox(vec2(NewPos.x, NewPos.y), Size))
 			{
+				HaveFreeTiles = false;
 				int Hits = 0;
 
 				if(TestBox(vec2(Pos.x, NewPos.y), Size))
@@ -541,6 +715,20 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elast
 					Vel.x *= -ElasticityX;
 				}
 			}
+			else
+			{
+				// the tile rounding of negative positions isn't uniform,
+				// just test those
+				const int MinX = round_to_int(NewMin.x);
+				const int MinY = round_to_int(NewMin.y);
+				const int MaxX = round_to_int(NewMax.x);
+				const int MaxY = round_to_int(NewMax.y);
+				HaveFreeTiles = MinX >= 0 && MinY >= 0 && MaxX >= 0 && MaxY >= 0;
+				FreeMinLow = vec2(MinX / 32 * 32, MinY / 32 * 32);
+				FreeMinHigh = FreeMinLow + vec2(31, 31);
+				FreeMaxLow = vec2(MaxX / 32 * 32, MaxY / 32 * 32);
+				FreeMaxHigh = FreeMaxLow + vec2(31, 31);
+			}
 
 			Pos = NewPos;
 		}
@@ -565,6 +753,9 @@ void CCollision::Dest()
 	m_pSwitch = 0;
 	m_pTune = 0;
 	m_pDoor = 0;
+	m_vTileAttributes.clear();
+	m_TeleOuts.Clear();
+	m_TeleCheckOuts.Clear();
 }
 
 int CCollision::IsSolid(int x, int y) const
@@ -622,8 +813,9 @@ int CCollision::IsTeleport(int Index) const
 	if(Index < 0 || !m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELEIN)
-		return m_pTele[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_TeleType == TILE_TELEIN)
+		return Attributes.m_TeleNumber;
 
 	return 0;
 }
@@ -635,8 +827,9 @@ int CCollision::IsEvilTeleport(int Index) const
 	if(!m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELEINEVIL)
-		return m_pTele[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_TeleType == TILE_TELEINEVIL)
+		return Attributes.m_TeleNumber;
 
 	return 0;
 }
@@ -645,14 +838,14 @@ bool CCollision::IsCheckTeleport(int Index) const
 {
 	if(Index < 0 || !m_pTele)
 		return false;
-	return m_pTele[Index].m_Type == TILE_TELECHECKIN;
+	return m_vTileAttributes[Index].m_TeleType == TILE_TELECHECKIN;
 }
 
 bool CCollision::IsCheckEvilTeleport(int Index) const
 {
 	if(Index < 0 || !m_pTele)
 		return false;
-	return m_pTele[Index].m_Type == TILE_TELECHECKINEVIL;
+	return m_vTileAttributes[Index].m_TeleType == TILE_TELECHECKINEVIL;
 }
 
 int CCollision::IsTeleCheckpoint(int Index) const
@@ -663,8 +856,9 @@ int CCollision::IsTeleCheckpoint(int Index) const
 	if(!m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELECHECK)
-		return m_pTele[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_TeleType == TILE_TELECHECK)
+		return Attributes.m_TeleNumber;
 
 	return 0;
 }
@@ -674,8 +868,9 @@ int CCollision::IsTeleportWeapon(int Index) const
 	if(Index < 0 || !m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELEINWEAPON)
-		return m_pTele[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_TeleType == TILE_TELEINWEAPON)
+		return Attributes.m_TeleNumber;
 
 	return 0;
 }
@@ -685,8 +880,9 @@ int CCollision::IsTeleportHook(int Index) const
 	if(Index < 0 || !m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELEINHOOK)
-		return m_pTele[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_TeleType == TILE_TELEINHOOK)
+		return Attributes.m_TeleNumber;
 
 	return 0;
 }
@@ -696,7 +892,7 @@ int CCollision::IsSpeedup(int Index) const
 	if(Index < 0 || !m_pSpeedup)
 		return 0;
 
-	if(m_pSpeedup[Index].m_Force > 0)
+	if(m_vTileAttributes[Index].m_SpeedupForce > 0)
 		return Index;
 
 	return 0;
@@ -707,21 +903,19 @@ int CCollision::IsTune(int Index) const
 	if(Index < 0 || !m_pTune)
 		return 0;
 
-	if(m_pTune[Index].m_Type)
-		return m_pTune[Index].m_Number;
-
-	return 0;
+	return m_vTileAttributes[Index].m_TuneNumber;
 }
 
 void CCollision::GetSpeedup(int Index, vec2 *pDir, int *pForce, int *pMaxSpeed) const
 {
 	if(Index < 0 || !m_pSpeedup)
 		return;
-	float Angle = m_pSpeedup[Index].m_Angle * (pi / 180.0f);
-	*pForce = m_pSpeedup[Index].m_Force;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	float Angle = Attributes.m_SpeedupAngle * (pi / 180.0f);
+	*pForce = Attributes.m_SpeedupForce;
 	*pDir = direction(Angle);
 	if(pMaxSpeed)
-		*pMaxSpeed = m_pSpeedup[Index].m_MaxSpeed;
+		*pMaxSpeed = Attributes.m_SpeedupMaxSpeed;
 }
 
 int CCollision::GetSwitchType(int Index) const
@@ -729,10 +923,7 @@ int CCollision::GetSwitchType(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
-	if(m_pSwitch[Index].m_Type > 0)
-		return m_pSwitch[Index].m_Type;
-
-	return 0;
+	return m_vTileAttributes[Index].m_SwitchType;
 }
 
 int CCollision::GetSwitchNumber(int Index) const
@@ -740,8 +931,9 @@ int CCollision::GetSwitchNumber(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
-	if(m_pSwitch[Index].m_Type > 0 && m_pSwitch[Index].m_Number > 0)
-		return m_pSwitch[Index].m_Number;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_SwitchType > 0 && Attributes.m_SwitchNumber > 0)
+		return Attributes.m_SwitchNumber;
 
 	return 0;
 }
@@ -751,8 +943,9 @@ int CCollision::GetSwitchDelay(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
-	if(m_pSwitch[Index].m_Type > 0)
-		return m_pSwitch[Index].m_Delay;
+	const CTileAttributes &Attributes = m_vTileAttributes[Index];
+	if(Attributes.m_SwitchType > 0)
+		return Attributes.m_SwitchDelay;
 
 	return 0;
 }
@@ -909,13 +1102,15 @@ std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxI
 	else
 	{
 		int LastIndex = 0;
-		for(int i = 0; i < End; i++)
-		{
-			float a = i / d;
-			vec2 Tmp = mix(PrevPos, Pos, a);
+		const CLinePoints Points(PrevPos, Pos, d, End - 1);
+		const auto TileKey = [this](vec2 Tmp) {
 			int Nx = clamp((int)Tmp.x / 32, 0, m_Width - 1);
 			int Ny = clamp((int)Tmp.y / 32, 0, m_Height - 1);
-			int Index = Ny * m_Width + Nx;
+			return Ny * m_Width + Nx;
+		};
+		for(int i = 0; i < End; i = Points.LastWithKey(i, TileKey) + 1)
+		{
+			int Index = TileKey(Points.Point(i));
 			if(TileExists(Index) && LastIndex != Index)
 			{
 				if(MaxIndices && vIndices.size() > MaxIndices)
@@ -1152,12 +1347,13 @@ void ThroughOffset(vec2 Pos0, vec2 Pos1, int *pOffsetX, int *pOffsetY)
 int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
+	int id = std::ceil(d);
+	const CLinePoints Points(Pos0, Pos1, d, id - 1);
+	const auto TileKey = [this](vec2 Pos) { return GetPureMapIndex(Pos); };
 
-	for(int i = 0, id = std::ceil(d); i < id; i++)
+	for(int i = 0; i < id; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = (int)i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
 		int Nx = clamp(round_to_int(Pos.x) / 32, 0, m_Width - 1);
 		int Ny = clamp(round_to_int(Pos.y) / 32, 0, m_Height - 1);
 		if(GetIndex(Nx, Ny) == TILE_SOLID || GetIndex(Nx, Ny) == TILE_NOHOOK || GetIndex(Nx, Ny) == TILE_NOLASER || GetFIndex(Nx, Ny) == TILE_NOLASER)
@@ -1165,13 +1361,12 @@ int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i == 0 ? Pos0 : Points.Point(i - 1);
 			if(GetFIndex(Nx, Ny) == TILE_NOLASER)
 				return GetFCollisionAt(Pos.x, Pos.y);
 			else
 				return GetCollisionAt(Pos.x, Pos.y);
 		}
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -1183,24 +1378,24 @@ int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2
 int CCollision::IntersectNoLaserNW(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
+	int id = std::ceil(d);
+	const CLinePoints Points(Pos0, Pos1, d, id - 1);
+	const auto TileKey = [this](vec2 Pos) { return GetPureMapIndex(Pos); };
 
-	for(int i = 0, id = std::ceil(d); i < id; i++)
+	for(int i = 0; i < id; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = (float)i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
 		if(IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)) || IsFNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
 		{
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i == 0 ? Pos0 : Points.Point(i - 1);
 			if(IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
 				return GetCollisionAt(Pos.x, Pos.y);
 			else
 				return GetFCollisionAt(Pos.x, Pos.y);
 		}
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -1212,18 +1407,19 @@ int CCollision::IntersectNoLaserNW(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, ve
 int CCollision::IntersectAir(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
+	int id = std::ceil(d);
+	const CLinePoints Points(Pos0, Pos1, d, id - 1);
+	const auto TileKey = [this](vec2 Pos) { return GetPureMapIndex(Pos); };
 
-	for(int i = 0, id = std::ceil(d); i < id; i++)
+	for(int i = 0; i < id; i = Points.LastWithKey(i, TileKey) + 1)
 	{
-		float a = (float)i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = Points.Point(i);
 		if(IsSolid(round_to_int(Pos.x), round_to_int(Pos.y)) || (!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)) && !GetFTile(round_to_int(Pos.x), round_to_int(Pos.y))))
 		{
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i == 0 ? Pos0 : Points.Point(i - 1);
 			if(!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)) && !GetFTile(round_to_int(Pos.x), round_to_int(Pos.y)))
 				return -1;
 			else if(!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)))
@@ -1231,7 +1427,6 @@ int CCollision::IntersectAir(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pO
 			else
 				return GetFTile(round_to_int(Pos.x), round_to_int(Pos.y));
 		}
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
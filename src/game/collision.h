@@ -21,6 +21,44 @@ vec2 ClampVel(int MoveRestriction, vec2 Vel);
 typedef bool (*CALLBACK_SWITCHACTIVE)(int Number, void *pUser);
 struct CAntibotMapData;
 
+// Positions of the tele outs of one type, grouped by their tele number in
+// one array. The positions of a number are in the order of the tele layer,
+// tele outs without a number are left out.
+class CTeleOuts
+{
+public:
+	void Init(const class CTeleTile *pTele, int Width, int Height, int Type);
+	void Clear();
+	// number of tele outs with the tele number, 0 for invalid numbers
+	int Num(int Number) const { return Number >= 0 && Number < NUM_NUMBERS ? m_aOffsets[Number + 1] - m_aOffsets[Number] : 0; }
+	vec2 Get(int Number, int Index) const { return m_vPositions[m_aOffsets[Number] + Index]; }
+
+private:
+	enum
+	{
+		NUM_NUMBERS = 256,
+	};
+	// positions of number `i` are `m_aOffsets[i]` to `m_aOffsets[i + 1]`
+	int m_aOffsets[NUM_NUMBERS + 1] = {};
+	std::vector<vec2> m_vPositions;
+};
+
+// Tele, speedup, switch and tune attributes of a tile, packed together so
+// looking up all of them only touches one record instead of four layers.
+struct CTileAttributes
+{
+	unsigned char m_TeleType;
+	unsigned char m_TeleNumber;
+	unsigned char m_SwitchType;
+	unsigned char m_SwitchNumber;
+	unsigned char m_SwitchDelay;
+	unsigned char m_SpeedupForce;
+	unsigned char m_SpeedupMaxSpeed;
+	// 0 if the tile has no tune type
+	unsigned char m_TuneNumber;
+	short m_SpeedupAngle;
+};
+
 class CCollision
 {
 	class CTile *m_pTiles;
@@ -44,6 +82,9 @@ public:
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elasticity, bool *pGrounded = nullptr) const;
 	bool TestBox(vec2 Pos, vec2 Size) const;
+	// MoveBox skips the tile lookups of steps that stay within tiles that
+	// are known to be free, this gives the same results as testing every step
+	void SetMoveBoxTestAllSteps(bool TestAllSteps) { m_MoveBoxTestAllSteps = TestAllSteps; }
 
 	// DDRace
 
@@ -95,6 +136,10 @@ public:
 	int GetSwitchType(int Index) const;
 	int GetSwitchNumber(int Index) const;
 	int GetSwitchDelay(int Index) const;
+	// nullptr if the map has none of these layers
+	const CTileAttributes *TileAttributes(int Index) const { return Index >= 0 && !m_vTileAttributes.empty() ? &m_vTileAttributes[Index] : nullptr; }
+	const CTeleOuts &TeleOuts() const { return m_TeleOuts; }
+	const CTeleOuts &TeleCheckOuts() const { return m_TeleCheckOuts; }
 
 	int IsSolid(int x, int y) const;
 	bool IsThrough(int x, int y, int xoff, int yoff, vec2 pos0, vec2 pos1) const;
@@ -123,6 +168,12 @@ private:
 	class CSwitchTile *m_pSwitch;
 	class CTuneTile *m_pTune;
 	class CDoorTile *m_pDoor;
+
+	std::vector<CTileAttributes> m_vTileAttributes;
+	CTeleOuts m_TeleOuts;
+	CTeleOuts m_TeleCheckOuts;
+
+	bool m_MoveBoxTestAllSteps;
 };
 
 void ThroughOffset(vec2 Pos0, vec2 Pos1, int *pOffsetX, int *pOffsetY);
@@ -243,15 +243,16 @@ class CDataFileWriterFinishJob : public IJob
 	char m_aRealFileName[IO_MAX_PATH_LENGTH];
 	char m_aTempFileName[IO_MAX_PATH_LENGTH];
 	CDataFileWriter m_Writer;
+	CJobPool *m_pJobPool;
 
 	void Run() override
 	{
-		m_Writer.Finish();
+		m_Writer.Finish(m_pJobPool);
 	}
 
 public:
-	CDataFileWriterFinishJob(const char *pRealFileName, const char *pTempFileName, CDataFileWriter &&Writer) :
-		m_Writer(std::move(Writer))
+	CDataFileWriterFinishJob(const char *pRealFileName, const char *pTempFileName, CDataFileWriter &&Writer, CJobPool *pJobPool) :
+		m_Writer(std::move(Writer)), m_pJobPool(pJobPool)
 	{
 		str_copy(m_aRealFileName, pRealFileName);
 		str_copy(m_aTempFileName, pTempFileName);
@@ -4,6 +4,7 @@
 #include <engine/console.h>
 #include <engine/graphics.h>
 #include <engine/serverbrowser.h>
+#include <engine/shared/config.h>
 #include <engine/shared/datafile.h>
 #include <engine/sound.h>
 #include <engine/storage.h>
@@ -124,12 +125,12 @@ bool CEditorMap::Save(const char *pFileName)
 					pDataRGBA[j * PixelSize + 2] = pDataRGB[j * 3 + 2];
 					pDataRGBA[j * PixelSize + 3] = 255;
 				}
-				Item.m_ImageData = Writer.AddData(DataSize, pDataRGBA);
+				Item.m_ImageData = Writer.AddData(DataSize, pDataRGBA, g_Config.m_EdImageCompressionLevel);
 				free(pDataRGBA);
 			}
 			else
 			{
-				Item.m_ImageData = Writer.AddData(DataSize, pImg->m_pData);
+				Item.m_ImageData = Writer.AddData(DataSize, pImg->m_pData, g_Config.m_EdImageCompressionLevel);
 			}
 		}
 		Writer.AddItem(MAPITEMTYPE_IMAGE, i, sizeof(Item), &Item);
@@ -396,7 +397,7 @@ bool CEditorMap::Save(const char *pFileName)
 	}
 
 	// finish the data file
-	std::shared_ptr<CDataFileWriterFinishJob> pWriterFinishJob = std::make_shared<CDataFileWriterFinishJob>(pFileName, aFileNameTmp, std::move(Writer));
+	std::shared_ptr<CDataFileWriterFinishJob> pWriterFinishJob = std::make_shared<CDataFileWriterFinishJob>(pFileName, aFileNameTmp, std::move(Writer), m_pEditor->Engine()->JobPool());
 	m_pEditor->Engine()->AddJob(pWriterFinishJob);
 	m_pEditor->m_WriterFinishJobs.push_back(pWriterFinishJob);
 
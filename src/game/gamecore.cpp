@@ -69,7 +69,7 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 	return 1.0f / std::pow(Curvature, (Value - Start) / Range);
 }
 
-void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision, CTeamsCore *pTeams, std::map<int, std::vector<vec2>> *pTeleOuts)
+void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision, CTeamsCore *pTeams, const CTeleOuts *pTeleOuts)
 {
 	m_pWorld = pWorld;
 	m_pCollision = pCollision;
@@ -288,9 +288,15 @@ void CCharacterCore::Tick(bool UseInput, bool DoDeferredTick)
 		// Check against other players first
 		if(!this->m_HookHitDisabled && m_pWorld && m_Tuning.m_PlayerHooking)
 		{
+			// only players close to the hook's path can be hit, with a
+			// margin for rounding
+			const vec2 Radius = vec2(PhysicalSize() + 3.0f, PhysicalSize() + 3.0f);
+			const uint64_t Candidates = m_pWorld->CharactersInBox(vec2(minimum(m_HookPos.x, NewPos.x), minimum(m_HookPos.y, NewPos.y)) - Radius, vec2(maximum(m_HookPos.x, NewPos.x), maximum(m_HookPos.y, NewPos.y)) + Radius);
 			float Distance = 0.0f;
 			for(int i = 0; i < MAX_CLIENTS; i++)
 			{
+				if(!(Candidates & ((uint64_t)1 << i)))
+					continue;
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 				if(!pCharCore || pCharCore == this || (!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo)))
 					continue;
@@ -326,14 +332,14 @@ void CCharacterCore::Tick(bool UseInput, bool DoDeferredTick)
 				m_HookState = HOOK_RETRACT_START;
 			}
 
-			if(GoingThroughTele && m_pWorld && m_pTeleOuts && !m_pTeleOuts->empty() && !(*m_pTeleOuts)[teleNr - 1].empty())
+			if(GoingThroughTele && m_pWorld && m_pTeleOuts && m_pTeleOuts->Num(teleNr))
 			{
 				m_TriggeredEvents = 0;
 				SetHookedPlayer(-1);
 
 				m_NewHook = true;
-				int RandomOut = m_pWorld->RandomOr0((*m_pTeleOuts)[teleNr - 1].size());
-				m_HookPos = (*m_pTeleOuts)[teleNr - 1][RandomOut] + TargetDirection * PhysicalSize() * 1.5f;
+				int RandomOut = m_pWorld->RandomOr0(m_pTeleOuts->Num(teleNr));
+				m_HookPos = m_pTeleOuts->Get(teleNr, RandomOut) + TargetDirection * PhysicalSize() * 1.5f;
 				m_HookDir = TargetDirection;
 				m_HookTeleBase = m_HookPos;
 			}
@@ -405,8 +411,16 @@ void CCharacterCore::TickDeferred()
 {
 	if(m_pWorld)
 	{
+		// players further away than the collision distance only matter if
+		// they are hooked
+		const vec2 Radius = vec2(PhysicalSize() * 1.25f + 1.0f, PhysicalSize() * 1.25f + 1.0f);
+		uint64_t Candidates = m_pWorld->CharactersInBox(m_Pos - Radius, m_Pos + Radius);
+		if(m_HookedPlayer >= 0 && m_HookedPlayer < MAX_CLIENTS)
+			Candidates |= (uint64_t)1 << m_HookedPlayer;
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
+			if(!(Candidates & ((uint64_t)1 << i)))
+				continue;
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 			if(!pCharCore)
 				continue;
@@ -515,14 +529,21 @@ void CCharacterCore::Move()
 		float Distance = distance(m_Pos, NewPos);
 		if(Distance > 0)
 		{
+			const vec2 Radius = vec2(PhysicalSize() + 1.0f, PhysicalSize() + 1.0f);
+			uint64_t Candidates = m_pWorld->CharactersInBox(vec2(minimum(m_Pos.x, NewPos.x), minimum(m_Pos.y, NewPos.y)) - Radius, vec2(maximum(m_Pos.x, NewPos.x), maximum(m_Pos.y, NewPos.y)) + Radius);
+			// skip the steps if no one else is close
+			if(m_Id >= 0 && m_Id < MAX_CLIENTS && m_pWorld->m_apCharacters[m_Id] == this)
+				Candidates &= ~((uint64_t)1 << m_Id);
 			int End = Distance + 1;
 			vec2 LastPos = m_Pos;
-			for(int i = 0; i < End; i++)
+			for(int i = 0; i < End && Candidates; i++)
 			{
 				float a = i / Distance;
 				vec2 Pos = mix(m_Pos, NewPos, a);
 				for(int p = 0; p < MAX_CLIENTS; p++)
 				{
+					if(!(Candidates & ((uint64_t)1 << p)))
+						continue;
 					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
 					if(!pCharCore || pCharCore == this)
 						continue;
@@ -676,7 +697,7 @@ void CCharacterCore::SetTeamsCore(CTeamsCore *pTeams)
 	m_pTeams = pTeams;
 }
 
-void CCharacterCore::SetTeleOuts(std::map<int, std::vector<vec2>> *pTeleOuts)
+void CCharacterCore::SetTeleOuts(const CTeleOuts *pTeleOuts)
 {
 	m_pTeleOuts = pTeleOuts;
 }
@@ -709,3 +730,63 @@ void CWorldCore::InitSwitchers(int HighestSwitchNumber)
 		}
 	}
 }
+
+int CWorldCore::CharacterCell(float Coordinate)
+{
+	// NaN, characters there don't interact with anyone
+	if(Coordinate != Coordinate)
+		return 0;
+	return (int)std::floor(clamp(Coordinate, -1e9f, 1e9f) / CHARACTER_CELL_SIZE);
+}
+
+int CWorldCore::CharacterBucket(int CellX, int CellY)
+{
+	return ((unsigned)CellX * 73856093u ^ (unsigned)CellY * 19349663u) % NUM_CHARACTER_BUCKETS;
+}
+
+void CWorldCore::UpdateCharacterBuckets()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCore = m_apCharacters[i];
+		SBucketedCharacter &Bucketed = m_aBucketedCharacters[i];
+		if(pCore == Bucketed.m_pCore && (!pCore || pCore->m_Pos == Bucketed.m_Pos))
+			continue;
+
+		const uint64_t Bit = (uint64_t)1 << i;
+		if(Bucketed.m_pCore)
+		{
+			m_aCharacterBuckets[Bucketed.m_Bucket] &= ~Bit;
+			m_BucketedCharacters &= ~Bit;
+		}
+		Bucketed.m_pCore = pCore;
+		if(pCore)
+		{
+			Bucketed.m_Pos = pCore->m_Pos;
+			Bucketed.m_Bucket = CharacterBucket(CharacterCell(pCore->m_Pos.x), CharacterCell(pCore->m_Pos.y));
+			m_aCharacterBuckets[Bucketed.m_Bucket] |= Bit;
+			m_BucketedCharacters |= Bit;
+		}
+	}
+}
+
+uint64_t CWorldCore::CharactersInBox(vec2 Min, vec2 Max)
+{
+	UpdateCharacterBuckets();
+	// also catches NaN
+	if(m_NoCharacterBuckets || !(Min.x <= Max.x && Min.y <= Max.y))
+		return m_BucketedCharacters;
+
+	const int MinX = CharacterCell(Min.x);
+	const int MinY = CharacterCell(Min.y);
+	const int MaxX = CharacterCell(Max.x);
+	const int MaxY = CharacterCell(Max.y);
+	if((int64_t)(MaxX - MinX + 1) * (MaxY - MinY + 1) > MAX_CHARACTER_QUERY_CELLS)
+		return m_BucketedCharacters;
+
+	uint64_t Result = 0;
+	for(int y = MinY; y <= MaxY; y++)
+		for(int x = MinX; x <= MaxX; x++)
+			Result |= m_aCharacterBuckets[CharacterBucket(x, y)];
+	return Result;
+}
@@ -17,6 +17,7 @@
 
 class CCollision;
 class CTeamsCore;
+class CTeleOuts;
 
 class CTuneParam
 {
@@ -193,6 +194,9 @@ public:
 	{
 		mem_zero(m_apCharacters, sizeof(m_apCharacters));
 		m_pPrng = nullptr;
+		mem_zero(m_aBucketedCharacters, sizeof(m_aBucketedCharacters));
+		mem_zero(m_aCharacterBuckets, sizeof(m_aCharacterBuckets));
+		m_BucketedCharacters = 0;
 	}
 
 	int RandomOr0(int BelowThis)
@@ -213,13 +217,49 @@ public:
 
 	void InitSwitchers(int HighestSwitchNumber);
 	std::vector<SSwitchers> m_vSwitchers;
+
+	// Returns a bit for each character whose position may be inside the
+	// box, which includes all that are. Characters are kept in buckets by
+	// their position. Entries of `m_apCharacters` that were changed or moved
+	// since the last call are put into their new bucket first, so the
+	// result is always up to date.
+	uint64_t CharactersInBox(vec2 Min, vec2 Max);
+	// return all characters, for comparing against the full scan
+	bool m_NoCharacterBuckets = false;
+
+private:
+	enum
+	{
+		// two tiles
+		CHARACTER_CELL_SIZE = 64,
+		// cells are hashed into a fixed number of buckets, characters in
+		// other cells of the same bucket are checked in vain but found
+		NUM_CHARACTER_BUCKETS = 256,
+		// larger boxes check all characters
+		MAX_CHARACTER_QUERY_CELLS = 16,
+	};
+	static_assert(MAX_CLIENTS <= 64, "characters are stored as bits of an uint64_t");
+
+	struct SBucketedCharacter
+	{
+		const class CCharacterCore *m_pCore;
+		vec2 m_Pos;
+		int m_Bucket;
+	};
+	static int CharacterCell(float Coordinate);
+	static int CharacterBucket(int CellX, int CellY);
+	void UpdateCharacterBuckets();
+
+	SBucketedCharacter m_aBucketedCharacters[MAX_CLIENTS];
+	uint64_t m_aCharacterBuckets[NUM_CHARACTER_BUCKETS];
+	uint64_t m_BucketedCharacters;
 };
 
 class CCharacterCore
 {
 	CWorldCore *m_pWorld = nullptr;
 	CCollision *m_pCollision;
-	std::map<int, std::vector<vec2>> *m_pTeleOuts;
+	const CTeleOuts *m_pTeleOuts;
 
 public:
 	static constexpr float PhysicalSize() { return 28.0f; };
@@ -267,7 +307,7 @@ public:
 
 	int m_TriggeredEvents;
 
-	void Init(CWorldCore *pWorld, CCollision *pCollision, CTeamsCore *pTeams = nullptr, std::map<int, std::vector<vec2>> *pTeleOuts = nullptr);
+	void Init(CWorldCore *pWorld, CCollision *pCollision, CTeamsCore *pTeams = nullptr, const CTeleOuts *pTeleOuts = nullptr);
 	void SetCoreWorld(CWorldCore *pWorld, CCollision *pCollision, CTeamsCore *pTeams);
 	void Reset();
 	void TickDeferred();
@@ -288,7 +328,7 @@ public:
 
 	// DDNet Character
 	void SetTeamsCore(CTeamsCore *pTeams);
-	void SetTeleOuts(std::map<int, std::vector<vec2>> *pTeleOuts);
+	void SetTeleOuts(const CTeleOuts *pTeleOuts);
 	void ReadDDNet(const CNetObj_DDNetCharacter *pObjDDNet);
 	bool m_Solo;
 	bool m_Jetpack;
@@ -349,7 +349,7 @@ void CGameContext::ModifyWeapons(IConsole::IResult *pResult, void *pUserData,
 void CGameContext::Teleport(CCharacter *pChr, vec2 Pos)
 {
 	pChr->Core()->m_Pos = Pos;
-	pChr->m_Pos = Pos;
+	pChr->SetPos(Pos);
 	pChr->m_PrevPos = Pos;
 	pChr->m_DDRaceState = DDRACE_CHEAT;
 }
@@ -359,13 +359,13 @@ void CGameContext::ConToTeleporter(IConsole::IResult *pResult, void *pUserData)
 	CGameContext *pSelf = (CGameContext *)pUserData;
 	unsigned int TeleTo = pResult->GetInteger(0);
 
-	if(!pSelf->m_pController->m_TeleOuts[TeleTo - 1].empty())
+	if(pSelf->Collision()->TeleOuts().Num(TeleTo))
 	{
 		CCharacter *pChr = pSelf->GetPlayerChar(pResult->m_ClientID);
 		if(pChr)
 		{
-			int TeleOut = pSelf->m_World.m_Core.RandomOr0(pSelf->m_pController->m_TeleOuts[TeleTo - 1].size());
-			pSelf->Teleport(pChr, pSelf->m_pController->m_TeleOuts[TeleTo - 1][TeleOut]);
+			int TeleOut = pSelf->m_World.m_Core.RandomOr0(pSelf->Collision()->TeleOuts().Num(TeleTo));
+			pSelf->Teleport(pChr, pSelf->Collision()->TeleOuts().Get(TeleTo, TeleOut));
 		}
 	}
 }
@@ -375,13 +375,13 @@ void CGameContext::ConToCheckTeleporter(IConsole::IResult *pResult, void *pUserD
 	CGameContext *pSelf = (CGameContext *)pUserData;
 	unsigned int TeleTo = pResult->GetInteger(0);
 
-	if(!pSelf->m_pController->m_TeleCheckOuts[TeleTo - 1].empty())
+	if(pSelf->Collision()->TeleCheckOuts().Num(TeleTo))
 	{
 		CCharacter *pChr = pSelf->GetPlayerChar(pResult->m_ClientID);
 		if(pChr)
 		{
-			int TeleOut = pSelf->m_World.m_Core.RandomOr0(pSelf->m_pController->m_TeleCheckOuts[TeleTo - 1].size());
-			pSelf->Teleport(pChr, pSelf->m_pController->m_TeleCheckOuts[TeleTo - 1][TeleOut]);
+			int TeleOut = pSelf->m_World.m_Core.RandomOr0(pSelf->Collision()->TeleCheckOuts().Num(TeleTo));
+			pSelf->Teleport(pChr, pSelf->Collision()->TeleCheckOuts().Get(TeleTo, TeleOut));
 			pChr->m_TeleCheckpoint = TeleTo;
 		}
 	}
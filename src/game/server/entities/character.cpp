@@ -65,7 +65,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_IsBlueTeleGunTeleport = false;
 
 	m_pPlayer = pPlayer;
-	m_Pos = Pos;
+	SetPos(Pos);
 
 	mem_zero(&m_LatestPrevPrevInput, sizeof(m_LatestPrevPrevInput));
 	m_LatestPrevPrevInput.m_TargetY = -1;
@@ -806,7 +806,7 @@ void CCharacter::TickDeferred()
 	bool StuckAfterMove = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
 	m_Core.Quantize();
 	bool StuckAfterQuant = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
-	m_Pos = m_Core.m_Pos;
+	SetPos(m_Core.m_Pos);
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -860,8 +860,7 @@ void CCharacter::TickDeferred()
 
 	if(m_pPlayer->GetTeam() == TEAM_SPECTATORS)
 	{
-		m_Pos.x = m_Input.m_TargetX;
-		m_Pos.y = m_Input.m_TargetY;
+		SetPos(vec2(m_Input.m_TargetX, m_Input.m_TargetY));
 	}
 
 	// update the m_SendCore if needed
@@ -1280,7 +1279,7 @@ int CCharacter::Team()
 	return Teams()->m_Core.Team(m_pPlayer->GetCID());
 }
 
-void CCharacter::SetTeleports(std::map<int, std::vector<vec2>> *pTeleOuts, std::map<int, std::vector<vec2>> *pTeleCheckOuts)
+void CCharacter::SetTeleports(const CTeleOuts *pTeleOuts, const CTeleOuts *pTeleCheckOuts)
 {
 	m_pTeleOuts = pTeleOuts;
 	m_pTeleCheckOuts = pTeleCheckOuts;
@@ -1821,12 +1820,12 @@ void CCharacter::HandleTiles(int Index)
 	}
 
 	int z = Collision()->IsTeleport(MapIndex);
-	if(!g_Config.m_SvOldTeleportHook && !g_Config.m_SvOldTeleportWeapons && z && !(*m_pTeleOuts)[z - 1].empty())
+	if(!g_Config.m_SvOldTeleportHook && !g_Config.m_SvOldTeleportWeapons && z && m_pTeleOuts->Num(z))
 	{
 		if(m_Core.m_Super)
 			return;
-		int TeleOut = GameWorld()->m_Core.RandomOr0((*m_pTeleOuts)[z - 1].size());
-		m_Core.m_Pos = (*m_pTeleOuts)[z - 1][TeleOut];
+		int TeleOut = GameWorld()->m_Core.RandomOr0(m_pTeleOuts->Num(z));
+		m_Core.m_Pos = m_pTeleOuts->Get(z, TeleOut);
 		if(!g_Config.m_SvTeleportHoldHook)
 		{
 			ResetHook();
@@ -1836,12 +1835,12 @@ void CCharacter::HandleTiles(int Index)
 		return;
 	}
 	int evilz = Collision()->IsEvilTeleport(MapIndex);
-	if(evilz && !(*m_pTeleOuts)[evilz - 1].empty())
+	if(evilz && m_pTeleOuts->Num(evilz))
 	{
 		if(m_Core.m_Super)
 			return;
-		int TeleOut = GameWorld()->m_Core.RandomOr0((*m_pTeleOuts)[evilz - 1].size());
-		m_Core.m_Pos = (*m_pTeleOuts)[evilz - 1][TeleOut];
+		int TeleOut = GameWorld()->m_Core.RandomOr0(m_pTeleOuts->Num(evilz));
+		m_Core.m_Pos = m_pTeleOuts->Get(evilz, TeleOut);
 		if(!g_Config.m_SvOldTeleportHook && !g_Config.m_SvOldTeleportWeapons)
 		{
 			m_Core.m_Vel = vec2(0, 0);
@@ -1863,12 +1862,12 @@ void CCharacter::HandleTiles(int Index)
 		if(m_Core.m_Super)
 			return;
 		// first check if there is a TeleCheckOut for the current recorded checkpoint, if not check previous checkpoints
-		for(int k = m_TeleCheckpoint - 1; k >= 0; k--)
+		for(int Number = m_TeleCheckpoint; Number > 0; Number--)
 		{
-			if(!(*m_pTeleCheckOuts)[k].empty())
+			if(m_pTeleCheckOuts->Num(Number))
 			{
-				int TeleOut = GameWorld()->m_Core.RandomOr0((*m_pTeleCheckOuts)[k].size());
-				m_Core.m_Pos = (*m_pTeleCheckOuts)[k][TeleOut];
+				int TeleOut = GameWorld()->m_Core.RandomOr0(m_pTeleCheckOuts->Num(Number));
+				m_Core.m_Pos = m_pTeleCheckOuts->Get(Number, TeleOut);
 				m_Core.m_Vel = vec2(0, 0);
 
 				if(!g_Config.m_SvTeleportHoldHook)
@@ -1900,12 +1899,12 @@ void CCharacter::HandleTiles(int Index)
 		if(m_Core.m_Super)
 			return;
 		// first check if there is a TeleCheckOut for the current recorded checkpoint, if not check previous checkpoints
-		for(int k = m_TeleCheckpoint - 1; k >= 0; k--)
+		for(int Number = m_TeleCheckpoint; Number > 0; Number--)
 		{
-			if(!(*m_pTeleCheckOuts)[k].empty())
+			if(m_pTeleCheckOuts->Num(Number))
 			{
-				int TeleOut = GameWorld()->m_Core.RandomOr0((*m_pTeleCheckOuts)[k].size());
-				m_Core.m_Pos = (*m_pTeleCheckOuts)[k][TeleOut];
+				int TeleOut = GameWorld()->m_Core.RandomOr0(m_pTeleCheckOuts->Num(Number));
+				m_Core.m_Pos = m_pTeleCheckOuts->Get(Number, TeleOut);
 
 				if(!g_Config.m_SvTeleportHoldHook)
 				{
@@ -8,6 +8,7 @@
 
 class CGameTeams;
 class CGameWorld;
+class CTeleOuts;
 class IAntibot;
 struct CAntibotCharacterData;
 
@@ -135,8 +136,8 @@ private:
 	CCharacterCore m_Core;
 	CGameTeams *m_pTeams = nullptr;
 
-	std::map<int, std::vector<vec2>> *m_pTeleOuts = nullptr;
-	std::map<int, std::vector<vec2>> *m_pTeleCheckOuts = nullptr;
+	const CTeleOuts *m_pTeleOuts = nullptr;
+	const CTeleOuts *m_pTeleCheckOuts = nullptr;
 
 	// info for dead reckoning
 	int m_ReckoningTick; // tick that we are performing dead reckoning From
@@ -167,7 +168,7 @@ private:
 public:
 	CGameTeams *Teams() { return m_pTeams; }
 	void SetTeams(CGameTeams *pTeams);
-	void SetTeleports(std::map<int, std::vector<vec2>> *pTeleOuts, std::map<int, std::vector<vec2>> *pTeleCheckOuts);
+	void SetTeleports(const CTeleOuts *pTeleOuts, const CTeleOuts *pTeleCheckOuts);
 
 	void FillAntibot(CAntibotCharacterData *pData);
 	void Pause(bool Pause);
@@ -196,6 +196,6 @@ void CPickup::Move()
 		{
 			m_Core = GameServer()->Collision()->CpSpeed(index, Flags);
 		}
-		m_Pos += m_Core;
+		SetPos(m_Pos + m_Core);
 	}
 }
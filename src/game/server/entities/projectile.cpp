@@ -276,10 +276,10 @@ void CProjectile::Tick()
 		z = GameServer()->Collision()->IsTeleport(x);
 	else
 		z = GameServer()->Collision()->IsTeleportWeapon(x);
-	if(z && !GameServer()->m_pController->m_TeleOuts[z - 1].empty())
+	if(z && GameServer()->Collision()->TeleOuts().Num(z))
 	{
-		int TeleOut = GameServer()->m_World.m_Core.RandomOr0(GameServer()->m_pController->m_TeleOuts[z - 1].size());
-		m_Pos = GameServer()->m_pController->m_TeleOuts[z - 1][TeleOut];
+		int TeleOut = GameServer()->m_World.m_Core.RandomOr0(GameServer()->Collision()->TeleOuts().Num(z));
+		m_Pos = GameServer()->Collision()->TeleOuts().Get(z, TeleOut);
 		m_StartTick = Server()->Tick();
 	}
 }
@@ -22,6 +22,10 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 
 	m_pPrevTypeEntity = 0;
 	m_pNextTypeEntity = 0;
+
+	m_InsertOrder = 0;
+	m_GridCell = -1;
+	m_GridSlot = -1;
 }
 
 CEntity::~CEntity()
@@ -22,6 +22,7 @@ class CEntity
 
 private:
 	friend CGameWorld; // entity list handling
+	friend CSpatialGrid<CEntity>;
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
 
@@ -32,6 +33,11 @@ private:
 	int m_ID;
 	int m_ObjType;
 
+	/* Spatial grid, see CSpatialGrid */
+	int64_t m_InsertOrder;
+	int m_GridCell;
+	int m_GridSlot;
+
 	/*
 		Variable: m_ProximityRadius
 			Contains the physical size of the entity.
@@ -75,6 +81,16 @@ public: // TODO: Maybe make protected
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
 
+	/* Setters */
+
+	/*
+		Function: SetPos
+			Moves the entity. Characters and pickups are tracked in the
+			spatial grid of the world and have to be moved with this
+			instead of writing m_Pos.
+	*/
+	void SetPos(vec2 Pos) { m_pGameWorld->MoveEntity(this, Pos); }
+
 	/* Other functions */
 
 	/*
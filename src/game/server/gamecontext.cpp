@@ -167,6 +167,12 @@ void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUse
 	aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
 }
 
+void CGameContext::TeeHistorianIndexWrite(const void *pData, int DataSize, void *pUser)
+{
+	CGameContext *pSelf = (CGameContext *)pUser;
+	aio_write(pSelf->m_pTeeHistorianIndexFile, pData, DataSize);
+}
+
 void CGameContext::CommandCallback(int ClientID, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser)
 {
 	CGameContext *pSelf = (CGameContext *)pUser;
@@ -1195,6 +1201,9 @@ void CGameContext::OnTick()
 		m_SqlRandomMapResult = nullptr;
 	}
 
+	if(m_pScore)
+		m_pScore->OnTick();
+
 	// Record player position at the end of the tick
 	if(m_TeeHistorianActive)
 	{
@@ -3502,6 +3511,7 @@ void CGameContext::OnInit(const void *pPersistentData)
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	m_World.InitGrid(&m_Collision);
 	m_World.m_pTuningList = m_aTuningList;
 	m_World.m_Core.InitSwitchers(m_Collision.m_HighestSwitchNumber);
 
@@ -3609,8 +3619,9 @@ void CGameContext::OnInit(const void *pPersistentData)
 		char aGameUuid[UUID_MAXSTRSIZE];
 		FormatUuid(m_GameUuid, aGameUuid, sizeof(aGameUuid));
 
+		const bool Compress = g_Config.m_SvTeeHistorianCompression > 0;
 		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian", aGameUuid);
+		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian%s", aGameUuid, Compress ? ".gz" : "");
 
 		IOHANDLE THFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 		if(!THFile)
@@ -3623,7 +3634,22 @@ void CGameContext::OnInit(const void *pPersistentData)
 		{
 			dbg_msg("teehistorian", "recording to '%s'", aFilename);
 		}
-		m_pTeeHistorianFile = aio_new(THFile);
+		if(Compress)
+		{
+			if(m_TeeHistorianCompressor.Init(g_Config.m_SvTeeHistorianCompression))
+			{
+				dbg_msg("teehistorian", "failed to initialize compression");
+				io_close(THFile);
+				Server()->SetErrorShutdown("teehistorian compression error");
+				return;
+			}
+			// compressed on the aio thread
+			m_pTeeHistorianFile = aio_new_with_write_func(THFile, CTeeHistorianCompressor::AioWrite, &m_TeeHistorianCompressor);
+		}
+		else
+		{
+			m_pTeeHistorianFile = aio_new(THFile);
+		}
 
 		char aVersion[128];
 		if(GIT_SHORTREV_HASH)
@@ -3666,6 +3692,24 @@ void CGameContext::OnInit(const void *pPersistentData)
 
 		m_TeeHistorian.Reset(&GameInfo, TeeHistorianWrite, this);
 
+		m_pTeeHistorianIndexFile = nullptr;
+		if(g_Config.m_SvTeeHistorianIndex > 0)
+		{
+			// the index is optional, the game goes on without it
+			char aIndexFilename[IO_MAX_PATH_LENGTH];
+			str_format(aIndexFilename, sizeof(aIndexFilename), "teehistorian/%s.teehistorian.index", aGameUuid);
+			IOHANDLE IndexFile = Storage()->OpenFile(aIndexFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+			if(IndexFile)
+			{
+				m_pTeeHistorianIndexFile = aio_new(IndexFile);
+				m_TeeHistorian.EnableIndex(g_Config.m_SvTeeHistorianIndex, TeeHistorianIndexWrite, this);
+			}
+			else
+			{
+				dbg_msg("teehistorian", "failed to open index '%s'", aIndexFilename);
+			}
+		}
+
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
 			int Level = Server()->GetAuthedState(i);
@@ -3948,6 +3992,18 @@ void CGameContext::OnShutdown(void *pPersistentData)
 			Server()->SetErrorShutdown("teehistorian close error");
 		}
 		aio_free(m_pTeeHistorianFile);
+
+		if(m_pTeeHistorianIndexFile)
+		{
+			aio_close(m_pTeeHistorianIndexFile);
+			aio_wait(m_pTeeHistorianIndexFile);
+			Error = aio_error(m_pTeeHistorianIndexFile);
+			if(Error)
+			{
+				dbg_msg("teehistorian", "error writing index, err=%d", Error);
+			}
+			aio_free(m_pTeeHistorianIndexFile);
+		}
 	}
 
 	// Stop any demos being recorded.
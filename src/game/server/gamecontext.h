@@ -5,6 +5,7 @@
 
 #include <engine/console.h>
 #include <engine/server.h>
+#include <engine/shared/teehistorian_file.h>
 
 #include <game/collision.h>
 #include <game/generated/protocol.h>
@@ -95,6 +96,8 @@ class CGameContext : public IGameServer
 	bool m_TeeHistorianActive;
 	CTeeHistorian m_TeeHistorian;
 	ASYNCIO *m_pTeeHistorianFile;
+	CTeeHistorianCompressor m_TeeHistorianCompressor;
+	ASYNCIO *m_pTeeHistorianIndexFile;
 	CUuid m_GameUuid;
 	CMapBugs m_MapBugs;
 	CPrng m_Prng;
@@ -103,6 +106,7 @@ class CGameContext : public IGameServer
 
 	static void CommandCallback(int ClientID, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser);
 	static void TeeHistorianWrite(const void *pData, int DataSize, void *pUser);
+	static void TeeHistorianIndexWrite(const void *pData, int DataSize, void *pUser);
 
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConToggleTuneParam(IConsole::IResult *pResult, void *pUserData);
@@ -8,7 +8,6 @@
 #include <engine/shared/protocol.h>
 #include <game/server/teams.h>
 
-#include <map>
 #include <vector>
 
 struct CScoreLoadBestTimeResult;
@@ -149,13 +148,10 @@ public:
 	int ClampTeam(int Team);
 
 	CClientMask GetMaskForPlayerWorldEvent(int Asker, int ExceptID = -1);
-	virtual void InitTeleporter();
 
 	// DDRace
 
 	float m_CurrentRecord;
-	std::map<int, std::vector<vec2>> m_TeleOuts;
-	std::map<int, std::vector<vec2>> m_TeleCheckOuts;
 	CGameTeams &Teams() { return m_Teams; }
 	std::shared_ptr<CScoreLoadBestTimeResult> m_pLoadBestTimeResult;
 };
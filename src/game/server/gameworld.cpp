@@ -9,6 +9,8 @@
 
 #include <engine/shared/config.h>
 
+#include <game/collision.h>
+
 #include <algorithm>
 #include <utility>
 
@@ -42,6 +44,42 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 	m_pServer = m_pGameServer->Server();
 }
 
+void CGameWorld::InitGrid(const CCollision *pCollision)
+{
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		if(!IsGridType(Type))
+			continue;
+
+		m_aGrids[Type].Init(pCollision->GetWidth(), pCollision->GetHeight());
+		for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			pEnt->m_GridCell = -1;
+			m_aGrids[Type].Insert(pEnt);
+		}
+	}
+}
+
+void CGameWorld::MoveEntity(CEntity *pEnt, vec2 Pos)
+{
+	pEnt->m_Pos = Pos;
+	m_aGrids[pEnt->m_ObjType].Update(pEnt);
+}
+
+// Returns the entities of a type that might be within the box, in the order
+// of the entity list so that the queries give the same results as a full
+// list scan. Falls back to the full list if the box covers many cells.
+const std::vector<CEntity *> &CGameWorld::GridCandidates(int Type, vec2 Min, vec2 Max)
+{
+	m_vpGridCandidates.clear();
+	if(m_aGrids[Type].Candidates(Min, Max, m_vpGridCandidates))
+		return m_vpGridCandidates;
+
+	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		m_vpGridCandidates.push_back(pEnt);
+	return m_vpGridCandidates;
+}
+
 CEntity *CGameWorld::FindFirst(int Type)
 {
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
@@ -53,6 +91,22 @@ int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max,
 		return 0;
 
 	int Num = 0;
+	if(IsGridType(Type))
+	{
+		for(CEntity *pEnt : GridCandidates(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius)))
+		{
+			if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
+			{
+				if(ppEnts)
+					ppEnts[Num] = pEnt;
+				Num++;
+				if(Num == Max)
+					break;
+			}
+		}
+		return Num;
+	}
+
 	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
 	{
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
@@ -81,6 +135,9 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	pEnt->m_InsertOrder = m_NextInsertOrder++;
+	m_aGrids[pEnt->m_ObjType].Insert(pEnt);
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
@@ -103,6 +160,8 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	m_aGrids[pEnt->m_ObjType].Remove(pEnt);
 }
 
 //
@@ -248,6 +307,13 @@ void CGameWorld::Tick()
 
 	RemoveEntities();
 
+#ifdef CONF_DEBUG
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+		if(m_aGrids[Type].Initialized())
+			for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+				dbg_assert(pEnt->m_GridCell == m_aGrids[Type].Cell(pEnt->m_Pos), "entity moved without CEntity::SetPos");
+#endif
+
 	// find the characters' strong/weak id
 	int StrongWeakID = 0;
 	for(CCharacter *pChar = (CCharacter *)FindFirst(ENTTYPE_CHARACTER); pChar; pChar = (CCharacter *)pChar->TypeNext())
@@ -276,9 +342,11 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CCharacter *pClosest = 0;
 
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	for(CEntity *pEnt : GridCandidates(ENTTYPE_CHARACTER, Min, Max))
 	{
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
 			continue;
 
@@ -314,9 +382,9 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 	float ClosestRange = Radius * 2;
 	CCharacter *pClosest = 0;
 
-	CCharacter *p = (CCharacter *)GameServer()->m_World.FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
+	for(CEntity *pEnt : GridCandidates(ENTTYPE_CHARACTER, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius)))
 	{
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
 			continue;
 
@@ -337,9 +405,11 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	for(CEntity *pEnt : GridCandidates(ENTTYPE_CHARACTER, Min, Max))
 	{
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
 			continue;
 
@@ -5,8 +5,12 @@
 
 #include <game/gamecore.h>
 
+#include "spatial_grid.h"
+
+#include <cstdint>
 #include <vector>
 
+class CCollision;
 class CEntity;
 class CCharacter;
 
@@ -34,6 +38,14 @@ private:
 
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	int64_t m_NextInsertOrder = 0;
+
+	// spatial grids of the entity types that are looked up by position
+	static bool IsGridType(int Type) { return Type == ENTTYPE_CHARACTER || Type == ENTTYPE_PICKUP; }
+	const std::vector<CEntity *> &GridCandidates(int Type, vec2 Min, vec2 Max);
+
+	CSpatialGrid<CEntity> m_aGrids[NUM_ENTTYPES];
+	std::vector<CEntity *> m_vpGridCandidates;
 
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
@@ -53,6 +65,15 @@ public:
 
 	void SetGameServer(CGameContext *pGameServer);
 
+	/*
+		Function: InitGrid
+			Sizes the spatial grid used by the position queries to the map.
+
+		Arguments:
+			pCollision - Collision of the loaded map.
+	*/
+	void InitGrid(const CCollision *pCollision);
+
 	CEntity *FindFirst(int Type);
 
 	/*
@@ -119,6 +140,17 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: MoveEntity
+			Sets the position of an entity and updates the spatial grid.
+			Use <CEntity::SetPos> instead of calling this directly.
+
+		Arguments:
+			pEntity - Entity to move
+			Pos - New position
+	*/
+	void MoveEntity(CEntity *pEntity, vec2 Pos);
+
 	void RemoveEntitiesFromPlayer(int PlayerId);
 	void RemoveEntitiesFromPlayers(int PlayerIds[], int NumPlayers);
 
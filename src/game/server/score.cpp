@@ -71,7 +71,8 @@ void CScore::GeneratePassphrase(char *pBuf, int BufSize)
 CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	m_pPool(pPool),
 	m_pGameServer(pGameServer),
-	m_pServer(pGameServer->Server())
+	m_pServer(pGameServer->Server()),
+	m_ScoreBatchStart(0)
 {
 	LoadBestTime();
 
@@ -108,6 +109,38 @@ CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	}
 }
 
+CScore::~CScore()
+{
+	FlushScores();
+}
+
+void CScore::OnTick()
+{
+	if(m_pScoreBatch != nullptr && time_get() - m_ScoreBatchStart >= (int64_t)g_Config.m_SvSqlBatchWindow * time_freq() / 1000)
+		FlushScores();
+}
+
+CSqlScoreBatch *CScore::ScoreBatch()
+{
+	if(m_pScoreBatch != nullptr && m_pScoreBatch->NumItems() >= MAX_BATCH_SCORES)
+		FlushScores();
+	if(m_pScoreBatch == nullptr)
+	{
+		m_pScoreBatch = std::make_unique<CSqlScoreBatch>();
+		m_ScoreBatchStart = time_get();
+	}
+	return m_pScoreBatch.get();
+}
+
+void CScore::FlushScores()
+{
+	if(m_pScoreBatch == nullptr)
+		return;
+	// all batches go to the same worker to save the finishes of a player in
+	// order, the pool belongs to this server which runs one map at a time
+	m_pPool->ExecuteWrite(CScoreWorker::SaveScores, std::move(m_pScoreBatch), "save scores", "scores");
+}
+
 void CScore::LoadBestTime()
 {
 	if(m_pGameServer->m_pController->m_pLoadBestTimeResult)
@@ -160,7 +193,7 @@ void CScore::SaveScore(int ClientID, float Time, const char *pTimestamp, const f
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCurrentTimeCp[i] = aTimeCp[i];
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score");
+	ScoreBatch()->m_vpScores.push_back(std::move(Tmp));
 }
 
 void CScore::SaveTeamScore(int *pClientIDs, unsigned int Size, float Time, const char *pTimestamp)
@@ -183,7 +216,7 @@ void CScore::SaveTeamScore(int *pClientIDs, unsigned int Size, float Time, const
 	str_copy(Tmp->m_aMap, g_Config.m_SvMap, sizeof(Tmp->m_aMap));
 	Tmp->m_TeamrankUuid = RandomUuid();
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveTeamScore, std::move(Tmp), "save team score");
+	ScoreBatch()->m_vpTeamScores.push_back(std::move(Tmp));
 }
 
 void CScore::ShowRank(int ClientID, const char *pName)
@@ -319,7 +352,10 @@ void CScore::SaveTeam(int ClientID, const char *pCode, const char *pServer)
 	}
 	pController->Teams().KillSavedTeam(ClientID, Team);
 	GameServer()->SendChatTeam(Team, aBuf);
-	m_pPool->ExecuteWrite(CScoreWorker::SaveTeam, std::move(Tmp), "save team");
+	// keep saves and loads of the same code in order
+	char aShardKey[128];
+	str_copy(aShardKey, Tmp->m_aCode[0] != '\0' ? Tmp->m_aCode : Tmp->m_aGeneratedCode, sizeof(aShardKey));
+	m_pPool->ExecuteWrite(CScoreWorker::SaveTeam, std::move(Tmp), "save team", aShardKey);
 }
 
 void CScore::LoadTeam(const char *pCode, int ClientID)
@@ -359,7 +395,7 @@ void CScore::LoadTeam(const char *pCode, int ClientID)
 			Tmp->m_NumPlayer++;
 		}
 	}
-	m_pPool->ExecuteWrite(CScoreWorker::LoadTeam, std::move(Tmp), "load team");
+	m_pPool->ExecuteWrite(CScoreWorker::LoadTeam, std::move(Tmp), "load team", pCode);
 }
 
 void CScore::GetSaves(int ClientID)
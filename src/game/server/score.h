@@ -38,9 +38,22 @@ class CScore
 	// returns true if the player should be rate limited
 	bool RateLimitPlayer(int ClientID);
 
+	enum
+	{
+		MAX_BATCH_SCORES = 64,
+	};
+	// Finishes are collected for sv_sql_batch_window and then saved in one
+	// transaction, e.g. the scores of a whole team finishing together.
+	std::unique_ptr<CSqlScoreBatch> m_pScoreBatch;
+	int64_t m_ScoreBatchStart;
+	CSqlScoreBatch *ScoreBatch();
+	void FlushScores();
+
 public:
 	CScore(CGameContext *pGameServer, CDbConnectionPool *pPool);
-	~CScore() {}
+	~CScore();
+
+	void OnTick();
 
 	CPlayerData *PlayerData(int ID) { return &m_aPlayerData[ID]; }
 
@@ -393,8 +393,6 @@ bool CScoreWorker::MapInfo(IDbConnection *pSqlServer, const ISqlData *pGameData,
 bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlScoreData *>(pGameData);
-	auto *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
 
 	char aBuf[1024];
 
@@ -465,85 +463,114 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 		return false;
 	}
 
-	if(w == Write::NORMAL)
+	if(w == Write::NORMAL && AddFinishPoints(pSqlServer, pData, pError, ErrorSize))
 	{
-		str_format(aBuf, sizeof(aBuf),
-			"SELECT COUNT(*) AS NumFinished FROM %s_race WHERE Map=? AND Name=? ORDER BY time ASC LIMIT 1",
-			pSqlServer->GetPrefix());
+		return true;
+	}
+	return InsertRaces(pSqlServer, &pData, 1, w, pError, ErrorSize);
+}
+
+bool CScoreWorker::AddFinishPoints(IDbConnection *pSqlServer, const CSqlScoreData *pData, char *pError, int ErrorSize)
+{
+	auto *pResult = dynamic_cast<CScorePlayerResult *>(pData->m_pResult.get());
+	auto *paMessages = pResult->m_Data.m_aaMessages;
+
+	char aBuf[1024];
+	str_format(aBuf, sizeof(aBuf),
+		"SELECT COUNT(*) AS NumFinished FROM %s_race WHERE Map=? AND Name=? ORDER BY time ASC LIMIT 1",
+		pSqlServer->GetPrefix());
+	if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+	{
+		return true;
+	}
+	pSqlServer->BindString(1, pData->m_aMap);
+	pSqlServer->BindString(2, pData->m_aName);
+
+	bool End;
+	if(pSqlServer->Step(&End, pError, ErrorSize))
+	{
+		return true;
+	}
+	int NumFinished = pSqlServer->GetInt(1);
+	if(NumFinished == 0)
+	{
+		str_format(aBuf, sizeof(aBuf), "SELECT Points FROM %s_maps WHERE Map=?", pSqlServer->GetPrefix());
 		if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 		{
 			return true;
 		}
 		pSqlServer->BindString(1, pData->m_aMap);
-		pSqlServer->BindString(2, pData->m_aName);
 
-		bool End;
-		if(pSqlServer->Step(&End, pError, ErrorSize))
+		bool End2;
+		if(pSqlServer->Step(&End2, pError, ErrorSize))
 		{
 			return true;
 		}
-		int NumFinished = pSqlServer->GetInt(1);
-		if(NumFinished == 0)
+		if(!End2)
 		{
-			str_format(aBuf, sizeof(aBuf), "SELECT Points FROM %s_maps WHERE Map=?", pSqlServer->GetPrefix());
-			if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+			int Points = pSqlServer->GetInt(1);
+			if(pSqlServer->AddPoints(pData->m_aName, Points, pError, ErrorSize))
 			{
 				return true;
 			}
-			pSqlServer->BindString(1, pData->m_aMap);
-
-			bool End2;
-			if(pSqlServer->Step(&End2, pError, ErrorSize))
-			{
-				return true;
-			}
-			if(!End2)
-			{
-				int Points = pSqlServer->GetInt(1);
-				if(pSqlServer->AddPoints(pData->m_aName, Points, pError, ErrorSize))
-				{
-					return true;
-				}
-				str_format(paMessages[0], sizeof(paMessages[0]),
-					"You earned %d point%s for finishing this map!",
-					Points, Points == 1 ? "" : "s");
-			}
+			str_format(paMessages[0], sizeof(paMessages[0]),
+				"You earned %d point%s for finishing this map!",
+				Points, Points == 1 ? "" : "s");
 		}
 	}
+	return false;
+}
 
-	// save score. Can't fail, because no UNIQUE/PRIMARY KEY constrain is defined.
+bool CScoreWorker::InsertRaces(IDbConnection *pSqlServer, const CSqlScoreData *const *ppData, int Num, Write w, char *pError, int ErrorSize)
+{
+	// save scores. Can't fail, because no UNIQUE/PRIMARY KEY constrain is defined.
+	char aBuf[1024];
 	str_format(aBuf, sizeof(aBuf),
 		"%s INTO %s_race%s("
 		"	Map, Name, Timestamp, Time, Server, "
 		"	cp1, cp2, cp3, cp4, cp5, cp6, cp7, cp8, cp9, cp10, cp11, cp12, cp13, "
 		"	cp14, cp15, cp16, cp17, cp18, cp19, cp20, cp21, cp22, cp23, cp24, cp25, "
 		"	GameID, DDNet7) "
-		"VALUES (?, ?, %s, %.2f, ?, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	?, %s)",
+		"VALUES ",
 		pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
-		w == Write::NORMAL ? "" : "_backup",
-		pSqlServer->InsertTimestampAsUtc(), pData->m_Time,
-		pData->m_aCurrentTimeCp[0], pData->m_aCurrentTimeCp[1], pData->m_aCurrentTimeCp[2],
-		pData->m_aCurrentTimeCp[3], pData->m_aCurrentTimeCp[4], pData->m_aCurrentTimeCp[5],
-		pData->m_aCurrentTimeCp[6], pData->m_aCurrentTimeCp[7], pData->m_aCurrentTimeCp[8],
-		pData->m_aCurrentTimeCp[9], pData->m_aCurrentTimeCp[10], pData->m_aCurrentTimeCp[11],
-		pData->m_aCurrentTimeCp[12], pData->m_aCurrentTimeCp[13], pData->m_aCurrentTimeCp[14],
-		pData->m_aCurrentTimeCp[15], pData->m_aCurrentTimeCp[16], pData->m_aCurrentTimeCp[17],
-		pData->m_aCurrentTimeCp[18], pData->m_aCurrentTimeCp[19], pData->m_aCurrentTimeCp[20],
-		pData->m_aCurrentTimeCp[21], pData->m_aCurrentTimeCp[22], pData->m_aCurrentTimeCp[23],
-		pData->m_aCurrentTimeCp[24], pSqlServer->False());
-	if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		w == Write::NORMAL ? "" : "_backup");
+	std::string Query = aBuf;
+	for(int i = 0; i < Num; i++)
+	{
+		const CSqlScoreData *pData = ppData[i];
+		str_format(aBuf, sizeof(aBuf),
+			"%s(?, ?, %s, %.2f, ?, "
+			"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
+			"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
+			"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
+			"	?, %s)",
+			i == 0 ? "" : ", ",
+			pSqlServer->InsertTimestampAsUtc(), pData->m_Time,
+			pData->m_aCurrentTimeCp[0], pData->m_aCurrentTimeCp[1], pData->m_aCurrentTimeCp[2],
+			pData->m_aCurrentTimeCp[3], pData->m_aCurrentTimeCp[4], pData->m_aCurrentTimeCp[5],
+			pData->m_aCurrentTimeCp[6], pData->m_aCurrentTimeCp[7], pData->m_aCurrentTimeCp[8],
+			pData->m_aCurrentTimeCp[9], pData->m_aCurrentTimeCp[10], pData->m_aCurrentTimeCp[11],
+			pData->m_aCurrentTimeCp[12], pData->m_aCurrentTimeCp[13], pData->m_aCurrentTimeCp[14],
+			pData->m_aCurrentTimeCp[15], pData->m_aCurrentTimeCp[16], pData->m_aCurrentTimeCp[17],
+			pData->m_aCurrentTimeCp[18], pData->m_aCurrentTimeCp[19], pData->m_aCurrentTimeCp[20],
+			pData->m_aCurrentTimeCp[21], pData->m_aCurrentTimeCp[22], pData->m_aCurrentTimeCp[23],
+			pData->m_aCurrentTimeCp[24], pSqlServer->False());
+		Query += aBuf;
+	}
+	// the inlined times make the text unique, don't evict cached statements for it
+	if(pSqlServer->PrepareStatement(Query.c_str(), pError, ErrorSize, false))
 	{
 		return true;
 	}
-	pSqlServer->BindString(1, pData->m_aMap);
-	pSqlServer->BindString(2, pData->m_aName);
-	pSqlServer->BindString(3, pData->m_aTimestamp);
-	pSqlServer->BindString(4, g_Config.m_SvSqlServerName);
-	pSqlServer->BindString(5, pData->m_aGameUuid);
+	for(int i = 0; i < Num; i++)
+	{
+		const CSqlScoreData *pData = ppData[i];
+		pSqlServer->BindString(i * 5 + 1, pData->m_aMap);
+		pSqlServer->BindString(i * 5 + 2, pData->m_aName);
+		pSqlServer->BindString(i * 5 + 3, pData->m_aTimestamp);
+		pSqlServer->BindString(i * 5 + 4, g_Config.m_SvSqlServerName);
+		pSqlServer->BindString(i * 5 + 5, pData->m_aGameUuid);
+	}
 	pSqlServer->Print();
 	int NumInserted;
 	return pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
@@ -668,7 +695,7 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 				str_format(aBuf, sizeof(aBuf),
 					"UPDATE %s_teamrace SET Time=%.2f, Timestamp=%s, DDNet7=%s, GameID=? WHERE ID = ?",
 					pSqlServer->GetPrefix(), pData->m_Time, pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
-				if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+				if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize, false))
 				{
 					return true;
 				}
@@ -688,29 +715,129 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 		}
 	}
 
+	// if no entry found... create a new one
+	str_format(aBuf, sizeof(aBuf),
+		"%s INTO %s_teamrace%s(Map, Name, Timestamp, Time, ID, GameID, DDNet7) "
+		"VALUES ",
+		pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
+		w == Write::NORMAL ? "" : "_backup");
+	std::string Query = aBuf;
 	for(unsigned int i = 0; i < pData->m_Size; i++)
 	{
-		// if no entry found... create a new one
 		str_format(aBuf, sizeof(aBuf),
-			"%s INTO %s_teamrace%s(Map, Name, Timestamp, Time, ID, GameID, DDNet7) "
-			"VALUES (?, ?, %s, %.2f, ?, ?, %s)",
-			pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
-			w == Write::NORMAL ? "" : "_backup",
+			"%s(?, ?, %s, %.2f, ?, ?, %s)",
+			i == 0 ? "" : ", ",
 			pSqlServer->InsertTimestampAsUtc(), pData->m_Time, pSqlServer->False());
-		if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		Query += aBuf;
+	}
+	// the inlined times make the text unique, don't evict cached statements for it
+	if(pSqlServer->PrepareStatement(Query.c_str(), pError, ErrorSize, false))
+	{
+		return true;
+	}
+	// copy uuid, because mysql BindBlob doesn't support const buffers
+	CUuid TeamrankId = pData->m_TeamrankUuid;
+	for(unsigned int i = 0; i < pData->m_Size; i++)
+	{
+		pSqlServer->BindString(i * 5 + 1, pData->m_aMap);
+		pSqlServer->BindString(i * 5 + 2, pData->m_aaNames[i]);
+		pSqlServer->BindString(i * 5 + 3, pData->m_aTimestamp);
+		pSqlServer->BindBlob(i * 5 + 4, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
+		pSqlServer->BindString(i * 5 + 5, pData->m_aGameUuid);
+	}
+	pSqlServer->Print();
+	int NumInserted;
+	return pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
+}
+
+void CSqlScoreBatch::SetCompleted(bool Success) const
+{
+	for(const auto &pScore : m_vpScores)
+		pScore->SetCompleted(Success);
+	for(const auto &pTeamScore : m_vpTeamScores)
+		pTeamScore->SetCompleted(Success);
+}
+
+bool CScoreWorker::SaveScores(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	const auto *pData = dynamic_cast<const CSqlScoreBatch *>(pGameData);
+
+	if(pSqlServer->BeginTransaction(pError, ErrorSize))
+	{
+		return true;
+	}
+	if(SaveScoresImpl(pSqlServer, pData, w, pError, ErrorSize) ||
+		pSqlServer->CommitTransaction(pError, ErrorSize))
+	{
+		// keep the first error message
+		char aRollbackError[256];
+		if(pSqlServer->RollbackTransaction(aRollbackError, sizeof(aRollbackError)))
 		{
-			return true;
+			log_error("sql", "rolling back saving scores failed: %s", aRollbackError);
 		}
-		pSqlServer->BindString(1, pData->m_aMap);
-		pSqlServer->BindString(2, pData->m_aaNames[i]);
-		pSqlServer->BindString(3, pData->m_aTimestamp);
-		// copy uuid, because mysql BindBlob doesn't support const buffers
-		CUuid TeamrankId = pData->m_TeamrankUuid;
-		pSqlServer->BindBlob(4, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
-		pSqlServer->BindString(5, pData->m_aGameUuid);
-		pSqlServer->Print();
-		int NumInserted;
-		if(pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize))
+		return true;
+	}
+	log_debug("sql", "saved %d scores and %d team scores in one transaction",
+		(int)pData->m_vpScores.size(), (int)pData->m_vpTeamScores.size());
+	return false;
+}
+
+bool CScoreWorker::SaveScoresImpl(IDbConnection *pSqlServer, const CSqlScoreBatch *pData, Write w, char *pError, int ErrorSize)
+{
+	// The whole batch was either written or not, so the backup database is
+	// updated for each score on its own.
+	if(w == Write::NORMAL_SUCCEEDED || w == Write::NORMAL_FAILED)
+	{
+		for(const auto &pScore : pData->m_vpScores)
+		{
+			if(SaveScore(pSqlServer, pScore.get(), w, pError, ErrorSize))
+			{
+				return true;
+			}
+		}
+		for(const auto &pTeamScore : pData->m_vpTeamScores)
+		{
+			if(SaveTeamScore(pSqlServer, pTeamScore.get(), w, pError, ErrorSize))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<const CSqlScoreData *> vpScores;
+	for(const auto &pScore : pData->m_vpScores)
+	{
+		if(w == Write::NORMAL)
+		{
+			// the races of this batch aren't inserted yet, so only the first
+			// finish of a player can earn points
+			bool FinishedBefore = false;
+			for(const CSqlScoreData *pPrevious : vpScores)
+			{
+				if(str_comp(pPrevious->m_aMap, pScore->m_aMap) == 0 && str_comp(pPrevious->m_aName, pScore->m_aName) == 0)
+				{
+					FinishedBefore = true;
+					break;
+				}
+			}
+			if(!FinishedBefore && AddFinishPoints(pSqlServer, pScore.get(), pError, ErrorSize))
+			{
+				return true;
+			}
+		}
+		vpScores.push_back(pScore.get());
+	}
+	if(!vpScores.empty() && InsertRaces(pSqlServer, vpScores.data(), vpScores.size(), w, pError, ErrorSize))
+	{
+		return true;
+	}
+
+	// teams are saved one after another, because a team can finish more
+	// than once in a batch and has to find its previous rank
+	for(const auto &pTeamScore : pData->m_vpTeamScores)
+	{
+		if(SaveTeamScore(pSqlServer, pTeamScore.get(), w, pError, ErrorSize))
 		{
 			return true;
 		}
@@ -186,6 +186,21 @@ struct CSqlTeamScoreData : ISqlData
 	CUuid m_TeamrankUuid;
 };
 
+// finishes which are saved together in one transaction
+struct CSqlScoreBatch : ISqlData
+{
+	CSqlScoreBatch() :
+		ISqlData(nullptr)
+	{
+	}
+
+	void SetCompleted(bool Success) const override;
+	int NumItems() const override { return m_vpScores.size() + m_vpTeamScores.size(); }
+
+	std::vector<std::unique_ptr<CSqlScoreData>> m_vpScores;
+	std::vector<std::unique_ptr<CSqlTeamScoreData>> m_vpTeamScores;
+};
+
 struct CSqlTeamSave : ISqlData
 {
 	CSqlTeamSave(std::shared_ptr<CScoreSaveResult> pResult) :
@@ -300,6 +315,14 @@ struct CScoreWorker
 
 	static bool SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
 	static bool SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
+	// saves a CSqlScoreBatch in one transaction, inserting all race records
+	// with a single statement
+	static bool SaveScores(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
+
+private:
+	static bool AddFinishPoints(IDbConnection *pSqlServer, const CSqlScoreData *pData, char *pError, int ErrorSize);
+	static bool InsertRaces(IDbConnection *pSqlServer, const CSqlScoreData *const *ppData, int Num, Write w, char *pError, int ErrorSize);
+	static bool SaveScoresImpl(IDbConnection *pSqlServer, const CSqlScoreBatch *pData, Write w, char *pError, int ErrorSize);
 };
 
 #endif // GAME_SERVER_SCOREWORKER_H
@@ -0,0 +1,151 @@
+#ifndef GAME_SERVER_SPATIAL_GRID_H
+#define GAME_SERVER_SPATIAL_GRID_H
+
+#include <base/math.h>
+#include <base/vmath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+	Class: Spatial Grid
+		Uniform grid over the map for looking up objects by position. Each
+		cell covers CELL_TILES x CELL_TILES tiles, objects outside of the
+		map are put into the closest border cell.
+
+		The objects need `m_Pos`, `m_ProximityRadius` and `m_InsertOrder`,
+		their cell and their slot in it are kept in `m_GridCell` and
+		`m_GridSlot`.
+*/
+template<typename T>
+class CSpatialGrid
+{
+public:
+	enum
+	{
+		CELL_TILES = 8,
+		CELL_SIZE = CELL_TILES * 32,
+	};
+
+	/*
+		Function: Init
+			Sizes the grid to a map and removes all objects.
+
+		Arguments:
+			Width - Width of the map in tiles.
+			Height - Height of the map in tiles.
+	*/
+	void Init(int Width, int Height)
+	{
+		m_Width = maximum(1, (Width + CELL_TILES - 1) / CELL_TILES);
+		m_Height = maximum(1, (Height + CELL_TILES - 1) / CELL_TILES);
+		m_vvpCells.clear();
+		m_vvpCells.resize((size_t)m_Width * m_Height);
+		m_NumObjects = 0;
+		m_MaxProximityRadius = 0.0f;
+	}
+
+	bool Initialized() const { return !m_vvpCells.empty(); }
+
+	int Cell(vec2 Pos) const
+	{
+		return Coord(Pos.y / CELL_SIZE, m_Height) * m_Width + Coord(Pos.x / CELL_SIZE, m_Width);
+	}
+
+	void Insert(T *pObject)
+	{
+		if(!Initialized())
+			return;
+
+		pObject->m_GridCell = Cell(pObject->m_Pos);
+		pObject->m_GridSlot = m_vvpCells[pObject->m_GridCell].size();
+		m_vvpCells[pObject->m_GridCell].push_back(pObject);
+		m_NumObjects++;
+		m_MaxProximityRadius = maximum(m_MaxProximityRadius, (float)pObject->m_ProximityRadius);
+	}
+
+	void Remove(T *pObject)
+	{
+		if(pObject->m_GridCell < 0)
+			return;
+
+		std::vector<T *> &vpCell = m_vvpCells[pObject->m_GridCell];
+		vpCell[pObject->m_GridSlot] = vpCell.back();
+		vpCell[pObject->m_GridSlot]->m_GridSlot = pObject->m_GridSlot;
+		vpCell.pop_back();
+		m_NumObjects--;
+		pObject->m_GridCell = -1;
+		pObject->m_GridSlot = -1;
+	}
+
+	// moves the object to the cell of its current position
+	void Update(T *pObject)
+	{
+		if(pObject->m_GridCell >= 0 && pObject->m_GridCell != Cell(pObject->m_Pos))
+		{
+			Remove(pObject);
+			Insert(pObject);
+		}
+	}
+
+	/*
+		Function: Candidates
+			Collects the objects that might be within a box, newest first.
+
+		Arguments:
+			Min - Top left corner of the box.
+			Max - Bottom right corner of the box.
+			vpCandidates - Vector the objects are appended to.
+
+		Returns:
+			False without collecting anything if the grid is not initialized
+			or the box covers more cells than there are objects. Scanning
+			all objects is cheaper then.
+	*/
+	bool Candidates(vec2 Min, vec2 Max, std::vector<T *> &vpCandidates) const
+	{
+		if(!Initialized())
+			return false;
+
+		const int MinX = Coord((Min.x - m_MaxProximityRadius) / CELL_SIZE, m_Width);
+		const int MinY = Coord((Min.y - m_MaxProximityRadius) / CELL_SIZE, m_Height);
+		const int MaxX = Coord((Max.x + m_MaxProximityRadius) / CELL_SIZE, m_Width);
+		const int MaxY = Coord((Max.y + m_MaxProximityRadius) / CELL_SIZE, m_Height);
+		if((MaxX - MinX + 1) * (MaxY - MinY + 1) > m_NumObjects)
+			return false;
+
+		const size_t Start = vpCandidates.size();
+		for(int y = MinY; y <= MaxY; y++)
+			for(int x = MinX; x <= MaxX; x++)
+			{
+				const std::vector<T *> &vpCell = m_vvpCells[y * m_Width + x];
+				vpCandidates.insert(vpCandidates.end(), vpCell.begin(), vpCell.end());
+			}
+		std::sort(vpCandidates.begin() + Start, vpCandidates.end(), [](const T *pA, const T *pB) {
+			return pA->m_InsertOrder > pB->m_InsertOrder;
+		});
+		return true;
+	}
+
+private:
+	static int Coord(float Value, int Size)
+	{
+		// also catches NaN
+		const float Floor = std::floor(Value);
+		if(!(Floor > 0.0f))
+			return 0;
+		if(Floor >= Size - 1)
+			return Size - 1;
+		return (int)Floor;
+	}
+
+	int m_Width = 0;
+	int m_Height = 0;
+	std::vector<std::vector<T *>> m_vvpCells;
+	int m_NumObjects = 0;
+	float m_MaxProximityRadius = 0.0f;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <engine/shared/config.h>
 #include <engine/shared/json.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/teehistorian_index.h>
 #include <game/gamecore.h>
 
 static const char TEEHISTORIAN_NAME[] = "teehistorian@ddnet.tw";
@@ -15,27 +16,16 @@ static const char TEEHISTORIAN_VERSION_MINOR[] = "6";
 #include <engine/shared/teehistorian_ex_chunks.h>
 #undef UUID
 
-enum
-{
-	TEEHISTORIAN_NONE,
-	TEEHISTORIAN_FINISH,
-	TEEHISTORIAN_TICK_SKIP,
-	TEEHISTORIAN_PLAYER_NEW,
-	TEEHISTORIAN_PLAYER_OLD,
-	TEEHISTORIAN_INPUT_DIFF,
-	TEEHISTORIAN_INPUT_NEW,
-	TEEHISTORIAN_MESSAGE,
-	TEEHISTORIAN_JOIN,
-	TEEHISTORIAN_DROP,
-	TEEHISTORIAN_CONSOLE_COMMAND,
-	TEEHISTORIAN_EX,
-};
+static_assert(sizeof(CNetObj_PlayerInput) == CTeeHistorianKeyframe::INPUT_SIZE * sizeof(int), "keyframe input size mismatch");
 
 CTeeHistorian::CTeeHistorian()
 {
 	m_State = STATE_START;
 	m_pfnWriteCallback = 0;
 	m_pWriteCallbackUserdata = 0;
+	m_pfnIndexCallback = 0;
+	m_pIndexCallbackUserdata = 0;
+	m_KeyframeInterval = 0;
 }
 
 void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCallback, void *pUser)
@@ -64,12 +54,33 @@ void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCal
 	}
 	m_pfnWriteCallback = pfnWriteCallback;
 	m_pWriteCallbackUserdata = pUser;
+	m_WrittenBytes = 0;
+
+	m_pfnIndexCallback = 0;
+	m_pIndexCallbackUserdata = 0;
+	m_KeyframeInterval = 0;
+	m_GameUuid = pGameInfo->m_GameUuid;
 
 	WriteHeader(pGameInfo);
 
 	m_State = STATE_START;
 }
 
+void CTeeHistorian::EnableIndex(int KeyframeInterval, WRITE_CALLBACK pfnWriteCallback, void *pUser)
+{
+	dbg_assert(m_State == STATE_START, "invalid teehistorian state");
+	dbg_assert(KeyframeInterval > 0, "invalid keyframe interval");
+
+	m_pfnIndexCallback = pfnWriteCallback;
+	m_pIndexCallbackUserdata = pUser;
+	m_KeyframeInterval = KeyframeInterval;
+	m_LastKeyframeTick = -1;
+
+	std::vector<unsigned char> vHeader;
+	CTeeHistorianIndex::PackHeader(&vHeader, m_GameUuid, KeyframeInterval);
+	m_pfnIndexCallback(vHeader.data(), vHeader.size(), m_pIndexCallbackUserdata);
+}
+
 void CTeeHistorian::WriteHeader(const CGameInfo *pGameInfo)
 {
 	Write(&TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID));
@@ -262,6 +273,10 @@ void CTeeHistorian::EnsureTickWrittenPlayerData(int ClientID)
 	else
 	{
 		// Tick is implicit.
+		if(!m_TickWritten)
+		{
+			WriteKeyframe();
+		}
 		m_LastWrittenTick = m_Tick;
 		m_TickWritten = true;
 	}
@@ -336,10 +351,11 @@ void CTeeHistorian::RecordPlayerTeam(int ClientID, int Team)
 {
 	if(m_aPrevPlayers[ClientID].m_Team != Team)
 	{
-		m_aPrevPlayers[ClientID].m_Team = Team;
-
+		// before updating the state, it might be written to a keyframe
 		EnsureTickWritten();
 
+		m_aPrevPlayers[ClientID].m_Team = Team;
+
 		CPacker Buffer;
 		Buffer.Reset();
 		Buffer.AddInt(ClientID);
@@ -358,10 +374,10 @@ void CTeeHistorian::RecordTeamPractice(int Team, bool Practice)
 {
 	if(m_aPrevTeams[Team].m_Practice != Practice)
 	{
-		m_aPrevTeams[Team].m_Practice = Practice;
-
 		EnsureTickWritten();
 
+		m_aPrevTeams[Team].m_Practice = Practice;
+
 		CPacker Buffer;
 		Buffer.Reset();
 		Buffer.AddInt(Team);
@@ -379,6 +395,7 @@ void CTeeHistorian::RecordTeamPractice(int Team, bool Practice)
 void CTeeHistorian::Write(const void *pData, int DataSize)
 {
 	m_pfnWriteCallback(pData, DataSize, m_pWriteCallbackUserdata);
+	m_WrittenBytes += DataSize;
 }
 
 void CTeeHistorian::EnsureTickWritten()
@@ -389,8 +406,49 @@ void CTeeHistorian::EnsureTickWritten()
 	}
 }
 
+void CTeeHistorian::WriteKeyframe()
+{
+	if(m_KeyframeInterval <= 0 || (m_LastKeyframeTick >= 0 && m_Tick < m_LastKeyframeTick + m_KeyframeInterval))
+	{
+		return;
+	}
+
+	CTeeHistorianKeyframe Keyframe;
+	Keyframe.m_Tick = m_Tick;
+	Keyframe.m_LastTick = m_LastWrittenTick;
+	Keyframe.m_Offset = m_WrittenBytes;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CTeehistorianPlayer &Prev = m_aPrevPlayers[i];
+		CTeeHistorianKeyframe::CPlayer &Player = Keyframe.m_aPlayers[i];
+		Player.m_Alive = Prev.m_Alive;
+		Player.m_X = Prev.m_Alive ? Prev.m_X : 0;
+		Player.m_Y = Prev.m_Alive ? Prev.m_Y : 0;
+		// zero means no input was recorded yet
+		Player.m_HaveInput = Prev.m_UniqueClientID != 0;
+		if(Player.m_HaveInput)
+			mem_copy(Player.m_aInput, &Prev.m_Input, sizeof(Player.m_aInput));
+		else
+			mem_zero(Player.m_aInput, sizeof(Player.m_aInput));
+		Player.m_Team = Prev.m_Team;
+		Keyframe.m_aTeamPractice[i] = m_aPrevTeams[i].m_Practice;
+	}
+
+	std::vector<unsigned char> vData;
+	CTeeHistorianIndex::PackKeyframe(&vData, Keyframe);
+	m_pfnIndexCallback(vData.data(), vData.size(), m_pIndexCallbackUserdata);
+	m_LastKeyframeTick = m_Tick;
+
+	if(m_Debug)
+	{
+		dbg_msg("teehistorian", "keyframe tick=%d offset=%" PRId64, m_Tick, m_WrittenBytes);
+	}
+}
+
 void CTeeHistorian::WriteTick()
 {
+	WriteKeyframe();
+
 	CPacker TickPacker;
 	TickPacker.Reset();
 
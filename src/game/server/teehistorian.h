@@ -50,6 +50,10 @@ public:
 	CTeeHistorian();
 
 	void Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCallback, void *pUser);
+	// Writes a seek index with a keyframe at the first recorded tick of
+	// every `KeyframeInterval` ticks, see `CTeeHistorianIndex`. Must be
+	// called after `Reset`.
+	void EnableIndex(int KeyframeInterval, WRITE_CALLBACK pfnWriteCallback, void *pUser);
 	void Finish();
 
 	bool Starting() const { return m_State == STATE_START; }
@@ -98,6 +102,7 @@ private:
 	void EnsureTickWrittenPlayerData(int ClientID);
 	void EnsureTickWritten();
 	void WriteTick();
+	void WriteKeyframe();
 	void Write(const void *pData, int DataSize);
 
 	enum
@@ -132,6 +137,13 @@ private:
 
 	WRITE_CALLBACK m_pfnWriteCallback;
 	void *m_pWriteCallbackUserdata;
+	int64_t m_WrittenBytes;
+
+	WRITE_CALLBACK m_pfnIndexCallback;
+	void *m_pIndexCallbackUserdata;
+	int m_KeyframeInterval;
+	int m_LastKeyframeTick;
+	CUuid m_GameUuid;
 
 	int m_State;
 
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/datafile.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(CONF_FAMILY_UNIX)
+#include <sys/resource.h>
+#endif
+
+// returns the peak resident set size of the process in KiB, -1 if unknown
+static long PeakRss()
+{
+#if defined(CONF_FAMILY_UNIX)
+	struct rusage Usage;
+	if(getrusage(RUSAGE_SELF, &Usage) != 0)
+		return -1;
+#if defined(CONF_PLATFORM_MACOS)
+	return Usage.ru_maxrss / 1024;
+#else
+	return Usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+// opens each map and loads all of its data, like the client and the server
+// do when they change the map
+TEST(Datafile, Load)
+{
+	const int NumRounds = 10;
+
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	ASSERT_TRUE(pStorage);
+	std::vector<std::string> vMaps;
+	pStorage->ListDirectory(
+		IStorage::TYPE_ALL, "data/maps", [](const char *pName, int IsDir, int StorageType, void *pUser) {
+			if(!IsDir && str_endswith(pName, ".map"))
+				static_cast<std::vector<std::string> *>(pUser)->push_back(std::string("data/maps/") + pName);
+			return 0;
+		},
+		&vMaps);
+	ASSERT_FALSE(vMaps.empty());
+	std::sort(vMaps.begin(), vMaps.end());
+
+	// the peak of the process only grows, so a map only adds to it if it
+	// needs more memory than the ones before
+	for(const std::string &Map : vMaps)
+	{
+		const long RssBefore = PeakRss();
+		int64_t Size = 0;
+		int64_t Duration = 0;
+		for(int Round = 0; Round < NumRounds; Round++)
+		{
+			const int64_t Start = time_get_impl();
+			CDataFileReader Reader;
+			ASSERT_TRUE(Reader.Open(pStorage.get(), Map.c_str(), IStorage::TYPE_ALL)) << Map;
+			Size = 0;
+			for(int i = 0; i < Reader.NumData(); i++)
+			{
+				if(Reader.GetData(i))
+					Size += Reader.GetDataSize(i);
+			}
+			Reader.Close();
+			Duration += time_get_impl() - Start;
+		}
+		EXPECT_GT(Size, 0) << Map;
+		dbg_msg("datafile", "%s: %d loads of %.2fKiB of data, %.2fms per load, peak rss %ldKiB (+%ldKiB)", Map.c_str(), NumRounds, Size / 1024.0,
+			Duration * 1000.0 / time_freq() / NumRounds, PeakRss(), PeakRss() - RssBefore);
+	}
+}
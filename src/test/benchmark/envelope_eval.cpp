@@ -0,0 +1,90 @@
+#include <test/envelope_eval.h>
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/storage.h>
+
+#include <game/client/envelope_eval.h>
+
+#include <chrono>
+#include <memory>
+
+using namespace std::chrono_literals;
+
+TEST(EnvelopeEval, Maps)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	for(const char *pMap : {"data/maps/Sunny Side Up.map", "data/maps/Tutorial.map", "data/maps/coverage.map"})
+	{
+		CTestMapEnvelopes Envelopes;
+		ASSERT_TRUE(Envelopes.Load(pStorage.get(), pMap)) << pMap;
+		const int NumEnvelopes = Envelopes.m_vTables.size();
+		if(NumEnvelopes == 0)
+			continue;
+
+		// a frame evaluates each envelope, like a map with one animated quad
+		// per envelope
+		const int NumFrames = 20000 / NumEnvelopes + 1;
+		float Sum = 0.0f;
+		const int64_t ExactStart = time_get_impl();
+		for(int Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const std::chrono::nanoseconds Time = Frame * std::chrono::nanoseconds(16667us);
+			for(int Env = 0; Env < NumEnvelopes; Env++)
+			{
+				ColorRGBA Result;
+				Envelopes.SelectEnvelope(Env);
+				EvalEnvelope(Envelopes.m_pPoints.get(), 4, Time, Result);
+				Sum += Result.r;
+			}
+		}
+		const int64_t BakedStart = time_get_impl();
+		for(int Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const std::chrono::nanoseconds Time = Frame * std::chrono::nanoseconds(16667us);
+			for(int Env = 0; Env < NumEnvelopes; Env++)
+			{
+				ColorRGBA Result;
+				Envelopes.m_vTables[Env].Eval(Time, Result);
+				Sum += Result.r;
+			}
+		}
+		const int64_t End = time_get_impl();
+
+		int NumSamples = 0;
+		for(const CEnvelopeTable &Table : Envelopes.m_vTables)
+			NumSamples += Table.NumSamples();
+		dbg_msg("envelope_eval", "%s: %d envelopes, %d samples, %d frames, exact=%.2fms baked=%.2fms (%f)", pMap, NumEnvelopes, NumSamples, NumFrames,
+			(BakedStart - ExactStart) * 1000.0 / time_freq(), (End - BakedStart) * 1000.0 / time_freq(), Sum);
+	}
+}
+
+TEST(EnvelopeEval, Bezier)
+{
+	CTestEnvelopePointAccess Points;
+	AddEditorBezierPoints(&Points);
+	CEnvelopeTable Table;
+	ASSERT_TRUE(Table.Bake(&Points, 4));
+
+	const int NumEvaluations = 20000;
+	float Sum = 0.0f;
+	const int64_t ExactStart = time_get_impl();
+	for(int i = 0; i < NumEvaluations; i++)
+	{
+		ColorRGBA Result;
+		EvalEnvelope(&Points, 4, i * std::chrono::nanoseconds(16667us), Result);
+		Sum += Result.r + Result.g + Result.b + Result.a;
+	}
+	const int64_t BakedStart = time_get_impl();
+	for(int i = 0; i < NumEvaluations; i++)
+	{
+		ColorRGBA Result;
+		Table.Eval(i * std::chrono::nanoseconds(16667us), Result);
+		Sum += Result.r + Result.g + Result.b + Result.a;
+	}
+	const int64_t End = time_get_impl();
+	dbg_msg("envelope_eval", "bezier: %d points, %d samples, %d evaluations, exact=%.2fms baked=%.2fms (%f)", Points.NumPoints(), Table.NumSamples(), NumEvaluations,
+		(BakedStart - ExactStart) * 1000.0 / time_freq(), (End - BakedStart) * 1000.0 / time_freq(), Sum);
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/prng.h>
+#include <game/teamscore.h>
+
+#include <memory>
+
+// a full server of players with random inputs on dm1, the characters close
+// to each other found through the buckets of CWorldCore or by checking all
+// of them
+TEST(WorldCore, CharacterBuckets)
+{
+	const int NumTicks = 2000;
+
+	std::unique_ptr<IKernel> pKernel(IKernel::Create());
+	IEngineMap *pMap = CreateEngineMap();
+	pKernel->RegisterInterface(CreateLocalStorage());
+	pKernel->RegisterInterface(pMap);
+	pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+	ASSERT_TRUE(pMap->Load("data/maps/dm1.map"));
+	CLayers Layers;
+	Layers.Init(pKernel.get());
+	CCollision Collision;
+	Collision.Init(&Layers);
+
+	CPrng Prng;
+	uint64_t aSeed[2] = {0x1234, 0x5678};
+	Prng.Seed(aSeed);
+	auto &&RandomFloat = [&](float Max) { return Prng.RandomBits() / (float)0xffffffffu * Max; };
+
+	CTeamsCore Teams;
+	CWorldCore aWorlds[2];
+	CCharacterCore aaCores[2][MAX_CLIENTS];
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		vec2 Spawn;
+		do
+		{
+			Spawn = vec2(RandomFloat(Collision.GetWidth() * 32.0f), RandomFloat(Collision.GetHeight() * 32.0f));
+		} while(Collision.TestBox(Spawn, CCharacterCore::PhysicalSizeVec2()));
+		for(int Impl = 0; Impl < 2; Impl++)
+		{
+			aWorlds[Impl].m_NoCharacterBuckets = Impl == 0;
+			CCharacterCore &Core = aaCores[Impl][i];
+			Core.Init(&aWorlds[Impl], &Collision, &Teams);
+			Core.Reset();
+			Core.m_Id = i;
+			Core.m_Pos = Spawn;
+			aWorlds[Impl].m_apCharacters[i] = &Core;
+		}
+	}
+
+	int64_t aDuration[2] = {0, 0};
+	for(int t = 0; t < NumTicks; t++)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CNetObj_PlayerInput Input;
+			mem_zero(&Input, sizeof(Input));
+			Input.m_Direction = (int)(Prng.RandomBits() % 3) - 1;
+			Input.m_TargetX = (int)(Prng.RandomBits() % 801) - 400;
+			Input.m_TargetY = (int)(Prng.RandomBits() % 801) - 400;
+			Input.m_Jump = Prng.RandomBits() % 8 == 0;
+			Input.m_Hook = Prng.RandomBits() % 4 != 0;
+			for(int Impl = 0; Impl < 2; Impl++)
+				aaCores[Impl][i].m_Input = Input;
+		}
+
+		for(int Impl = 0; Impl < 2; Impl++)
+		{
+			const int64_t Start = time_get_impl();
+			for(CCharacterCore *pCore : aWorlds[Impl].m_apCharacters)
+				pCore->Tick(true);
+			for(CCharacterCore *pCore : aWorlds[Impl].m_apCharacters)
+			{
+				pCore->Move();
+				pCore->Quantize();
+			}
+			aDuration[Impl] += time_get_impl() - Start;
+		}
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		EXPECT_EQ(aaCores[0][i].m_Pos, aaCores[1][i].m_Pos) << i;
+	dbg_msg("gamecore", "%d ticks with %d players, full scan=%.2fms buckets=%.2fms", NumTicks, MAX_CLIENTS,
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq());
+}
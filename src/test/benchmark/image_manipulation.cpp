@@ -0,0 +1,46 @@
+#include <test/image_manipulation.h>
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/gfx/image_manipulation.h>
+#include <engine/shared/jobs.h>
+
+#include <thread>
+#include <vector>
+
+TEST(ImageManipulation, Dilate)
+{
+	// a large tileset made of the grass tiles
+	STestImage Tiles;
+	ASSERT_TRUE(LoadImage("data/mapres/grass_main.png", &Tiles));
+	const int Size = 2048;
+	std::vector<unsigned char> vImage((size_t)Size * Size * 4);
+	for(int y = 0; y < Size; y++)
+	{
+		for(int x = 0; x < Size; x += Tiles.m_Width)
+			mem_copy(&vImage[((size_t)y * Size + x) * 4], &Tiles.m_vData[(size_t)(y % Tiles.m_Height) * Tiles.m_Width * 4], (size_t)minimum(Tiles.m_Width, Size - x) * 4);
+	}
+
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
+
+	std::vector<unsigned char> avResult[3];
+	int64_t aDuration[3];
+	for(int Impl = 0; Impl < 3; Impl++)
+	{
+		avResult[Impl] = vImage;
+		const int64_t Start = time_get_impl();
+		if(Impl == 0)
+			DilateImageSubReference(avResult[Impl].data(), Size, Size, 0, 0, Size, Size);
+		else
+			DilateImage(avResult[Impl].data(), Size, Size, Impl == 2 ? &JobPool : nullptr);
+		aDuration[Impl] = time_get_impl() - Start;
+	}
+	EXPECT_TRUE(avResult[1] == avResult[0]);
+	EXPECT_TRUE(avResult[2] == avResult[0]);
+	dbg_msg("image_manipulation", "dilating %dx%d, reference=%.2fms vectorized=%.2fms job pool with %d threads=%.2fms", Size, Size,
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq(), std::thread::hardware_concurrency(), aDuration[2] * 1000.0 / time_freq());
+}
@@ -0,0 +1,69 @@
+#include <test/layer_visuals.h>
+#include <test/test.h>
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/jobs.h>
+#include <engine/storage.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const char *const s_apMaps[] = {"data/maps/Tutorial.map", "data/maps/coverage.map", "data/maps/Sunny Side Up.map", "data/maps/ctf1.map", "data/maps/dm1.map"};
+
+TEST(LayerVisuals, JobPool)
+{
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
+	for(const char *pMap : s_apMaps)
+	{
+		CTestLayerVisuals TestVisuals;
+		ASSERT_TRUE(TestVisuals.Load(pMap)) << pMap;
+
+		const int64_t SequentialStart = time_get_impl();
+		const std::vector<SPreparedLayer> vSequential = TestVisuals.Prepare(nullptr);
+		const int64_t JobPoolStart = time_get_impl();
+		const std::vector<SPreparedLayer> vJobPool = TestVisuals.Prepare(&JobPool);
+		const int64_t End = time_get_impl();
+		EXPECT_EQ(vSequential.size(), vJobPool.size());
+		dbg_msg("layer_visuals", "%s: %d layers, sequential=%.2fms job_pool=%.2fms", pMap, (int)TestVisuals.m_vLayers.size(),
+			(JobPoolStart - SequentialStart) * 1000.0 / time_freq(), (End - JobPoolStart) * 1000.0 / time_freq());
+	}
+}
+
+TEST(LayerVisuals, Cache)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	const char *pPath = "cache.layers";
+
+	for(const char *pMap : s_apMaps)
+	{
+		CTestLayerVisuals TestVisuals;
+		ASSERT_TRUE(TestVisuals.Load(pMap)) << pMap;
+
+		const int64_t PrepareStart = time_get_impl();
+		const std::vector<SPreparedLayer> vPrepared = TestVisuals.Prepare(nullptr);
+		const int64_t PrepareEnd = time_get_impl();
+
+		const std::vector<unsigned char> vData = CTestLayerVisuals::SerializeCache(vPrepared);
+		IOHANDLE File = pStorage->OpenFile(pPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		EXPECT_EQ(io_write(File, vData.data(), vData.size()), vData.size());
+		io_close(File);
+
+		const int64_t CacheStart = time_get_impl();
+		CTileLayerCache Cache;
+		ASSERT_TRUE(Cache.Load(pStorage.get(), pPath)) << pMap;
+		std::vector<SPreparedLayer> vCached;
+		EXPECT_TRUE(TestVisuals.LoadFromCache(Cache, &vCached)) << pMap;
+		const int64_t CacheEnd = time_get_impl();
+		dbg_msg("layer_visuals", "%s: %d tile layers, %d bytes, prepare=%.2fms cache=%.2fms", pMap, Cache.NumLayers(), (int)vData.size(),
+			(PrepareEnd - PrepareStart) * 1000.0 / time_freq(), (CacheEnd - CacheStart) * 1000.0 / time_freq());
+	}
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+// a server sending one snapshot to each client per tick, the packets of a
+// tick are flushed together like in CServer::Run
+TEST(Net, SendBatching)
+{
+	const int NumClients = 64;
+	const int NumTicks = 2000;
+	const int PacketSize = 500;
+
+	NETADDR Bindaddr = {};
+	NETSOCKET Receiver;
+	NETSOCKET Sender;
+
+	Bindaddr.type = NETTYPE_IPV4;
+	Sender = net_udp_create(Bindaddr);
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!(Receiver = net_udp_create(Bindaddr)));
+
+	if(net_udp_set_send_batching(Sender, 1) != 0)
+	{
+		net_udp_close(Receiver);
+		net_udp_close(Sender);
+		GTEST_SKIP() << "Batched sending is not supported on this platform";
+	}
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	unsigned char aPacket[PacketSize];
+	for(int i = 0; i < PacketSize; i++)
+		aPacket[i] = i;
+
+	int64_t aDuration[2] = {0, 0};
+	int aNumReceived[2] = {0, 0};
+	for(int Batching = 0; Batching < 2; Batching++)
+	{
+		ASSERT_EQ(net_udp_set_send_batching(Sender, Batching), 0);
+		for(int Tick = 0; Tick < NumTicks; Tick++)
+		{
+			const int64_t Start = time_get_impl();
+			for(int i = 0; i < NumClients; i++)
+				net_udp_send(Sender, &Target, aPacket, sizeof(aPacket));
+			net_udp_flush(Sender);
+			aDuration[Batching] += time_get_impl() - Start;
+
+			// loopback delivers the packets while sending, drain them so that
+			// the receive buffer doesn't drop the next tick
+			NETADDR Addr;
+			unsigned char *pData;
+			while(net_udp_recv(Receiver, &Addr, &pData) > 0)
+				aNumReceived[Batching]++;
+		}
+	}
+	net_udp_set_send_batching(Sender, 0);
+	net_udp_close(Receiver);
+	net_udp_close(Sender);
+
+	const int NumPackets = NumClients * NumTicks;
+	EXPECT_EQ(aNumReceived[0], NumPackets);
+	EXPECT_EQ(aNumReceived[1], NumPackets);
+	dbg_msg("net", "%d ticks with %d packets of %d bytes, single=%.2fms (%.0f packets/s) batched=%.2fms (%.0f packets/s)", NumTicks, NumClients, PacketSize,
+		aDuration[0] * 1000.0 / time_freq(), NumPackets * (double)time_freq() / aDuration[0],
+		aDuration[1] * 1000.0 / time_freq(), NumPackets * (double)time_freq() / aDuration[1]);
+}
@@ -0,0 +1,58 @@
+#include <test/particle_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <game/client/particle_pool.h>
+
+#include <cstdlib>
+#include <vector>
+
+TEST_F(ParticlePool, Update)
+{
+	// keep the pool full, like with many players shooting and using ninja
+	const int NumParticles = 1024 * 8;
+	const int NumFrames = 200;
+	const float TimePassed = 1.0f / 60.0f;
+
+	std::vector<CParticle> vSpawn;
+	for(int i = 0; i < NumParticles * 4; i++)
+		vSpawn.push_back(RandomParticle());
+
+	int64_t aDuration[2];
+	int aNumUpdated[2] = {0, 0};
+	for(int Impl = 0; Impl < 2; Impl++)
+	{
+		srand(1);
+		CParticlePool Pool(NumParticles);
+		std::vector<CParticle> vParticles;
+		unsigned NextSpawn = 0;
+		int64_t Duration = 0;
+		for(int Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const int Num = Impl == 0 ? (int)vParticles.size() : Pool.Num();
+			for(int i = Num; i < NumParticles; i++)
+			{
+				const CParticle &Particle = vSpawn[NextSpawn++ % vSpawn.size()];
+				if(Impl == 0)
+					vParticles.push_back(Particle);
+				else
+					Pool.Add(Particle, 0.0f);
+			}
+
+			const int64_t Start = time_get_impl();
+			if(Impl == 0)
+				UpdateReference(vParticles, TimePassed, 1, &m_Collision);
+			else
+				Pool.Update(TimePassed, 1, &m_Collision);
+			Duration += time_get_impl() - Start;
+			aNumUpdated[Impl] += NumParticles;
+		}
+		aDuration[Impl] = Duration;
+	}
+	const double ReferenceMs = aDuration[0] * 1000.0 / time_freq();
+	const double PoolMs = aDuration[1] * 1000.0 / time_freq();
+	dbg_msg("particle_pool", "%d frames of %d particles, reference=%.2fms (%.0f particles/ms) pool=%.2fms (%.0f particles/ms)", NumFrames, NumParticles,
+		ReferenceMs, aNumUpdated[0] / ReferenceMs, PoolMs, aNumUpdated[1] / PoolMs);
+}
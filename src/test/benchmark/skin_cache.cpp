@@ -0,0 +1,67 @@
+#include <test/test.h>
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/gfx/image_loader.h>
+#include <engine/storage.h>
+
+#include <game/client/skin_cache.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// the client decodes each skin file on startup unless the skin cache has it
+TEST(SkinCache, DecodeAndLoad)
+{
+	const int GridX = 8;
+	const int GridY = 4;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	std::vector<std::string> vSkins;
+	fs_listdir(
+		"data/skins", [](const char *pName, int IsDir, int DirType, void *pUser) {
+			if(!IsDir && str_endswith(pName, ".png"))
+				static_cast<std::vector<std::string> *>(pUser)->push_back(std::string("data/skins/") + pName);
+			return 0;
+		},
+		0, &vSkins);
+	ASSERT_FALSE(vSkins.empty());
+
+	int NumSkins = 0;
+	int64_t DecodeDuration = 0;
+	int64_t CacheDuration = 0;
+	for(const std::string &Skin : vSkins)
+	{
+		CSkinCacheData Data;
+		int64_t Start = time_get_impl();
+		IOHANDLE File = io_open(Skin.c_str(), IOFLAG_READ);
+		ASSERT_TRUE(File) << Skin;
+		void *pFileData;
+		unsigned FileSize;
+		io_read_all(File, &pFileData, &FileSize);
+		io_close(File);
+		int PngliteIncompatible;
+		const bool Decoded = DecodePNG(pFileData, FileSize, Skin.c_str(), Data.m_Info, PngliteIncompatible);
+		free(pFileData);
+		DecodeDuration += time_get_impl() - Start;
+		if(!Decoded || Data.m_Info.m_Format != CImageInfo::FORMAT_RGBA || Data.m_Info.m_Width % GridX != 0 || Data.m_Info.m_Height % GridY != 0)
+			continue;
+		Data.m_DecodedWidth = Data.m_Info.m_Width;
+		Data.m_DecodedHeight = Data.m_Info.m_Height;
+		ASSERT_TRUE(Data.Save(pStorage.get(), "benchmark.skin", "benchmark")) << Skin;
+
+		CSkinCacheData Cached;
+		Start = time_get_impl();
+		ASSERT_TRUE(Cached.Load(pStorage.get(), "benchmark.skin", GridX, GridY)) << Skin;
+		CacheDuration += time_get_impl() - Start;
+		NumSkins++;
+	}
+	pStorage->RemoveFile("benchmark.skin", IStorage::TYPE_SAVE);
+	dbg_msg("skin_cache", "%d skins, decode=%.2fms cache=%.2fms", NumSkins, DecodeDuration * 1000.0 / time_freq(), CacheDuration * 1000.0 / time_freq());
+}
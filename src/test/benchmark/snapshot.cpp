@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/snapshot.h>
+
+#include <game/generated/protocol.h>
+
+// a full snapshot of a server with 64 players that shoot a lot
+static int BuildFullSnapshot(CSnapshot *pSnap, int Tick)
+{
+	CSnapshotBuilder Builder;
+	// the NETOBJTYPE_EX items of extended types are only added on the
+	// next initialization
+	Builder.Init();
+	Builder.NewItem(NETOBJTYPE_DDNETCHARACTER, 0, sizeof(CNetObj_DDNetCharacter));
+	Builder.NewItem(NETOBJTYPE_DDNETPLAYER, 0, sizeof(CNetObj_DDNetPlayer));
+	Builder.Init();
+	Builder.NewItem(NETOBJTYPE_GAMEINFO, 0, sizeof(CNetObj_GameInfo));
+	for(int i = 0; i < 64; i++)
+	{
+		int *pPlayerInfo = (int *)Builder.NewItem(NETOBJTYPE_PLAYERINFO, i, sizeof(CNetObj_PlayerInfo));
+		pPlayerInfo[1] = i;
+		int *pCharacter = (int *)Builder.NewItem(NETOBJTYPE_CHARACTER, i, sizeof(CNetObj_Character));
+		pCharacter[0] = Tick;
+		pCharacter[1] = i * 32 + Tick;
+		Builder.NewItem(NETOBJTYPE_DDNETCHARACTER, i, sizeof(CNetObj_DDNetCharacter));
+		Builder.NewItem(NETOBJTYPE_DDNETPLAYER, i, sizeof(CNetObj_DDNetPlayer));
+	}
+	// projectiles and lasers come and go
+	for(int i = 0; i < 500; i++)
+	{
+		const int ID = (i + Tick) % 4096;
+		if(i % 3 == 0)
+		{
+			int *pLaser = (int *)Builder.NewItem(NETOBJTYPE_LASER, ID, sizeof(CNetObj_Laser));
+			pLaser[0] = ID;
+		}
+		else
+		{
+			int *pProjectile = (int *)Builder.NewItem(NETOBJTYPE_PROJECTILE, ID, sizeof(CNetObj_Projectile));
+			pProjectile[2] = Tick;
+		}
+	}
+	for(int i = 0; i < 100; i++)
+		Builder.NewItem(NETOBJTYPE_PICKUP, 4096 + i, sizeof(CNetObj_Pickup));
+	return Builder.Finish(pSnap);
+}
+
+TEST(Snapshot, ItemIndex)
+{
+	const int NumRounds = 20;
+
+	char aData[CSnapshot::MAX_SIZE];
+	CSnapshot *pSnap = (CSnapshot *)aData;
+	BuildFullSnapshot(pSnap, 0);
+
+	// look up every item by its key and every character by its type, like
+	// the client does for each snapshot
+	const int aTypes[] = {NETOBJTYPE_CHARACTER, NETOBJTYPE_DDNETCHARACTER, NETOBJTYPE_DDNETPLAYER};
+	int64_t aDuration[2];
+	int aFound[2] = {0, 0};
+	for(int Impl = 0; Impl < 2; Impl++)
+	{
+		const int64_t Start = time_get_impl();
+		for(int Round = 0; Round < NumRounds; Round++)
+		{
+			CSnapshotItemIndex Index;
+			if(Impl == 1)
+				Index.Build(pSnap);
+			for(int i = 0; i < pSnap->NumItems(); i++)
+			{
+				const int Key = pSnap->GetItem(i)->Key();
+				aFound[Impl] += (Impl == 0 ? pSnap->GetItemIndex(Key) : Index.GetItemIndex(Key)) == i;
+			}
+			for(int ID = 0; ID < 64; ID++)
+			{
+				for(int Type : aTypes)
+					aFound[Impl] += (Impl == 0 ? pSnap->FindItem(Type, ID) : Index.FindItem(Type, ID)) != nullptr;
+			}
+		}
+		aDuration[Impl] = time_get_impl() - Start;
+	}
+	EXPECT_EQ(aFound[0], aFound[1]);
+	dbg_msg("snapshot", "%d rounds over %d items, linear=%.2fms index=%.2fms", NumRounds, pSnap->NumItems(),
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq());
+}
+
+TEST(Snapshot, UnpackDelta)
+{
+	const int NumTicks = 200;
+
+	char aFrom[CSnapshot::MAX_SIZE];
+	char aTo[CSnapshot::MAX_SIZE];
+	char aUnpacked[CSnapshot::MAX_SIZE];
+	char aDelta[CSnapshot::MAX_SIZE];
+	CSnapshot *pFrom = (CSnapshot *)aFrom;
+	CSnapshot *pTo = (CSnapshot *)aTo;
+	CSnapshot *pUnpacked = (CSnapshot *)aUnpacked;
+
+	CSnapshotDelta Delta;
+	int64_t CreateDuration = 0;
+	int64_t UnpackDuration = 0;
+	BuildFullSnapshot(pFrom, 0);
+	for(int Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		BuildFullSnapshot(pTo, Tick);
+		const int64_t CreateStart = time_get_impl();
+		const int DeltaSize = Delta.CreateDelta(pFrom, pTo, aDelta);
+		const int64_t UnpackStart = time_get_impl();
+		const int UnpackedSize = Delta.UnpackDelta(pFrom, pUnpacked, aDelta, DeltaSize);
+		UnpackDuration += time_get_impl() - UnpackStart;
+		CreateDuration += UnpackStart - CreateStart;
+		ASSERT_GT(UnpackedSize, 0);
+		ASSERT_EQ(pUnpacked->Crc(), pTo->Crc());
+		mem_copy(aFrom, aTo, sizeof(aFrom));
+	}
+	dbg_msg("snapshot", "%d deltas of %d items, create=%.2fms unpack=%.2fms", NumTicks, pTo->NumItems(),
+		CreateDuration * 1000.0 / time_freq(), UnpackDuration * 1000.0 / time_freq());
+}
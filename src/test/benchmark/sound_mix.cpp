@@ -0,0 +1,58 @@
+#include <test/sound_mix.h>
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/client/sound_mix.h>
+
+#include <vector>
+
+TEST(SoundMix, Mix)
+{
+	// mixes many voices like on maps with a lot of map sounds, with the
+	// scalar loops and with the kernels
+	const int NumVoices = 256;
+	const unsigned Frames = 1024;
+	const int NumBuffers = 100;
+
+	CTestSamples TestSamples;
+	std::vector<std::vector<short>> vvSamples;
+	std::vector<int> vChannels;
+	std::vector<int> vVolumes;
+	for(int i = 0; i < NumVoices; i++)
+	{
+		vChannels.push_back(i % 2 + 1);
+		vvSamples.push_back(TestSamples.Samples(Frames * vChannels.back()));
+		vVolumes.push_back(TestSamples.m_Prng.RandomBits() % 256);
+		vVolumes.push_back(TestSamples.m_Prng.RandomBits() % 256);
+	}
+
+	std::vector<int> vMix(Frames * 2);
+	std::vector<short> avOut[2];
+	int64_t aDuration[2];
+	for(int Impl = 0; Impl < 2; Impl++)
+	{
+		avOut[Impl].resize(Frames * 2);
+		const int64_t Start = time_get_impl();
+		for(int Buffer = 0; Buffer < NumBuffers; Buffer++)
+		{
+			mem_zero(vMix.data(), vMix.size() * sizeof(int));
+			for(int i = 0; i < NumVoices; i++)
+			{
+				if(Impl == 0)
+					MixVoiceReference(vMix.data(), vvSamples[i].data(), vChannels[i], Frames, vVolumes[i * 2], vVolumes[i * 2 + 1]);
+				else
+					MixVoice(vMix.data(), vvSamples[i].data(), vChannels[i], Frames, vVolumes[i * 2], vVolumes[i * 2 + 1]);
+			}
+			if(Impl == 0)
+				ClampMixReference(avOut[Impl].data(), vMix.data(), Frames * 2, 30);
+			else
+				ClampMix(avOut[Impl].data(), vMix.data(), Frames * 2, 30);
+		}
+		aDuration[Impl] = time_get_impl() - Start;
+	}
+	EXPECT_EQ(avOut[1], avOut[0]);
+	dbg_msg("sound_mix", "%d voices, %d buffers of %d frames, scalar=%.2fms kernels=%.2fms", NumVoices, NumBuffers, Frames,
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq());
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <game/prng.h>
+#include <game/server/spatial_grid.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct SBenchmarkObject
+{
+	vec2 m_Pos;
+	vec2 m_Vel;
+	float m_ProximityRadius;
+	int64_t m_InsertOrder;
+	int m_GridCell = -1;
+	int m_GridSlot = -1;
+};
+
+// a dense world, like a full server where everyone shoots grenades: the
+// projectiles look for characters along their path like
+// CGameWorld::IntersectCharacter, and the characters look for pickups and
+// explosions hit the characters around them like CGameWorld::FindEntities
+TEST(SpatialGrid, Queries)
+{
+	const int MapWidth = 300;
+	const int MapHeight = 150;
+	const int NumCharacters = 64;
+	const int NumProjectiles = 600;
+	const int NumPickups = 300;
+	const int NumTicks = 200;
+
+	CPrng Prng;
+	uint64_t aSeed[2] = {0x1234, 0x5678};
+	Prng.Seed(aSeed);
+	auto &&RandomFloat = [&](float Min, float Max) { return Min + (Max - Min) * (Prng.RandomBits() % 100000) / 100000.0f; };
+
+	enum
+	{
+		TYPE_CHARACTER,
+		TYPE_PROJECTILE,
+		TYPE_PICKUP,
+		NUM_TYPES,
+	};
+	const int aNumObjects[NUM_TYPES] = {NumCharacters, NumProjectiles, NumPickups};
+	const float aRadii[NUM_TYPES] = {28.0f, 0.0f, 14.0f};
+	const float aSpeeds[NUM_TYPES] = {10.0f, 30.0f, 0.0f};
+	CSpatialGrid<SBenchmarkObject> aGrids[NUM_TYPES];
+	// newest first, like the entity lists of the game world
+	std::vector<std::unique_ptr<SBenchmarkObject>> avpObjects[NUM_TYPES];
+	int64_t InsertOrder = 0;
+	for(int Type = 0; Type < NUM_TYPES; Type++)
+	{
+		aGrids[Type].Init(MapWidth, MapHeight);
+		for(int i = 0; i < aNumObjects[Type]; i++)
+		{
+			auto pObject = std::make_unique<SBenchmarkObject>();
+			// most of the players are in the middle of the map
+			pObject->m_Pos = vec2(RandomFloat(MapWidth * 8.0f, MapWidth * 24.0f), RandomFloat(MapHeight * 8.0f, MapHeight * 24.0f));
+			pObject->m_Vel = vec2(RandomFloat(-aSpeeds[Type], aSpeeds[Type]), RandomFloat(-aSpeeds[Type], aSpeeds[Type]));
+			pObject->m_ProximityRadius = aRadii[Type];
+			pObject->m_InsertOrder = InsertOrder++;
+			aGrids[Type].Insert(pObject.get());
+			avpObjects[Type].insert(avpObjects[Type].begin(), std::move(pObject));
+		}
+	}
+
+	int64_t aDuration[2] = {0, 0};
+	int aFound[2] = {0, 0};
+	std::vector<SBenchmarkObject *> vpCandidates;
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		for(int Type = 0; Type < NUM_TYPES; Type++)
+		{
+			for(auto &pObject : avpObjects[Type])
+			{
+				pObject->m_Pos += pObject->m_Vel;
+				if(pObject->m_Pos.x < 0.0f || pObject->m_Pos.x > MapWidth * 32.0f)
+					pObject->m_Vel.x = -pObject->m_Vel.x;
+				if(pObject->m_Pos.y < 0.0f || pObject->m_Pos.y > MapHeight * 32.0f)
+					pObject->m_Vel.y = -pObject->m_Vel.y;
+				aGrids[Type].Update(pObject.get());
+			}
+		}
+
+		for(int UseGrid = 0; UseGrid < 2; UseGrid++)
+		{
+			auto &&Candidates = [&](int Type, vec2 Min, vec2 Max) -> const std::vector<SBenchmarkObject *> & {
+				vpCandidates.clear();
+				if(UseGrid && aGrids[Type].Candidates(Min, Max, vpCandidates))
+					return vpCandidates;
+				for(auto &pObject : avpObjects[Type])
+					vpCandidates.push_back(pObject.get());
+				return vpCandidates;
+			};
+
+			const int64_t Start = time_get_impl();
+			for(auto &pProjectile : avpObjects[TYPE_PROJECTILE])
+			{
+				const vec2 Pos0 = pProjectile->m_Pos - pProjectile->m_Vel;
+				const vec2 Pos1 = pProjectile->m_Pos;
+				const float Radius = 6.0f;
+				const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+				const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+				for(SBenchmarkObject *pCharacter : Candidates(TYPE_CHARACTER, Min, Max))
+				{
+					vec2 IntersectPos;
+					if(closest_point_on_line(Pos0, Pos1, pCharacter->m_Pos, IntersectPos) && distance(pCharacter->m_Pos, IntersectPos) < pCharacter->m_ProximityRadius + Radius)
+						aFound[UseGrid]++;
+				}
+			}
+			for(auto &pCharacter : avpObjects[TYPE_CHARACTER])
+			{
+				for(const auto &[Type, Radius] : {std::pair<int, float>(TYPE_PICKUP, 28.0f), std::pair<int, float>(TYPE_CHARACTER, 135.0f)})
+				{
+					const vec2 Pos = pCharacter->m_Pos;
+					for(SBenchmarkObject *pObject : Candidates(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius)))
+					{
+						if(distance(pObject->m_Pos, Pos) < Radius + pObject->m_ProximityRadius)
+							aFound[UseGrid]++;
+					}
+				}
+			}
+			aDuration[UseGrid] += time_get_impl() - Start;
+		}
+	}
+	EXPECT_EQ(aFound[0], aFound[1]);
+	dbg_msg("spatial_grid", "%d ticks with %d characters, %d projectiles and %d pickups, %d found, list=%.2fms grid=%.2fms", NumTicks, NumCharacters, NumProjectiles, NumPickups, aFound[1],
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq());
+}
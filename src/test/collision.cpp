@@ -0,0 +1,529 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+#include <game/prng.h>
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+// The per-pixel line checks as they were before the tile traversal. The new
+// implementations have to give bit-identical results.
+
+static int IntersectLineReference(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+		if(Collision.CheckPoint(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Collision.GetCollisionAt(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int IntersectLineTeleHookReference(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	int dx = 0, dy = 0;
+	ThroughOffset(Pos0, Pos1, &dx, &dy);
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		int Index = Collision.GetPureMapIndex(Pos);
+		if(g_Config.m_SvOldTeleportHook)
+			*pTeleNr = Collision.IsTeleport(Index);
+		else
+			*pTeleNr = Collision.IsTeleportHook(Index);
+		if(*pTeleNr)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return TILE_TELEINHOOK;
+		}
+
+		int Hit = 0;
+		if(Collision.CheckPoint(ix, iy))
+		{
+			if(!Collision.IsThrough(ix, iy, dx, dy, Pos0, Pos1))
+				Hit = Collision.GetCollisionAt(ix, iy);
+		}
+		else if(Collision.IsHookBlocker(ix, iy, Pos0, Pos1))
+		{
+			Hit = TILE_NOHOOK;
+		}
+		if(Hit)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Hit;
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int IntersectLineTeleWeaponReference(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		int Index = Collision.GetPureMapIndex(Pos);
+		if(g_Config.m_SvOldTeleportWeapons)
+			*pTeleNr = Collision.IsTeleport(Index);
+		else
+			*pTeleNr = Collision.IsTeleportWeapon(Index);
+		if(*pTeleNr)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return TILE_TELEINWEAPON;
+		}
+
+		if(Collision.CheckPoint(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Collision.GetCollisionAt(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int IntersectNoLaserReference(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = std::ceil(d); i < id; i++)
+	{
+		float a = (int)i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int Nx = clamp(round_to_int(Pos.x) / 32, 0, Collision.GetWidth() - 1);
+		int Ny = clamp(round_to_int(Pos.y) / 32, 0, Collision.GetHeight() - 1);
+		if(Collision.GetIndex(Nx, Ny) == TILE_SOLID || Collision.GetIndex(Nx, Ny) == TILE_NOHOOK || Collision.GetIndex(Nx, Ny) == TILE_NOLASER || Collision.GetFIndex(Nx, Ny) == TILE_NOLASER)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(Collision.GetFIndex(Nx, Ny) == TILE_NOLASER)
+				return Collision.GetFCollisionAt(Pos.x, Pos.y);
+			else
+				return Collision.GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static std::vector<int> GetMapIndicesReference(const CCollision &Collision, vec2 PrevPos, vec2 Pos)
+{
+	std::vector<int> vIndices;
+	float d = distance(PrevPos, Pos);
+	int End(d + 1);
+	if(!d)
+		return Collision.GetMapIndices(PrevPos, Pos);
+
+	int LastIndex = 0;
+	for(int i = 0; i < End; i++)
+	{
+		float a = i / d;
+		vec2 Tmp = mix(PrevPos, Pos, a);
+		int Nx = clamp((int)Tmp.x / 32, 0, Collision.GetWidth() - 1);
+		int Ny = clamp((int)Tmp.y / 32, 0, Collision.GetHeight() - 1);
+		int Index = Ny * Collision.GetWidth() + Nx;
+		if(Collision.TileExists(Index) && LastIndex != Index)
+		{
+			vIndices.push_back(Index);
+			LastIndex = Index;
+		}
+	}
+	return vIndices;
+}
+
+static bool SameVec(vec2 A, vec2 B)
+{
+	return mem_comp(&A, &B, sizeof(A)) == 0;
+}
+
+class CTestCollision
+{
+public:
+	std::unique_ptr<IKernel> m_pKernel;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	CPrng m_Prng;
+
+	bool Load(const char *pMapName)
+	{
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		IEngineMap *pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(CreateLocalStorage());
+		m_pKernel->RegisterInterface(pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+		if(!pMap->Load(pMapName))
+			return false;
+		m_Layers.Init(m_pKernel.get());
+		m_Collision.Init(&m_Layers);
+
+		uint64_t aSeed[2] = {0x1234, 0x5678};
+		m_Prng.Seed(aSeed);
+		return true;
+	}
+
+	float RandomFloat(float Max)
+	{
+		return m_Prng.RandomBits() / (float)0xffffffffu * Max;
+	}
+
+	// random segments inside and around the map, some of them start or end
+	// exactly on a tile border or are axis aligned
+	void RandomSegment(vec2 *pPos0, vec2 *pPos1)
+	{
+		const vec2 Size = vec2(m_Collision.GetWidth(), m_Collision.GetHeight()) * 32.0f;
+		*pPos0 = vec2(RandomFloat(Size.x + 128.0f) - 64.0f, RandomFloat(Size.y + 128.0f) - 64.0f);
+		const float Angle = RandomFloat(2.0f * pi);
+		const float Length = (m_Prng.RandomBits() % 4 == 0) ? RandomFloat(40.0f) : RandomFloat(1200.0f);
+		*pPos1 = *pPos0 + direction(Angle) * Length;
+		switch(m_Prng.RandomBits() % 8)
+		{
+		case 0: pPos0->x = std::floor(pPos0->x / 32.0f) * 32.0f - 0.5f; break;
+		case 1: pPos1->y = std::floor(pPos1->y / 32.0f) * 32.0f + 0.5f; break;
+		case 2: pPos1->x = pPos0->x; break;
+		case 3: pPos1->y = pPos0->y; break;
+		case 4: *pPos0 = vec2(round_to_int(pPos0->x), round_to_int(pPos0->y)); break;
+		}
+	}
+};
+
+static const char *const s_apMaps[] = {"data/maps/Tutorial.map", "data/maps/coverage.map", "data/maps/ctf1.map", "data/maps/dm1.map"};
+static const int NUM_SEGMENTS = 3000;
+// every MoveBox step is tested in one of the implementations, which is slow
+static const int NUM_MOVE_BOXES = 2000;
+
+TEST(Collision, IntersectLine)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		for(int i = 0; i < NUM_SEGMENTS; i++)
+		{
+			vec2 Pos0, Pos1;
+			TestCollision.RandomSegment(&Pos0, &Pos1);
+
+			vec2 aOut[4];
+			const int Expected = IntersectLineReference(TestCollision.m_Collision, Pos0, Pos1, &aOut[0], &aOut[1]);
+			const int Result = TestCollision.m_Collision.IntersectLine(Pos0, Pos1, &aOut[2], &aOut[3]);
+			ASSERT_EQ(Result, Expected) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_TRUE(SameVec(aOut[0], aOut[2])) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_TRUE(SameVec(aOut[1], aOut[3])) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+		}
+	}
+}
+
+TEST(Collision, IntersectLineTele)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		for(int i = 0; i < NUM_SEGMENTS; i++)
+		{
+			vec2 Pos0, Pos1;
+			TestCollision.RandomSegment(&Pos0, &Pos1);
+
+			vec2 aOut[4];
+			int aTeleNr[2];
+			int Expected = IntersectLineTeleHookReference(TestCollision.m_Collision, Pos0, Pos1, &aOut[0], &aOut[1], &aTeleNr[0]);
+			int Result = TestCollision.m_Collision.IntersectLineTeleHook(Pos0, Pos1, &aOut[2], &aOut[3], &aTeleNr[1]);
+			ASSERT_EQ(Result, Expected) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_EQ(aTeleNr[1], aTeleNr[0]);
+			ASSERT_TRUE(SameVec(aOut[0], aOut[2]));
+			ASSERT_TRUE(SameVec(aOut[1], aOut[3]));
+
+			Expected = IntersectLineTeleWeaponReference(TestCollision.m_Collision, Pos0, Pos1, &aOut[0], &aOut[1], &aTeleNr[0]);
+			Result = TestCollision.m_Collision.IntersectLineTeleWeapon(Pos0, Pos1, &aOut[2], &aOut[3], &aTeleNr[1]);
+			ASSERT_EQ(Result, Expected) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_EQ(aTeleNr[1], aTeleNr[0]);
+			ASSERT_TRUE(SameVec(aOut[0], aOut[2]));
+			ASSERT_TRUE(SameVec(aOut[1], aOut[3]));
+		}
+	}
+}
+
+TEST(Collision, IntersectNoLaser)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		for(int i = 0; i < NUM_SEGMENTS; i++)
+		{
+			vec2 Pos0, Pos1;
+			TestCollision.RandomSegment(&Pos0, &Pos1);
+
+			vec2 aOut[4];
+			const int Expected = IntersectNoLaserReference(TestCollision.m_Collision, Pos0, Pos1, &aOut[0], &aOut[1]);
+			const int Result = TestCollision.m_Collision.IntersectNoLaser(Pos0, Pos1, &aOut[2], &aOut[3]);
+			ASSERT_EQ(Result, Expected) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_TRUE(SameVec(aOut[0], aOut[2]));
+			ASSERT_TRUE(SameVec(aOut[1], aOut[3]));
+		}
+	}
+}
+
+TEST(Collision, GetMapIndices)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		for(int i = 0; i < NUM_SEGMENTS; i++)
+		{
+			vec2 Pos0, Pos1;
+			TestCollision.RandomSegment(&Pos0, &Pos1);
+			ASSERT_EQ(TestCollision.m_Collision.GetMapIndices(Pos0, Pos1), GetMapIndicesReference(TestCollision.m_Collision, Pos0, Pos1)) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+		}
+	}
+}
+
+TEST(Collision, MoveBox)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		CCollision &Collision = TestCollision.m_Collision;
+		for(int i = 0; i < NUM_MOVE_BOXES; i++)
+		{
+			vec2 Pos0, Pos1;
+			TestCollision.RandomSegment(&Pos0, &Pos1);
+			const vec2 Size = i % 2 ? CCharacterCore::PhysicalSizeVec2() : vec2(TestCollision.RandomFloat(64.0f), TestCollision.RandomFloat(64.0f));
+			const vec2 Elasticity = vec2(TestCollision.RandomFloat(1.5f), TestCollision.RandomFloat(1.5f));
+
+			vec2 aPos[2] = {Pos0, Pos0};
+			vec2 aVel[2] = {Pos1 - Pos0, Pos1 - Pos0};
+			bool aGrounded[2] = {false, false};
+			for(int Impl = 0; Impl < 2; Impl++)
+			{
+				Collision.SetMoveBoxTestAllSteps(Impl == 0);
+				Collision.MoveBox(&aPos[Impl], &aVel[Impl], Size, Elasticity, &aGrounded[Impl]);
+			}
+			ASSERT_TRUE(SameVec(aPos[0], aPos[1])) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_TRUE(SameVec(aVel[0], aVel[1])) << pMap << " " << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			ASSERT_EQ(aGrounded[0], aGrounded[1]);
+		}
+	}
+}
+
+// Runs the same characters and inputs through two worlds, one of them
+// testing every MoveBox step, and compares the results after every tick.
+TEST(Collision, MoveBoxCharacterCore)
+{
+	static const int NUM_CHARACTERS = 8;
+	static const int NUM_TICKS = 300;
+
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision aTestCollisions[2];
+		CWorldCore aWorlds[2];
+		CCharacterCore aaCores[2][NUM_CHARACTERS];
+		for(int Impl = 0; Impl < 2; Impl++)
+		{
+			ASSERT_TRUE(aTestCollisions[Impl].Load(pMap)) << pMap;
+			aTestCollisions[Impl].m_Collision.SetMoveBoxTestAllSteps(Impl == 0);
+		}
+
+		CTestCollision &TestCollision = aTestCollisions[0];
+		for(int c = 0; c < NUM_CHARACTERS; c++)
+		{
+			vec2 Pos;
+			do
+			{
+				Pos = vec2(TestCollision.RandomFloat(TestCollision.m_Collision.GetWidth() * 32.0f), TestCollision.RandomFloat(TestCollision.m_Collision.GetHeight() * 32.0f));
+			} while(TestCollision.m_Collision.TestBox(Pos, CCharacterCore::PhysicalSizeVec2()));
+
+			for(int Impl = 0; Impl < 2; Impl++)
+			{
+				CCharacterCore &Core = aaCores[Impl][c];
+				Core.Init(&aWorlds[Impl], &aTestCollisions[Impl].m_Collision);
+				Core.Reset();
+				Core.m_Pos = Pos;
+				aWorlds[Impl].m_apCharacters[c] = &Core;
+			}
+		}
+
+		for(int Tick = 0; Tick < NUM_TICKS; Tick++)
+		{
+			for(int c = 0; c < NUM_CHARACTERS; c++)
+			{
+				CNetObj_PlayerInput Input = {0};
+				Input.m_Direction = (int)(TestCollision.m_Prng.RandomBits() % 3) - 1;
+				Input.m_TargetX = (int)(TestCollision.m_Prng.RandomBits() % 801) - 400;
+				Input.m_TargetY = (int)(TestCollision.m_Prng.RandomBits() % 801) - 400;
+				Input.m_Jump = TestCollision.m_Prng.RandomBits() % 8 == 0;
+				Input.m_Hook = TestCollision.m_Prng.RandomBits() % 4 != 0;
+				// like speedups or explosions
+				const bool Boost = TestCollision.m_Prng.RandomBits() % 50 == 0;
+				const vec2 BoostVel = direction(TestCollision.RandomFloat(2.0f * pi)) * TestCollision.RandomFloat(120.0f);
+				for(int Impl = 0; Impl < 2; Impl++)
+				{
+					aaCores[Impl][c].m_Input = Input;
+					if(Boost)
+						aaCores[Impl][c].m_Vel += BoostVel;
+				}
+			}
+
+			for(int Impl = 0; Impl < 2; Impl++)
+			{
+				for(CCharacterCore &Core : aaCores[Impl])
+					Core.Tick(true);
+				for(CCharacterCore &Core : aaCores[Impl])
+				{
+					Core.Move();
+					Core.Quantize();
+				}
+			}
+
+			for(int c = 0; c < NUM_CHARACTERS; c++)
+			{
+				const CCharacterCore &Core0 = aaCores[0][c];
+				const CCharacterCore &Core1 = aaCores[1][c];
+				ASSERT_TRUE(SameVec(Core0.m_Pos, Core1.m_Pos)) << pMap << " tick " << Tick << " character " << c;
+				ASSERT_TRUE(SameVec(Core0.m_Vel, Core1.m_Vel)) << pMap << " tick " << Tick << " character " << c;
+				ASSERT_TRUE(SameVec(Core0.m_HookPos, Core1.m_HookPos)) << pMap << " tick " << Tick << " character " << c;
+				ASSERT_EQ(Core0.m_HookState, Core1.m_HookState);
+				ASSERT_EQ(Core0.m_Jumped, Core1.m_Jumped);
+			}
+		}
+	}
+}
+
+TEST(Collision, TileAttributes)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		const CCollision &Collision = TestCollision.m_Collision;
+		CLayers &Layers = TestCollision.m_Layers;
+		const CTeleTile *pTele = TestCollision.m_Collision.TeleLayer();
+		const CSwitchTile *pSwitch = TestCollision.m_Collision.SwitchLayer();
+		const CTuneTile *pTune = TestCollision.m_Collision.TuneLayer();
+		const CSpeedupTile *pSpeedup = Layers.SpeedupLayer() ? static_cast<CSpeedupTile *>(Layers.Map()->GetData(Layers.SpeedupLayer()->m_Speedup)) : nullptr;
+
+		ASSERT_EQ(Collision.TileAttributes(0) != nullptr, pTele || pSwitch || pTune || pSpeedup) << pMap;
+		ASSERT_EQ(Collision.TileAttributes(-1), nullptr);
+		for(int i = 0; i < Collision.GetWidth() * Collision.GetHeight(); i++)
+		{
+			const int TeleType = pTele ? pTele[i].m_Type : 0;
+			const int TeleNumber = pTele ? pTele[i].m_Number : 0;
+			ASSERT_EQ(Collision.IsTeleport(i), TeleType == TILE_TELEIN ? TeleNumber : 0) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsEvilTeleport(i), TeleType == TILE_TELEINEVIL ? TeleNumber : 0) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsCheckTeleport(i), pTele && TeleType == TILE_TELECHECKIN) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsCheckEvilTeleport(i), pTele && TeleType == TILE_TELECHECKINEVIL) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsTeleCheckpoint(i), TeleType == TILE_TELECHECK ? TeleNumber : 0) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsTeleportWeapon(i), TeleType == TILE_TELEINWEAPON ? TeleNumber : 0) << pMap << " " << i;
+			ASSERT_EQ(Collision.IsTeleportHook(i), TeleType == TILE_TELEINHOOK ? TeleNumber : 0) << pMap << " " << i;
+
+			const int SwitchType = pSwitch ? pSwitch[i].m_Type : 0;
+			ASSERT_EQ(Collision.GetSwitchType(i), SwitchType) << pMap << " " << i;
+			ASSERT_EQ(Collision.GetSwitchNumber(i), SwitchType > 0 ? pSwitch[i].m_Number : 0) << pMap << " " << i;
+			ASSERT_EQ(Collision.GetSwitchDelay(i), SwitchType > 0 ? pSwitch[i].m_Delay : 0) << pMap << " " << i;
+
+			ASSERT_EQ(Collision.IsTune(i), pTune && pTune[i].m_Type ? pTune[i].m_Number : 0) << pMap << " " << i;
+
+			ASSERT_EQ(Collision.IsSpeedup(i), pSpeedup && pSpeedup[i].m_Force > 0 ? i : 0) << pMap << " " << i;
+			vec2 Dir = vec2(0.0f, 0.0f);
+			int Force = -1;
+			int MaxSpeed = -1;
+			Collision.GetSpeedup(i, &Dir, &Force, &MaxSpeed);
+			if(pSpeedup)
+			{
+				ASSERT_TRUE(SameVec(Dir, direction(pSpeedup[i].m_Angle * (pi / 180.0f)))) << pMap << " " << i;
+				ASSERT_EQ(Force, pSpeedup[i].m_Force) << pMap << " " << i;
+				ASSERT_EQ(MaxSpeed, pSpeedup[i].m_MaxSpeed) << pMap << " " << i;
+			}
+			else
+			{
+				ASSERT_EQ(Force, -1) << pMap << " " << i;
+			}
+		}
+	}
+}
+
+TEST(Collision, TeleOuts)
+{
+	for(const char *pMap : s_apMaps)
+	{
+		CTestCollision TestCollision;
+		ASSERT_TRUE(TestCollision.Load(pMap)) << pMap;
+		const CCollision &Collision = TestCollision.m_Collision;
+		const CTeleTile *pTele = TestCollision.m_Collision.TeleLayer();
+
+		// the tele outs the way the game controller used to collect them
+		std::map<int, std::vector<vec2>> aExpected[2];
+		const int Width = Collision.GetWidth();
+		for(int i = 0; pTele && i < Width * Collision.GetHeight(); i++)
+		{
+			if(pTele[i].m_Number > 0 && pTele[i].m_Type == TILE_TELEOUT)
+				aExpected[0][pTele[i].m_Number].emplace_back(i % Width * 32.0f + 16.0f, i / Width * 32.0f + 16.0f);
+			else if(pTele[i].m_Number > 0 && pTele[i].m_Type == TILE_TELECHECKOUT)
+				aExpected[1][pTele[i].m_Number].emplace_back(i % Width * 32.0f + 16.0f, i / Width * 32.0f + 16.0f);
+		}
+
+		const CTeleOuts *apTeleOuts[2] = {&Collision.TeleOuts(), &Collision.TeleCheckOuts()};
+		for(int Type = 0; Type < 2; Type++)
+		{
+			for(int Number = -1; Number <= 257; Number++)
+			{
+				const std::vector<vec2> &vExpected = aExpected[Type][Number];
+				ASSERT_EQ(apTeleOuts[Type]->Num(Number), (int)vExpected.size()) << pMap << " " << Number;
+				for(int i = 0; i < (int)vExpected.size(); i++)
+					ASSERT_TRUE(SameVec(apTeleOuts[Type]->Get(Number, i), vExpected[i])) << pMap << " " << Number << " " << i;
+			}
+		}
+	}
+}
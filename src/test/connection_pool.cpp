@@ -0,0 +1,115 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+
+#include <memory>
+#include <vector>
+
+struct CPoolTestData : ISqlData
+{
+	CPoolTestData(std::shared_ptr<ISqlResult> pResult) :
+		ISqlData(std::move(pResult))
+	{
+	}
+
+	char m_aKey[16];
+	int m_Seq;
+};
+
+static bool PoolTestWrite(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	const CPoolTestData *pData = dynamic_cast<const CPoolTestData *>(pGameData);
+	if(w != Write::NORMAL)
+		return false;
+	if(pSqlServer->PrepareStatement("INSERT INTO pool_test(Key, Seq) VALUES (?, ?)", pError, ErrorSize))
+		return true;
+	pSqlServer->BindString(1, pData->m_aKey);
+	pSqlServer->BindInt(2, pData->m_Seq);
+	int NumInserted;
+	return pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
+}
+
+static bool PoolTestRead(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+{
+	if(pSqlServer->PrepareStatement("SELECT COUNT(*) FROM pool_test", pError, ErrorSize))
+		return true;
+	bool End;
+	return pSqlServer->Step(&End, pError, ErrorSize) || End;
+}
+
+TEST(ConnectionPool, ShardedWriteOrder)
+{
+	CTestInfo Info;
+	char aError[256];
+	auto pConn = CreateSqliteConnection(Info.m_aFilename, true);
+	ASSERT_FALSE(pConn->Connect(aError, sizeof(aError))) << aError;
+	int NumUpdated;
+	ASSERT_FALSE(pConn->PrepareStatement("CREATE TABLE pool_test(Key VARCHAR(16) NOT NULL, Seq INTEGER NOT NULL)", aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(pConn->ExecuteUpdate(&NumUpdated, aError, sizeof(aError))) << aError;
+	pConn->Disconnect();
+
+	const int NUM_KEYS = 8;
+	const int NUM_WRITES = 400;
+	std::vector<std::shared_ptr<ISqlResult>> vpResults;
+	{
+		CDbConnectionPool Pool;
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, Info.m_aFilename);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, Info.m_aFilename);
+		Pool.Start(4);
+		for(int i = 0; i < NUM_WRITES; i++)
+		{
+			vpResults.push_back(std::make_shared<ISqlResult>());
+			auto pData = std::make_unique<CPoolTestData>(vpResults.back());
+			str_format(pData->m_aKey, sizeof(pData->m_aKey), "player%d", i % NUM_KEYS);
+			pData->m_Seq = i;
+			char aKey[16];
+			str_copy(aKey, pData->m_aKey);
+			Pool.ExecuteWrite(PoolTestWrite, std::move(pData), "pool test write", aKey);
+
+			vpResults.push_back(std::make_shared<ISqlResult>());
+			Pool.Execute(PoolTestRead, std::make_unique<CPoolTestData>(vpResults.back()), "pool test read");
+		}
+		// read queries are dismissed during shutdown
+		for(const auto &pResult : vpResults)
+		{
+			while(!pResult->m_Completed.load())
+				thread_yield();
+		}
+		Pool.OnShutdown();
+	}
+	for(const auto &pResult : vpResults)
+	{
+		ASSERT_TRUE(pResult->m_Completed.load());
+		EXPECT_TRUE(pResult->m_Success);
+	}
+
+	ASSERT_FALSE(pConn->Connect(aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(pConn->PrepareStatement("SELECT Key, Seq FROM pool_test ORDER BY rowid", aError, sizeof(aError))) << aError;
+	int aLastSeq[NUM_KEYS];
+	for(int &LastSeq : aLastSeq)
+		LastSeq = -1;
+	int NumRows = 0;
+	bool End;
+	while(!pConn->Step(&End, aError, sizeof(aError)) && !End)
+	{
+		char aKey[16];
+		pConn->GetString(1, aKey, sizeof(aKey));
+		const int Seq = pConn->GetInt(2);
+		const int Key = Seq % NUM_KEYS;
+		char aExpectedKey[16];
+		str_format(aExpectedKey, sizeof(aExpectedKey), "player%d", Key);
+		EXPECT_STREQ(aKey, aExpectedKey);
+		// writes of the same key are executed in the order they were queued
+		EXPECT_GT(Seq, aLastSeq[Key]);
+		aLastSeq[Key] = Seq;
+		NumRows++;
+	}
+	pConn->Disconnect();
+	EXPECT_EQ(NumRows, NUM_WRITES);
+	// close the database first, so SQLite removes its WAL files
+	pConn = nullptr;
+	fs_remove(Info.m_aFilename);
+}
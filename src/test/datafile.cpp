@@ -1,8 +1,11 @@
 #include "test.h"
 #include <gtest/gtest.h>
+#include <iterator>
 #include <memory>
+#include <vector>
 
 #include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 #include <game/mapitems_ex.h>
 
@@ -105,3 +108,165 @@ TEST(Datafile, StringData)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, Data)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+
+	int aData[1024];
+	for(int i = 0; i < (int)std::size(aData); i++)
+		aData[i] = i * i;
+	CMapItemTest ItemTest;
+	mem_zero(&ItemTest, sizeof(ItemTest));
+	ItemTest.m_Version = CMapItemTest::CURRENT_VERSION;
+	ItemTest.m_Field3 = 9876;
+
+	{
+		CDataFileWriter Writer;
+		Writer.Open(pStorage.get(), Info.m_aFilename);
+		EXPECT_EQ(Writer.AddData(sizeof(aData), aData), 0);
+		EXPECT_EQ(Writer.AddData(sizeof(aData), aData, 0), 1); // no compression
+		Writer.AddItem(MAPITEMTYPE_TEST, 0x8000, sizeof(ItemTest), &ItemTest);
+		Writer.Finish();
+	}
+
+	void *pFile;
+	unsigned FileSize;
+	ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_SAVE, &pFile, &FileSize));
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		EXPECT_EQ(Reader.Sha256(), sha256(pFile, FileSize));
+		EXPECT_EQ(Reader.MapSize(), (int)FileSize);
+
+		const CMapItemTest *pTest = (const CMapItemTest *)Reader.FindItem(MAPITEMTYPE_TEST, 0x8000);
+		ASSERT_TRUE(pTest);
+		EXPECT_EQ(pTest->m_Field3, 9876);
+
+		for(int Index = 0; Index < 2; Index++)
+		{
+			ASSERT_EQ(Reader.GetDataSize(Index), (int)sizeof(aData));
+			ASSERT_TRUE(Reader.GetData(Index));
+			EXPECT_EQ(mem_comp(Reader.GetData(Index), aData, sizeof(aData)), 0);
+			Reader.UnloadData(Index);
+			ASSERT_TRUE(Reader.GetData(Index));
+			EXPECT_EQ(mem_comp(Reader.GetData(Index), aData, sizeof(aData)), 0);
+		}
+
+		char *pReplacement = (char *)malloc(4);
+		mem_copy(pReplacement, "abc", 4);
+		Reader.ReplaceData(0, pReplacement, 4);
+		EXPECT_STREQ(Reader.GetDataString(0), "abc");
+		Reader.Close();
+	}
+	free(pFile);
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+static void WriteBlocks(IStorage *pStorage, const char *pFilename, CJobPool *pJobPool)
+{
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, pFilename));
+	for(int Block = 0; Block < 32; Block++)
+	{
+		std::vector<int> vData((Block + 1) * 1000);
+		for(size_t i = 0; i < vData.size(); i++)
+			vData[i] = (i * (Block + 3)) % 251;
+		Writer.AddData(vData.size() * sizeof(int), vData.data(), Block % 10);
+	}
+	CMapItemTest ItemTest;
+	mem_zero(&ItemTest, sizeof(ItemTest));
+	Writer.AddItem(MAPITEMTYPE_TEST, 0x8000, sizeof(ItemTest), &ItemTest);
+	Writer.Finish(pJobPool);
+}
+
+TEST(Datafile, ParallelCompressionSameOutput)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+	char aSerial[IO_MAX_PATH_LENGTH];
+	char aParallel[IO_MAX_PATH_LENGTH];
+	str_format(aSerial, sizeof(aSerial), "%s.serial", Info.m_aFilename);
+	str_format(aParallel, sizeof(aParallel), "%s.parallel", Info.m_aFilename);
+
+	WriteBlocks(pStorage.get(), aSerial, nullptr);
+	{
+		CJobPool JobPool;
+		JobPool.Init(4);
+		WriteBlocks(pStorage.get(), aParallel, &JobPool);
+	}
+
+	SHA256_DIGEST SerialSha256, ParallelSha256;
+	ASSERT_TRUE(pStorage->CalculateHashes(aSerial, IStorage::TYPE_SAVE, &SerialSha256));
+	ASSERT_TRUE(pStorage->CalculateHashes(aParallel, IStorage::TYPE_SAVE, &ParallelSha256));
+	EXPECT_EQ(SerialSha256, ParallelSha256);
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage.get(), aParallel, IStorage::TYPE_SAVE));
+	ASSERT_EQ(Reader.NumData(), 32);
+	for(int Block = 0; Block < 32; Block++)
+	{
+		ASSERT_EQ(Reader.GetDataSize(Block), (Block + 1) * 1000 * (int)sizeof(int));
+		const int *pData = (const int *)Reader.GetData(Block);
+		ASSERT_TRUE(pData);
+		EXPECT_EQ(pData[Block * 1000 + 7], (int)(((Block * 1000 + 7) * (Block + 3)) % 251));
+	}
+	Reader.Close();
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(aSerial, IStorage::TYPE_SAVE);
+		pStorage->RemoveFile(aParallel, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Datafile, TruncatedWhileOpen)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+
+	// larger than the buffer of the file
+	std::vector<int> vData(64 * 1024);
+	for(int i = 0; i < (int)vData.size(); i++)
+		vData[i] = i * i;
+	CMapItemTest ItemTest;
+	mem_zero(&ItemTest, sizeof(ItemTest));
+	ItemTest.m_Version = CMapItemTest::CURRENT_VERSION;
+	ItemTest.m_Field3 = 9876;
+
+	{
+		CDataFileWriter Writer;
+		Writer.Open(pStorage.get(), Info.m_aFilename);
+		EXPECT_EQ(Writer.AddData(vData.size() * sizeof(int), vData.data(), 0), 0); // no compression
+		Writer.AddItem(MAPITEMTYPE_TEST, 0x8000, sizeof(ItemTest), &ItemTest);
+		Writer.Finish();
+	}
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+
+		// like a map that is overwritten while the server has it loaded
+		IOHANDLE File = pStorage->OpenFile(Info.m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_close(File);
+
+		// the items are read when opening, the data is gone
+		const CMapItemTest *pTest = (const CMapItemTest *)Reader.FindItem(MAPITEMTYPE_TEST, 0x8000);
+		ASSERT_TRUE(pTest);
+		EXPECT_EQ(pTest->m_Field3, 9876);
+		EXPECT_FALSE(Reader.GetData(0));
+		Reader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
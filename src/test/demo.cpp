@@ -0,0 +1,272 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/demo.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <game/generated/protocol.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+static void RecordDemo(IStorage *pStorage, const char *pFilename, CSnapshotDelta *pDelta, CDemoRecordWriter *pWriter)
+{
+	CDemoRecorder Recorder(pDelta, true, pWriter);
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = {};
+	ASSERT_EQ(Recorder.Start(pStorage, nullptr, pFilename, "0.6 626fce9a778df4d4", "test", Sha256, 0, "server", 0, aMapData), 0);
+	ASSERT_TRUE(Recorder.IsRecording());
+
+	for(int Tick = 1; Tick <= 1000; Tick++)
+	{
+		CSnapshotBuilder Builder;
+		Builder.Init();
+		for(int i = 0; i < 16; i++)
+		{
+			CNetObj_Character *pCharacter = (CNetObj_Character *)Builder.NewItem(NETOBJTYPE_CHARACTER, i, sizeof(CNetObj_Character));
+			mem_zero(pCharacter, sizeof(*pCharacter));
+			pCharacter->m_Tick = Tick;
+			pCharacter->m_X = (Tick * (i + 1)) % 3000;
+			pCharacter->m_Y = i * 32;
+		}
+		char aData[CSnapshot::MAX_SIZE];
+		const int Size = Builder.Finish(aData);
+		Recorder.RecordSnapshot(Tick, aData, Size);
+
+		if(Tick % 7 == 0)
+		{
+			char aMessage[32];
+			str_format(aMessage, sizeof(aMessage), "message %d", Tick);
+			Recorder.RecordMessage(aMessage, str_length(aMessage));
+		}
+		if(Tick % 100 == 0)
+			Recorder.AddDemoMarker();
+	}
+	EXPECT_EQ(Recorder.Length(), 999 / SERVER_TICK_SPEED);
+	EXPECT_EQ(Recorder.Stop(), 0);
+	EXPECT_FALSE(Recorder.IsRecording());
+}
+
+TEST(Demo, WriterThreadSameFile)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(NETOBJTYPE_CHARACTER, sizeof(CNetObj_Character));
+	RecordDemo(pStorage.get(), "direct.demo", &Delta, nullptr);
+	{
+		// small enough to make the recorder wait for the writer
+		CDemoRecordWriter Writer(4096);
+		RecordDemo(pStorage.get(), "writer.demo", &Delta, &Writer);
+		EXPECT_GT(Writer.Stats().m_NumJobs, 1000);
+		EXPECT_LE(Writer.Stats().m_MaxQueuedBytes, 4096 + CSnapshot::MAX_SIZE);
+	}
+
+	void *pDirect;
+	unsigned DirectSize;
+	void *pWriter;
+	unsigned WriterSize;
+	ASSERT_TRUE(pStorage->ReadFile("direct.demo", IStorage::TYPE_SAVE, &pDirect, &DirectSize));
+	ASSERT_TRUE(pStorage->ReadFile("writer.demo", IStorage::TYPE_SAVE, &pWriter, &WriterSize));
+	ASSERT_GT(DirectSize, sizeof(CDemoHeader));
+	ASSERT_EQ(DirectSize, WriterSize);
+	// the recordings might have been started in different seconds
+	mem_zero((char *)pDirect + offsetof(CDemoHeader, m_aTimestamp), sizeof(CDemoHeader::m_aTimestamp));
+	mem_zero((char *)pWriter + offsetof(CDemoHeader, m_aTimestamp), sizeof(CDemoHeader::m_aTimestamp));
+	EXPECT_EQ(mem_comp(pDirect, pWriter, DirectSize), 0);
+	free(pDirect);
+	free(pWriter);
+}
+
+// records two demos at once, the first one is stopped halfway
+static void RecordTwoDemos(IStorage *pStorage, const char *pFilename0, const char *pFilename1, CSnapshotDelta *pDelta, CDemoRecordWriter *pWriter)
+{
+	CDemoRecorder aRecorders[2] = {CDemoRecorder(pDelta, true, pWriter), CDemoRecorder(pDelta, true, pWriter)};
+	const char *apFilenames[2] = {pFilename0, pFilename1};
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = {};
+	for(int r = 0; r < 2; r++)
+		ASSERT_EQ(aRecorders[r].Start(pStorage, nullptr, apFilenames[r], "0.6 626fce9a778df4d4", "test", Sha256, 0, "server", 0, aMapData), 0);
+
+	for(int Tick = 1; Tick <= 1000; Tick++)
+	{
+		for(int r = 0; r < 2; r++)
+		{
+			if(!aRecorders[r].IsRecording())
+				continue;
+			CSnapshotBuilder Builder;
+			Builder.Init();
+			for(int i = 0; i < 16; i++)
+			{
+				CNetObj_Character *pCharacter = (CNetObj_Character *)Builder.NewItem(NETOBJTYPE_CHARACTER, i, sizeof(CNetObj_Character));
+				mem_zero(pCharacter, sizeof(*pCharacter));
+				pCharacter->m_Tick = Tick;
+				pCharacter->m_X = (Tick * (i + 1) * (r + 1)) % 3000;
+			}
+			char aData[CSnapshot::MAX_SIZE];
+			const int Size = Builder.Finish(aData);
+			aRecorders[r].RecordSnapshot(Tick, aData, Size);
+		}
+		if(Tick == 500)
+		{
+			EXPECT_EQ(aRecorders[0].Stop(), 0);
+		}
+	}
+	EXPECT_EQ(aRecorders[1].Stop(), 0);
+}
+
+static void ExpectSameDemo(IStorage *pStorage, const char *pFilename0, const char *pFilename1)
+{
+	void *apData[2];
+	unsigned aSizes[2];
+	ASSERT_TRUE(pStorage->ReadFile(pFilename0, IStorage::TYPE_SAVE, &apData[0], &aSizes[0]));
+	ASSERT_TRUE(pStorage->ReadFile(pFilename1, IStorage::TYPE_SAVE, &apData[1], &aSizes[1]));
+	EXPECT_GT(aSizes[0], sizeof(CDemoHeader));
+	EXPECT_EQ(aSizes[0], aSizes[1]);
+	if(aSizes[0] == aSizes[1])
+	{
+		for(void *pData : apData)
+			mem_zero((char *)pData + offsetof(CDemoHeader, m_aTimestamp), sizeof(CDemoHeader::m_aTimestamp));
+		EXPECT_EQ(mem_comp(apData[0], apData[1], aSizes[0]), 0) << pFilename0 << " " << pFilename1;
+	}
+	free(apData[0]);
+	free(apData[1]);
+}
+
+TEST(Demo, WriterThreadTwoRecordings)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(NETOBJTYPE_CHARACTER, sizeof(CNetObj_Character));
+	RecordTwoDemos(pStorage.get(), "direct0.demo", "direct1.demo", &Delta, nullptr);
+	{
+		CDemoRecordWriter Writer;
+		RecordTwoDemos(pStorage.get(), "writer0.demo", "writer1.demo", &Delta, &Writer);
+	}
+	ExpectSameDemo(pStorage.get(), "direct0.demo", "writer0.demo");
+	ExpectSameDemo(pStorage.get(), "direct1.demo", "writer1.demo");
+}
+
+class CDemoLog : public CDemoPlayer::IListener
+{
+public:
+	const CDemoPlayer *m_pPlayer = nullptr;
+	std::vector<std::string> m_vEntries;
+
+	void Add(char Type, const void *pData, int Size)
+	{
+		char aSha256[SHA256_MAXSTRSIZE];
+		sha256_str(sha256(pData, Size), aSha256, sizeof(aSha256));
+		char aEntry[128];
+		str_format(aEntry, sizeof(aEntry), "%c %d %d %s", Type, m_pPlayer->BaseInfo()->m_CurrentTick, Size, aSha256);
+		m_vEntries.emplace_back(aEntry);
+	}
+	void OnDemoPlayerSnapshot(void *pData, int Size) override { Add('S', pData, Size); }
+	void OnDemoPlayerMessage(void *pData, int Size) override { Add('M', pData, Size); }
+};
+
+static void PlayDemo(IStorage *pStorage, const char *pFilename, CSnapshotDelta *pDelta, int PrefetchTicks, std::vector<std::string> *pvLog)
+{
+	CDemoPlayer Player(pDelta, false);
+	CDemoLog Log;
+	Log.m_pPlayer = &Player;
+	Player.SetListener(&Log);
+	Player.SetPrefetchTicks(PrefetchTicks);
+	Player.SetKeyFrameIndexFiles(4);
+	ASSERT_EQ(Player.Load(pStorage, nullptr, pFilename, IStorage::TYPE_SAVE), 0);
+	EXPECT_EQ(Player.BaseInfo()->m_FirstTick, 1);
+	EXPECT_EQ(Player.BaseInfo()->m_LastTick, 1000);
+
+	Player.Play();
+	Player.Update(false);
+	EXPECT_TRUE(Player.IsPlaying());
+	EXPECT_TRUE(Player.BaseInfo()->m_Paused);
+	EXPECT_EQ(Player.BaseInfo()->m_CurrentTick, 1000);
+
+	// backwards, forwards within the same key frame interval and forwards
+	// past a key frame
+	for(int Tick : {500, 503, 820, 12, 1000})
+	{
+		ASSERT_EQ(Player.SetPos(Tick), 0);
+		char aEntry[32];
+		str_format(aEntry, sizeof(aEntry), "seek %d %d", Tick, Player.BaseInfo()->m_CurrentTick);
+		Log.m_vEntries.emplace_back(aEntry);
+	}
+	Player.Stop();
+	*pvLog = Log.m_vEntries;
+}
+
+static int CountFiles(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	if(!IsDir)
+		(*static_cast<int *>(pUser))++;
+	return 0;
+}
+
+TEST(Demo, PrefetchAndKeyFrameIndex)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	ASSERT_TRUE(pStorage->CreateFolder("demoindex", IStorage::TYPE_SAVE));
+	CNetBase::Init();
+
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(NETOBJTYPE_CHARACTER, sizeof(CNetObj_Character));
+	RecordDemo(pStorage.get(), "test.demo", &Delta, nullptr);
+
+	// the first load scans the file and writes the key frame index
+	std::vector<std::string> vDirect;
+	PlayDemo(pStorage.get(), "test.demo", &Delta, 0, &vDirect);
+	int NumIndexFiles = 0;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CountFiles, &NumIndexFiles);
+	EXPECT_EQ(NumIndexFiles, 1);
+	ASSERT_GT(vDirect.size(), 1000u);
+
+	// a small prefetch window makes the player wait for the prefetcher
+	std::vector<std::string> vPrefetch;
+	PlayDemo(pStorage.get(), "test.demo", &Delta, 5, &vPrefetch);
+	EXPECT_EQ(vDirect, vPrefetch);
+}
+
+TEST(Demo, PruneKeyFrameIndex)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	ASSERT_TRUE(pStorage->CreateFolder("demoindex", IStorage::TYPE_SAVE));
+	for(const char *pName : {"demoindex/1.idx", "demoindex/2.idx", "demoindex/3.idx", "demoindex/4.idx", "demoindex/5.idx", "demoindex/other.txt"})
+	{
+		IOHANDLE File = pStorage->OpenFile(pName, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_close(File);
+	}
+
+	CDemoPlayer::PruneKeyFrameIndex(pStorage.get(), 5);
+	int NumFiles = 0;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CountFiles, &NumFiles);
+	EXPECT_EQ(NumFiles, 6);
+
+	// other files in the folder are kept
+	CDemoPlayer::PruneKeyFrameIndex(pStorage.get(), 2);
+	NumFiles = 0;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CountFiles, &NumFiles);
+	EXPECT_EQ(NumFiles, 3);
+	EXPECT_TRUE(pStorage->FileExists("demoindex/other.txt", IStorage::TYPE_SAVE));
+}
@@ -0,0 +1,142 @@
+#include "envelope_eval.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+
+#include <engine/storage.h>
+
+#include <game/client/envelope_eval.h>
+#include <game/mapitems.h>
+
+#include <chrono>
+#include <memory>
+
+using namespace std::chrono_literals;
+
+static const char *const s_apMaps[] = {"data/maps/Gold Mine.map", "data/maps/LearnToPlay.map", "data/maps/Sunny Side Up.map", "data/maps/Tsunami.map", "data/maps/Tutorial.map", "data/maps/coverage.map", "data/maps/ctf1.map", "data/maps/ctf2.map", "data/maps/ctf3.map", "data/maps/ctf4.map", "data/maps/ctf5.map", "data/maps/ctf6.map", "data/maps/ctf7.map", "data/maps/dm1.map", "data/maps/dm2.map", "data/maps/dm6.map", "data/maps/dm7.map", "data/maps/dm8.map", "data/maps/dm9.map"};
+
+TEST(EnvelopeEval, Step)
+{
+	CTestEnvelopePointAccess Points;
+	Points.AddPoint(0, CURVETYPE_STEP, 1.0f);
+	Points.AddPoint(100, CURVETYPE_STEP, 2.0f);
+	Points.AddPoint(250, CURVETYPE_LINEAR, 3.0f);
+	Points.AddPoint(300, CURVETYPE_LINEAR, 5.0f);
+
+	CEnvelopeTable Table;
+	ASSERT_TRUE(Table.Bake(&Points, 4));
+	EXPECT_EQ(Table.NumSamples(), 0);
+
+	// step curves must jump exactly at the point times, including the end of
+	// a segment belonging to it
+	for(const auto Time : {0ns, 1ns, std::chrono::nanoseconds(100ms) - 1ns, std::chrono::nanoseconds(100ms), std::chrono::nanoseconds(100ms) + 1ns, std::chrono::nanoseconds(250ms), std::chrono::nanoseconds(275ms), std::chrono::nanoseconds(299ms), std::chrono::nanoseconds(300ms), std::chrono::nanoseconds(1234567ms)})
+	{
+		ColorRGBA Expected, Baked;
+		EvalEnvelope(&Points, 4, Time, Expected);
+		Table.Eval(Time, Baked);
+		EXPECT_EQ(Expected, Baked) << Time.count();
+	}
+}
+
+TEST(EnvelopeEval, BezierSamples)
+{
+	// bezier with tangents along the straight line between the points
+	CTestEnvelopePointAccess Straight;
+	Straight.AddPoint(0, CURVETYPE_BEZIER, 0.0f);
+	Straight.AddPoint(1000, CURVETYPE_LINEAR, 1.0f);
+	for(int c = 0; c < CEnvPoint::MAX_CHANNELS; c++)
+	{
+		Straight.m_vBeziers[0].m_aOutTangentDeltaX[c] = 100;
+		Straight.m_vBeziers[0].m_aOutTangentDeltaY[c] = f2fx(0.1f);
+		Straight.m_vBeziers[1].m_aInTangentDeltaX[c] = -100;
+		Straight.m_vBeziers[1].m_aInTangentDeltaY[c] = f2fx(-0.1f);
+	}
+	CEnvelopeTable StraightTable;
+	ASSERT_TRUE(StraightTable.Bake(&Straight, 4));
+	EXPECT_EQ(StraightTable.NumSamples(), CEnvelopeTable::MIN_SEGMENT_SAMPLES + 1);
+
+	// a sharp ease in and out needs more samples
+	CTestEnvelopePointAccess Curved = Straight;
+	for(int c = 0; c < CEnvPoint::MAX_CHANNELS; c++)
+	{
+		Curved.m_vBeziers[0].m_aOutTangentDeltaX[c] = 600;
+		Curved.m_vBeziers[0].m_aOutTangentDeltaY[c] = 0;
+		Curved.m_vBeziers[1].m_aInTangentDeltaX[c] = -600;
+		Curved.m_vBeziers[1].m_aInTangentDeltaY[c] = 0;
+	}
+	CEnvelopeTable CurvedTable;
+	ASSERT_TRUE(CurvedTable.Bake(&Curved, 4));
+	EXPECT_GT(CurvedTable.NumSamples(), CEnvelopeTable::MIN_SEGMENT_SAMPLES + 1);
+	EXPECT_LE(CurvedTable.NumSamples(), CEnvelopeTable::MAX_SEGMENT_SAMPLES + 1);
+
+	for(int Millis = 0; Millis <= 1000; Millis++)
+	{
+		ColorRGBA Expected, Baked;
+		EvalEnvelope(&Curved, 4, std::chrono::nanoseconds(std::chrono::milliseconds(Millis)), Expected);
+		CurvedTable.Eval(std::chrono::nanoseconds(std::chrono::milliseconds(Millis)), Baked);
+		EXPECT_NEAR(Expected.r, Baked.r, 1.0f / 512.0f) << Millis;
+	}
+}
+
+TEST(EnvelopeEval, Unsorted)
+{
+	CTestEnvelopePointAccess Points;
+	Points.AddPoint(0, CURVETYPE_LINEAR, 1.0f);
+	Points.AddPoint(200, CURVETYPE_LINEAR, 2.0f);
+	Points.AddPoint(100, CURVETYPE_LINEAR, 3.0f);
+
+	CEnvelopeTable Table;
+	EXPECT_FALSE(Table.Bake(&Points, 4));
+	EXPECT_FALSE(Table.Valid());
+}
+
+TEST(EnvelopeEval, Maps)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	for(const char *pMap : s_apMaps)
+	{
+		CTestMapEnvelopes Envelopes;
+		ASSERT_TRUE(Envelopes.Load(pStorage.get(), pMap)) << pMap;
+
+		for(size_t Env = 0; Env < Envelopes.m_vTables.size(); Env++)
+		{
+			SCOPED_TRACE(testing::Message() << pMap << " envelope " << Env);
+			const CEnvelopeTable &Table = Envelopes.m_vTables[Env];
+			ASSERT_TRUE(Table.Valid());
+			// only bezier curves are sampled, everything else must be exact
+			if(Table.NumSamples() > 0)
+				continue;
+			Envelopes.SelectEnvelope(Env);
+
+			// two loops of the envelope in uneven steps
+			const std::chrono::nanoseconds Step = maximum(Envelopes.Duration() / 997, std::chrono::nanoseconds(1ms) / 3);
+			for(std::chrono::nanoseconds Time = 0ns; Time <= 2 * Envelopes.Duration(); Time += Step)
+			{
+				ColorRGBA Expected, Baked;
+				EvalEnvelope(Envelopes.m_pPoints.get(), 4, Time, Expected);
+				Table.Eval(Time, Baked);
+				ASSERT_EQ(Expected, Baked) << Time.count();
+			}
+		}
+	}
+}
+
+TEST(EnvelopeEval, EditorBezier)
+{
+	CTestEnvelopePointAccess Points;
+	AddEditorBezierPoints(&Points);
+	CEnvelopeTable Table;
+	ASSERT_TRUE(Table.Bake(&Points, 4));
+
+	for(int i = 0; i < 4000; i++)
+	{
+		ColorRGBA Expected, Baked;
+		EvalEnvelope(&Points, 4, i * 1ms, Expected);
+		Table.Eval(i * 1ms, Baked);
+		// the tolerance is relative to the values of the segment, which go
+		// up to 200
+		for(int c = 0; c < CEnvPoint::MAX_CHANNELS; c++)
+			ASSERT_NEAR(Expected[c], Baked[c], 200.0f / 1024.0f) << i;
+	}
+}
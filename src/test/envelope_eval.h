@@ -0,0 +1,97 @@
+#ifndef TEST_ENVELOPE_EVAL_H
+#define TEST_ENVELOPE_EVAL_H
+
+#include <base/math.h>
+
+#include <engine/shared/datafile.h>
+#include <engine/storage.h>
+
+#include <game/client/envelope_eval.h>
+#include <game/mapitems.h>
+
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CTestEnvelopePointAccess : public IEnvelopePointAccess
+{
+public:
+	std::vector<CEnvPoint> m_vPoints;
+	std::vector<CEnvPointBezier> m_vBeziers;
+
+	void AddPoint(int Time, int Curvetype, float Value)
+	{
+		CEnvPoint Point;
+		Point.m_Time = Time;
+		Point.m_Curvetype = Curvetype;
+		for(int &PointValue : Point.m_aValues)
+			PointValue = f2fx(Value);
+		m_vPoints.push_back(Point);
+		m_vBeziers.push_back(CEnvPointBezier{});
+	}
+
+	int NumPoints() const override { return m_vPoints.size(); }
+	const CEnvPoint *GetPoint(int Index) const override { return &m_vPoints[Index]; }
+	const CEnvPointBezier *GetBezier(int Index) const override { return &m_vBeziers[Index]; }
+};
+
+// the envelopes of a map as CMapLayers bakes them
+class CTestMapEnvelopes
+{
+public:
+	CDataFileReader m_Reader;
+	std::unique_ptr<CMapBasedEnvelopePointAccess> m_pPoints;
+	std::vector<std::pair<int, int>> m_vRanges;
+	std::vector<CEnvelopeTable> m_vTables;
+
+	bool Load(IStorage *pStorage, const char *pMap)
+	{
+		if(!m_Reader.Open(pStorage, pMap, IStorage::TYPE_ALL))
+			return false;
+		m_pPoints = std::make_unique<CMapBasedEnvelopePointAccess>(&m_Reader);
+		int EnvStart, EnvNum;
+		m_Reader.GetType(MAPITEMTYPE_ENVELOPE, &EnvStart, &EnvNum);
+		m_vTables.resize(EnvNum);
+		for(int Env = 0; Env < EnvNum; Env++)
+		{
+			const CMapItemEnvelope *pItem = (CMapItemEnvelope *)m_Reader.GetItem(EnvStart + Env);
+			m_vRanges.emplace_back(pItem->m_StartPoint, pItem->m_NumPoints);
+			SelectEnvelope(Env);
+			m_vTables[Env].Bake(m_pPoints.get(), 4);
+		}
+		return true;
+	}
+
+	void SelectEnvelope(int Env)
+	{
+		m_pPoints->SetPointsRange(m_vRanges[Env].first, m_vRanges[Env].second);
+	}
+
+	// one full loop of the envelope
+	std::chrono::nanoseconds Duration() const
+	{
+		if(m_pPoints->NumPoints() == 0)
+			return std::chrono::nanoseconds(0);
+		return m_pPoints->GetPoint(m_pPoints->NumPoints() - 1)->m_Time * std::chrono::nanoseconds(std::chrono::milliseconds(1));
+	}
+};
+
+// an envelope with bezier curves like the editor creates them, none of the
+// maps in data/ use them
+inline void AddEditorBezierPoints(CTestEnvelopePointAccess *pPoints)
+{
+	for(int i = 0; i < 16; i++)
+	{
+		pPoints->AddPoint(i * 250, CURVETYPE_BEZIER, (i % 3) * 100.0f);
+		for(int c = 0; c < CEnvPoint::MAX_CHANNELS; c++)
+		{
+			pPoints->m_vBeziers[i].m_aInTangentDeltaX[c] = -50 - 10 * c;
+			pPoints->m_vBeziers[i].m_aInTangentDeltaY[c] = f2fx(-20.0f * c);
+			pPoints->m_vBeziers[i].m_aOutTangentDeltaX[c] = 50 + 10 * c;
+			pPoints->m_vBeziers[i].m_aOutTangentDeltaY[c] = f2fx(20.0f * c);
+		}
+	}
+}
+
+#endif // TEST_ENVELOPE_EVAL_H
@@ -0,0 +1,98 @@
+#include "image_manipulation.h"
+#include <gtest/gtest.h>
+
+#include <engine/gfx/image_manipulation.h>
+#include <engine/shared/jobs.h>
+
+#include <game/prng.h>
+
+#include <iterator>
+#include <vector>
+
+TEST(ImageManipulation, DilateDataImages)
+{
+	CJobPool JobPool;
+	JobPool.Init(4);
+
+	// a tileset, a large and a small image with soft edges and a cursor,
+	// DilateRandom covers the rest
+	for(const char *pPath : {"data/mapres/basic_freeze.png", "data/mapres/light.png", "data/arrow.png", "data/gui_cursor.png"})
+	{
+		STestImage Image;
+		ASSERT_TRUE(LoadImage(pPath, &Image)) << pPath;
+
+		std::vector<unsigned char> vExpected = Image.m_vData;
+		DilateImageSubReference(vExpected.data(), Image.m_Width, Image.m_Height, 0, 0, Image.m_Width, Image.m_Height);
+
+		std::vector<unsigned char> vResult = Image.m_vData;
+		DilateImage(vResult.data(), Image.m_Width, Image.m_Height);
+		ASSERT_TRUE(vResult == vExpected) << Image.m_Name;
+
+		vResult = Image.m_vData;
+		DilateImage(vResult.data(), Image.m_Width, Image.m_Height, &JobPool);
+		ASSERT_TRUE(vResult == vExpected) << Image.m_Name;
+	}
+}
+
+TEST(ImageManipulation, DilateRandom)
+{
+	CJobPool JobPool;
+	JobPool.Init(4);
+	CPrng Prng;
+	uint64_t aSeed[2] = {0x1234, 0x5678};
+	Prng.Seed(aSeed);
+
+	// few opaque pixels so colors spread far, with alpha values around the
+	// threshold
+	const unsigned char aAlphas[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 10, 11, 255};
+	for(int Size = 0; Size < 40; Size++)
+	{
+		const int w = 1 + Prng.RandomBits() % (Size < 20 ? 12 : 300);
+		const int h = 1 + Prng.RandomBits() % (Size < 20 ? 12 : 800);
+		std::vector<unsigned char> vImage((size_t)w * h * 4);
+		for(size_t i = 0; i < vImage.size(); i += 4)
+		{
+			for(int c = 0; c < 3; c++)
+				vImage[i + c] = Prng.RandomBits();
+			// even fewer in the large images, to spread colors over the
+			// borders of the bands
+			const unsigned Alpha = Prng.RandomBits() % (Size < 20 ? std::size(aAlphas) : 200);
+			vImage[i + 3] = Alpha < std::size(aAlphas) ? aAlphas[Alpha] : 0;
+		}
+
+		std::vector<unsigned char> vExpected = vImage;
+		DilateImageSubReference(vExpected.data(), w, h, 0, 0, w, h);
+		for(CJobPool *pJobPool : {(CJobPool *)nullptr, &JobPool})
+		{
+			std::vector<unsigned char> vResult = vImage;
+			DilateImage(vResult.data(), w, h, pJobPool);
+			ASSERT_TRUE(vResult == vExpected) << w << "x" << h;
+		}
+
+		// a part in the middle of the image
+		const int x = Prng.RandomBits() % w;
+		const int y = Prng.RandomBits() % h;
+		const int sw = Prng.RandomBits() % (w - x + 1);
+		const int sh = Prng.RandomBits() % (h - y + 1);
+		vExpected = vImage;
+		DilateImageSubReference(vExpected.data(), w, h, x, y, sw, sh);
+		for(CJobPool *pJobPool : {(CJobPool *)nullptr, &JobPool})
+		{
+			std::vector<unsigned char> vResult = vImage;
+			DilateImageSub(vResult.data(), w, h, x, y, sw, sh, pJobPool);
+			ASSERT_TRUE(vResult == vExpected) << w << "x" << h << " " << x << "," << y << " " << sw << "x" << sh;
+		}
+
+		// the tiles of a tileset, like map_optimize
+		vExpected = vImage;
+		std::vector<unsigned char> vResult = vImage;
+		const int TileW = w / 16;
+		const int TileH = h / 16;
+		for(int i = 0; i < 256; i++)
+		{
+			DilateImageSubReference(vExpected.data(), w, h, (i % 16) * TileW, (i / 16) * TileH, TileW, TileH);
+			DilateImageSub(vResult.data(), w, h, (i % 16) * TileW, (i / 16) * TileH, TileW, TileH, &JobPool);
+		}
+		ASSERT_TRUE(vResult == vExpected) << w << "x" << h;
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef TEST_IMAGE_MANIPULATION_H
+#define TEST_IMAGE_MANIPULATION_H
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/gfx/image_loader.h>
+
+#include <string>
+#include <vector>
+
+// The dilation as it was before it was vectorized and split into bands. The
+// new one has to give the same results.
+
+inline void DilateReference(int w, int h, const unsigned char *pSrc, unsigned char *pDest, unsigned char AlphaThreshold = 10)
+{
+	const int BPP = 4;
+	int ix, iy;
+	const int aDirX[] = {0, -1, 1, 0};
+	const int aDirY[] = {-1, 0, 0, 1};
+
+	int AlphaCompIndex = BPP - 1;
+
+	int m = 0;
+	for(int y = 0; y < h; y++)
+	{
+		for(int x = 0; x < w; x++, m += BPP)
+		{
+			for(int i = 0; i < BPP; ++i)
+				pDest[m + i] = pSrc[m + i];
+			if(pSrc[m + AlphaCompIndex] > AlphaThreshold)
+				continue;
+
+			int aSumOfOpaque[] = {0, 0, 0};
+			int Counter = 0;
+			for(int c = 0; c < 4; c++)
+			{
+				ix = clamp(x + aDirX[c], 0, w - 1);
+				iy = clamp(y + aDirY[c], 0, h - 1);
+				int k = iy * w * BPP + ix * BPP;
+				if(pSrc[k + AlphaCompIndex] > AlphaThreshold)
+				{
+					for(int p = 0; p < BPP - 1; ++p)
+						aSumOfOpaque[p] += pSrc[k + p];
+					++Counter;
+					break;
+				}
+			}
+
+			if(Counter > 0)
+			{
+				for(int i = 0; i < BPP - 1; ++i)
+				{
+					aSumOfOpaque[i] /= Counter;
+					pDest[m + i] = (unsigned char)aSumOfOpaque[i];
+				}
+
+				pDest[m + AlphaCompIndex] = 255;
+			}
+		}
+	}
+}
+
+inline void DilateImageSubReference(unsigned char *pImageBuff, int w, int h, int x, int y, int sw, int sh)
+{
+	const int BPP = 4;
+	std::vector<unsigned char> vOriginal((size_t)sw * sh * BPP);
+	std::vector<unsigned char> avBuffer[2];
+	avBuffer[0].resize(vOriginal.size());
+	avBuffer[1].resize(vOriginal.size());
+
+	for(int Y = 0; Y < sh; ++Y)
+		mem_copy(&vOriginal[(size_t)Y * sw * BPP], &pImageBuff[((size_t)(y + Y) * w + x) * BPP], (size_t)sw * BPP);
+
+	DilateReference(sw, sh, vOriginal.data(), avBuffer[0].data());
+	for(int i = 0; i < 5; i++)
+	{
+		DilateReference(sw, sh, avBuffer[0].data(), avBuffer[1].data());
+		DilateReference(sw, sh, avBuffer[1].data(), avBuffer[0].data());
+	}
+
+	for(size_t m = 0; m < vOriginal.size(); m += BPP)
+	{
+		for(int i = 0; i < BPP - 1; ++i)
+		{
+			if(vOriginal[m + 3] == 0)
+				vOriginal[m + i] = avBuffer[0][m + i];
+		}
+	}
+
+	for(int Y = 0; Y < sh; ++Y)
+		mem_copy(&pImageBuff[((size_t)(y + Y) * w + x) * BPP], &vOriginal[(size_t)Y * sw * BPP], (size_t)sw * BPP);
+}
+
+struct STestImage
+{
+	std::string m_Name;
+	int m_Width;
+	int m_Height;
+	std::vector<unsigned char> m_vData;
+};
+
+// an RGBA image from a png file
+inline bool LoadImage(const char *pPath, STestImage *pImage)
+{
+	IOHANDLE File = io_open(pPath, IOFLAG_READ);
+	if(!File)
+		return false;
+	void *pFileData;
+	unsigned FileSize;
+	io_read_all(File, &pFileData, &FileSize);
+	io_close(File);
+
+	TImageByteBuffer ByteBuffer((uint8_t *)pFileData, (uint8_t *)pFileData + FileSize);
+	free(pFileData);
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	int PngliteIncompatible;
+	uint8_t *pImageBuff;
+	EImageFormat Format;
+	if(!LoadPNG(ImageByteBuffer, pPath, PngliteIncompatible, pImage->m_Width, pImage->m_Height, pImageBuff, Format))
+		return false;
+	const bool Rgba = Format == IMAGE_FORMAT_RGBA;
+	if(Rgba)
+	{
+		pImage->m_Name = pPath;
+		pImage->m_vData.assign(pImageBuff, pImageBuff + (size_t)pImage->m_Width * pImage->m_Height * 4);
+	}
+	free(pImageBuff);
+	return Rgba;
+}
+
+#endif // TEST_IMAGE_MANIPULATION_H
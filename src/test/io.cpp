@@ -78,3 +78,46 @@ TEST(Io, SyncWorks)
 	EXPECT_FALSE(io_close(File));
 	EXPECT_FALSE(fs_remove(Info.m_aFilename));
 }
+
+TEST(Io, Mmap)
+{
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_FALSE(io_close(File));
+
+	// empty files can't be mapped
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	unsigned Size = 1;
+	EXPECT_EQ(io_mmap(File, &Size), nullptr);
+	EXPECT_EQ(Size, 0u);
+	EXPECT_FALSE(io_close(File));
+
+	File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_write(File, "hello world", 11), 11u);
+	EXPECT_FALSE(io_close(File));
+
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	char *pData = static_cast<char *>(io_mmap(File, &Size));
+	EXPECT_FALSE(io_close(File));
+	ASSERT_TRUE(pData);
+	ASSERT_EQ(Size, 11u);
+	EXPECT_EQ(mem_comp(pData, "hello world", 11), 0);
+
+	// changes are not written back
+	pData[0] = 'j';
+	EXPECT_EQ(mem_comp(pData, "jello world", 11), 0);
+	io_munmap(pData, Size);
+
+	char aBuf[16];
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_read(File, aBuf, sizeof(aBuf)), 11u);
+	EXPECT_EQ(mem_comp(aBuf, "hello world", 11), 0);
+	EXPECT_FALSE(io_close(File));
+
+	fs_remove(Info.m_aFilename);
+}
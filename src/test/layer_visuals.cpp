@@ -0,0 +1,153 @@
+#include "layer_visuals.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/jobs.h>
+#include <engine/storage.h>
+
+#include <game/client/layer_visuals.h>
+
+#include <memory>
+#include <vector>
+
+static void ExpectSameVisual(STileLayerVisuals::STileVisual Expected, STileLayerVisuals::STileVisual Visual)
+{
+	EXPECT_EQ(Expected.DoDraw(), Visual.DoDraw());
+	EXPECT_EQ(Expected.IndexBufferByteOffset(), Visual.IndexBufferByteOffset());
+}
+
+static void ExpectSamePrepared(const SPreparedLayer &Expected, const SPreparedLayer &Prepared)
+{
+	ASSERT_EQ(Prepared.m_Vertices.m_NumQuads, Expected.m_Vertices.m_NumQuads);
+	ASSERT_EQ(Prepared.m_Vertices.m_DataSize, Expected.m_Vertices.m_DataSize);
+	if(Expected.m_Vertices.m_DataSize > 0)
+	{
+		EXPECT_EQ(mem_comp(Prepared.m_Vertices.m_pData, Expected.m_Vertices.m_pData, Expected.m_Vertices.m_DataSize), 0);
+	}
+	if(!Expected.m_pVisuals)
+		return;
+
+	const STileLayerVisuals &ExpectedVisuals = *Expected.m_pVisuals;
+	const STileLayerVisuals &Visuals = *Prepared.m_pVisuals;
+	ASSERT_EQ(Visuals.m_Width, ExpectedVisuals.m_Width);
+	ASSERT_EQ(Visuals.m_Height, ExpectedVisuals.m_Height);
+	for(unsigned t = 0; t < ExpectedVisuals.m_Width * ExpectedVisuals.m_Height; t++)
+		ExpectSameVisual(ExpectedVisuals.m_pTilesOfLayer[t], Visuals.m_pTilesOfLayer[t]);
+	ExpectSameVisual(ExpectedVisuals.m_BorderTopLeft, Visuals.m_BorderTopLeft);
+	ExpectSameVisual(ExpectedVisuals.m_BorderTopRight, Visuals.m_BorderTopRight);
+	ExpectSameVisual(ExpectedVisuals.m_BorderBottomLeft, Visuals.m_BorderBottomLeft);
+	ExpectSameVisual(ExpectedVisuals.m_BorderBottomRight, Visuals.m_BorderBottomRight);
+	ExpectSameVisual(ExpectedVisuals.m_BorderKillTile, Visuals.m_BorderKillTile);
+	for(unsigned x = 0; x < ExpectedVisuals.m_Width; x++)
+	{
+		ExpectSameVisual(ExpectedVisuals.m_vBorderTop[x], Visuals.m_vBorderTop[x]);
+		ExpectSameVisual(ExpectedVisuals.m_vBorderBottom[x], Visuals.m_vBorderBottom[x]);
+	}
+	for(unsigned y = 0; y < ExpectedVisuals.m_Height; y++)
+	{
+		ExpectSameVisual(ExpectedVisuals.m_vBorderLeft[y], Visuals.m_vBorderLeft[y]);
+		ExpectSameVisual(ExpectedVisuals.m_vBorderRight[y], Visuals.m_vBorderRight[y]);
+	}
+}
+
+static const char *const s_apMaps[] = {"data/maps/Tutorial.map", "data/maps/coverage.map", "data/maps/Sunny Side Up.map", "data/maps/ctf1.map", "data/maps/dm1.map"};
+
+TEST(LayerVisuals, JobPool)
+{
+	CJobPool JobPool;
+	JobPool.Init(4);
+	for(const char *pMap : s_apMaps)
+	{
+		CTestLayerVisuals TestVisuals;
+		ASSERT_TRUE(TestVisuals.Load(pMap)) << pMap;
+
+		// both must give the same buffers
+		const std::vector<SPreparedLayer> vExpected = TestVisuals.Prepare(nullptr);
+		const std::vector<SPreparedLayer> vPrepared = TestVisuals.Prepare(&JobPool);
+
+		ASSERT_EQ(vPrepared.size(), vExpected.size());
+		for(size_t i = 0; i < vExpected.size(); i++)
+		{
+			SCOPED_TRACE(testing::Message() << pMap << " layer " << i);
+			ExpectSamePrepared(vExpected[i], vPrepared[i]);
+			if(!TestVisuals.m_vLayers[i].m_IsTileLayer)
+			{
+				EXPECT_EQ(vPrepared[i].m_Vertices.m_NumQuads, (size_t)TestVisuals.m_vLayers[i].m_NumQuads);
+			}
+		}
+	}
+}
+
+TEST(LayerVisuals, Cache)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	const char *pPath = "cache.layers";
+
+	for(const char *pMap : s_apMaps)
+	{
+		CTestLayerVisuals TestVisuals;
+		ASSERT_TRUE(TestVisuals.Load(pMap)) << pMap;
+
+		const std::vector<SPreparedLayer> vExpected = TestVisuals.Prepare(nullptr);
+		const std::vector<unsigned char> vData = CTestLayerVisuals::SerializeCache(vExpected);
+		IOHANDLE File = pStorage->OpenFile(pPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		EXPECT_EQ(io_write(File, vData.data(), vData.size()), vData.size());
+		io_close(File);
+
+		CTileLayerCache Cache;
+		ASSERT_TRUE(Cache.Load(pStorage.get(), pPath)) << pMap;
+		std::vector<SPreparedLayer> vCached;
+		ASSERT_TRUE(TestVisuals.LoadFromCache(Cache, &vCached)) << pMap;
+		for(size_t i = 0; i < vExpected.size(); i++)
+		{
+			if(!vExpected[i].m_pVisuals)
+				continue;
+			SCOPED_TRACE(testing::Message() << pMap << " layer " << i);
+			ExpectSamePrepared(vExpected[i], vCached[i]);
+		}
+
+		// a layer of a different size doesn't match
+		if(Cache.NumLayers() > 0)
+		{
+			STileLayerVisuals Visuals;
+			Visuals.Init(1, 1);
+			SPreparedLayerVertices Vertices;
+			EXPECT_FALSE(Cache.MatchesLayer(0, Visuals));
+			EXPECT_FALSE(Cache.GetLayer(0, Visuals, &Vertices));
+		}
+
+		// truncated files are rejected
+		Cache.Unload();
+		File = pStorage->OpenFile(pPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		EXPECT_EQ(io_write(File, vData.data(), vData.size() - 1), vData.size() - 1);
+		io_close(File);
+		EXPECT_FALSE(Cache.Load(pStorage.get(), pPath)) << pMap;
+	}
+}
+
+TEST(LayerVisuals, GameLayer)
+{
+	CTestLayerVisuals TestVisuals;
+	ASSERT_TRUE(TestVisuals.Load("data/maps/dm1.map"));
+	const std::vector<SPreparedLayer> vPrepared = TestVisuals.Prepare(nullptr);
+	for(size_t i = 0; i < TestVisuals.m_vLayers.size(); i++)
+	{
+		const SLayer &Layer = TestVisuals.m_vLayers[i];
+		if(!Layer.m_IsTileLayer || Layer.m_Source.m_Type != STileLayerSource::TYPE_GAME)
+			continue;
+
+		// one vertex position and texture coordinate per corner of each
+		// tile, the kill tile is drawn around the map
+		EXPECT_EQ(vPrepared[i].m_Vertices.m_DataSize, vPrepared[i].m_Vertices.m_NumQuads * 4 * (sizeof(float) * 2 + 4));
+		EXPECT_TRUE(vPrepared[i].m_pVisuals->m_BorderKillTile.DoDraw());
+		return;
+	}
+	FAIL() << "no game layer";
+}
@@ -0,0 +1,219 @@
+#ifndef TEST_LAYER_VISUALS_H
+#define TEST_LAYER_VISUALS_H
+
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/jobs.h>
+#include <engine/storage.h>
+
+#include <game/client/layer_visuals.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <memory>
+#include <vector>
+
+// Prepares the visuals of all tile and quad layers of a map without any
+// graphics, one after another or on a job pool like the client does when
+// loading a map.
+
+struct SLayer
+{
+	bool m_IsTileLayer;
+	STileLayerSource m_Source;
+	const CQuad *m_pQuads;
+	int m_NumQuads;
+	bool m_Textured;
+};
+
+struct SPreparedLayer
+{
+	std::unique_ptr<STileLayerVisuals> m_pVisuals;
+	SPreparedLayerVertices m_Vertices;
+
+	~SPreparedLayer() { free(m_Vertices.m_pData); }
+};
+
+inline void PrepareLayer(const SLayer &Layer, SPreparedLayer *pPrepared)
+{
+	if(Layer.m_IsTileLayer)
+		PrepareTileLayerVisuals(*pPrepared->m_pVisuals, Layer.m_Source, &pPrepared->m_Vertices);
+	else
+		PrepareQuadLayerVertices(Layer.m_pQuads, Layer.m_NumQuads, Layer.m_Textured, &pPrepared->m_Vertices);
+}
+
+class CPrepareJob : public IJob
+{
+	const SLayer *m_pLayer;
+	SPreparedLayer *m_pPrepared;
+
+	void Run() override { PrepareLayer(*m_pLayer, m_pPrepared); }
+
+public:
+	CPrepareJob(const SLayer *pLayer, SPreparedLayer *pPrepared) :
+		m_pLayer(pLayer), m_pPrepared(pPrepared) {}
+};
+
+class CTestLayerVisuals
+{
+public:
+	std::unique_ptr<IKernel> m_pKernel;
+	CLayers m_Layers;
+	std::vector<SLayer> m_vLayers;
+
+	bool Load(const char *pMapName)
+	{
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		IEngineMap *pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(CreateLocalStorage());
+		m_pKernel->RegisterInterface(pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+		if(!pMap->Load(pMapName))
+			return false;
+		m_Layers.Init(m_pKernel.get());
+
+		for(int g = 0; g < m_Layers.NumGroups(); g++)
+		{
+			const CMapItemGroup *pGroup = m_Layers.GetGroup(g);
+			for(int l = 0; l < pGroup->m_NumLayers; l++)
+			{
+				CMapItemLayer *pLayer = m_Layers.GetLayer(pGroup->m_StartLayer + l);
+				if(pLayer->m_Type == LAYERTYPE_TILES)
+					AddTileLayer((CMapItemLayerTilemap *)pLayer);
+				else if(pLayer->m_Type == LAYERTYPE_QUADS)
+					AddQuadLayer((CMapItemLayerQuads *)pLayer);
+			}
+		}
+		return true;
+	}
+
+	void AddTileLayer(CMapItemLayerTilemap *pTilemap)
+	{
+		int Type = STileLayerSource::TYPE_DESIGN;
+		int DataIndex = pTilemap->m_Data;
+		if(pTilemap == m_Layers.FrontLayer())
+		{
+			Type = STileLayerSource::TYPE_FRONT;
+			DataIndex = pTilemap->m_Front;
+		}
+		else if(pTilemap == m_Layers.SwitchLayer())
+		{
+			Type = STileLayerSource::TYPE_SWITCH;
+			DataIndex = pTilemap->m_Switch;
+		}
+		else if(pTilemap == m_Layers.TeleLayer())
+		{
+			Type = STileLayerSource::TYPE_TELE;
+			DataIndex = pTilemap->m_Tele;
+		}
+		else if(pTilemap == m_Layers.SpeedupLayer())
+		{
+			Type = STileLayerSource::TYPE_SPEEDUP;
+			DataIndex = pTilemap->m_Speedup;
+		}
+		else if(pTilemap == m_Layers.TuneLayer())
+		{
+			Type = STileLayerSource::TYPE_TUNE;
+			DataIndex = pTilemap->m_Tune;
+		}
+		else if(pTilemap == m_Layers.GameLayer())
+		{
+			Type = STileLayerSource::TYPE_GAME;
+		}
+
+		for(int Overlay = 0; Overlay < STileLayerSource::NumOverlays(Type) + 1; Overlay++)
+		{
+			SLayer Layer;
+			Layer.m_IsTileLayer = true;
+			Layer.m_Source.m_Type = Type;
+			Layer.m_Source.m_pTiles = m_Layers.Map()->GetData(DataIndex);
+			Layer.m_Source.m_Width = pTilemap->m_Width;
+			Layer.m_Source.m_Height = pTilemap->m_Height;
+			Layer.m_Source.m_Overlay = Overlay;
+			Layer.m_Source.m_DoTextureCoords = Type != STileLayerSource::TYPE_DESIGN || pTilemap->m_Image != -1;
+			Layer.m_pQuads = nullptr;
+			Layer.m_NumQuads = 0;
+			Layer.m_Textured = Layer.m_Source.m_DoTextureCoords;
+			m_vLayers.push_back(Layer);
+		}
+	}
+
+	void AddQuadLayer(CMapItemLayerQuads *pQuadLayer)
+	{
+		SLayer Layer;
+		Layer.m_IsTileLayer = false;
+		Layer.m_pQuads = (const CQuad *)m_Layers.Map()->GetDataSwapped(pQuadLayer->m_Data);
+		Layer.m_NumQuads = pQuadLayer->m_NumQuads;
+		Layer.m_Textured = pQuadLayer->m_Image != -1;
+		m_vLayers.push_back(Layer);
+	}
+
+	std::vector<SPreparedLayer> Prepare(CJobPool *pJobPool)
+	{
+		std::vector<SPreparedLayer> vPrepared(m_vLayers.size());
+		std::vector<std::shared_ptr<CPrepareJob>> vpJobs;
+		for(size_t i = 0; i < m_vLayers.size(); i++)
+		{
+			if(m_vLayers[i].m_IsTileLayer)
+			{
+				vPrepared[i].m_pVisuals = std::make_unique<STileLayerVisuals>();
+				vPrepared[i].m_pVisuals->Init(m_vLayers[i].m_Source.m_Width, m_vLayers[i].m_Source.m_Height);
+				vPrepared[i].m_pVisuals->m_IsTextured = m_vLayers[i].m_Source.m_DoTextureCoords;
+			}
+			if(pJobPool)
+			{
+				vpJobs.push_back(std::make_shared<CPrepareJob>(&m_vLayers[i], &vPrepared[i]));
+				pJobPool->Add(vpJobs.back());
+			}
+			else
+			{
+				PrepareLayer(m_vLayers[i], &vPrepared[i]);
+			}
+		}
+		for(auto &pJob : vpJobs)
+		{
+			while(pJob->Status() != IJob::STATE_DONE)
+				thread_yield();
+		}
+		return vPrepared;
+	}
+
+	// the cache file of the prepared tile layers, like the client writes it
+	static std::vector<unsigned char> SerializeCache(const std::vector<SPreparedLayer> &vPrepared)
+	{
+		int NumTileLayers = 0;
+		for(const SPreparedLayer &Prepared : vPrepared)
+			NumTileLayers += Prepared.m_pVisuals != nullptr;
+		std::vector<unsigned char> vData;
+		CTileLayerCache::SerializeHeader(NumTileLayers, &vData);
+		for(const SPreparedLayer &Prepared : vPrepared)
+		{
+			if(Prepared.m_pVisuals)
+				CTileLayerCache::SerializeLayer(*Prepared.m_pVisuals, Prepared.m_Vertices, &vData);
+		}
+		return vData;
+	}
+
+	// copies the tile layers out of the cache, quad layers are left empty
+	bool LoadFromCache(const CTileLayerCache &Cache, std::vector<SPreparedLayer> *pvCached) const
+	{
+		*pvCached = std::vector<SPreparedLayer>(m_vLayers.size());
+		int CacheIndex = 0;
+		for(size_t i = 0; i < m_vLayers.size(); i++)
+		{
+			if(!m_vLayers[i].m_IsTileLayer)
+				continue;
+			SPreparedLayer &Cached = (*pvCached)[i];
+			Cached.m_pVisuals = std::make_unique<STileLayerVisuals>();
+			Cached.m_pVisuals->Init(m_vLayers[i].m_Source.m_Width, m_vLayers[i].m_Source.m_Height);
+			Cached.m_pVisuals->m_IsTextured = m_vLayers[i].m_Source.m_DoTextureCoords;
+			if(!Cache.GetLayer(CacheIndex++, *Cached.m_pVisuals, &Cached.m_Vertices))
+				return false;
+		}
+		return CacheIndex == Cache.NumLayers();
+	}
+};
+
+#endif // TEST_LAYER_VISUALS_H
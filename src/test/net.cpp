@@ -48,3 +48,69 @@ TEST(Net, Ipv4AndIpv6Work)
 	net_udp_close(Socket1);
 	net_udp_close(Socket2);
 }
+
+TEST(Net, BatchedSend)
+{
+	NETADDR Bindaddr = {};
+	NETSOCKET Socket1;
+	NETSOCKET Socket2;
+
+	Bindaddr.type = NETTYPE_IPV4;
+	Socket2 = net_udp_create(Bindaddr);
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!(Socket1 = net_udp_create(Bindaddr)));
+
+	if(net_udp_set_send_batching(Socket2, 1) != 0)
+	{
+		net_udp_close(Socket1);
+		net_udp_close(Socket2);
+		GTEST_SKIP() << "Batched sending is not supported on this platform";
+	}
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	// more packets than fit into the queue at once, but not more than
+	// fit into the receive buffer of the socket
+	const int NUM_PACKETS = 200;
+	for(int i = 0; i < NUM_PACKETS; i++)
+	{
+		char aData[16];
+		str_format(aData, sizeof(aData), "packet %d", i);
+		EXPECT_EQ(net_udp_send(Socket2, &Target, aData, str_length(aData)), str_length(aData));
+	}
+	EXPECT_EQ(net_udp_flush(Socket2), 0);
+
+	NETADDR Addr;
+	unsigned char *pData;
+	int NumReceived = 0;
+	while(NumReceived < NUM_PACKETS + 2)
+	{
+		// several packets are received at once, only wait if there are none left
+		int Bytes = net_udp_recv(Socket1, &Addr, &pData);
+		if(Bytes <= 0)
+		{
+			ASSERT_EQ(net_socket_read_wait(Socket1, 10000000), 1);
+			continue;
+		}
+		char aExpected[16];
+		str_format(aExpected, sizeof(aExpected), "packet %d", NumReceived);
+		ASSERT_EQ(Bytes, str_length(aExpected));
+		EXPECT_EQ(mem_comp(pData, aExpected, Bytes), 0);
+		NumReceived++;
+
+		if(NumReceived == NUM_PACKETS)
+		{
+			// packets are sent immediately again after disabling the queue
+			EXPECT_EQ(net_udp_send(Socket2, &Target, "packet 200", 10), 10);
+			EXPECT_EQ(net_udp_set_send_batching(Socket2, 0), 0);
+			EXPECT_EQ(net_udp_send(Socket2, &Target, "packet 201", 10), 10);
+		}
+	}
+
+	net_udp_close(Socket1);
+	net_udp_close(Socket2);
+}
@@ -0,0 +1,67 @@
+#include "particle_pool.h"
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <game/client/particle_pool.h>
+
+#include <cstdlib>
+#include <vector>
+
+static bool SameFloat(float a, float b)
+{
+	return mem_comp(&a, &b, sizeof(a)) == 0;
+}
+
+TEST_F(ParticlePool, SameAsReference)
+{
+	CParticlePool Pool(1000);
+	std::vector<CParticle> vParticles;
+	for(int Frame = 0; Frame < 500; Frame++)
+	{
+		const int NumAdd = m_Prng.RandomBits() % 40;
+		for(int i = 0; i < NumAdd && Pool.Num() < Pool.Capacity(); i++)
+		{
+			CParticle Particle = RandomParticle();
+			const float Life = Frame % 3 == 0 ? RandomFloat(0.0f, 0.05f) : 0.0f;
+			Particle.m_Life = Life;
+			ASSERT_TRUE(Pool.Add(Particle, Life));
+			vParticles.push_back(Particle);
+		}
+
+		const float TimePassed = RandomFloat(0.001f, 0.05f);
+		const int FrictionCount = m_Prng.RandomBits() % 3;
+		const int Seed = m_Prng.RandomBits() % 10000;
+		srand(Seed);
+		UpdateReference(vParticles, TimePassed, FrictionCount, &m_Collision);
+		srand(Seed);
+		Pool.Update(TimePassed, FrictionCount, &m_Collision);
+
+		ASSERT_EQ(Pool.Num(), (int)vParticles.size()) << Frame;
+		for(int i = 0; i < Pool.Num(); i++)
+		{
+			const CParticle &Particle = vParticles[i];
+			ASSERT_TRUE(SameFloat(Pool.Pos(i).x, Particle.m_Pos.x) && SameFloat(Pool.Pos(i).y, Particle.m_Pos.y)) << Frame << " " << i;
+			ASSERT_TRUE(SameFloat(Pool.Vel(i).x, Particle.m_Vel.x) && SameFloat(Pool.Vel(i).y, Particle.m_Vel.y)) << Frame << " " << i;
+			ASSERT_TRUE(SameFloat(Pool.Rot(i), Particle.m_Rot)) << Frame << " " << i;
+			ASSERT_EQ(Pool.Sprite(i), Particle.m_Spr);
+			const float Age = Particle.m_Life / Particle.m_LifeSpan;
+			ASSERT_TRUE(SameFloat(Pool.Age(i), Age)) << Frame << " " << i;
+			ASSERT_TRUE(SameFloat(Pool.Size(i, Age), mix(Particle.m_StartSize, Particle.m_EndSize, Age)));
+			ASSERT_TRUE(SameFloat(Pool.Alpha(i, Age), Particle.m_UseAlphaFading ? mix(Particle.m_StartAlpha, Particle.m_EndAlpha, Age) : Particle.m_Color.a));
+		}
+	}
+
+	Pool.Reset();
+	EXPECT_EQ(Pool.Num(), 0);
+}
+
+TEST_F(ParticlePool, Full)
+{
+	CParticlePool Pool(16);
+	for(int i = 0; i < 16; i++)
+		EXPECT_TRUE(Pool.Add(RandomParticle(), 0.0f));
+	EXPECT_FALSE(Pool.Add(RandomParticle(), 0.0f));
+	EXPECT_EQ(Pool.Num(), 16);
+}
@@ -0,0 +1,120 @@
+#ifndef TEST_PARTICLE_POOL_H
+#define TEST_PARTICLE_POOL_H
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/client/particle_pool.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/prng.h>
+
+#include <memory>
+#include <vector>
+
+// The update of a particle as it was before the particles were stored in a
+// pool. The pool has to give the same results.
+inline bool UpdateReference(CParticle &Particle, float TimePassed, int FrictionCount, const CCollision *pCollision)
+{
+	Particle.m_Vel.y += Particle.m_Gravity * TimePassed;
+
+	for(int f = 0; f < FrictionCount; f++) // apply friction
+		Particle.m_Vel *= Particle.m_Friction;
+
+	// move the point
+	vec2 Vel = Particle.m_Vel * TimePassed;
+	if(Particle.m_Collides)
+	{
+		pCollision->MovePoint(&Particle.m_Pos, &Vel, random_float(0.1f, 1.0f), NULL);
+	}
+	else
+	{
+		Particle.m_Pos += Vel;
+	}
+	Particle.m_Vel = Vel * (1.0f / TimePassed);
+
+	Particle.m_Life += TimePassed;
+	Particle.m_Rot += TimePassed * Particle.m_Rotspeed;
+
+	// check particle death
+	return Particle.m_Life <= Particle.m_LifeSpan;
+}
+
+inline void UpdateReference(std::vector<CParticle> &vParticles, float TimePassed, int FrictionCount, const CCollision *pCollision)
+{
+	std::vector<bool> vAlive;
+	for(CParticle &Particle : vParticles)
+		vAlive.push_back(UpdateReference(Particle, TimePassed, FrictionCount, pCollision));
+
+	// remove the dead particles in the same order as the pool
+	for(size_t i = 0; i < vParticles.size();)
+	{
+		if(vAlive[i])
+		{
+			i++;
+			continue;
+		}
+		vParticles[i] = vParticles.back();
+		vAlive[i] = vAlive.back();
+		vParticles.pop_back();
+		vAlive.pop_back();
+	}
+}
+
+class ParticlePool : public ::testing::Test
+{
+protected:
+	std::unique_ptr<IKernel> m_pKernel;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	CPrng m_Prng;
+
+	void SetUp() override
+	{
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		IEngineMap *pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(CreateLocalStorage());
+		m_pKernel->RegisterInterface(pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+		ASSERT_TRUE(pMap->Load("data/maps/dm1.map"));
+		m_Layers.Init(m_pKernel.get());
+		m_Collision.Init(&m_Layers);
+
+		uint64_t aSeed[2] = {0x1234, 0x5678};
+		m_Prng.Seed(aSeed);
+	}
+
+	float RandomFloat(float Min, float Max)
+	{
+		return Min + m_Prng.RandomBits() / (float)0xffffffffu * (Max - Min);
+	}
+
+	// particles like the ones of the effects, some of them collide
+	CParticle RandomParticle()
+	{
+		CParticle Particle;
+		Particle.SetDefault();
+		const vec2 Size = vec2(m_Collision.GetWidth(), m_Collision.GetHeight()) * 32.0f;
+		Particle.m_Pos = vec2(RandomFloat(0.0f, Size.x), RandomFloat(0.0f, Size.y));
+		Particle.m_Vel = direction(RandomFloat(0.0f, 2.0f * pi)) * RandomFloat(0.0f, 1000.0f);
+		Particle.m_Spr = m_Prng.RandomBits() % 10;
+		Particle.m_LifeSpan = RandomFloat(0.1f, 1.5f);
+		Particle.m_StartSize = RandomFloat(8.0f, 64.0f);
+		Particle.m_EndSize = 0.0f;
+		Particle.m_UseAlphaFading = m_Prng.RandomBits() % 2;
+		Particle.m_Rot = RandomFloat(0.0f, 2.0f * pi);
+		Particle.m_Rotspeed = RandomFloat(-4.0f, 4.0f);
+		Particle.m_Gravity = RandomFloat(0.0f, 2000.0f);
+		Particle.m_Friction = RandomFloat(0.7f, 1.0f);
+		Particle.m_Collides = m_Prng.RandomBits() % 2;
+		Particle.m_Life = 0.0f;
+		return Particle;
+	}
+};
+
+#endif // TEST_PARTICLE_POOL_H
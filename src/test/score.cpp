@@ -177,6 +177,19 @@ TEST_P(SingleScore, Rank)
 	ExpectLines(m_pPlayerResult, {"nameless tee - 01:40.00 - better than 100% - requested by brainless tee", "Global rank 1"}, true);
 }
 
+TEST_P(SingleScore, StatementCache)
+{
+	g_Config.m_SvRegionalRankings = false;
+	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	const IDbConnection::CPrepareStats Before = m_pConn->PrepareStats();
+	m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult, {"nameless tee - 01:40.00 - better than 100% - requested by brainless tee", "Global rank 1"}, true);
+	// the same query again only reuses the statements of the first one
+	EXPECT_EQ(m_pConn->PrepareStats().m_NumPrepared, Before.m_NumPrepared);
+	EXPECT_GT(m_pConn->PrepareStats().m_NumCached, Before.m_NumCached);
+}
+
 TEST_P(SingleScore, TopServerRegional)
 {
 	g_Config.m_SvRegionalRankings = true;
@@ -525,6 +538,127 @@ TEST_P(Points, EqualPointsTop)
 			"-------------------------------"});
 }
 
+struct ScoreBatch : public Score
+{
+	ScoreBatch()
+	{
+		str_copy(g_Config.m_SvSqlServerName, "USA", sizeof(g_Config.m_SvSqlServerName));
+		str_copy(m_PlayerRequest.m_aMap, "Kobra 3", sizeof(m_PlayerRequest.m_aMap));
+		str_copy(m_PlayerRequest.m_aRequestingPlayer, "brainless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+		m_PlayerRequest.m_Offset = 0;
+	}
+
+	void AddScore(const char *pName, float Time)
+	{
+		auto pScoreData = std::make_unique<CSqlScoreData>(std::make_shared<CScorePlayerResult>());
+		str_copy(pScoreData->m_aMap, "Kobra 3", sizeof(pScoreData->m_aMap));
+		str_copy(pScoreData->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(pScoreData->m_aGameUuid));
+		str_copy(pScoreData->m_aName, pName, sizeof(pScoreData->m_aName));
+		pScoreData->m_ClientID = 0;
+		pScoreData->m_Time = Time;
+		str_copy(pScoreData->m_aTimestamp, "2021-11-24 19:24:08", sizeof(pScoreData->m_aTimestamp));
+		for(int i = 0; i < NUM_CHECKPOINTS; i++)
+			pScoreData->m_aCurrentTimeCp[i] = 0;
+		m_Batch.m_vpScores.push_back(std::move(pScoreData));
+	}
+
+	void AddTeamScore(float Time)
+	{
+		auto pTeamScoreData = std::make_unique<CSqlTeamScoreData>();
+		str_copy(pTeamScoreData->m_aMap, "Kobra 3", sizeof(pTeamScoreData->m_aMap));
+		str_copy(pTeamScoreData->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(pTeamScoreData->m_aGameUuid));
+		pTeamScoreData->m_Size = 2;
+		str_copy(pTeamScoreData->m_aaNames[0], "nameless tee", sizeof(pTeamScoreData->m_aaNames[0]));
+		str_copy(pTeamScoreData->m_aaNames[1], "brainless tee", sizeof(pTeamScoreData->m_aaNames[1]));
+		pTeamScoreData->m_Time = Time;
+		str_copy(pTeamScoreData->m_aTimestamp, "2021-11-24 19:24:08", sizeof(pTeamScoreData->m_aTimestamp));
+		pTeamScoreData->m_TeamrankUuid = RandomUuid();
+		m_Batch.m_vpTeamScores.push_back(std::move(pTeamScoreData));
+	}
+
+	CScorePlayerResult *ScoreResult(int Index)
+	{
+		return dynamic_cast<CScorePlayerResult *>(m_Batch.m_vpScores[Index]->m_pResult.get());
+	}
+
+	CSqlScoreBatch m_Batch;
+};
+
+TEST_P(ScoreBatch, Finishes)
+{
+	AddScore("nameless tee", 100.0);
+	AddScore("brainless tee", 110.0);
+	AddScore("nameless tee", 90.0);
+	AddTeamScore(100.0);
+	AddTeamScore(95.0);
+	EXPECT_EQ(m_Batch.NumItems(), 5);
+	ASSERT_FALSE(CScoreWorker::SaveScores(m_pConn, &m_Batch, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+
+	// only the first finish of a player earns points
+	EXPECT_STREQ(ScoreResult(0)->m_Data.m_aaMessages[0], "You earned 5 points for finishing this map!");
+	EXPECT_STREQ(ScoreResult(1)->m_Data.m_aaMessages[0], "You earned 5 points for finishing this map!");
+	EXPECT_STREQ(ScoreResult(2)->m_Data.m_aaMessages[0], "");
+
+	str_copy(m_PlayerRequest.m_aName, "nameless tee", sizeof(m_PlayerRequest.m_aName));
+	ASSERT_FALSE(CScoreWorker::ShowPoints(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult, {"1. nameless tee Points: 5, requested by brainless tee"}, true);
+
+	m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+	g_Config.m_SvRegionalRankings = false;
+	ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult,
+		{"------------ Global Top ------------",
+			"1. nameless tee Time: 01:30.00",
+			"2. brainless tee Time: 01:50.00",
+			"----------------------------------------"});
+
+	// the second finish of the team improves the rank of the first one
+	m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+	ASSERT_FALSE(CScoreWorker::ShowTeamTop5(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult,
+		{"------- Team Top 5 -------",
+			"1. brainless tee & nameless tee Team Time: 01:35.00",
+			"-------------------------------"});
+
+	m_Batch.SetCompleted(true);
+	for(int i = 0; i < 3; i++)
+	{
+		EXPECT_TRUE(ScoreResult(i)->m_Completed.load());
+		EXPECT_TRUE(ScoreResult(i)->m_Success);
+	}
+}
+
+TEST_P(ScoreBatch, StatementCache)
+{
+	AddScore("nameless tee", 100.0);
+	ASSERT_FALSE(CScoreWorker::SaveScores(m_pConn, &m_Batch, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+	str_copy(m_PlayerRequest.m_aName, "nameless tee", sizeof(m_PlayerRequest.m_aName));
+	g_Config.m_SvRegionalRankings = false;
+	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	const IDbConnection::CPrepareStats Before = m_pConn->PrepareStats();
+
+	// more distinct finish batches than the cache can hold
+	const int NumBatches = 40;
+	for(int i = 0; i < NumBatches; i++)
+	{
+		m_Batch.m_vpScores.clear();
+		AddScore("nameless tee", 99.0f - i);
+		ASSERT_FALSE(CScoreWorker::SaveScores(m_pConn, &m_Batch, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+	}
+
+	// only the inserts with inlined times are prepared again, they don't
+	// evict the other statements of the batch
+	EXPECT_EQ(m_pConn->PrepareStats().m_NumPrepared, Before.m_NumPrepared + NumBatches);
+	EXPECT_GE(m_pConn->PrepareStats().m_NumCached, Before.m_NumCached + NumBatches);
+
+	// statements used before the batches are still cached
+	const IDbConnection::CPrepareStats AfterBatches = m_pConn->PrepareStats();
+	m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(m_pConn->PrepareStats().m_NumPrepared, AfterBatches.m_NumPrepared);
+	EXPECT_GT(m_pConn->PrepareStats().m_NumCached, AfterBatches.m_NumCached);
+}
+
 struct RandomMap : public Score
 {
 	std::shared_ptr<CScoreRandomMapResult> m_pRandomMapResult{std::make_shared<CScoreRandomMapResult>(0)};
@@ -623,4 +757,5 @@ INSTANTIATE(TeamScore);
 INSTANTIATE(MapInfo);
 INSTANTIATE(MapVote);
 INSTANTIATE(Points);
+INSTANTIATE(ScoreBatch);
 INSTANTIATE(RandomMap);
@@ -0,0 +1,179 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/uuid_manager.h>
+#include <engine/storage.h>
+
+#include <game/client/skin_cache.h>
+
+#include <memory>
+#include <vector>
+
+static const int GRID_X = 8;
+static const int GRID_Y = 4;
+
+static void FillSkin(CSkinCacheData *pData)
+{
+	pData->m_DecodedWidth = 250;
+	pData->m_DecodedHeight = 130;
+	pData->m_Info.m_Width = 256;
+	pData->m_Info.m_Height = 128;
+	pData->m_Info.m_Format = CImageInfo::FORMAT_RGBA;
+	const size_t DataSize = (size_t)pData->m_Info.m_Width * pData->m_Info.m_Height * 4;
+	pData->m_Info.m_pData = malloc(DataSize);
+	unsigned char *pPixels = static_cast<unsigned char *>(pData->m_Info.m_pData);
+	for(size_t i = 0; i < DataSize; i++)
+		pPixels[i] = i * 7;
+	pData->m_aBloodColor[0] = 1000;
+	pData->m_aBloodColor[1] = 20000;
+	pData->m_aBloodColor[2] = 300000;
+	pData->m_Metrics.m_Body.m_Width = 90;
+	pData->m_Metrics.m_Body.m_Height = 80;
+	pData->m_Metrics.m_Body.m_OffsetX = 3;
+	pData->m_Metrics.m_Body.m_OffsetY = 4;
+	pData->m_Metrics.m_Body.m_MaxWidth = 96;
+	pData->m_Metrics.m_Body.m_MaxHeight = 96;
+	pData->m_Metrics.m_Feet.m_Width = 60;
+	pData->m_Metrics.m_Feet.m_Height = 30;
+	pData->m_Metrics.m_Feet.m_OffsetX = 2;
+	pData->m_Metrics.m_Feet.m_OffsetY = 1;
+	pData->m_Metrics.m_Feet.m_MaxWidth = 64;
+	pData->m_Metrics.m_Feet.m_MaxHeight = 32;
+}
+
+static void ExpectSameMetrics(const CSkin::SSkinMetricVariable &Expected, const CSkin::SSkinMetricVariable &Metrics)
+{
+	EXPECT_EQ(Metrics.m_Width, Expected.m_Width);
+	EXPECT_EQ(Metrics.m_Height, Expected.m_Height);
+	EXPECT_EQ(Metrics.m_OffsetX, Expected.m_OffsetX);
+	EXPECT_EQ(Metrics.m_OffsetY, Expected.m_OffsetY);
+	EXPECT_EQ(Metrics.m_MaxWidth, Expected.m_MaxWidth);
+	EXPECT_EQ(Metrics.m_MaxHeight, Expected.m_MaxHeight);
+}
+
+static std::vector<unsigned char> ReadAll(IStorage *pStorage, const char *pPath)
+{
+	void *pData;
+	unsigned DataSize;
+	if(!pStorage->ReadFile(pPath, IStorage::TYPE_SAVE, &pData, &DataSize))
+		return {};
+	std::vector<unsigned char> vData(static_cast<unsigned char *>(pData), static_cast<unsigned char *>(pData) + DataSize);
+	free(pData);
+	return vData;
+}
+
+static void WriteAll(IStorage *pStorage, const char *pPath, const unsigned char *pData, unsigned DataSize)
+{
+	IOHANDLE File = pStorage->OpenFile(pPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_write(File, pData, DataSize), DataSize);
+	io_close(File);
+}
+
+TEST(SkinCache, RoundTrip)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	CSkinCacheData Expected;
+	FillSkin(&Expected);
+	ASSERT_TRUE(Expected.Save(pStorage.get(), "test.skin", "default"));
+
+	CSkinCacheData Cached;
+	ASSERT_TRUE(Cached.Load(pStorage.get(), "test.skin", GRID_X, GRID_Y));
+	EXPECT_EQ(Cached.m_DecodedWidth, Expected.m_DecodedWidth);
+	EXPECT_EQ(Cached.m_DecodedHeight, Expected.m_DecodedHeight);
+	ASSERT_EQ(Cached.m_Info.m_Width, Expected.m_Info.m_Width);
+	ASSERT_EQ(Cached.m_Info.m_Height, Expected.m_Info.m_Height);
+	EXPECT_EQ(Cached.m_Info.m_Format, CImageInfo::FORMAT_RGBA);
+	EXPECT_EQ(mem_comp(Cached.m_Info.m_pData, Expected.m_Info.m_pData, (size_t)Expected.m_Info.m_Width * Expected.m_Info.m_Height * 4), 0);
+	for(int i = 0; i < 3; i++)
+		EXPECT_EQ(Cached.m_aBloodColor[i], Expected.m_aBloodColor[i]);
+	ExpectSameMetrics(Expected.m_Metrics.m_Body, Cached.m_Metrics.m_Body);
+	ExpectSameMetrics(Expected.m_Metrics.m_Feet, Cached.m_Metrics.m_Feet);
+
+	// the image has to fit into the sprite grid of the client
+	EXPECT_FALSE(Cached.Load(pStorage.get(), "test.skin", 3, GRID_Y));
+	EXPECT_EQ(Cached.m_Info.m_pData, nullptr);
+	EXPECT_FALSE(Cached.Load(pStorage.get(), "missing.skin", GRID_X, GRID_Y));
+}
+
+TEST(SkinCache, Invalid)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	CSkinCacheData Expected;
+	FillSkin(&Expected);
+	ASSERT_TRUE(Expected.Save(pStorage.get(), "valid.skin", "default"));
+	const std::vector<unsigned char> vValid = ReadAll(pStorage.get(), "valid.skin");
+	ASSERT_GT(vValid.size(), sizeof(CUuid) + 16);
+	CSkinCacheData Cached;
+
+	// truncated in the header and in the image
+	for(unsigned Size : {0u, (unsigned)sizeof(CUuid), (unsigned)sizeof(CUuid) + 10, (unsigned)vValid.size() - 1})
+	{
+		WriteAll(pStorage.get(), "invalid.skin", vValid.data(), Size);
+		EXPECT_FALSE(Cached.Load(pStorage.get(), "invalid.skin", GRID_X, GRID_Y)) << Size;
+		EXPECT_EQ(Cached.m_Info.m_pData, nullptr);
+		EXPECT_EQ(Cached.m_aBloodColor[0], 0);
+	}
+
+	// a different layout
+	std::vector<unsigned char> vCorrupted = vValid;
+	vCorrupted[3] ^= 0xff;
+	WriteAll(pStorage.get(), "invalid.skin", vCorrupted.data(), vCorrupted.size());
+	EXPECT_FALSE(Cached.Load(pStorage.get(), "invalid.skin", GRID_X, GRID_Y));
+
+	// an image size that doesn't match the file size
+	vCorrupted = vValid;
+	vCorrupted[sizeof(CUuid) + 8 + 3] ^= 0x01;
+	WriteAll(pStorage.get(), "invalid.skin", vCorrupted.data(), vCorrupted.size());
+	EXPECT_FALSE(Cached.Load(pStorage.get(), "invalid.skin", GRID_X, GRID_Y));
+
+	// an image size that would overflow
+	vCorrupted = vValid;
+	mem_zero(&vCorrupted[sizeof(CUuid) + 8], 8);
+	vCorrupted[sizeof(CUuid) + 8] = 0x80;
+	vCorrupted[sizeof(CUuid) + 12] = 0x80;
+	WriteAll(pStorage.get(), "invalid.skin", vCorrupted.data(), vCorrupted.size());
+	EXPECT_FALSE(Cached.Load(pStorage.get(), "invalid.skin", GRID_X, GRID_Y));
+
+	EXPECT_TRUE(Cached.Load(pStorage.get(), "valid.skin", GRID_X, GRID_Y));
+}
+
+static int CountFiles(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	if(!IsDir)
+		(*static_cast<int *>(pUser))++;
+	return 0;
+}
+
+TEST(SkinCache, Prune)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	ASSERT_TRUE(pStorage->CreateFolder("skincache", IStorage::TYPE_SAVE));
+	for(const char *pName : {"skincache/1.skin", "skincache/2.skin", "skincache/3.skin", "skincache/4.skin", "skincache/other.txt"})
+		WriteAll(pStorage.get(), pName, nullptr, 0);
+
+	CSkinCacheData::Prune(pStorage.get(), 4);
+	int NumFiles = 0;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "skincache", CountFiles, &NumFiles);
+	EXPECT_EQ(NumFiles, 5);
+
+	// other files in the folder are kept
+	CSkinCacheData::Prune(pStorage.get(), 1);
+	NumFiles = 0;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "skincache", CountFiles, &NumFiles);
+	EXPECT_EQ(NumFiles, 2);
+	EXPECT_TRUE(pStorage->FileExists("skincache/other.txt", IStorage::TYPE_SAVE));
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/snapshot.h>
+
+#include <game/generated/protocol.h>
+
+static int BuildSnapshot(CSnapshot *pSnap, int NumCharacters, int IdOffset)
+{
+	CSnapshotBuilder Builder;
+	// the NETOBJTYPE_EX items of extended types are only added on the
+	// next initialization
+	Builder.Init();
+	Builder.NewItem(NETOBJTYPE_DDNETCHARACTER, 0, sizeof(CNetObj_DDNetCharacter));
+	Builder.Init();
+	for(int i = 0; i < NumCharacters; i++)
+	{
+		const int ID = (i + IdOffset) % 1000;
+		int *pCharacter = (int *)Builder.NewItem(NETOBJTYPE_CHARACTER, ID, sizeof(CNetObj_Character));
+		pCharacter[0] = i;
+		pCharacter[1] = ID * 3;
+		if(i % 4 == 0)
+		{
+			int *pDDNetCharacter = (int *)Builder.NewItem(NETOBJTYPE_DDNETCHARACTER, ID, sizeof(CNetObj_DDNetCharacter));
+			pDDNetCharacter[0] = ID;
+		}
+		if(i % 8 == 0)
+		{
+			int *pProjectile = (int *)Builder.NewItem(NETOBJTYPE_PROJECTILE, ID, sizeof(CNetObj_Projectile));
+			pProjectile[2] = i + IdOffset;
+		}
+	}
+	return Builder.Finish(pSnap);
+}
+
+TEST(Snapshot, ItemIndex)
+{
+	char aData[CSnapshot::MAX_SIZE];
+	CSnapshot *pSnap = (CSnapshot *)aData;
+	BuildSnapshot(pSnap, 400, 0);
+
+	CSnapshotItemIndex Index;
+	Index.Build(pSnap);
+	EXPECT_EQ(Index.Snapshot(), pSnap);
+
+	for(int i = 0; i < pSnap->NumItems(); i++)
+	{
+		EXPECT_EQ(Index.GetItemIndex(pSnap->GetItem(i)->Key()), pSnap->GetItemIndex(pSnap->GetItem(i)->Key()));
+		EXPECT_EQ(Index.GetItemType(i), pSnap->GetItemType(i));
+	}
+	const int aTypes[] = {NETOBJTYPE_CHARACTER, NETOBJTYPE_DDNETCHARACTER, NETOBJTYPE_PROJECTILE, NETOBJTYPE_LASER, NETOBJTYPE_DDNETPLAYER};
+	for(int Type : aTypes)
+	{
+		for(int ID = 0; ID < 1000; ID++)
+		{
+			EXPECT_EQ(Index.FindItem(Type, ID), pSnap->FindItem(Type, ID));
+		}
+	}
+	EXPECT_NE(Index.FindItem(NETOBJTYPE_DDNETCHARACTER, 0), nullptr);
+	EXPECT_EQ(Index.GetItemIndex(0x12345678), -1);
+}
+
+TEST(Snapshot, ItemIndexEmpty)
+{
+	CSnapshotItemIndex Index;
+	Index.Build(CSnapshot::EmptySnapshot());
+	EXPECT_EQ(Index.GetItemIndex(0), -1);
+	EXPECT_EQ(Index.FindItem(NETOBJTYPE_CHARACTER, 0), nullptr);
+	EXPECT_EQ(Index.FindItem(NETOBJTYPE_DDNETCHARACTER, 0), nullptr);
+}
+
+TEST(Snapshot, DeltaRoundTrip)
+{
+	char aFrom[CSnapshot::MAX_SIZE];
+	char aTo[CSnapshot::MAX_SIZE];
+	char aUnpacked[CSnapshot::MAX_SIZE];
+	char aDelta[CSnapshot::MAX_SIZE];
+	CSnapshot *pFrom = (CSnapshot *)aFrom;
+	CSnapshot *pTo = (CSnapshot *)aTo;
+	CSnapshot *pUnpacked = (CSnapshot *)aUnpacked;
+
+	// some items are deleted, some are new and the rest is updated
+	BuildSnapshot(pFrom, 400, 0);
+	BuildSnapshot(pTo, 400, 37);
+
+	CSnapshotDelta Delta;
+	for(const CSnapshot *pBase : {CSnapshot::EmptySnapshot(), (const CSnapshot *)pFrom})
+	{
+		int DeltaSize = Delta.CreateDelta(pBase, pTo, aDelta);
+		ASSERT_GT(DeltaSize, 0);
+		int UnpackedSize = Delta.UnpackDelta(pBase, pUnpacked, aDelta, DeltaSize);
+		ASSERT_GT(UnpackedSize, 0);
+		ASSERT_TRUE(pUnpacked->IsValid(UnpackedSize));
+
+		EXPECT_EQ(pUnpacked->NumItems(), pTo->NumItems());
+		EXPECT_EQ(pUnpacked->Crc(), pTo->Crc());
+		for(int i = 0; i < pTo->NumItems(); i++)
+		{
+			const CSnapshotItem *pItem = pTo->GetItem(i);
+			const int UnpackedIndex = pUnpacked->GetItemIndex(pItem->Key());
+			ASSERT_NE(UnpackedIndex, -1);
+			ASSERT_EQ(pUnpacked->GetItemSize(UnpackedIndex), pTo->GetItemSize(i));
+			EXPECT_EQ(mem_comp(pUnpacked->GetItem(UnpackedIndex)->Data(), pItem->Data(), pTo->GetItemSize(i)), 0);
+		}
+	}
+}
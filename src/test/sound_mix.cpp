@@ -0,0 +1,111 @@
+#include "sound_mix.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/client/sound_mix.h>
+
+#include <limits>
+#include <vector>
+
+TEST(SoundMix, MixVoice)
+{
+	CTestSamples TestSamples;
+	const int aVolumes[] = {0, 1, 127, 255, 32767, -32768, 40000, 255 * 255};
+	for(int Channels = 1; Channels <= 3; Channels++)
+	{
+		for(unsigned Frames = 0; Frames < 40; Frames++)
+		{
+			// start at odd offsets to test unaligned data
+			const int Offset = Frames % 3;
+			const std::vector<short> vIn = TestSamples.Samples((Frames + Offset) * Channels);
+			for(int VolumeL : aVolumes)
+			{
+				for(int VolumeR : aVolumes)
+				{
+					std::vector<int> vExpected(Frames * 2 + 1);
+					for(auto &Value : vExpected)
+						Value = (int)(TestSamples.m_Prng.RandomBits() % 200001) - 100000;
+					std::vector<int> vResult = vExpected;
+					MixVoiceReference(vExpected.data() + 1, vIn.data() + Offset * Channels, Channels, Frames, VolumeL, VolumeR);
+					MixVoice(vResult.data() + 1, vIn.data() + Offset * Channels, Channels, Frames, VolumeL, VolumeR);
+					ASSERT_EQ(vResult, vExpected) << Channels << " " << Frames << " " << VolumeL << " " << VolumeR;
+				}
+			}
+		}
+	}
+}
+
+TEST(SoundMix, ClampMix)
+{
+	CTestSamples TestSamples;
+	// the mix values stay small enough to not overflow when multiplied
+	// with the master volume
+	const int MaxMix = std::numeric_limits<int>::max() / 100;
+	for(unsigned Samples = 0; Samples < 40; Samples++)
+	{
+		for(int MasterVol : {0, 1, 30, 99, 100})
+		{
+			std::vector<int> vMix(Samples + 1);
+			for(unsigned i = 0; i < vMix.size(); i++)
+			{
+				switch(i % 4)
+				{
+				case 0: vMix[i] = (int)(TestSamples.m_Prng.RandomBits() % (2 * MaxMix + 1)) - MaxMix; break;
+				case 1: vMix[i] = (int)(TestSamples.m_Prng.RandomBits() % 20000001) - 10000000; break;
+				case 2: vMix[i] = (int)(TestSamples.m_Prng.RandomBits() % 201) - 100; break;
+				case 3: vMix[i] = i % 8 == 3 ? MaxMix : -MaxMix; break;
+				}
+			}
+			std::vector<short> vExpected(Samples + 1, 0);
+			std::vector<short> vResult(Samples + 1, 0);
+			ClampMixReference(vExpected.data(), vMix.data() + 1, Samples, MasterVol);
+			ClampMix(vResult.data(), vMix.data() + 1, Samples, MasterVol);
+			ASSERT_EQ(vResult, vExpected) << Samples << " " << MasterVol;
+		}
+	}
+}
+
+struct SQueueTest
+{
+	CSpscQueue<int, 64> m_Queue;
+	int m_NumItems;
+};
+
+static void PushItems(void *pUser)
+{
+	SQueueTest *pTest = static_cast<SQueueTest *>(pUser);
+	for(int i = 0; i < pTest->m_NumItems; i++)
+	{
+		while(!pTest->m_Queue.Push(i))
+			thread_yield();
+	}
+}
+
+TEST(SoundMix, SpscQueue)
+{
+	SQueueTest QueueTest;
+	QueueTest.m_NumItems = 100000;
+
+	int Item;
+	EXPECT_FALSE(QueueTest.m_Queue.Pop(&Item));
+	for(int i = 0; i < 64; i++)
+		EXPECT_TRUE(QueueTest.m_Queue.Push(i));
+	EXPECT_FALSE(QueueTest.m_Queue.Push(64));
+	for(int i = 0; i < 64; i++)
+	{
+		ASSERT_TRUE(QueueTest.m_Queue.Pop(&Item));
+		EXPECT_EQ(Item, i);
+	}
+	EXPECT_FALSE(QueueTest.m_Queue.Pop(&Item));
+
+	void *pThread = thread_init(PushItems, &QueueTest, "spsc_queue");
+	for(int i = 0; i < QueueTest.m_NumItems; i++)
+	{
+		while(!QueueTest.m_Queue.Pop(&Item))
+			thread_yield();
+		ASSERT_EQ(Item, i);
+	}
+	thread_wait(pThread);
+	EXPECT_FALSE(QueueTest.m_Queue.Pop(&Item));
+}
@@ -0,0 +1,59 @@
+#ifndef TEST_SOUND_MIX_H
+#define TEST_SOUND_MIX_H
+
+#include <base/math.h>
+
+#include <game/prng.h>
+
+#include <limits>
+#include <vector>
+
+// The scalar loops as they were before the vectorized kernels. The kernels
+// have to give the same results.
+
+inline void MixVoiceReference(int *pOut, const short *pIn, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	const short *pInL = pIn;
+	const short *pInR = Channels == 1 ? pIn : pIn + 1;
+	for(unsigned s = 0; s < Frames; s++)
+	{
+		*pOut++ += (*pInL) * VolumeL;
+		*pOut++ += (*pInR) * VolumeR;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
+inline void ClampMixReference(short *pFinalOut, const int *pMix, unsigned Samples, int MasterVol)
+{
+	for(unsigned i = 0; i < Samples; i++)
+		pFinalOut[i] = clamp<int>(((pMix[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+}
+
+class CTestSamples
+{
+public:
+	CPrng m_Prng;
+
+	CTestSamples()
+	{
+		uint64_t aSeed[2] = {0x1234, 0x5678};
+		m_Prng.Seed(aSeed);
+	}
+
+	std::vector<short> Samples(int Num)
+	{
+		std::vector<short> vSamples(Num);
+		for(auto &Sample : vSamples)
+			Sample = (short)m_Prng.RandomBits();
+		// full scale values
+		if(Num > 1)
+		{
+			vSamples[0] = std::numeric_limits<short>::min();
+			vSamples[Num - 1] = std::numeric_limits<short>::max();
+		}
+		return vSamples;
+	}
+};
+
+#endif // TEST_SOUND_MIX_H
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <game/prng.h>
+#include <game/server/spatial_grid.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+struct STestObject
+{
+	vec2 m_Pos;
+	float m_ProximityRadius;
+	int64_t m_InsertOrder;
+	int m_GridCell = -1;
+	int m_GridSlot = -1;
+};
+
+class SpatialGrid : public ::testing::Test
+{
+protected:
+	static const int MAP_WIDTH = 100;
+	static const int MAP_HEIGHT = 60;
+
+	CPrng m_Prng;
+	CSpatialGrid<STestObject> m_Grid;
+	// newest first, like the entity lists of the game world
+	std::vector<std::unique_ptr<STestObject>> m_vpObjects;
+	int64_t m_NextInsertOrder = 0;
+	int m_NumGridQueries = 0;
+
+	SpatialGrid()
+	{
+		uint64_t aSeed[2] = {0x1234, 0x5678};
+		m_Prng.Seed(aSeed);
+		m_Grid.Init(MAP_WIDTH, MAP_HEIGHT);
+	}
+
+	float RandomFloat(float Min, float Max)
+	{
+		return Min + (Max - Min) * (m_Prng.RandomBits() % 100000) / 100000.0f;
+	}
+
+	// also outside of the map
+	vec2 RandomPos()
+	{
+		return vec2(RandomFloat(-1000.0f, MAP_WIDTH * 32 + 1000.0f), RandomFloat(-1000.0f, MAP_HEIGHT * 32 + 1000.0f));
+	}
+
+	void Insert()
+	{
+		const float aRadii[] = {0.0f, 14.0f, 28.0f};
+		auto pObject = std::make_unique<STestObject>();
+		pObject->m_Pos = RandomPos();
+		pObject->m_ProximityRadius = aRadii[m_Prng.RandomBits() % std::size(aRadii)];
+		pObject->m_InsertOrder = m_NextInsertOrder++;
+		m_Grid.Insert(pObject.get());
+		m_vpObjects.insert(m_vpObjects.begin(), std::move(pObject));
+	}
+
+	void Remove()
+	{
+		const size_t Index = m_Prng.RandomBits() % m_vpObjects.size();
+		m_Grid.Remove(m_vpObjects[Index].get());
+		m_vpObjects.erase(m_vpObjects.begin() + Index);
+	}
+
+	void Move()
+	{
+		STestObject *pObject = m_vpObjects[m_Prng.RandomBits() % m_vpObjects.size()].get();
+		if(m_Prng.RandomBits() % 2)
+			pObject->m_Pos = RandomPos();
+		else
+			pObject->m_Pos += vec2(RandomFloat(-300.0f, 300.0f), RandomFloat(-300.0f, 300.0f));
+		m_Grid.Update(pObject);
+	}
+
+	// the objects a query of CGameWorld::FindEntities finds, from a scan over
+	// all objects or from the grid
+	std::vector<STestObject *> Find(vec2 Pos, float Radius, bool UseGrid)
+	{
+		std::vector<STestObject *> vpCandidates;
+		if(UseGrid && m_Grid.Candidates(Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), vpCandidates))
+			m_NumGridQueries++;
+		else
+		{
+			for(auto &pObject : m_vpObjects)
+				vpCandidates.push_back(pObject.get());
+		}
+
+		std::vector<STestObject *> vpFound;
+		for(STestObject *pObject : vpCandidates)
+		{
+			if(distance(pObject->m_Pos, Pos) < Radius + pObject->m_ProximityRadius)
+				vpFound.push_back(pObject);
+		}
+		return vpFound;
+	}
+
+	void ExpectSameResults()
+	{
+		for(const auto &pObject : m_vpObjects)
+			ASSERT_EQ(pObject->m_GridCell, m_Grid.Cell(pObject->m_Pos));
+
+		for(int i = 0; i < 50; i++)
+		{
+			// around objects, where the queries find something
+			const vec2 Pos = m_vpObjects.empty() || i % 2 ? RandomPos() : m_vpObjects[m_Prng.RandomBits() % m_vpObjects.size()]->m_Pos;
+			const float Radius = RandomFloat(0.0f, i < 40 ? 400.0f : 3000.0f);
+			ASSERT_EQ(Find(Pos, Radius, true), Find(Pos, Radius, false));
+		}
+	}
+};
+
+TEST_F(SpatialGrid, SameAsList)
+{
+	for(int Step = 0; Step < 300; Step++)
+	{
+		const unsigned Op = m_Prng.RandomBits() % 10;
+		if(Op < 4 || m_vpObjects.empty())
+			Insert();
+		else if(Op < 5)
+			Remove();
+		else
+			Move();
+		ExpectSameResults();
+	}
+	// most queries are small enough for the grid
+	EXPECT_GT(m_NumGridQueries, 300 * 50 / 2);
+}
+
+TEST_F(SpatialGrid, Init)
+{
+	for(int i = 0; i < 100; i++)
+		Insert();
+
+	// the game world puts existing entities into the grid when a map is
+	// loaded
+	m_Grid.Init(MAP_WIDTH * 2, MAP_HEIGHT / 2);
+	for(auto &pObject : m_vpObjects)
+	{
+		pObject->m_GridCell = -1;
+		m_Grid.Insert(pObject.get());
+	}
+	ExpectSameResults();
+	EXPECT_GT(m_NumGridQueries, 0);
+}
+
+TEST_F(SpatialGrid, NotInitialized)
+{
+	CSpatialGrid<STestObject> Grid;
+	STestObject Object;
+	Object.m_Pos = vec2(100.0f, 100.0f);
+	Object.m_ProximityRadius = 28.0f;
+	Object.m_InsertOrder = 0;
+	Grid.Insert(&Object);
+	EXPECT_EQ(Object.m_GridCell, -1);
+	Grid.Update(&Object);
+	Grid.Remove(&Object);
+
+	std::vector<STestObject *> vpCandidates;
+	EXPECT_FALSE(Grid.Candidates(vec2(0.0f, 0.0f), vec2(200.0f, 200.0f), vpCandidates));
+	EXPECT_TRUE(vpCandidates.empty());
+}
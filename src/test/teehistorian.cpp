@@ -1,12 +1,24 @@
+#include "test.h"
 #include <gtest/gtest.h>
 
 #include <base/detect.h>
 #include <engine/external/json-parser/json.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
 #include <engine/server.h>
 #include <engine/shared/config.h>
+#include <engine/shared/teehistorian_file.h>
+#include <engine/shared/teehistorian_index.h>
+#include <engine/storage.h>
+#include <game/collision.h>
 #include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/prng.h>
 #include <game/server/teehistorian.h>
+#include <game/teamscore.h>
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 void RegisterGameUuids(CUuidManager *pManager);
@@ -857,3 +869,364 @@ TEST_F(TeeHistorian, PrevGameUuid)
 	EXPECT_STREQ(JsonPrevGameUuid, "fe19c218-f555-4002-a273-126c59ccc17a");
 	json_value_free(pJson);
 }
+
+TEST_F(TeeHistorian, CompressedFile)
+{
+	Tick(1);
+	Player(0, 1, 2);
+	Tick(2);
+	Player(0, 2, 1);
+	Finish();
+
+	CTestInfo Info;
+	CTeeHistorianCompressor Compressor;
+	ASSERT_FALSE(Compressor.Init(6));
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	ASYNCIO *pAio = aio_new_with_write_func(File, CTeeHistorianCompressor::AioWrite, &Compressor);
+	// write in pieces to exercise several deflate calls
+	for(size_t i = 0; i < m_vBuffer.size(); i += 7)
+		aio_write(pAio, m_vBuffer.data() + i, minimum<size_t>(7, m_vBuffer.size() - i));
+	aio_close(pAio);
+	aio_wait(pAio);
+	EXPECT_EQ(aio_error(pAio), 0);
+	aio_free(pAio);
+
+	CTeeHistorianFileReader Reader;
+	ASSERT_FALSE(Reader.Open(io_open(Info.m_aFilename, IOFLAG_READ)));
+	EXPECT_TRUE(Reader.Compressed());
+	std::vector<unsigned char> vRead(m_vBuffer.size() + 16);
+	int Size = 0;
+	int Read;
+	while((Read = Reader.Read(vRead.data() + Size, vRead.size() - Size)) > 0)
+		Size += Read;
+	EXPECT_EQ(Read, 0);
+	vRead.resize(Size);
+	EXPECT_EQ(vRead, m_vBuffer);
+	Reader.Close();
+	fs_remove(Info.m_aFilename);
+}
+
+TEST_F(TeeHistorian, UncompressedFile)
+{
+	Tick(1);
+	Player(0, 1, 2);
+	Finish();
+
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, m_vBuffer.data(), m_vBuffer.size());
+	io_close(File);
+
+	CTeeHistorianFileReader Reader;
+	ASSERT_FALSE(Reader.Open(io_open(Info.m_aFilename, IOFLAG_READ)));
+	EXPECT_FALSE(Reader.Compressed());
+	std::vector<unsigned char> vRead(m_vBuffer.size() + 16);
+	const int Size = Reader.Read(vRead.data(), vRead.size());
+	ASSERT_EQ(Size, (int)m_vBuffer.size());
+	vRead.resize(Size);
+	EXPECT_EQ(vRead, m_vBuffer);
+	Reader.Close();
+	fs_remove(Info.m_aFilename);
+}
+
+static void ExpectSameState(const CTeeHistorianKeyframe &Expected, const CTeeHistorianKeyframe &State)
+{
+	EXPECT_EQ(Expected.m_Tick, State.m_Tick);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CTeeHistorianKeyframe::CPlayer &ExpectedPlayer = Expected.m_aPlayers[i];
+		const CTeeHistorianKeyframe::CPlayer &Player = State.m_aPlayers[i];
+		EXPECT_EQ(ExpectedPlayer.m_Alive, Player.m_Alive) << "cid=" << i;
+		EXPECT_EQ(ExpectedPlayer.m_X, Player.m_X) << "cid=" << i;
+		EXPECT_EQ(ExpectedPlayer.m_Y, Player.m_Y) << "cid=" << i;
+		EXPECT_EQ(ExpectedPlayer.m_Team, Player.m_Team) << "cid=" << i;
+		EXPECT_EQ(ExpectedPlayer.m_HaveInput, Player.m_HaveInput) << "cid=" << i;
+		EXPECT_EQ(mem_comp(ExpectedPlayer.m_aInput, Player.m_aInput, sizeof(Player.m_aInput)), 0) << "cid=" << i;
+		EXPECT_EQ(Expected.m_aTeamPractice[i], State.m_aTeamPractice[i]) << "team=" << i;
+	}
+}
+
+TEST_F(TeeHistorian, Index)
+{
+	std::vector<unsigned char> vIndex;
+	m_TH.EnableIndex(
+		4, [](const void *pData, int DataSize, void *pUser) {
+			WriteBuffer(*(std::vector<unsigned char> *)pUser, pData, DataSize);
+		},
+		&vIndex);
+
+	CNetObj_PlayerInput Input;
+	mem_zero(&Input, sizeof(Input));
+	for(int t = 1; t <= 40; t++)
+	{
+		// no data for a few ticks to get explicit tick skips
+		if(t >= 20 && t < 25)
+			continue;
+		Tick(t);
+		Player(0, t, 2 * t);
+		if(t % 7 == 0)
+			DeadPlayer(1);
+		else
+			Player(1, 100, t / 3);
+		if(t > 10)
+			Player(5, -t, t);
+		Inputs();
+		Input.m_Direction = t % 3 - 1;
+		Input.m_TargetX = t * 10;
+		m_TH.RecordPlayerInput(0, 1, &Input);
+		if(t % 5 == 0)
+			m_TH.RecordPlayerInput(5, 2, &Input);
+		if(t % 9 == 0)
+		{
+			m_TH.RecordPlayerTeam(1, t);
+			m_TH.RecordTeamPractice(t, true);
+		}
+	}
+	Finish();
+
+	CTestInfo Info;
+	char aIndexFilename[IO_MAX_PATH_LENGTH];
+	str_format(aIndexFilename, sizeof(aIndexFilename), "%s.index", Info.m_aFilename);
+	IOHANDLE File = io_open(aIndexFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, vIndex.data(), vIndex.size());
+	io_close(File);
+
+	CTeeHistorianIndex Index;
+	File = io_open(aIndexFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	ASSERT_FALSE(Index.Load(File));
+	io_close(File);
+	fs_remove(aIndexFilename);
+	EXPECT_EQ(Index.GameUuid(), m_GameInfo.m_GameUuid);
+	EXPECT_EQ(Index.KeyframeInterval(), 4);
+	EXPECT_GT(Index.NumKeyframes(), 5);
+
+	CTeeHistorianKeyframe Keyframe;
+	EXPECT_TRUE(Index.Find(0, &Keyframe));
+	ASSERT_FALSE(Index.Find(16, &Keyframe));
+	EXPECT_EQ(Keyframe.m_Tick, 13);
+	// no ticks were recorded in between
+	ASSERT_FALSE(Index.Find(24, &Keyframe));
+	EXPECT_EQ(Keyframe.m_Tick, 17);
+	ASSERT_FALSE(Index.Find(25, &Keyframe));
+	EXPECT_EQ(Keyframe.m_Tick, 25);
+
+	for(int Compressed = 0; Compressed < 2; Compressed++)
+	{
+		File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+		ASSERT_TRUE(File);
+		if(Compressed)
+		{
+			CTeeHistorianCompressor Compressor;
+			ASSERT_FALSE(Compressor.Init(9));
+			ASSERT_FALSE(Compressor.Write(File, m_vBuffer.data(), m_vBuffer.size(), true));
+		}
+		else
+		{
+			io_write(File, m_vBuffer.data(), m_vBuffer.size());
+		}
+		io_close(File);
+
+		// decode everything, remembering the state after every chunk
+		std::vector<int64_t> vOffsets;
+		std::vector<CTeeHistorianKeyframe> vStates;
+		{
+			CTeeHistorianFileReader Reader;
+			ASSERT_FALSE(Reader.Open(io_open(Info.m_aFilename, IOFLAG_READ)));
+			CTeeHistorianDecoder Decoder(&Reader);
+			ASSERT_FALSE(Decoder.ReadHeader());
+			while(true)
+			{
+				vOffsets.push_back(Decoder.Offset());
+				CTeeHistorianDecoder::CChunk Chunk;
+				ASSERT_FALSE(Decoder.ReadChunk(&Chunk));
+				if(Chunk.m_Type == TEEHISTORIAN_FINISH)
+					break;
+				vStates.push_back(Decoder.State());
+			}
+		}
+		ASSERT_EQ(vStates.back().m_Tick, 40);
+
+		// decoding from any keyframe gives the same states
+		for(int i = 0; i < Index.NumKeyframes(); i++)
+		{
+			ASSERT_FALSE(Index.Get(i, &Keyframe));
+			auto It = std::find(vOffsets.begin(), vOffsets.end(), Keyframe.m_Offset);
+			ASSERT_NE(It, vOffsets.end()) << "keyframe " << i << " is not at a chunk boundary";
+			size_t First = It - vOffsets.begin();
+
+			CTeeHistorianFileReader Reader;
+			ASSERT_FALSE(Reader.Open(io_open(Info.m_aFilename, IOFLAG_READ)));
+			CTeeHistorianDecoder Decoder(&Reader);
+			ASSERT_FALSE(Decoder.Seek(Keyframe));
+			for(size_t j = First; j < vStates.size(); j++)
+			{
+				CTeeHistorianDecoder::CChunk Chunk;
+				ASSERT_FALSE(Decoder.ReadChunk(&Chunk));
+				if(j == First)
+				{
+					EXPECT_EQ(Decoder.Tick(), Keyframe.m_Tick);
+				}
+				ExpectSameState(vStates[j], Decoder.State());
+			}
+		}
+	}
+	fs_remove(Info.m_aFilename);
+}
+
+// Replays the inputs of a recorded game with a full server through two
+// worlds, one finding the characters close to each other through the
+// buckets of CWorldCore and one checking all of them. Both must give the
+// same results after every tick.
+TEST_F(TeeHistorian, CharacterBuckets)
+{
+	static const int NUM_TICKS = 500;
+
+	std::unique_ptr<IKernel> pKernel(IKernel::Create());
+	IEngineMap *pMap = CreateEngineMap();
+	pKernel->RegisterInterface(CreateLocalStorage());
+	pKernel->RegisterInterface(pMap);
+	pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+	ASSERT_TRUE(pMap->Load("data/maps/dm1.map"));
+	CLayers Layers;
+	Layers.Init(pKernel.get());
+	CCollision Collision;
+	Collision.Init(&Layers);
+
+	CPrng Prng;
+	uint64_t aSeed[2] = {0x1234, 0x5678};
+	Prng.Seed(aSeed);
+	auto &&RandomFloat = [&](float Max) { return Prng.RandomBits() / (float)0xffffffffu * Max; };
+
+	vec2 aSpawns[MAX_CLIENTS];
+	for(vec2 &Spawn : aSpawns)
+	{
+		do
+		{
+			Spawn = vec2(RandomFloat(Collision.GetWidth() * 32.0f), RandomFloat(Collision.GetHeight() * 32.0f));
+		} while(Collision.TestBox(Spawn, CCharacterCore::PhysicalSizeVec2()));
+	}
+
+	for(int t = 1; t <= NUM_TICKS; t++)
+	{
+		Tick(t);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			Player(i, aSpawns[i].x, aSpawns[i].y);
+		Inputs();
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CNetObj_PlayerInput Input;
+			mem_zero(&Input, sizeof(Input));
+			Input.m_Direction = (int)(Prng.RandomBits() % 3) - 1;
+			Input.m_TargetX = (int)(Prng.RandomBits() % 801) - 400;
+			Input.m_TargetY = (int)(Prng.RandomBits() % 801) - 400;
+			Input.m_Jump = Prng.RandomBits() % 8 == 0;
+			Input.m_Hook = Prng.RandomBits() % 4 != 0;
+			m_TH.RecordPlayerInput(i, i, &Input);
+		}
+	}
+	Finish();
+
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, m_vBuffer.data(), m_vBuffer.size());
+	io_close(File);
+
+	// the players and their inputs at the end of each tick
+	std::vector<CTeeHistorianKeyframe> vTicks;
+	{
+		CTeeHistorianFileReader Reader;
+		ASSERT_FALSE(Reader.Open(io_open(Info.m_aFilename, IOFLAG_READ)));
+		CTeeHistorianDecoder Decoder(&Reader);
+		ASSERT_FALSE(Decoder.ReadHeader());
+		CTeeHistorianKeyframe State = Decoder.State();
+		while(true)
+		{
+			CTeeHistorianDecoder::CChunk Chunk;
+			ASSERT_FALSE(Decoder.ReadChunk(&Chunk));
+			if((Chunk.m_Type == TEEHISTORIAN_FINISH || Decoder.Tick() != State.m_Tick) && State.m_Tick > 0)
+				vTicks.push_back(State);
+			if(Chunk.m_Type == TEEHISTORIAN_FINISH)
+				break;
+			State = Decoder.State();
+		}
+	}
+	fs_remove(Info.m_aFilename);
+	ASSERT_EQ((int)vTicks.size(), NUM_TICKS);
+
+	CTeamsCore Teams;
+	CWorldCore aWorlds[2];
+	CCharacterCore aaCores[2][MAX_CLIENTS];
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		Teams.Team(i, i % 3);
+	Teams.SetSolo(6, true);
+	for(int Impl = 0; Impl < 2; Impl++)
+	{
+		aWorlds[Impl].m_NoCharacterBuckets = Impl == 0;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			const CTeeHistorianKeyframe::CPlayer &Player = vTicks[0].m_aPlayers[i];
+			ASSERT_TRUE(Player.m_Alive);
+			CCharacterCore &Core = aaCores[Impl][i];
+			Core.Init(&aWorlds[Impl], &Collision, &Teams);
+			Core.Reset();
+			Core.m_Id = i;
+			Core.m_Pos = vec2(Player.m_X, Player.m_Y);
+		}
+		aaCores[Impl][5].m_Super = true;
+		aaCores[Impl][6].m_Solo = true;
+		aaCores[Impl][7].m_CollisionDisabled = true;
+		aaCores[Impl][8].m_HookHitDisabled = true;
+	}
+
+	int NumPlayerHooks = 0;
+	for(int t = 0; t < NUM_TICKS; t++)
+	{
+		for(int Impl = 0; Impl < 2; Impl++)
+		{
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				CCharacterCore &Core = aaCores[Impl][i];
+				static_assert(sizeof(Core.m_Input) == sizeof(vTicks[t].m_aPlayers[i].m_aInput), "input size differs");
+				mem_copy(&Core.m_Input, vTicks[t].m_aPlayers[i].m_aInput, sizeof(Core.m_Input));
+				// a player is gone for a few ticks now and then
+				const bool Present = !(i == (t / 50) % MAX_CLIENTS && t % 50 < 10);
+				aWorlds[Impl].m_apCharacters[i] = Present ? &Core : nullptr;
+			}
+			// and others are moved by the game, e.g. by teleporters
+			if(t % 7 == 0)
+				aaCores[Impl][t % MAX_CLIENTS].m_Pos = aaCores[Impl][(t * 5 + 1) % MAX_CLIENTS].m_Pos + vec2(40.0f, 0.0f);
+
+			for(CCharacterCore *pCore : aWorlds[Impl].m_apCharacters)
+				if(pCore)
+					pCore->Tick(true);
+			for(CCharacterCore *pCore : aWorlds[Impl].m_apCharacters)
+			{
+				if(pCore)
+				{
+					pCore->Move();
+					pCore->Quantize();
+				}
+			}
+		}
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			const CCharacterCore &Core0 = aaCores[0][i];
+			const CCharacterCore &Core1 = aaCores[1][i];
+			ASSERT_EQ(Core0.m_Pos, Core1.m_Pos) << "tick " << t << " character " << i;
+			ASSERT_EQ(Core0.m_Vel, Core1.m_Vel) << "tick " << t << " character " << i;
+			ASSERT_EQ(Core0.m_HookPos, Core1.m_HookPos) << "tick " << t << " character " << i;
+			ASSERT_EQ(Core0.m_HookState, Core1.m_HookState) << "tick " << t << " character " << i;
+			ASSERT_EQ(Core0.HookedPlayer(), Core1.HookedPlayer()) << "tick " << t << " character " << i;
+			ASSERT_EQ(Core0.m_TriggeredEvents, Core1.m_TriggeredEvents) << "tick " << t << " character " << i;
+			if(Core0.m_TriggeredEvents & COREEVENT_HOOK_ATTACH_PLAYER)
+				NumPlayerHooks++;
+		}
+	}
+	EXPECT_GT(NumPlayerHooks, 0);
+}
@@ -59,6 +59,11 @@ public:
 		{
 			return m_IsDirectory < Other.m_IsDirectory;
 		}
+		// subdirectories have to be removed before their parents
+		if(m_IsDirectory)
+		{
+			return str_comp(m_aData, Other.m_aData) > 0;
+		}
 		return str_comp(m_aData, Other.m_aData) < 0;
 	}
 };
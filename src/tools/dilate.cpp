@@ -5,8 +5,11 @@
 #include <engine/gfx/image_loader.h>
 #include <engine/gfx/image_manipulation.h>
 #include <engine/graphics.h>
+#include <engine/shared/jobs.h>
 
-int DilateFile(const char *pFilename)
+#include <thread>
+
+int DilateFile(const char *pFilename, CJobPool *pJobPool)
 {
 	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
 	if(File)
@@ -43,7 +46,7 @@ int DilateFile(const char *pFilename)
 			int w = Img.m_Width;
 			int h = Img.m_Height;
 
-			DilateImage(pBuffer, w, h);
+			DilateImage(pBuffer, w, h, pJobPool);
 
 			// save here
 			IOHANDLE SaveFile = io_open(pFilename, IOFLAG_WRITE);
@@ -84,8 +87,10 @@ int main(int argc, const char **argv)
 		return -1;
 	}
 
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
 	for(int i = 1; i < argc; i++)
-		DilateFile(argv[i]);
+		DilateFile(argv[i], &JobPool);
 
 	return 0;
 }
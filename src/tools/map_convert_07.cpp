@@ -6,9 +6,12 @@
 #include <engine/gfx/image_loader.h>
 #include <engine/graphics.h>
 #include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 #include <game/gamecore.h>
 #include <game/mapitems.h>
+
+#include <thread>
 /*
 	Usage: map_convert_07 <source map filepath> <dest map filepath>
 */
@@ -255,6 +258,8 @@ int main(int argc, const char **argv)
 	}
 
 	g_DataReader.Close();
-	g_DataWriter.Finish();
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
+	g_DataWriter.Finish(&JobPool);
 	return Success ? 0 : -1;
 }
@@ -4,8 +4,10 @@
 #include <cstdint>
 #include <engine/gfx/image_manipulation.h>
 #include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 #include <game/mapitems.h>
+#include <thread>
 #include <vector>
 
 void ClearTransparentPixels(uint8_t *pImg, int Width, int Height)
@@ -206,6 +208,9 @@ int main(int argc, const char **argv)
 		Writer.AddItem(Type, ID, Size, pPtr);
 	}
 
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
+
 	// add all data
 	for(int Index = 0; Index < Reader.NumData(); Index++)
 	{
@@ -274,12 +279,12 @@ int main(int argc, const char **argv)
 							int ImgTileH = Height / 16;
 							int x = (i % 16) * ImgTileW;
 							int y = (i / 16) * ImgTileH;
-							DilateImageSub(pImgBuff, Width, Height, x, y, ImgTileW, ImgTileH);
+							DilateImageSub(pImgBuff, Width, Height, x, y, ImgTileW, ImgTileH, &JobPool);
 						}
 					}
 					else
 					{
-						DilateImage(pImgBuff, Width, Height);
+						DilateImage(pImgBuff, Width, Height, &JobPool);
 					}
 				}
 			}
@@ -313,7 +318,7 @@ int main(int argc, const char **argv)
 	}
 
 	Reader.Close();
-	Writer.Finish();
+	Writer.Finish(&JobPool);
 
 	return 0;
 }
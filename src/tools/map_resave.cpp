@@ -2,8 +2,11 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
 #include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 
+#include <thread>
+
 int main(int argc, const char **argv)
 {
 	CCmdlineFix CmdlineFix(&argc, &argv);
@@ -43,6 +46,8 @@ int main(int argc, const char **argv)
 	}
 
 	Reader.Close();
-	Writer.Finish();
+	CJobPool JobPool;
+	JobPool.Init(std::thread::hardware_concurrency());
+	Writer.Finish(&JobPool);
 	return 0;
 }
@@ -0,0 +1,61 @@
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/shared/teehistorian_file.h>
+
+static const char *TOOL_NAME = "teehistorian_decode";
+
+// writes the uncompressed contents of a teehistorian file, regardless of
+// whether it was recorded compressed or not
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(argc != 3)
+	{
+		dbg_msg(TOOL_NAME, "Usage: %s <input.teehistorian[.gz]> <output.teehistorian>", argv[0]);
+		return -1;
+	}
+
+	IOHANDLE InputFile = io_open(argv[1], IOFLAG_READ);
+	if(!InputFile)
+	{
+		dbg_msg(TOOL_NAME, "failed to open '%s'", argv[1]);
+		return -1;
+	}
+	CTeeHistorianFileReader Reader;
+	if(Reader.Open(InputFile))
+	{
+		dbg_msg(TOOL_NAME, "failed to read '%s'", argv[1]);
+		return -1;
+	}
+
+	IOHANDLE OutputFile = io_open(argv[2], IOFLAG_WRITE);
+	if(!OutputFile)
+	{
+		dbg_msg(TOOL_NAME, "failed to open '%s' for writing", argv[2]);
+		return -1;
+	}
+
+	int64_t Total = 0;
+	int Result = 0;
+	while(true)
+	{
+		unsigned char aBuf[64 * 1024];
+		const int Size = Reader.Read(aBuf, sizeof(aBuf));
+		if(Size < 0)
+		{
+			dbg_msg(TOOL_NAME, "'%s' is corrupted or truncated after %" PRId64 " bytes", argv[1], Total);
+			Result = -1;
+			break;
+		}
+		if(Size == 0)
+			break;
+		io_write(OutputFile, aBuf, Size);
+		Total += Size;
+	}
+	io_close(OutputFile);
+
+	dbg_msg(TOOL_NAME, "wrote %" PRId64 " bytes of %s teehistorian data to '%s'", Total, Reader.Compressed() ? "compressed" : "uncompressed", argv[2]);
+	return Result;
+}
@@ -0,0 +1,170 @@
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/external/json-parser/json.h>
+#include <engine/shared/teehistorian_file.h>
+#include <engine/shared/teehistorian_index.h>
+
+static const char *TOOL_NAME = "teehistorian_seek";
+
+static void PrintState(const CTeeHistorianKeyframe &State, int Tick)
+{
+	dbg_msg(TOOL_NAME, "state at tick %d:", Tick);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CTeeHistorianKeyframe::CPlayer &Player = State.m_aPlayers[i];
+		if(!Player.m_Alive && !Player.m_HaveInput)
+			continue;
+		const int *pInput = Player.m_aInput;
+		char aPos[64];
+		if(Player.m_Alive)
+			str_format(aPos, sizeof(aPos), "x=%d y=%d", Player.m_X, Player.m_Y);
+		else
+			str_copy(aPos, "dead");
+		const bool Practice = Player.m_Team >= 0 && Player.m_Team < MAX_CLIENTS && State.m_aTeamPractice[Player.m_Team];
+		dbg_msg(TOOL_NAME, "  cid=%d %s team=%d%s dir=%d target=%d,%d jump=%d fire=%d hook=%d flags=%d weapon=%d", i, aPos,
+			Player.m_Team, Practice ? " (practice)" : "",
+			pInput[0], pInput[1], pInput[2], pInput[3], pInput[4], pInput[5], pInput[6], pInput[7]);
+	}
+}
+
+static void PrintChunk(const CTeeHistorianDecoder::CChunk &Chunk, const CTeeHistorianKeyframe &State)
+{
+	switch(Chunk.m_Type)
+	{
+	case CTeeHistorianDecoder::CHUNK_PLAYER_DIFF:
+	case TEEHISTORIAN_PLAYER_NEW:
+		dbg_msg(TOOL_NAME, "  player cid=%d x=%d y=%d", Chunk.m_ClientID, State.m_aPlayers[Chunk.m_ClientID].m_X, State.m_aPlayers[Chunk.m_ClientID].m_Y);
+		break;
+	case TEEHISTORIAN_PLAYER_OLD:
+		dbg_msg(TOOL_NAME, "  player_old cid=%d", Chunk.m_ClientID);
+		break;
+	case TEEHISTORIAN_INPUT_DIFF:
+	case TEEHISTORIAN_INPUT_NEW:
+	{
+		const int *pInput = State.m_aPlayers[Chunk.m_ClientID].m_aInput;
+		dbg_msg(TOOL_NAME, "  input cid=%d dir=%d target=%d,%d jump=%d fire=%d hook=%d", Chunk.m_ClientID,
+			pInput[0], pInput[1], pInput[2], pInput[3], pInput[4], pInput[5]);
+		break;
+	}
+	case TEEHISTORIAN_MESSAGE:
+		dbg_msg(TOOL_NAME, "  message cid=%d size=%d", Chunk.m_ClientID, Chunk.m_DataSize);
+		break;
+	case TEEHISTORIAN_JOIN:
+		dbg_msg(TOOL_NAME, "  join cid=%d", Chunk.m_ClientID);
+		break;
+	case TEEHISTORIAN_DROP:
+		dbg_msg(TOOL_NAME, "  drop cid=%d reason='%s'", Chunk.m_ClientID, Chunk.m_pString);
+		break;
+	case TEEHISTORIAN_CONSOLE_COMMAND:
+		dbg_msg(TOOL_NAME, "  console_command cid=%d '%s'", Chunk.m_ClientID, Chunk.m_pString);
+		break;
+	case TEEHISTORIAN_EX:
+	{
+		char aUuid[UUID_MAXSTRSIZE];
+		FormatUuid(Chunk.m_Uuid, aUuid, sizeof(aUuid));
+		dbg_msg(TOOL_NAME, "  ex uuid=%s size=%d", aUuid, Chunk.m_DataSize);
+		break;
+	}
+	}
+}
+
+// jumps to a tick of a teehistorian file using its index and prints the
+// chunks recorded in that tick and the player state at its end
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(argc != 4)
+	{
+		dbg_msg(TOOL_NAME, "Usage: %s <input.teehistorian[.gz]> <input.teehistorian.index> <tick>", argv[0]);
+		return -1;
+	}
+	const int Tick = str_toint(argv[3]);
+
+	IOHANDLE IndexFile = io_open(argv[2], IOFLAG_READ);
+	if(!IndexFile)
+	{
+		dbg_msg(TOOL_NAME, "failed to open '%s'", argv[2]);
+		return -1;
+	}
+	CTeeHistorianIndex Index;
+	const bool IndexError = Index.Load(IndexFile);
+	io_close(IndexFile);
+	if(IndexError)
+	{
+		dbg_msg(TOOL_NAME, "failed to read index '%s'", argv[2]);
+		return -1;
+	}
+
+	IOHANDLE InputFile = io_open(argv[1], IOFLAG_READ);
+	if(!InputFile)
+	{
+		dbg_msg(TOOL_NAME, "failed to open '%s'", argv[1]);
+		return -1;
+	}
+	CTeeHistorianFileReader Reader;
+	if(Reader.Open(InputFile))
+	{
+		dbg_msg(TOOL_NAME, "failed to read '%s'", argv[1]);
+		return -1;
+	}
+	CTeeHistorianDecoder Decoder(&Reader);
+	if(Decoder.ReadHeader())
+	{
+		dbg_msg(TOOL_NAME, "'%s' is not a teehistorian file", argv[1]);
+		return -1;
+	}
+
+	char aIndexGameUuid[UUID_MAXSTRSIZE];
+	FormatUuid(Index.GameUuid(), aIndexGameUuid, sizeof(aIndexGameUuid));
+	json_value *pHeader = json_parse(Decoder.Header(), str_length(Decoder.Header()));
+	const bool SameGame = pHeader && (*pHeader)["game_uuid"].type == json_string && str_comp((*pHeader)["game_uuid"], aIndexGameUuid) == 0;
+	json_value_free(pHeader);
+	if(!SameGame)
+	{
+		dbg_msg(TOOL_NAME, "index '%s' belongs to a different game", argv[2]);
+		return -1;
+	}
+
+	CTeeHistorianKeyframe Keyframe;
+	if(!Index.Find(Tick, &Keyframe))
+	{
+		dbg_msg(TOOL_NAME, "starting at keyframe of tick %d, offset %" PRId64 " (%d keyframes)", Keyframe.m_Tick, Keyframe.m_Offset, Index.NumKeyframes());
+		if(Decoder.Seek(Keyframe))
+		{
+			dbg_msg(TOOL_NAME, "failed to seek to offset %" PRId64, Keyframe.m_Offset);
+			return -1;
+		}
+	}
+	else
+	{
+		dbg_msg(TOOL_NAME, "no keyframe before tick %d, starting at the beginning", Tick);
+	}
+
+	// the state at the end of the tick is the one before the first chunk
+	// of a later tick
+	CTeeHistorianKeyframe State = Decoder.State();
+	while(true)
+	{
+		CTeeHistorianDecoder::CChunk Chunk;
+		if(Decoder.ReadChunk(&Chunk))
+		{
+			dbg_msg(TOOL_NAME, "'%s' is corrupted or truncated at offset %" PRId64, argv[1], Decoder.Offset());
+			return -1;
+		}
+		if(Chunk.m_Type == TEEHISTORIAN_FINISH)
+		{
+			if(State.m_Tick < Tick)
+				dbg_msg(TOOL_NAME, "game ended at tick %d", State.m_Tick);
+			break;
+		}
+		if(Decoder.Tick() > Tick)
+			break;
+		if(Decoder.Tick() == Tick)
+			PrintChunk(Chunk, Decoder.State());
+		State = Decoder.State();
+	}
+	PrintState(State, Tick);
+	return 0;
+}